@@ -0,0 +1,67 @@
+/*
+ * Compares the throughput of SeqReader's native BAM decoding with the
+ * samtools based SAM path on the same alignments. The samtools path is only
+ * measured if samtools is available.
+ * Usage: bam_reader [bam] [repeats] [threads]
+ */
+
+#include "btllib/seq_reader.hpp"
+#include "btllib/util.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+static void
+run(const std::string& label,
+    const std::string& path,
+    const size_t repeats,
+    const unsigned threads)
+{
+  size_t records = 0, bases = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < repeats; i++) {
+    btllib::SeqReader reader(
+      path, btllib::SeqReader::Flag::SHORT_MODE, threads);
+    for (const auto record : reader) {
+      records++;
+      bases += record.seq.size();
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << label << '\t' << records << '\t' << std::fixed
+            << std::setprecision(3) << elapsed.count() << '\t'
+            << std::setprecision(0) << double(records) / elapsed.count()
+            << '\t' << double(bases) / elapsed.count() << '\n';
+}
+
+int
+main(int argc, char** argv)
+{
+  const std::string bam =
+    argc > 1 ? argv[1]
+             : btllib::get_dirname(__FILE__) + "/../tests/large.bam";
+  const size_t repeats = argc > 2 ? std::stoul(argv[2]) : 100;
+  const unsigned threads = argc > 3 ? std::stoul(argv[3]) : 3;
+
+  std::cout << "path\trecords\tseconds\trecords_per_s\tbases_per_s\n";
+  run("native", bam, repeats, threads);
+
+  // NOLINTNEXTLINE(concurrency-mt-unsafe)
+  if (std::system("command -v samtools > /dev/null 2>&1") == 0) {
+    const std::string sam = bam + ".benchmark.sam";
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    if (std::system(("samtools view -h " + bam + " > " + sam).c_str()) == 0) {
+      run("samtools", sam, repeats, threads);
+    }
+    std::remove(sam.c_str());
+  } else {
+    std::cerr << "samtools not found, skipping the samtools path.\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Compares the throughput of Indexlr without filters and with a selective
+ * filter-in Bloom filter, which rejects most k-mers, for increasing window
+ * sizes. Filtering should cost about the same for every window size.
+ * Usage: indexlr [reads] [read_length] [threads]
+ */
+
+#include "btllib/bloom_filter.hpp"
+#include "btllib/indexlr.hpp"
+#include "btllib/nthash.hpp"
+#include "btllib/random_seq_generator.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+static const unsigned K = 32;
+// One in this many k-mers passes the filter
+static const uint64_t SELECTIVITY = 100;
+
+static void
+run(const std::string& label,
+    const std::string& path,
+    const size_t w,
+    const unsigned threads,
+    const btllib::BloomFilter* filter_in_bf)
+{
+  const auto start = std::chrono::steady_clock::now();
+  size_t minimizers = 0;
+  if (filter_in_bf != nullptr) {
+    btllib::Indexlr indexlr(path,
+                            K,
+                            w,
+                            btllib::Indexlr::Flag::FILTER_IN |
+                              btllib::Indexlr::Flag::SHORT_MODE,
+                            threads,
+                            false,
+                            *filter_in_bf);
+    for (const auto record : indexlr) {
+      minimizers += record.minimizers.size();
+    }
+  } else {
+    btllib::Indexlr indexlr(
+      path, K, w, btllib::Indexlr::Flag::SHORT_MODE, threads);
+    for (const auto record : indexlr) {
+      minimizers += record.minimizers.size();
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << label << '\t' << w << '\t' << minimizers << '\t' << std::fixed
+            << std::setprecision(3) << elapsed.count() << '\n';
+}
+
+int
+main(int argc, char** argv)
+{
+  const size_t reads = argc > 1 ? std::stoul(argv[1]) : 200;
+  const size_t read_length = argc > 2 ? std::stoul(argv[2]) : 50000;
+  const unsigned threads = argc > 3 ? std::stoul(argv[3]) : 3;
+
+  const std::string path =
+    "indexlr_benchmark_" + std::to_string(getpid()) + ".fa";
+  btllib::RandomSequenceGenerator generator(
+    btllib::RandomSequenceGenerator::SequenceType::DNA,
+    btllib::RandomSequenceGenerator::Masking::NONE,
+    42);
+  btllib::BloomFilter filter_in_bf(size_t(reads) * read_length, 1);
+  {
+    std::ofstream ofs(path);
+    for (size_t i = 0; i < reads; i++) {
+      const auto seq = generator.generate(read_length);
+      ofs << '>' << i << '\n' << seq << '\n';
+      for (btllib::NtHash nh(seq, 1, K); nh.roll();) {
+        if (nh.hashes()[0] % SELECTIVITY == 0) {
+          filter_in_bf.insert(nh.hashes());
+        }
+      }
+    }
+  }
+
+  std::cout << "filter\tw\tminimizers\tseconds\n";
+  for (const size_t w : { 10, 100, 1000, 10000 }) {
+    run("none", path, w, threads, nullptr);
+    run("filter_in", path, w, threads, &filter_in_bf);
+  }
+
+  std::remove(path.c_str());
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Compares the throughput of the mutex based OrderQueueMPMC and
+ * OrderQueueLockFree with the same number of producer and consumer threads.
+ * Usage: order_queue [blocks] [max_threads]
+ */
+
+#include "btllib/order_queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t QUEUE_SIZE = 32;
+static const size_t BLOCK_SIZE = 32;
+
+template<typename Queue>
+static double
+run(const size_t blocks, const unsigned threads)
+{
+  Queue queue(QUEUE_SIZE, BLOCK_SIZE);
+  std::atomic<size_t> next_write{ 0 }, next_read{ 0 };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::unique_ptr<std::thread>> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    workers.push_back(std::unique_ptr<std::thread>(new std::thread([&]() {
+      typename Queue::Block block(BLOCK_SIZE);
+      size_t num;
+      while ((num = next_write++) < blocks) {
+        block.num = num;
+        block.count = BLOCK_SIZE;
+        queue.write(block);
+      }
+    })));
+    workers.push_back(std::unique_ptr<std::thread>(new std::thread([&]() {
+      typename Queue::Block block(BLOCK_SIZE);
+      while (next_read++ < blocks) {
+        queue.read(block);
+      }
+    })));
+  }
+  for (auto& worker : workers) {
+    worker->join();
+  }
+  const std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  return double(blocks) / elapsed.count();
+}
+
+int
+main(int argc, char** argv)
+{
+  const size_t blocks = argc > 1 ? std::stoul(argv[1]) : 200000;
+  const unsigned max_threads = argc > 2 ? std::stoul(argv[2]) : 128;
+
+  std::cout << "threads\tmutex_blocks_per_s\tlockfree_blocks_per_s\tspeedup\n";
+  for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+    const auto mutex_rate =
+      run<btllib::OrderQueueMPMC<unsigned char>>(blocks, threads);
+    const auto lockfree_rate =
+      run<btllib::OrderQueueLockFree<unsigned char>>(blocks, threads);
+    std::cout << threads << '\t' << std::fixed << std::setprecision(0)
+              << mutex_rate << '\t' << lockfree_rate << '\t'
+              << std::setprecision(2) << lockfree_rate / mutex_rate << '\n';
+  }
+
+  return 0;
+}
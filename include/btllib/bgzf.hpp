@@ -0,0 +1,217 @@
+/**
+ * Utilities for BGZF (blocked gzip) files, as produced by bgzip and used by
+ * BAM files and compressed indexed FASTA/FASTQ files.
+ */
+#ifndef BTLLIB_BGZF_HPP
+#define BTLLIB_BGZF_HPP
+
+#include "btllib/executor.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace btllib {
+
+/** Maximum size of a BGZF block, both compressed and uncompressed. */
+static const size_t BGZF_MAX_BLOCK_SIZE = 65536;
+
+/** Size of the BGZF block header, including the BC extra subfield. */
+static const size_t BGZF_HEADER_SIZE = 18;
+
+/** Size of the BGZF block footer (CRC32 and ISIZE). */
+static const size_t BGZF_FOOTER_SIZE = 8;
+
+/** Location of a single BGZF block within the compressed and uncompressed
+ * streams. */
+struct BgzfBlock
+{
+  uint64_t coffset = 0;
+  uint64_t uoffset = 0;
+  uint32_t csize = 0;
+  uint32_t usize = 0;
+};
+
+/**
+ * Check whether a buffer starts with a BGZF block header.
+ *
+ * @param data Buffer to check.
+ * @param size Number of bytes in the buffer.
+ *
+ * @return Whether the buffer holds a BGZF block header.
+ */
+bool
+is_bgzf(const char* data, size_t size);
+
+/**
+ * Check whether a file is BGZF compressed.
+ *
+ * @param path Path to the file.
+ *
+ * @return Whether the file starts with a BGZF block header.
+ */
+bool
+is_bgzf(const std::string& path);
+
+/**
+ * Parse the total block size from a BGZF block header.
+ *
+ * @param header At least BGZF_HEADER_SIZE bytes of a block header.
+ *
+ * @return Total size of the block, including the header and footer.
+ */
+uint32_t
+bgzf_block_csize(const char* header);
+
+/**
+ * Parse the uncompressed size from a BGZF block footer.
+ *
+ * @param block A whole BGZF block.
+ * @param csize Total size of the block.
+ *
+ * @return Uncompressed size of the block data.
+ */
+uint32_t
+bgzf_block_usize(const char* block, uint32_t csize);
+
+/**
+ * Decompress a whole BGZF block.
+ *
+ * @param block A whole BGZF block, including the header and footer.
+ * @param csize Total size of the block.
+ * @param out Output buffer, at least BGZF_MAX_BLOCK_SIZE bytes long.
+ *
+ * @return Number of decompressed bytes.
+ */
+size_t
+bgzf_inflate_block(const char* block, uint32_t csize, char* out);
+
+/**
+ * Compress data into a single BGZF block.
+ *
+ * @param data Data to compress, at most BGZF_MAX_BLOCK_SIZE - 1024 bytes so
+ * that incompressible data still fits in a block.
+ * @param size Number of bytes to compress.
+ * @param out Output buffer, at least BGZF_MAX_BLOCK_SIZE bytes long.
+ * @param level zlib compression level.
+ *
+ * @return Total size of the block, including the header and footer.
+ */
+size_t
+bgzf_deflate_block(const char* data, size_t size, char* out, int level = 6);
+
+/**
+ * Find all BGZF blocks in a file by walking the block headers, without
+ * decompressing the data.
+ *
+ * @param fd File descriptor of a BGZF file.
+ *
+ * @return Locations of all blocks in the file, in order.
+ */
+std::vector<BgzfBlock>
+scan_bgzf_blocks(int fd);
+
+/**
+ * Load a bgzip compatible .gzi index.
+ *
+ * @param gzi_path Path to the .gzi file.
+ * @param fd File descriptor of the BGZF file the index belongs to. The blocks
+ * from the last indexed one on, whose sizes the index does not store, are
+ * read from their headers.
+ *
+ * @return Locations of all blocks in the file, in order.
+ */
+std::vector<BgzfBlock>
+load_gzi(const std::string& gzi_path, int fd);
+
+/**
+ * Save a bgzip compatible .gzi index.
+ *
+ * @param gzi_path Path to write the index to.
+ * @param blocks Locations of all blocks in the file, in order.
+ */
+void
+save_gzi(const std::string& gzi_path, const std::vector<BgzfBlock>& blocks);
+
+/**
+ * Sequential reader of a BGZF stream. The thread calling read() splits the
+ * stream into chunks of BGZF blocks, which are inflated in parallel on the
+ * shared Executor and handed back to the caller in order. The reader starts
+ * no threads of its own.
+ */
+class BgzfReader
+{
+public:
+  /**
+   * Construct a BgzfReader.
+   *
+   * @param source Stream to read compressed data from.
+   * @param prefix Compressed data already read from the stream, which comes
+   * before the rest of the stream.
+   * @param prefix_size Number of bytes in the prefix.
+   * @param threads Maximum number of chunks inflated at once on the shared
+   * Executor. Must be at least 1.
+   */
+  BgzfReader(FILE* source,
+             const char* prefix,
+             size_t prefix_size,
+             unsigned threads);
+
+  BgzfReader(const BgzfReader&) = delete;
+  BgzfReader(BgzfReader&&) = delete;
+
+  BgzfReader& operator=(const BgzfReader&) = delete;
+  BgzfReader& operator=(BgzfReader&&) = delete;
+
+  ~BgzfReader();
+
+  void close() noexcept;
+
+  /**
+   * Read uncompressed data.
+   *
+   * @param out Buffer to read into.
+   * @param size Number of bytes to read.
+   *
+   * @return Number of bytes read. Less than size only at the end of stream.
+   */
+  size_t read(char* out, size_t size);
+
+  /** Number of BGZF blocks inflated by a task at a time. */
+  static const size_t BLOCKS_PER_CHUNK = 4;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct Chunk
+  {
+    std::vector<char> compressed;
+    std::vector<char> inflated;
+    size_t compressed_size = 0;
+    size_t inflated_size = 0;
+    TaskGroup inflating;
+  };
+  /// @endcond
+
+  size_t read_source(char* out, size_t size);
+  bool load_chunk(Chunk& chunk);
+  static void inflate_chunk(Chunk& chunk);
+  void start_inflating();
+  bool next_chunk();
+
+  FILE* source;
+  std::vector<char> prefix;
+  size_t prefix_pos = 0;
+  const unsigned threads;
+  bool stream_end = false;
+  // Chunks being inflated, in stream order
+  std::deque<std::unique_ptr<Chunk>> inflating;
+  std::unique_ptr<Chunk> current, spare;
+  size_t current_pos = 0;
+};
+
+} // namespace btllib
+
+#endif
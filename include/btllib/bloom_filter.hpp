@@ -30,6 +30,12 @@ static const char* const HASH_FN = NTHASH_FN_NAME;
 
 static const unsigned MAX_HASH_VALUES = 1024;
 static const unsigned PLACEHOLDER_NEWLINES = 50;
+// Elements prefetched at a time by the batch operations of Bloom filters
+static const size_t BLOOM_FILTER_BATCH_SIZE = 64;
+// Filter array elements counted by each population count task
+static const size_t POP_CNT_GRAIN = 1024 * 1024;
+// Filter bytes copied by each task of copy_from()
+static const size_t COPY_GRAIN = 16 * 1024 * 1024;
 
 /// @cond HIDDEN_SYMBOLS
 class BloomFilterInitializer
@@ -152,6 +158,48 @@ public:
     return contains_insert(hashes.data());
   }
 
+  /**
+   * Prefetch the filter bytes of a batch of elements, so that the cache
+   * misses of the batch overlap when it is then inserted or queried.
+   *
+   * @param hashes Integer array of hash values, hash_num per element.
+   * @param count Number of elements.
+   */
+  void prefetch(const uint64_t* hashes, size_t count) const;
+
+  /**
+   * Insert a batch of elements. The filter bytes of the elements are
+   * prefetched BLOOM_FILTER_BATCH_SIZE elements at a time.
+   *
+   * @param hashes Integer array of hash values, hash_num per element.
+   * @param count Number of elements.
+   */
+  void insert_batch(const uint64_t* hashes, size_t count);
+
+  /**
+   * Check for the presence of a batch of elements. The filter bytes of the
+   * elements are prefetched BLOOM_FILTER_BATCH_SIZE elements at a time.
+   *
+   * @param hashes Integer array of hash values, hash_num per element.
+   * @param count Number of elements.
+   * @param results Array of count values, set to whether each element is
+   * present.
+   *
+   * @return Number of elements present.
+   */
+  size_t contains_batch(const uint64_t* hashes,
+                        size_t count,
+                        bool* results) const;
+
+  /**
+   * Copy the contents of another filter of the same size into this one, in
+   * parallel. Elements inserted into the other filter during the copy may be
+   * copied in part.
+   *
+   * @param other Filter to copy.
+   */
+  void copy_from(const BloomFilter& other);
+
   /** Get filter size in bytes. */
   size_t get_bytes() const { return bytes; }
   /** Get population count, i.e. the number of 1 bits in the filter. */
@@ -360,6 +408,18 @@ public:
     return bloom_filter.contains_insert(hashes);
   }
 
+  /**
+   * Copy the contents of another filter of the same size into this one, in
+   * parallel. K-mers inserted into the other filter during the copy may be
+   * copied in part.
+   *
+   * @param other Filter to copy.
+   */
+  void copy_from(const KmerBloomFilter& other)
+  {
+    bloom_filter.copy_from(other.bloom_filter);
+  }
+
   /** Get filter size in bytes. */
   size_t get_bytes() const { return bloom_filter.get_bytes(); }
   /** Get population count, i.e. the number of 1 bits in the filter. */
@@ -579,6 +639,18 @@ public:
     return kmer_bloom_filter.contains_insert(hashes);
   }
 
+  /**
+   * Copy the contents of another filter of the same size into this one, in
+   * parallel. K-mers inserted into the other filter during the copy may be
+   * copied in part.
+   *
+   * @param other Filter to copy.
+   */
+  void copy_from(const SeedBloomFilter& other)
+  {
+    kmer_bloom_filter.copy_from(other.kmer_bloom_filter);
+  }
+
   /** Get filter size in bytes. */
   size_t get_bytes() const { return kmer_bloom_filter.get_bytes(); }
   /** Get population count, i.e. the number of 1 bits in the filter. */
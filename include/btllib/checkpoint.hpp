@@ -0,0 +1,138 @@
+#ifndef BTLLIB_CHECKPOINT_HPP
+#define BTLLIB_CHECKPOINT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Periodic checkpoints of a long-running filter build, from which the build
+ * can resume after a failure. A checkpoint is a snapshot of the filter
+ * together with the position of the build in its input and its totals up to
+ * that position.
+ *
+ * Snapshots are written on a background thread, alternating between two
+ * slots, <prefix>.0 and <prefix>.1. Once a snapshot is complete and synced to
+ * disk, <prefix>.checkpoint is atomically replaced to point to it, so the
+ * last complete checkpoint survives a failure at any point.
+ *
+ * FilterPipeline and MIBloomFilterBuilder take checkpoints when given one.
+ */
+class Checkpoint
+{
+
+public:
+  /** Position of a build in its input, and its totals at that position. */
+  struct State
+  {
+    /** Stage of the build, e.g. the pass over the input. */
+    unsigned stage = 0;
+    /** Index of the input source, e.g. a sequence file. */
+    size_t source = 0;
+    /** Number of records of the source that were fully processed. */
+    size_t record = 0;
+    /** Number of bases of the next record that were processed. */
+    size_t offset = 0;
+    /** Named totals of the build. */
+    std::map<std::string, std::vector<uint64_t>> counters;
+
+    /** Get a total, or 0 if it is not recorded. */
+    uint64_t get_counter(const std::string& name, size_t i = 0) const;
+  };
+
+  /**
+   * Writes a snapshot to the given path and returns the paths of all files
+   * written. Files other than the given path should be named by adding a
+   * suffix to it.
+   */
+  using Writer = std::function<std::vector<std::string>(const std::string&)>;
+
+  /**
+   * Construct a checkpoint, loading the state of the last checkpoint with the
+   * given prefix if there is one.
+   *
+   * @param prefix Path prefix of the checkpoint files.
+   * @param interval Minimum number of seconds between checkpoints.
+   */
+  Checkpoint(std::string prefix, double interval = 600);
+
+  Checkpoint(const Checkpoint&) = delete;
+  Checkpoint(Checkpoint&&) = delete;
+
+  Checkpoint& operator=(const Checkpoint&) = delete;
+  Checkpoint& operator=(Checkpoint&&) = delete;
+
+  /** Waits for the last checkpoint to be written. */
+  ~Checkpoint();
+
+  /**
+   * Whether a checkpoint exists to resume from. This and the getters below
+   * reflect the last checkpoint written before the last wait().
+   */
+  bool exists() const { return !files.empty(); }
+
+  /** Get the state of the last checkpoint. */
+  const State& get_state() const { return state; }
+
+  /**
+   * Get the path of the snapshot of the last checkpoint, e.g. to load the
+   * filter from. Empty if there is no checkpoint.
+   */
+  std::string get_snapshot_path() const
+  {
+    return files.empty() ? std::string() : files.front();
+  }
+
+  /** Whether the interval has passed since the last checkpoint was taken. */
+  bool due() const
+  {
+    return std::chrono::steady_clock::now() >= next_due;
+  }
+
+  /**
+   * Take a checkpoint. Waits for the previous checkpoint to be written, then
+   * returns while the snapshot is written in the background. Anything the
+   * writer reads must stay valid until wait() or the next call.
+   *
+   * @param state Position of the build and its totals.
+   * @param writer Writes the snapshot.
+   */
+  void save(State state, Writer writer);
+
+  /** Wait for the last checkpoint to be written. */
+  void wait();
+
+  /**
+   * Wait for the last checkpoint to be written and delete its files, as well
+   * as those of the previous one, e.g. once the build is complete.
+   */
+  void remove();
+
+  const std::string& get_prefix() const { return prefix; }
+  double get_interval() const { return interval; }
+
+private:
+  void write(unsigned slot, const Writer& writer);
+  void load();
+
+  const std::string prefix;
+  const double interval;
+  std::chrono::steady_clock::time_point next_due;
+  unsigned slot = 0;
+  State state, pending_state;
+  // Files of the last complete checkpoint, the snapshot first
+  std::vector<std::string> files, pending_files;
+  std::unique_ptr<std::thread> writer_thread;
+};
+
+} // namespace btllib
+
+#endif
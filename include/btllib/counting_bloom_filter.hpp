@@ -3,14 +3,18 @@
 
 #include "btllib/bloom_filter.hpp"
 #include "btllib/counting_bloom_filter.hpp"
+#include "btllib/executor.hpp"
+#include "btllib/metrics.hpp"
 #include "btllib/nthash.hpp"
 #include "btllib/status.hpp"
 
 #include "cpptoml.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <limits>
 #include <memory>
@@ -236,6 +240,47 @@ public:
     return contains_insert_thresh(hashes.data(), threshold);
   }
 
+  /**
+   * Prefetch the counters of a batch of elements, so that the cache misses of
+   * the batch overlap when it is then inserted or queried.
+   *
+   * @param hashes Integer array of hash values, hash_num per element.
+   * @param count Number of elements.
+   */
+  void prefetch(const uint64_t* hashes, size_t count) const;
+
+  /**
+   * Increment the counts of a batch of elements. The counters of the elements
+   * are prefetched BLOOM_FILTER_BATCH_SIZE elements at a time.
+   *
+   * @param hashes Integer array of hash values, hash_num per element.
+   * @param count Number of elements.
+   */
+  void insert_batch(const uint64_t* hashes, size_t count);
+
+  /**
+   * Get the counts of a batch of elements. The counters of the elements are
+   * prefetched BLOOM_FILTER_BATCH_SIZE elements at a time.
+   *
+   * @param hashes Integer array of hash values, hash_num per element.
+   * @param count Number of elements.
+   * @param results Array of count values, set to the count of each element.
+   *
+   * @return Number of elements with a non-zero count.
+   */
+  size_t contains_batch(const uint64_t* hashes,
+                        size_t count,
+                        T* results) const;
+
+  /**
+   * Copy the contents of another filter of the same size into this one, in
+   * parallel. Elements inserted into the other filter during the copy may be
+   * copied in part.
+   *
+   * @param other Filter to copy.
+   */
+  void copy_from(const CountingBloomFilter& other);
+
   /** Get filter size in bytes. */
   size_t get_bytes() const { return bytes; }
   /** Get population count, i.e. the number of counters >= threshold in the
@@ -679,6 +724,18 @@ public:
     return counting_bloom_filter.contains_insert_thresh(hashes, threshold);
   }
 
+  /**
+   * Copy the contents of another filter of the same size into this one, in
+   * parallel. K-mers inserted into the other filter during the copy may be
+   * copied in part.
+   *
+   * @param other Filter to copy.
+   */
+  void copy_from(const KmerCountingBloomFilter& other)
+  {
+    counting_bloom_filter.copy_from(other.counting_bloom_filter);
+  }
+
   /** Get filter size in bytes. */
   size_t get_bytes() const { return counting_bloom_filter.get_bytes(); }
   /** Get population count, i.e. the number of counters >0 in the filter. */
@@ -784,6 +841,7 @@ CountingBloomFilter<T>::insert(const uint64_t* hashes, T min_val)
   // Update flag to track if increment is done on at least one counter
   bool update_done = false;
   T new_val, tmp_min_val;
+  BTLLIB_METRIC_ADD(COUNTING_BLOOM_FILTER_INSERTS, 1);
   while (true) {
     new_val = min_val + 1;
     for (size_t i = 0; i < hash_num; ++i) {
@@ -794,6 +852,7 @@ CountingBloomFilter<T>::insert(const uint64_t* hashes, T min_val)
     if (update_done) {
       break;
     }
+    BTLLIB_METRIC_ADD(COUNTING_BLOOM_FILTER_CAS_RETRIES, hash_num);
     min_val = contains(hashes);
     if (min_val == std::numeric_limits<T>::max()) {
       break;
@@ -862,6 +921,7 @@ template<typename T>
 inline T
 CountingBloomFilter<T>::contains(const uint64_t* hashes) const
 {
+  BTLLIB_METRIC_ADD(COUNTING_BLOOM_FILTER_QUERIES, 1);
   T min = array[hashes[0] % array_size];
   for (size_t i = 1; i < hash_num; ++i) {
     const size_t idx = hashes[i] % array_size;
@@ -872,6 +932,49 @@ CountingBloomFilter<T>::contains(const uint64_t* hashes) const
   return min;
 }
 
+template<typename T>
+inline void
+CountingBloomFilter<T>::prefetch(const uint64_t* hashes,
+                                 const size_t count) const
+{
+  const size_t n = count * hash_num;
+  for (size_t i = 0; i < n; ++i) {
+    __builtin_prefetch(array.get() + hashes[i] % array_size);
+  }
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::insert_batch(const uint64_t* hashes,
+                                     const size_t count)
+{
+  for (size_t b = 0; b < count; b += BLOOM_FILTER_BATCH_SIZE) {
+    const size_t end = std::min(count, b + BLOOM_FILTER_BATCH_SIZE);
+    prefetch(hashes + b * hash_num, end - b);
+    for (size_t i = b; i < end; ++i) {
+      insert(hashes + i * hash_num);
+    }
+  }
+}
+
+template<typename T>
+inline size_t
+CountingBloomFilter<T>::contains_batch(const uint64_t* hashes,
+                                       const size_t count,
+                                       T* const results) const
+{
+  size_t found = 0;
+  for (size_t b = 0; b < count; b += BLOOM_FILTER_BATCH_SIZE) {
+    const size_t end = std::min(count, b + BLOOM_FILTER_BATCH_SIZE);
+    prefetch(hashes + b * hash_num, end - b);
+    for (size_t i = b; i < end; ++i) {
+      results[i] = contains(hashes + i * hash_num);
+      found += results[i] > 0 ? 1 : 0;
+    }
+  }
+  return found;
+}
+
 template<typename T>
 inline T
 CountingBloomFilter<T>::contains_insert(const uint64_t* hashes)
@@ -920,20 +1023,34 @@ CountingBloomFilter<T>::contains_insert_thresh(const uint64_t* hashes,
   return count;
 }
 
+template<typename T>
+inline void
+CountingBloomFilter<T>::copy_from(const CountingBloomFilter& other)
+{
+  check_error(other.array_size != array_size || other.hash_num != hash_num,
+              "CountingBloomFilter: cannot copy a filter of a different size.");
+  const size_t grain = COPY_GRAIN / sizeof(array[0]);
+  parallel_for(0, array_size, grain, [&](size_t start, size_t end) {
+    std::memcpy((void*)(array.get() + start),
+                (const void*)(other.array.get() + start),
+                (end - start) * sizeof(array[0]));
+  });
+}
+
 template<typename T>
 inline uint64_t
 CountingBloomFilter<T>::get_pop_cnt(const T threshold) const
 {
-  uint64_t pop_cnt = 0;
-  // OpenMP make up your mind man. Using default(none) here causes errors on
-  // some compilers and not others.
-  // NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
-#pragma omp parallel for reduction(+ : pop_cnt)
-  for (size_t i = 0; i < array_size; ++i) {
-    if (array[i] >= threshold) {
-      ++pop_cnt;
+  std::atomic<uint64_t> pop_cnt{ 0 };
+  parallel_for(0, array_size, POP_CNT_GRAIN, [&](size_t start, size_t end) {
+    uint64_t chunk_pop_cnt = 0;
+    for (size_t i = start; i < end; ++i) {
+      if (array[i] >= threshold) {
+        ++chunk_pop_cnt;
+      }
     }
-  }
+    pop_cnt += chunk_pop_cnt;
+  });
   return pop_cnt;
 }
 
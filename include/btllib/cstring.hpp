@@ -3,15 +3,78 @@
 
 #include <cstdlib>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace btllib {
 
+/**
+ * Bump allocator for CString contents. Memory is handed out from slabs that
+ * are kept across reset(), so that a parser filling the same strings over
+ * and over allocates nothing once the slabs are large enough. Individual
+ * allocations are never freed; all of them become invalid on reset().
+ */
+class CStringArena
+{
+
+public:
+  /** Size of a slab, unless a single allocation needs more. */
+  static const size_t SLAB_SIZE = 64 * 1024;
+
+  CStringArena() = default;
+
+  CStringArena(const CStringArena&) = delete;
+  CStringArena(CStringArena&&) = default;
+
+  CStringArena& operator=(const CStringArena&) = delete;
+  CStringArena& operator=(CStringArena&&) = default;
+
+  /** Allocate size bytes. */
+  char* allocate(size_t size);
+
+  /**
+   * Grow the latest allocation in place, if the current slab has room.
+   *
+   * @param p Start of the allocation.
+   * @param size Current size of the allocation.
+   * @param new_size Size to grow it to.
+   *
+   * @return Whether the allocation was grown.
+   */
+  bool extend(const char* p, size_t size, size_t new_size);
+
+  /** Invalidate all allocations, keeping the slabs for reuse. */
+  void reset();
+
+  /** Total size of the slabs. */
+  size_t get_capacity() const;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct Slab
+  {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+  /// @endcond
+
+  std::vector<Slab> slabs;
+  size_t current = 0;
+  size_t used = 0;
+};
+
+/**
+ * Growable C string. Short contents live in a buffer inside the object, so
+ * constructing an empty string allocates nothing. Longer contents are kept
+ * in the CStringArena the string is bound to, if any, or on the heap.
+ */
 struct CString
 {
-  static const size_t CSTRING_DEFAULT_CAP = 2048;
+  /** Capacity of the buffer inside the object, including the terminator. */
+  static const size_t SMALL_CAP = 32;
 
-  CString() { s[0] = '\0'; }
+  CString() { small[0] = '\0'; }
   CString(const CString& cstr);
   CString(CString&& cstr) noexcept;
   explicit CString(const std::string& str);
@@ -23,7 +86,12 @@ struct CString
   CString& operator+=(const std::string& str);
   CString& operator+=(char c);
 
-  ~CString() { free(s); } // NOLINT
+  ~CString()
+  {
+    if (s_heap) {
+      free(s); // NOLINT
+    }
+  }
 
   void clear();
   bool empty() const { return (ssize_t)s_size <= 0; }
@@ -40,11 +108,38 @@ struct CString
   CString& erase(size_t pos = 0,
                  size_t len = std::numeric_limits<size_t>::max());
 
-  char* s = (char*)std::malloc(CSTRING_DEFAULT_CAP); // NOLINT
+  /** Grow the capacity to at least cap, at least doubling it. */
+  void reserve(size_t cap);
+
+  /** Append n characters of str. */
+  void append(const char* str, size_t n);
+
+  /**
+   * Allocate future contents from an arena instead of the heap. Contents
+   * already in an arena are dropped, which makes this safe to call again
+   * after the arena is reset. Contents on the heap stay there.
+   *
+   * @param arena Arena to allocate from. Must outlive its use by the string.
+   * nullptr to allocate from the heap.
+   */
+  void set_arena(CStringArena* arena);
+
+  /** Move the contents to the heap, so that functions like getline() can
+   * realloc them. */
+  void make_heap();
+
+  char* s = small;
   size_t s_size = 0;
-  size_t s_cap = CSTRING_DEFAULT_CAP;
+  size_t s_cap = SMALL_CAP;
+  bool s_heap = false;
+  CStringArena* arena = nullptr;
+
+private:
+  void take(CString& cstr);
+
+  char small[SMALL_CAP];
 };
 
 } // namespace btllib
 
-#endif
\ No newline at end of file
+#endif
@@ -5,6 +5,8 @@
 #include "btllib/status.hpp"
 #include "btllib/util.hpp"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -23,6 +25,16 @@ struct Datatype
 
 extern const Datatype DATATYPES[12];
 
+/// @cond HIDDEN_SYMBOLS
+struct DecompressionJob;
+/// @endcond
+
+/**
+ * Open a file for reading or writing, (de)compressing or converting it with an
+ * external tool chosen by its extension. The tools available are looked up
+ * once per process. Plain gzip files are read without a helper process, by a
+ * pool of decompression threads reused across opens.
+ */
 class DataStream
 {
 public:
@@ -34,7 +46,15 @@ public:
     CLOSE
   };
 
-  DataStream(const std::string& path, Operation op);
+  /**
+   * Construct a DataStream.
+   *
+   * @param path Path to the file, "-" for stdin or stdout.
+   * @param op Operation to do on the file.
+   * @param raw Access the file as is, without (de)compressing or converting it
+   * based on its extension.
+   */
+  DataStream(const std::string& path, Operation op, bool raw = false);
   DataStream(const DataStream&) = delete;
   DataStream(DataStream&&) = delete;
 
@@ -48,20 +68,70 @@ public:
   FILE* operator->() const { return file; }
   operator FILE*() const { return file; }
 
+  /** Get the file descriptor underlying the stream. */
+  int get_fd() const { return fileno(file); }
+
+  /**
+   * Read from the file descriptor directly, skipping the copy into the stdio
+   * buffer of the FILE*. Only use this before anything has been read through
+   * the FILE*, or instead of it, as stdio may have buffered data ahead.
+   *
+   * @param data Buffer to read into.
+   * @param size Number of bytes to read.
+   *
+   * @return Number of bytes read, which is less than size only at the end of
+   * the stream.
+   */
+  size_t read(char* data, size_t size);
+
+  /** Seconds it took to open the stream, including starting any helper
+   * processes or threads. */
+  double get_setup_time() const { return double(setup_ns) / NS_PER_SECOND; }
+
+  /** Total seconds spent opening streams in this process. */
+  static double get_total_setup_time()
+  {
+    return double(total_setup_ns()) / NS_PER_SECOND;
+  }
+
+  /** Number of streams opened in this process. */
+  static size_t get_open_count() { return open_count(); }
+
 protected:
   std::string streampath;
   Operation op;
   FILE* file = nullptr;
   std::atomic<bool> closed{ false };
   std::unique_ptr<ProcessPipeline> pipeline;
+  std::shared_ptr<DecompressionJob> decompression;
+  char* stdio_buffer = nullptr;
+  uint64_t setup_ns = 0;
+
+  static constexpr double NS_PER_SECOND = 1e9;
+  // Page aligned, so that stdio reads and writes whole pages
+  static const size_t STDIO_BUFFER_SIZE = 256 * 1024;
+
+  void set_stdio_buffer();
+
+  static std::atomic<uint64_t>& total_setup_ns()
+  {
+    static std::atomic<uint64_t> var(0);
+    return var;
+  }
+
+  static std::atomic<size_t>& open_count()
+  {
+    static std::atomic<size_t> var(0);
+    return var;
+  }
 };
 
 class DataSource : public DataStream
 {
 
 public:
-  DataSource(const std::string& path)
-    : DataStream(path, READ)
+  DataSource(const std::string& path, bool raw = false)
+    : DataStream(path, READ, raw)
   {
   }
 };
@@ -70,8 +140,8 @@ class DataSink : public DataStream
 {
 
 public:
-  DataSink(const std::string& path, bool append = false)
-    : DataStream(path, append ? APPEND : WRITE)
+  DataSink(const std::string& path, bool append = false, bool raw = false)
+    : DataStream(path, append ? APPEND : WRITE, raw)
   {
   }
 };
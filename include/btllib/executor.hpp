@@ -0,0 +1,179 @@
+#ifndef BTLLIB_EXECUTOR_HPP
+#define BTLLIB_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Work-stealing pool of worker threads. The library runs its parallel work
+ * on a single shared executor (see global()), so that any number of
+ * SeqReader, Indexlr and filter operations in a process together use no more
+ * threads than the executor has. Every worker keeps a deque of tasks: it runs
+ * its newest task first, and once its deque is empty it steals the oldest
+ * task of another worker. Tasks submitted from outside the pool are spread
+ * over the workers in turn.
+ *
+ * Tasks should run to completion without waiting on other threads, apart
+ * from TaskGroup::wait(), which runs queued tasks while it waits. In
+ * particular, code that consumes a SeqReader or Indexlr must not run as a
+ * task, as their records are produced by tasks of the same executor.
+ */
+class Executor
+{
+
+public:
+  using Task = std::function<void()>;
+
+  /**
+   * Construct an executor and start its workers.
+   *
+   * @param threads Number of worker threads. If 0, one per hardware thread.
+   * @param pin_threads Pin each worker to a core of its own, taken in order
+   * from the cores the process may run on. Only supported on Linux.
+   */
+  explicit Executor(unsigned threads = 0, bool pin_threads = false);
+
+  Executor(const Executor&) = delete;
+  Executor(Executor&&) = delete;
+
+  Executor& operator=(const Executor&) = delete;
+  Executor& operator=(Executor&&) = delete;
+
+  /** Run the tasks still queued and stop the workers. */
+  ~Executor();
+
+  /**
+   * Get the executor shared by the library. It is started on first use,
+   * with the settings given to configure() or the defaults otherwise.
+   */
+  static Executor& global();
+
+  /**
+   * Configure the shared executor. Only takes effect if called before the
+   * executor is first used, i.e. before any SeqReader or Indexlr is
+   * constructed.
+   *
+   * @param threads Number of worker threads, and so the cap on the number of
+   * tasks the library runs at once. If 0, one per hardware thread.
+   * @param pin_threads Pin each worker to a core of its own.
+   */
+  static void configure(unsigned threads, bool pin_threads = false);
+
+  /** Queue a task to run on one of the workers. */
+  void submit(Task task);
+
+  /**
+   * Run a single queued task on the calling thread, if there is one.
+   *
+   * @return Whether a task was run.
+   */
+  bool run_pending();
+
+  /** Whether the calling thread is one of this executor's workers. */
+  bool in_worker() const;
+
+  /** Get the number of worker threads. */
+  unsigned get_threads() const { return unsigned(workers.size()); }
+  /** Whether the workers are pinned to cores. */
+  bool is_pinned() const { return pinned; }
+  /** Get the number of tasks run so far. */
+  size_t get_executed() const { return executed; }
+  /** Get the number of tasks run by a thread other than the worker they
+   * were queued on. */
+  size_t get_stolen() const { return stolen; }
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::unique_ptr<std::thread> thread;
+  };
+  /// @endcond
+
+  void work(size_t index);
+  bool take(size_t index, Task& task);
+  bool steal(size_t thief, Task& task);
+  void pin(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  bool pinned = false;
+  std::atomic<size_t> queued{ 0 };
+  std::atomic<size_t> next_worker{ 0 };
+  std::atomic<unsigned> sleeping{ 0 };
+  std::atomic<bool> stopping{ false };
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;
+  std::atomic<size_t> executed{ 0 };
+  std::atomic<size_t> stolen{ 0 };
+};
+
+/**
+ * A set of tasks that can be waited on together. Waiting runs queued tasks
+ * on the waiting thread, so it is safe to wait from within a task.
+ */
+class TaskGroup
+{
+
+public:
+  explicit TaskGroup(Executor& executor = Executor::global())
+    : executor(executor)
+  {
+  }
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup(TaskGroup&&) = delete;
+
+  TaskGroup& operator=(const TaskGroup&) = delete;
+  TaskGroup& operator=(TaskGroup&&) = delete;
+
+  ~TaskGroup() { wait(); }
+
+  /** Queue a task as part of the group. */
+  void run(Executor::Task task);
+
+  /** Return once every task of the group has finished. */
+  void wait();
+
+  /** Get the number of the group's tasks that have not finished. */
+  size_t get_pending() const { return pending; }
+
+  Executor& get_executor() { return executor; }
+
+private:
+  Executor& executor;
+  std::atomic<size_t> pending{ 0 };
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+/**
+ * Split a range into chunks and run them on an executor, returning once all
+ * are done.
+ *
+ * @param begin Start of the range.
+ * @param end End of the range, exclusive.
+ * @param grain Maximum number of elements per chunk.
+ * @param body Called with the start and end of each chunk.
+ * @param executor Executor to run the chunks on.
+ */
+void
+parallel_for(size_t begin,
+             size_t end,
+             size_t grain,
+             const std::function<void(size_t, size_t)>& body,
+             Executor& executor = Executor::global());
+
+} // namespace btllib
+
+#endif
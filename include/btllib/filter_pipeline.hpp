@@ -0,0 +1,732 @@
+#ifndef BTLLIB_FILTER_PIPELINE_HPP
+#define BTLLIB_FILTER_PIPELINE_HPP
+
+#include "btllib/bloom_filter.hpp"
+#include "btllib/checkpoint.hpp"
+#include "btllib/counting_bloom_filter.hpp"
+#include "btllib/executor.hpp"
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/nthash.hpp"
+#include "btllib/order_queue.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/status.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace btllib {
+
+/** What FilterPipeline does with the k-mers of each read. */
+enum class FilterPipelineMode
+{
+  /** Insert every k-mer. */
+  INSERT,
+  /** Query every k-mer, leaving the filter unchanged. */
+  QUERY,
+  /** Query every k-mer and insert it, reporting the state before insertion.
+   */
+  CONTAINS_INSERT
+};
+
+/// @cond HIDDEN_SYMBOLS
+// How FilterPipeline hashes reads for, and applies batches to, each filter
+// type. Reads are hashed with get_hasher_hash_num() hash values per k-mer or
+// spaced seed, and the hash values of a frame are split into elements of
+// get_hash_num() values each. apply() stores get_value_num() values per
+// element and returns the number of elements found. Filters that can be
+// inserted into also make empty filters of their own shape for checkpoints
+template<typename Filter>
+struct FilterPipelineOps;
+
+// Bloom filters that store elements by hash values: BloomFilter and
+// CountingBloomFilter
+struct FilterPipelineBloomOps
+{
+  struct Scratch
+  {};
+
+  template<typename BloomFilterType>
+  static size_t apply(BloomFilterType& filter,
+                      const FilterPipelineMode mode,
+                      const unsigned hash_num,
+                      const uint64_t* hashes,
+                      const size_t count,
+                      uint64_t* values)
+  {
+    filter.prefetch(hashes, count);
+    size_t found = 0;
+    switch (mode) {
+      case FilterPipelineMode::INSERT:
+        for (size_t i = 0; i < count; ++i) {
+          filter.insert(hashes + i * hash_num);
+        }
+        break;
+      case FilterPipelineMode::QUERY:
+        for (size_t i = 0; i < count; ++i) {
+          values[i] = uint64_t(filter.contains(hashes + i * hash_num));
+          found += values[i] > 0 ? 1 : 0;
+        }
+        break;
+      case FilterPipelineMode::CONTAINS_INSERT:
+        for (size_t i = 0; i < count; ++i) {
+          values[i] = uint64_t(filter.contains_insert(hashes + i * hash_num));
+          found += values[i] > 0 ? 1 : 0;
+        }
+        break;
+    }
+    return found;
+  }
+};
+
+template<>
+struct FilterPipelineOps<KmerBloomFilter> : FilterPipelineBloomOps
+{
+  static const bool INSERTS = true;
+
+  static unsigned get_k(const KmerBloomFilter& filter)
+  {
+    return filter.get_k();
+  }
+  static unsigned get_hasher_hash_num(const KmerBloomFilter& filter)
+  {
+    return filter.get_hash_num();
+  }
+  static unsigned get_hash_num(const KmerBloomFilter& filter)
+  {
+    return filter.get_hash_num();
+  }
+  static std::vector<SpacedSeed> get_seeds(const KmerBloomFilter&)
+  {
+    return std::vector<SpacedSeed>();
+  }
+  static unsigned get_value_num(const KmerBloomFilter&) { return 1; }
+  static KmerBloomFilter* make_empty(const KmerBloomFilter& filter)
+  {
+    return new KmerBloomFilter(
+      filter.get_bytes(), filter.get_hash_num(), filter.get_k());
+  }
+
+  static size_t apply(KmerBloomFilter& filter,
+                      const FilterPipelineMode mode,
+                      const uint64_t* hashes,
+                      const size_t count,
+                      uint64_t* values,
+                      Scratch&)
+  {
+    return FilterPipelineBloomOps::apply(filter.get_bloom_filter(),
+                                         mode,
+                                         filter.get_hash_num(),
+                                         hashes,
+                                         count,
+                                         values);
+  }
+};
+
+template<>
+struct FilterPipelineOps<SeedBloomFilter> : FilterPipelineBloomOps
+{
+  static const bool INSERTS = true;
+
+  static unsigned get_k(const SeedBloomFilter& filter)
+  {
+    return filter.get_k();
+  }
+  static unsigned get_hasher_hash_num(const SeedBloomFilter& filter)
+  {
+    return filter.get_hash_num_per_seed();
+  }
+  static unsigned get_hash_num(const SeedBloomFilter& filter)
+  {
+    return filter.get_hash_num_per_seed();
+  }
+  static std::vector<SpacedSeed> get_seeds(const SeedBloomFilter& filter)
+  {
+    return filter.get_parsed_seeds();
+  }
+  static unsigned get_value_num(const SeedBloomFilter&) { return 1; }
+  static SeedBloomFilter* make_empty(const SeedBloomFilter& filter)
+  {
+    return new SeedBloomFilter(filter.get_bytes(),
+                               filter.get_k(),
+                               filter.get_seeds(),
+                               filter.get_hash_num_per_seed());
+  }
+
+  static size_t apply(SeedBloomFilter& filter,
+                      const FilterPipelineMode mode,
+                      const uint64_t* hashes,
+                      const size_t count,
+                      uint64_t* values,
+                      Scratch&)
+  {
+    return FilterPipelineBloomOps::apply(
+      filter.get_kmer_bloom_filter().get_bloom_filter(),
+      mode,
+      filter.get_hash_num_per_seed(),
+      hashes,
+      count,
+      values);
+  }
+};
+
+template<typename T>
+struct FilterPipelineOps<KmerCountingBloomFilter<T>> : FilterPipelineBloomOps
+{
+  static const bool INSERTS = true;
+
+  static unsigned get_k(const KmerCountingBloomFilter<T>& filter)
+  {
+    return filter.get_k();
+  }
+  static unsigned get_hasher_hash_num(
+    const KmerCountingBloomFilter<T>& filter)
+  {
+    return filter.get_hash_num();
+  }
+  static unsigned get_hash_num(const KmerCountingBloomFilter<T>& filter)
+  {
+    return filter.get_hash_num();
+  }
+  static std::vector<SpacedSeed> get_seeds(const KmerCountingBloomFilter<T>&)
+  {
+    return std::vector<SpacedSeed>();
+  }
+  static unsigned get_value_num(const KmerCountingBloomFilter<T>&)
+  {
+    return 1;
+  }
+  static KmerCountingBloomFilter<T>* make_empty(
+    const KmerCountingBloomFilter<T>& filter)
+  {
+    return new KmerCountingBloomFilter<T>(
+      filter.get_bytes(), filter.get_hash_num(), filter.get_k());
+  }
+
+  static size_t apply(KmerCountingBloomFilter<T>& filter,
+                      const FilterPipelineMode mode,
+                      const uint64_t* hashes,
+                      const size_t count,
+                      uint64_t* values,
+                      Scratch&)
+  {
+    return FilterPipelineBloomOps::apply(filter.get_counting_bloom_filter(),
+                                         mode,
+                                         filter.get_hash_num(),
+                                         hashes,
+                                         count,
+                                         values);
+  }
+};
+
+// Multi-index Bloom filters are built by MIBloomFilterBuilder and only
+// queried here. A frame is a single element, whose hash values come one per
+// spaced seed if the filter has seeds. Every element reports the raw values
+// of its hash_num slots
+template<typename T>
+struct FilterPipelineOps<MIBloomFilter<T>>
+{
+  struct Scratch
+  {
+    std::vector<uint64_t> ranks;
+    std::vector<T> values;
+  };
+
+  static const bool INSERTS = false;
+
+  static unsigned get_k(const MIBloomFilter<T>& filter)
+  {
+    return filter.get_kmer_size();
+  }
+  static unsigned get_hasher_hash_num(const MIBloomFilter<T>& filter)
+  {
+    return filter.get_seed_values().empty() ? filter.get_hash_num() : 1;
+  }
+  static unsigned get_hash_num(const MIBloomFilter<T>& filter)
+  {
+    return filter.get_hash_num();
+  }
+  static std::vector<SpacedSeed> get_seeds(const MIBloomFilter<T>& filter)
+  {
+    return filter.get_seed_values();
+  }
+  static unsigned get_value_num(const MIBloomFilter<T>& filter)
+  {
+    return filter.get_hash_num();
+  }
+
+  static size_t apply(MIBloomFilter<T>& filter,
+                      FilterPipelineMode,
+                      const uint64_t* hashes,
+                      const size_t count,
+                      uint64_t* values,
+                      Scratch& scratch)
+  {
+    const size_t n = count * filter.get_hash_num();
+    if (scratch.ranks.size() < n) {
+      scratch.ranks.resize(n);
+      scratch.values.resize(n);
+    }
+    const size_t found = filter.at_batch(
+      hashes, count, scratch.values.data(), scratch.ranks.data());
+    std::copy(scratch.values.data(), scratch.values.data() + n, values);
+    return found;
+  }
+};
+/// @endcond
+
+/**
+ * Streams the reads of sequence files through a k-mer filter. Blocks of
+ * reads from a SeqReader are processed as tasks on the shared Executor. Each
+ * read is hashed into batches of BATCH_SIZE frames, and a whole batch is
+ * inserted or queried at a time with its filter memory prefetched. Supports
+ * KmerBloomFilter, SeedBloomFilter, KmerCountingBloomFilter and, for queries
+ * only, MIBloomFilter. Spaced seed filters hash reads with their seeds.
+ *
+ * Progress is counted as reads are processed and can be observed from any
+ * thread. Per-read results are passed to a callback.
+ *
+ * Long insertions can be checkpointed and resumed after a failure, see
+ * set_checkpoint().
+ */
+template<typename Filter>
+class FilterPipeline
+{
+
+public:
+  using Mode = FilterPipelineMode;
+
+  /** Outcome of a single read. */
+  struct Result
+  {
+    /** Number of the read in the input file. */
+    size_t num = std::numeric_limits<size_t>::max();
+    /** Number of elements hashed from the read. A k-mer filter has one
+     * element per k-mer, a spaced seed filter one per seed per frame. */
+    size_t elements = 0;
+    /** Number of elements found in the filter, before their insertion in
+     * CONTAINS_INSERT mode. Always 0 in INSERT mode. For a multi-index Bloom
+     * filter, the frames with all bits set. */
+    size_t hits = 0;
+    /** Values of the queried elements, if requested. One per element: 0 or
+     * 1 for Bloom filters and the count for counting Bloom filters. A
+     * multi-index Bloom filter reports the raw value of each of the frame's
+     * hash_num slots, or 0 where the bit is not set. */
+    std::vector<uint64_t> values;
+  };
+
+  /** Totals over the reads processed so far. */
+  struct Progress
+  {
+    size_t reads = 0;
+    size_t bases = 0;
+    size_t elements = 0;
+    size_t hits = 0;
+  };
+
+  /** Called on an executor worker for every read, in no particular order. */
+  using ReadCallback =
+    std::function<void(const SeqReader::Record&, const Result&)>;
+  /** Called after every block of reads, one call at a time. */
+  using ProgressCallback = std::function<void(const Progress&)>;
+
+  /**
+   * Construct a pipeline.
+   *
+   * @param filter Filter to insert into or query. Must outlive the pipeline.
+   * @param mode Whether to insert, query, or both.
+   * @param threads Maximum number of blocks of reads processed at once on the
+   * shared Executor.
+   */
+  FilterPipeline(Filter& filter, Mode mode, unsigned threads = 4);
+
+  FilterPipeline(const FilterPipeline&) = delete;
+  FilterPipeline(FilterPipeline&&) = delete;
+
+  FilterPipeline& operator=(const FilterPipeline&) = delete;
+  FilterPipeline& operator=(FilterPipeline&&) = delete;
+
+  /**
+   * Set the callback receiving the result of every read.
+   *
+   * @param callback Called concurrently from the executor's workers, so it must
+   * be thread-safe.
+   * @param values Fill in Result::values. Ignored in INSERT mode.
+   */
+  void set_read_callback(ReadCallback callback, bool values = false)
+  {
+    read_callback = std::move(callback);
+    report_values = values;
+  }
+
+  /**
+   * Set the callback receiving the progress totals.
+   *
+   * @param callback Called from the executor's workers after each block of
+   * reads. Calls are serialized.
+   */
+  void set_progress_callback(ProgressCallback callback)
+  {
+    progress_callback = std::move(callback);
+  }
+
+  /**
+   * Take checkpoints of the filter while it is inserted into. Whenever the
+   * checkpoint interval has passed, reading pauses until the blocks of reads
+   * in progress are done, the filter is copied to a snapshot in memory, and
+   * the snapshot is written in the background as reading goes on. The pause
+   * is that of the copy, at the cost of the memory of a second filter.
+   *
+   * If the checkpoint exists, the next run() resumes from its position,
+   * skipping the files and reads that were already processed, and the
+   * progress totals start from those of the checkpoint. The filter must then
+   * have been loaded from checkpoint.get_snapshot_path(), and run() must be
+   * given the same files and reader flags.
+   *
+   * @param checkpoint Checkpoint to take. Must outlive the pipeline.
+   */
+  void set_checkpoint(Checkpoint& checkpoint);
+
+  /**
+   * Process every read of a sequence file, returning once all are done.
+   * May be called repeatedly; the progress totals accumulate.
+   *
+   * @param seq_path Filepath to read sequences from.
+   * @param reader_flags SeqReader flags to read the file with.
+   */
+  void run(const std::string& seq_path,
+           unsigned reader_flags = SeqReader::Flag::AUTO_MODE)
+  {
+    run(std::vector<std::string>{ seq_path }, reader_flags);
+  }
+
+  /**
+   * Process every read of several sequence files in order, returning once all
+   * are done. When checkpointing, all files of the input must be given to a
+   * single call, as checkpoints record the position in them.
+   *
+   * @param seq_paths Filepaths to read sequences from.
+   * @param reader_flags SeqReader flags to read the files with.
+   */
+  void run(const std::vector<std::string>& seq_paths,
+           unsigned reader_flags = SeqReader::Flag::AUTO_MODE);
+
+  /** Get the progress totals. Safe to call while run() is in progress. */
+  Progress get_progress() const
+  {
+    Progress progress;
+    progress.reads = reads;
+    progress.bases = bases;
+    progress.elements = elements;
+    progress.hits = hits;
+    return progress;
+  }
+
+  /** Number of frames hashed before a batch is applied to the filter. */
+  static const size_t BATCH_SIZE = 512;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  using Ops = FilterPipelineOps<Filter>;
+
+  // Per task buffers, reused across blocks of reads
+  struct Scratch
+  {
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> values;
+    typename Ops::Scratch ops;
+    std::unique_ptr<NtHash> nthash;
+    std::unique_ptr<SeedNtHash> seed_nthash;
+    Result result;
+  };
+  /// @endcond
+
+  void process_block(const OrderQueueMPMC<SeqReader::Record>::Block& records,
+                     size_t first,
+                     Scratch& scratch);
+  void process(const SeqReader::Record& record, Scratch& scratch);
+  template<typename Hasher>
+  void process_frames(Hasher& hasher, Scratch& scratch);
+  void save_checkpoint(size_t source, size_t record, std::true_type);
+  void save_checkpoint(size_t, size_t, std::false_type) {}
+
+  Filter& filter;
+  const Mode mode;
+  const unsigned threads;
+  const unsigned k;
+  const unsigned hasher_hash_num;
+  const std::vector<SpacedSeed> seeds;
+  const unsigned value_num;
+  // Hash values and elements per frame
+  const size_t frame_hash_num;
+  const size_t frame_elements;
+  ReadCallback read_callback;
+  bool report_values = false;
+  ProgressCallback progress_callback;
+  std::mutex progress_mutex;
+  std::atomic<size_t> reads{ 0 };
+  std::atomic<size_t> bases{ 0 };
+  std::atomic<size_t> elements{ 0 };
+  std::atomic<size_t> hits{ 0 };
+  Checkpoint* checkpoint = nullptr;
+  std::unique_ptr<Filter> snapshot;
+  // Position to resume from, if any
+  bool resume = false;
+  size_t resume_source = 0;
+  size_t resume_record = 0;
+};
+
+template<typename Filter>
+inline FilterPipeline<Filter>::FilterPipeline(Filter& filter,
+                                              const Mode mode,
+                                              const unsigned threads)
+  : filter(filter)
+  , mode(mode)
+  , threads(threads)
+  , k(Ops::get_k(filter))
+  , hasher_hash_num(Ops::get_hasher_hash_num(filter))
+  , seeds(Ops::get_seeds(filter))
+  , value_num(Ops::get_value_num(filter))
+  , frame_hash_num(seeds.empty() ? hasher_hash_num
+                                 : seeds.size() * hasher_hash_num)
+  , frame_elements(frame_hash_num / Ops::get_hash_num(filter))
+{
+  check_error(threads == 0, "FilterPipeline: threads must be > 0.");
+  check_error(!Ops::INSERTS && mode != Mode::QUERY,
+              "FilterPipeline: The filter can only be queried.");
+}
+
+template<typename Filter>
+inline void
+FilterPipeline<Filter>::set_checkpoint(Checkpoint& checkpoint)
+{
+  check_error(!Ops::INSERTS || mode == Mode::QUERY,
+              "FilterPipeline: Only insertions can be checkpointed.");
+  this->checkpoint = &checkpoint;
+  if (checkpoint.exists()) {
+    const auto& state = checkpoint.get_state();
+    resume = true;
+    resume_source = state.source;
+    resume_record = state.record;
+    reads = state.get_counter("reads");
+    bases = state.get_counter("bases");
+    elements = state.get_counter("elements");
+    hits = state.get_counter("hits");
+  }
+}
+
+template<typename Filter>
+inline void
+FilterPipeline<Filter>::save_checkpoint(const size_t source,
+                                        const size_t record,
+                                        std::true_type)
+{
+  // The previous snapshot may still be being written
+  checkpoint->wait();
+  if (!snapshot) {
+    snapshot.reset(Ops::make_empty(filter));
+  }
+  snapshot->copy_from(filter);
+
+  Checkpoint::State state;
+  state.source = source;
+  state.record = record;
+  state.counters["reads"] = { uint64_t(reads) };
+  state.counters["bases"] = { uint64_t(bases) };
+  state.counters["elements"] = { uint64_t(elements) };
+  state.counters["hits"] = { uint64_t(hits) };
+  Filter* const to_save = snapshot.get();
+  checkpoint->save(std::move(state), [to_save](const std::string& path) {
+    to_save->save(path);
+    return std::vector<std::string>{ path };
+  });
+}
+
+template<typename Filter>
+inline void
+FilterPipeline<Filter>::run(const std::vector<std::string>& seq_paths,
+                            const unsigned reader_flags)
+{
+  using Block = OrderQueueMPMC<SeqReader::Record>::Block;
+  // Blocks are read on the calling thread and processed as tasks on the
+  // shared executor, at most `threads` at a time
+  std::mutex mutex;
+  std::condition_variable cv;
+  unsigned running = 0;
+  std::vector<std::unique_ptr<Scratch>> free_scratch;
+  TaskGroup group;
+  for (size_t source = 0; source < seq_paths.size(); source++) {
+    if (resume && source < resume_source) {
+      continue;
+    }
+    // Reads before this one were processed before the checkpoint resumed from
+    const size_t first_record =
+      resume && source == resume_source ? resume_record : 0;
+    size_t records_read = 0;
+    SeqReader reader(seq_paths[source], reader_flags);
+    for (;;) {
+      if (checkpoint != nullptr && checkpoint->due()) {
+        // Once the blocks in progress are done, the filter holds exactly the
+        // reads read so far
+        group.wait();
+        save_checkpoint(source,
+                        std::max(records_read, first_record),
+                        std::integral_constant<bool, Ops::INSERTS>());
+      }
+      std::shared_ptr<Block> records(new Block(reader.read_block()));
+      if (records->count == 0) {
+        break;
+      }
+      records_read = records->data[records->count - 1].num + 1;
+      size_t first = 0;
+      while (first < records->count &&
+             records->data[first].num < first_record) {
+        ++first;
+      }
+      if (first == records->count) {
+        continue;
+      }
+      std::unique_ptr<Scratch> scratch;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return running < threads; });
+        ++running;
+        if (!free_scratch.empty()) {
+          scratch = std::move(free_scratch.back());
+          free_scratch.pop_back();
+        }
+      }
+      if (!scratch) {
+        scratch.reset(new Scratch());
+      }
+      auto* const task_scratch = scratch.release();
+      group.run([&, records, first, task_scratch]() {
+        process_block(*records, first, *task_scratch);
+        const std::unique_lock<std::mutex> lock(mutex);
+        free_scratch.push_back(std::unique_ptr<Scratch>(task_scratch));
+        --running;
+        cv.notify_one();
+      });
+    }
+  }
+  group.wait();
+  resume = false;
+  if (checkpoint != nullptr) {
+    checkpoint->wait();
+  }
+}
+
+template<typename Filter>
+inline void
+FilterPipeline<Filter>::process_block(
+  const OrderQueueMPMC<SeqReader::Record>::Block& records,
+  const size_t first,
+  Scratch& scratch)
+{
+  // Totals are published once per block to keep the counters uncontended
+  size_t block_bases = 0, block_elements = 0, block_hits = 0;
+  for (size_t i = first; i < records.count; i++) {
+    const auto& record = records.data[i];
+    process(record, scratch);
+    block_bases += record.seq.size();
+    block_elements += scratch.result.elements;
+    block_hits += scratch.result.hits;
+    if (read_callback) {
+      read_callback(record, scratch.result);
+    }
+  }
+  reads += records.count - first;
+  bases += block_bases;
+  elements += block_elements;
+  hits += block_hits;
+  if (progress_callback) {
+    const std::unique_lock<std::mutex> lock(progress_mutex);
+    progress_callback(get_progress());
+  }
+}
+
+template<typename Filter>
+inline void
+FilterPipeline<Filter>::process(const SeqReader::Record& record,
+                                Scratch& scratch)
+{
+  auto& result = scratch.result;
+  result.num = record.num;
+  result.elements = 0;
+  result.hits = 0;
+  result.values.clear();
+  if (record.seq.size() < k) {
+    return;
+  }
+  // Hashers keep a pointer to the sequence, which outlives the call
+  if (seeds.empty()) {
+    if (scratch.nthash) {
+      scratch.nthash->change_seq(record.seq);
+    } else {
+      scratch.nthash =
+        std::unique_ptr<NtHash>(new NtHash(record.seq, hasher_hash_num, k));
+    }
+    process_frames(*scratch.nthash, scratch);
+  } else {
+    if (scratch.seed_nthash) {
+      scratch.seed_nthash->change_seq(record.seq);
+    } else {
+      scratch.seed_nthash = std::unique_ptr<SeedNtHash>(
+        new SeedNtHash(record.seq, seeds, hasher_hash_num, k));
+    }
+    process_frames(*scratch.seed_nthash, scratch);
+  }
+}
+
+template<typename Filter>
+template<typename Hasher>
+inline void
+FilterPipeline<Filter>::process_frames(Hasher& hasher, Scratch& scratch)
+{
+  auto& result = scratch.result;
+  if (scratch.hashes.size() < BATCH_SIZE * frame_hash_num) {
+    scratch.hashes.resize(BATCH_SIZE * frame_hash_num);
+    scratch.values.resize(BATCH_SIZE * frame_elements * value_num);
+  }
+  const bool keep_values = report_values && mode != Mode::INSERT;
+
+  bool more = true;
+  while (more) {
+    size_t batch = 0;
+    while (batch < BATCH_SIZE && (more = hasher.roll())) {
+      std::copy(hasher.hashes(),
+                hasher.hashes() + frame_hash_num,
+                scratch.hashes.data() + batch * frame_hash_num);
+      ++batch;
+    }
+    if (batch == 0) {
+      break;
+    }
+    const size_t batch_elements = batch * frame_elements;
+    result.hits += Ops::apply(filter,
+                              mode,
+                              scratch.hashes.data(),
+                              batch_elements,
+                              scratch.values.data(),
+                              scratch.ops);
+    result.elements += batch_elements;
+    if (keep_values) {
+      result.values.insert(result.values.end(),
+                           scratch.values.data(),
+                           scratch.values.data() + batch_elements * value_num);
+    }
+  }
+}
+
+} // namespace btllib
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef BTLLIB_INDEXED_SEQ_READER_HPP
+#define BTLLIB_INDEXED_SEQ_READER_HPP
+
+#include "btllib/bgzf.hpp"
+#include "btllib/seq_reader.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Random access to records of a FASTA or FASTQ file through a samtools
+ * compatible .fai index. FASTQ files are indexed with the 6 column variant
+ * of .fai used by `samtools fqidx`. Files compressed with bgzip are supported
+ * through their .gzi index. Missing indexes are built, in parallel, and saved
+ * next to the file. Threadsafe.
+ */
+class IndexedSeqReader
+{
+public:
+  enum class Format
+  {
+    FASTA,
+    FASTQ
+  };
+
+  /** One line of a .fai index. */
+  struct IndexEntry
+  {
+    std::string name;
+    /** Number of bases in the sequence. */
+    size_t length = 0;
+    /** Offset of the first base in the uncompressed file. */
+    uint64_t offset = 0;
+    /** Number of bases per line. */
+    size_t line_bases = 0;
+    /** Number of bytes per line, including the newline. */
+    size_t line_width = 0;
+    /** Offset of the first quality score. Only used for FASTQ files. */
+    uint64_t qual_offset = 0;
+  };
+
+  /** A region of a sequence. Coordinates are 0-based and half-open. */
+  struct Region
+  {
+    Region() = default;
+    Region(std::string name,
+           size_t start = 0,
+           size_t end = std::numeric_limits<size_t>::max())
+      : name(std::move(name))
+      , start(start)
+      , end(end)
+    {
+    }
+
+    std::string name;
+    size_t start = 0;
+    size_t end = std::numeric_limits<size_t>::max();
+  };
+
+  /**
+   * Construct an IndexedSeqReader for a FASTA or FASTQ file, optionally
+   * compressed with bgzip. If the .fai (and .gzi) index does not exist, it is
+   * built and saved.
+   *
+   * @param seq_path Path to the FASTA or FASTQ file.
+   * @param threads Number of threads to use for building the index and for
+   * fetching multiple regions at once.
+   */
+  IndexedSeqReader(const std::string& seq_path, unsigned threads = 3);
+
+  IndexedSeqReader(const IndexedSeqReader&) = delete;
+  IndexedSeqReader(IndexedSeqReader&&) = delete;
+
+  IndexedSeqReader& operator=(const IndexedSeqReader&) = delete;
+  IndexedSeqReader& operator=(IndexedSeqReader&&) = delete;
+
+  ~IndexedSeqReader();
+
+  void close() noexcept;
+
+  Format get_format() const { return format; }
+  bool is_compressed() const { return compressed; }
+
+  const std::vector<IndexEntry>& get_index() const { return index; }
+  size_t size() const { return index.size(); }
+  bool contains(const std::string& name) const
+  {
+    return name_to_num.find(name) != name_to_num.end();
+  }
+
+  /** Obtain the record with the given number, in file order. */
+  SeqReader::Record get(size_t num) const;
+
+  /** Obtain the record with the given name. */
+  SeqReader::Record get(const std::string& name) const;
+
+  /** Obtain part of a record. The region is clamped to the sequence. */
+  SeqReader::Record get(const Region& region) const;
+
+  /** Obtain multiple regions using the reader's threads. Results are in the
+   * same order as the given regions. */
+  std::vector<SeqReader::Record> get(const std::vector<Region>& regions) const;
+
+  /**
+   * Parse a samtools style region string: `name`, `name:beg` or
+   * `name:beg-end`, with 1-based inclusive coordinates.
+   *
+   * @param region Region string to parse.
+   *
+   * @return The parsed region.
+   */
+  static Region parse_region(const std::string& region);
+
+  /**
+   * Build the .fai index (and .gzi index for bgzipped files) for a file and
+   * save it next to the file.
+   *
+   * @param seq_path Path to the FASTA or FASTQ file.
+   * @param threads Number of threads to use.
+   */
+  static void build_index(const std::string& seq_path, unsigned threads = 3);
+
+  /** Size of the reads issued when scanning or fetching. */
+  static const size_t READ_SIZE = 1024 * 1024;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct BlockCache
+  {
+    size_t block_idx = std::numeric_limits<size_t>::max();
+    std::vector<char> cdata;
+    std::vector<char> udata;
+  };
+
+  class LineScanner;
+  /// @endcond
+
+  IndexedSeqReader(const std::string& seq_path, unsigned threads, bool load);
+
+  void open_source();
+  void load_index();
+  void build_index_entries();
+  void save_index() const;
+  void add_entry(IndexEntry entry);
+
+  std::vector<IndexEntry> build_index_range(uint64_t start,
+                                            uint64_t end,
+                                            uint64_t& next_start,
+                                            BlockCache& cache,
+                                            bool strict) const;
+  uint64_t find_record_start(uint64_t from, BlockCache& cache) const;
+
+  size_t read(uint64_t offset,
+              size_t size,
+              char* out,
+              BlockCache& cache) const;
+  std::string read_bases(const IndexEntry& entry,
+                         uint64_t first_offset,
+                         size_t start,
+                         size_t end,
+                         BlockCache& cache) const;
+  SeqReader::Record get(const Region& region, BlockCache& cache) const;
+
+  const std::string seq_path;
+  const unsigned threads;
+  int fd = -1;
+  bool compressed = false;
+  uint64_t uncompressed_size = 0;
+  std::vector<BgzfBlock> blocks;
+  bool gzi_loaded = false;
+  Format format = Format::FASTA;
+  std::vector<IndexEntry> index;
+  std::unordered_map<std::string, size_t> name_to_num;
+  std::atomic<bool> closed{ false };
+};
+
+} // namespace btllib
+
+#endif
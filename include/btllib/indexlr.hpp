@@ -2,6 +2,8 @@
 #define BTLLIB_INDEXLR_HPP
 
 #include "btllib/bloom_filter.hpp"
+#include "btllib/executor.hpp"
+#include "btllib/metrics.hpp"
 #include "btllib/nthash.hpp"
 #include "btllib/order_queue.hpp"
 #include "btllib/seq_reader.hpp"
@@ -10,12 +12,14 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -139,6 +143,13 @@ public:
    */
   Record read();
 
+  /**
+   * Obtain a whole block of records. Multiple threads can read blocks at
+   * once, and the block number gives the order of the blocks. A block with no
+   * records marks the end. Do not mix with read() on the same Indexlr.
+   */
+  OrderQueueLockFree<Record>::Block read_block();
+
   /**
    * Construct Indexlr to calculate minimizers from sequences at the given path.
    *
@@ -149,8 +160,8 @@ public:
    * @param q quality threshold to ignore potential minimizers.
    * @param flags Modifier flags. Specifiying either short or long mode flag is
    * mandatory; other flags are optional.
-   * @param threads Maximum number of processing threads to use. Must be at
-   * least 1.
+   * @param threads Maximum number of blocks minimized at once on the shared
+   * Executor. Must be at least 1.
    * @param verbose Whether to output informational messages during processing.
    * @param bf1 A Bloom filter to use for either filtering minimizers in or out,
    * if one of the flags is enabled. If both are enabled, bf1 is used for
@@ -224,26 +235,30 @@ public:
 private:
   static std::string extract_barcode(const std::string& id,
                                      const std::string& comment);
-  static void filter_hashed_kmer(Indexlr::HashedKmer& hk,
-                                 bool filter_in,
-                                 bool filter_out,
-                                 const BloomFilter& filter_in_bf,
-                                 const BloomFilter& filter_out_bf);
-
-  static void filter_kmer_qual(Indexlr::HashedKmer& hk,
-                               const std::string& kmer_qual,
-                               size_t q);
-  static size_t calc_kmer_quality(const std::string& qual);
-
-  static void calc_minimizer(
-    const std::vector<Indexlr::HashedKmer>& hashed_kmers_buffer,
-    const Indexlr::Minimizer*& min_current,
-    size_t idx,
-    ssize_t& min_idx_left,
-    ssize_t& min_idx_right,
-    ssize_t& min_pos_prev,
-    size_t w,
-    std::vector<Indexlr::Minimizer>& minimizers);
+  static void calc_qual_sums(const std::string& qual,
+                             std::vector<uint64_t>& qual_sums);
+
+  /// @cond HIDDEN_SYMBOLS
+  // Per thread ring buffers of minimize(), indexed by k-mer number modulo a
+  // power of two no smaller than w. Kept as separate arrays, so that the
+  // window scan only touches hashes and indices
+  struct MinimizeBuffer
+  {
+    std::vector<uint64_t> min_hashes;
+    std::vector<uint64_t> out_hashes;
+    std::vector<size_t> positions;
+    std::vector<uint8_t> forward;
+    // Monotone deque of k-mer numbers with increasing hashes. The front is
+    // the right-most minimum of the window
+    std::vector<size_t> deque;
+    // Prefix sums of the base qualities of the read, when filtering by quality
+    std::vector<uint64_t> qual_sums;
+  };
+  /// @endcond
+
+  bool passes_filters(uint64_t min_hash,
+                      const uint64_t* qual_sums,
+                      size_t pos) const;
   std::vector<Minimizer> minimize(const std::string& seq,
                                   const std::string& qual) const;
 
@@ -267,7 +282,7 @@ private:
   bool filter_out_enabled;
 
   SeqReader reader;
-  OrderQueueMPSC<Record> output_queue;
+  OrderQueueLockFree<Record> output_queue;
 
   using OutputQueueType = decltype(output_queue);
   static std::unique_ptr<OutputQueueType::Block>* ready_blocks_array()
@@ -295,43 +310,22 @@ private:
     return var;
   }
 
-  class Worker
-  {
-  public:
-    void start() { t = std::thread(do_work, this); }
-    void join() { t.join(); }
-    void set_id(const int id) { this->id = id; }
-
-    Worker& operator=(const Worker& worker) = delete;
-    Worker& operator=(Worker&& worker) = delete;
-
-    Worker(Indexlr& indexlr)
-      : indexlr(indexlr)
-    {
-    }
-    Worker(const Worker& worker)
-      : Worker(worker.indexlr)
-    {
-    }
-    Worker(Worker&& worker) noexcept
-      : Worker(worker.indexlr)
-    {
-    }
-
-  private:
-    void work();
-    static void do_work(Worker* worker) { worker->work(); }
-
-    int id = -1;
-    Indexlr& indexlr;
-    std::thread t;
-  };
-
-  std::vector<Worker> workers;
-  Barrier end_barrier;
-  std::mutex last_block_num_mutex;
-  uint64_t last_block_num = 0;
-  bool last_block_num_valid = false;
+  using InputBlock = decltype(std::declval<SeqReader>().read_block());
+
+  void dispatch();
+  void wait_for_room();
+  void minimize_block(InputBlock& input_block);
+
+  // A dispatcher thread reads blocks from the reader and minimizes each of
+  // them as a task on the shared executor, at most `threads` at a time
+  const unsigned threads;
+  std::unique_ptr<std::thread> dispatcher;
+  TaskGroup minimizing;
+  std::atomic<size_t> dispatched_blocks{ 0 };
+  std::atomic<size_t> delivered_blocks{ 0 };
+  std::atomic<unsigned> minimizing_blocks{ 0 };
+  std::mutex room_mutex;
+  std::condition_variable room_cv;
 };
 
 // Constructor for Indexlr class when q is specified
@@ -359,8 +353,7 @@ inline Indexlr::Indexlr(std::string seqfile,
            short_mode() ? SeqReader::Flag::SHORT_MODE
                         : SeqReader::Flag::LONG_MODE)
   , output_queue(reader.get_buffer_size(), reader.get_block_size())
-  , workers(std::vector<Worker>(threads, Worker(*this)))
-  , end_barrier(threads)
+  , threads(threads)
 {
   check_error(!short_mode() && !long_mode(),
               "Indexlr: no mode selected, either short or long mode flag must "
@@ -369,11 +362,8 @@ inline Indexlr::Indexlr(std::string seqfile,
               "Indexlr: short and long mode are mutually exclusive.");
   check_error(threads == 0,
               "Indexlr: Number of processing threads cannot be 0.");
-  int id_counter = 0;
-  for (auto& worker : workers) {
-    worker.set_id(id_counter++);
-    worker.start();
-  }
+  dispatcher = std::unique_ptr<std::thread>(
+    new std::thread([this]() { dispatch(); }));
 }
 
 // Constructor for Indexlr class when q is not specified
@@ -400,11 +390,13 @@ Indexlr::close() noexcept
   bool closed_expected = false;
   if (closed.compare_exchange_strong(closed_expected, true)) {
     try {
+      {
+        const std::unique_lock<std::mutex> lock(room_mutex);
+        room_cv.notify_all();
+      }
       reader.close();
       output_queue.close();
-      for (auto& worker : workers) {
-        worker.join();
-      }
+      dispatcher->join();
     } catch (const std::system_error& e) {
       log_error("Indexlr thread join failure: " + std::string(e.what()));
       std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
@@ -428,12 +420,16 @@ Initial conditions
     l    = 0         Index of left end of window
     r    = l + w - 1 Index of right end of window
 Computation
-At each window, if the previous minimum is out of scope, find the new,
-right-most, minimum or else, check with only the right-most element to determine
-if that is the new minimum. A minimizer is added to the final vector only if
-it's index has changed. for each window of v bounded by [l, r] if (i < l) i =
-index of minimum element in [l, r], furthest from l. else if (v[r] <= v[i]) i =
-r min = v[i] if (i != prev) { prev = i M <- M + m
+The right-most minimum of each window is kept at the front of a deque of
+indices whose values increase from front to back. Each new element pops the
+elements at the back that are no smaller than it, and elements that leave the
+window are popped from the front, so every element is pushed and popped once.
+A minimizer is added to the final vector only if its index has changed.
+for each window of v bounded by [l, r]
+    pop front while front < l
+    pop back while v[back] >= v[r], push back r
+    i = front, min = v[i]
+    if (i != prev) { prev = i M <- M + m
     }
     l = l + 1        Move window's left bound by one element
     r = l + w - 1    Set window's right bound
@@ -461,93 +457,34 @@ Indexlr::extract_barcode(const std::string& id, const std::string& comment)
   return "NA";
 }
 
+// Any k-mer's quality sum is then the difference of two prefix sums
 inline void
-Indexlr::filter_hashed_kmer(Indexlr::HashedKmer& hk,
-                            bool filter_in,
-                            bool filter_out,
-                            const BloomFilter& filter_in_bf,
-                            const BloomFilter& filter_out_bf)
+Indexlr::calc_qual_sums(const std::string& qual,
+                        std::vector<uint64_t>& qual_sums)
 {
-  if (filter_in && filter_out) {
-    std::vector<uint64_t> tmp;
-    tmp = { hk.min_hash };
-    if (!filter_in_bf.contains(tmp) || filter_out_bf.contains(tmp)) {
-      hk.min_hash = std::numeric_limits<uint64_t>::max();
-    }
-  } else if (filter_in) {
-    if (!filter_in_bf.contains({ hk.min_hash })) {
-      hk.min_hash = std::numeric_limits<uint64_t>::max();
-    }
-  } else if (filter_out) {
-    if (filter_out_bf.contains({ hk.min_hash })) {
-      hk.min_hash = std::numeric_limits<uint64_t>::max();
-    }
-  }
-}
-
-inline void
-Indexlr::filter_kmer_qual(Indexlr::HashedKmer& hk,
-                          const std::string& kmer_qual,
-                          size_t q)
-{
-  if (calc_kmer_quality(kmer_qual) < q) {
-    hk.min_hash = std::numeric_limits<uint64_t>::max();
-  }
-}
-
-inline size_t
-Indexlr::calc_kmer_quality(const std::string& qual)
-{
-  // convert the quality scores to integers
-  std::vector<int> qual_ints;
   const int thirty_three = 33;
-  qual_ints.reserve(qual.size());
-  for (auto c : qual) {
-    qual_ints.push_back(c - thirty_three);
-  }
-  // calculate the mean (potential improvement: use other statistics)
-  size_t sum = 0;
-  for (auto q : qual_ints) {
-    sum += q;
+  qual_sums.resize(qual.size() + 1);
+  uint64_t sum = 0;
+  qual_sums[0] = 0;
+  for (size_t i = 0; i < qual.size(); i++) {
+    sum += uint64_t(qual[i] - thirty_three);
+    qual_sums[i + 1] = sum;
   }
-  return (sum / qual_ints.size());
 }
 
-inline void
-Indexlr::calc_minimizer(
-  const std::vector<Indexlr::HashedKmer>& hashed_kmers_buffer,
-  const Indexlr::Minimizer*& min_current,
-  const size_t idx,
-  ssize_t& min_idx_left,
-  ssize_t& min_idx_right,
-  ssize_t& min_pos_prev,
-  const size_t w,
-  std::vector<Indexlr::Minimizer>& minimizers)
+inline bool
+Indexlr::passes_filters(const uint64_t min_hash,
+                        const uint64_t* qual_sums,
+                        const size_t pos) const
 {
-  min_idx_left = ssize_t(idx + 1 - w);
-  min_idx_right = ssize_t(idx + 1);
-  const auto& min_left =
-    hashed_kmers_buffer[min_idx_left % hashed_kmers_buffer.size()];
-  const auto& min_right =
-    hashed_kmers_buffer[(min_idx_right - 1) % hashed_kmers_buffer.size()];
-
-  if (min_current == nullptr || min_current->pos < min_left.pos) {
-    min_current = &min_left;
-    // Use of operator '<=' returns the minimum that is furthest from left.
-    for (ssize_t i = min_idx_left; i < min_idx_right; i++) {
-      const auto& min_i = hashed_kmers_buffer[i % hashed_kmers_buffer.size()];
-      if (min_i.min_hash <= min_current->min_hash) {
-        min_current = &min_i;
-      }
-    }
-  } else if (min_right.min_hash <= min_current->min_hash) {
-    min_current = &min_right;
+  if (filter_in() && !filter_in_bf.get().contains(&min_hash)) {
+    return false;
   }
-  if (ssize_t(min_current->pos) > min_pos_prev &&
-      min_current->min_hash != std::numeric_limits<uint64_t>::max()) {
-    min_pos_prev = ssize_t(min_current->pos);
-    minimizers.push_back(*min_current);
+  if (filter_out() && filter_out_bf.get().contains(&min_hash)) {
+    return false;
   }
+  // The mean quality, rounded down, is at least q
+  return q == 0 || qual_sums[pos + k] - qual_sums[pos] >= q * k;
 }
 
 inline std::vector<Indexlr::Minimizer>
@@ -558,38 +495,84 @@ Indexlr::minimize(const std::string& seq, const std::string& qual) const
   }
   std::vector<Minimizer> minimizers;
   minimizers.reserve(2 * (seq.size() - k + 1) / w);
-  std::vector<HashedKmer> hashed_kmers_buffer(w + 1);
-  ssize_t min_idx_left, min_idx_right, min_pos_prev = -1;
-  const Minimizer* min_current = nullptr;
-  size_t idx = 0;
-  for (NtHash nh(seq, 2, k); nh.roll(); ++idx) {
-    auto& hk = hashed_kmers_buffer[idx % hashed_kmers_buffer.size()];
 
-    hk = HashedKmer(nh.hashes()[0],
-                    nh.hashes()[1],
-                    nh.get_pos(),
-                    nh.forward(),
-                    output_seq() ? seq.substr(nh.get_pos(), k) : "",
-                    output_qual() ? qual.substr(nh.get_pos(), k) : "");
+  thread_local static MinimizeBuffer buffer;
+  size_t capacity = 1;
+  while (capacity < w) {
+    capacity *= 2;
+  }
+  const size_t mask = capacity - 1;
+  if (buffer.min_hashes.size() < capacity) {
+    buffer.min_hashes.resize(capacity);
+    buffer.out_hashes.resize(capacity);
+    buffer.positions.resize(capacity);
+    buffer.forward.resize(capacity);
+    buffer.deque.resize(capacity);
+  }
+  const uint64_t* qual_sums = nullptr;
+  if (q > 0) {
+    if (qual.size() != seq.size()) {
+      log_error("Indexlr: Filtering by quality requires quality strings.");
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+    calc_qual_sums(qual, buffer.qual_sums);
+    qual_sums = buffer.qual_sums.data();
+  }
+  uint64_t* const min_hashes = buffer.min_hashes.data();
+  size_t* const deque = buffer.deque.data();
+  size_t head = 0, tail = 0;
+  const auto push = [&](const size_t idx) {
+    const uint64_t min_hash = min_hashes[idx & mask];
+    // Popping equal hashes keeps the right-most minimum at the front
+    while (tail > head &&
+           min_hashes[deque[(tail - 1) & mask] & mask] >= min_hash) {
+      --tail;
+    }
+    deque[tail++ & mask] = idx;
+  };
 
-    filter_hashed_kmer(
-      hk, filter_in(), filter_out(), filter_in_bf.get(), filter_out_bf.get());
+  // K-mers that fail the filters take the largest hash, so they are only
+  // the window minimum when every k-mer of the window failed
+  const uint64_t filtered = std::numeric_limits<uint64_t>::max();
+  const bool filtering = filter_in() || filter_out() || q > 0;
+  ssize_t min_pos_prev = -1;
+  size_t idx = 0;
+  for (NtHash nh(seq, 2, k); nh.roll(); ++idx) {
+    const size_t slot = idx & mask;
+    min_hashes[slot] = nh.hashes()[0];
+    buffer.out_hashes[slot] = nh.hashes()[1];
+    buffer.positions[slot] = nh.get_pos();
+    buffer.forward[slot] = uint8_t(nh.forward());
+    if (filtering &&
+        !passes_filters(min_hashes[slot], qual_sums, nh.get_pos())) {
+      BTLLIB_METRIC_ADD(INDEXLR_FILTER_REJECTS, 1);
+      min_hashes[slot] = filtered;
+    }
 
-    if (q > 0) {
-      filter_kmer_qual(hk, qual.substr(nh.get_pos(), k), q);
+    const size_t left = idx + 1 >= w ? idx + 1 - w : 0;
+    while (tail > head && deque[head & mask] < left) {
+      ++head;
+    }
+    push(idx);
+    if (idx + 1 < w) {
+      continue;
     }
 
-    if (idx + 1 >= w) {
-      calc_minimizer(hashed_kmers_buffer,
-                     min_current,
-                     idx,
-                     min_idx_left,
-                     min_idx_right,
-                     min_pos_prev,
-                     w,
-                     minimizers);
+    const size_t min_slot = deque[head & mask] & mask;
+    if (ssize_t(buffer.positions[min_slot]) > min_pos_prev &&
+        min_hashes[min_slot] != filtered) {
+      const size_t pos = buffer.positions[min_slot];
+      min_pos_prev = ssize_t(pos);
+      minimizers.emplace_back(min_hashes[min_slot],
+                              buffer.out_hashes[min_slot],
+                              pos,
+                              bool(buffer.forward[min_slot]),
+                              output_seq() ? seq.substr(pos, k) : "",
+                              output_qual() ? qual.substr(pos, k) : "");
     }
   }
+  BTLLIB_METRIC_ADD(INDEXLR_KMERS, idx);
+  BTLLIB_METRIC_ADD(INDEXLR_MINIMIZERS, minimizers.size());
   return minimizers;
 }
 
@@ -613,93 +596,124 @@ Indexlr::read()
       block = decltype(output_queue)::Block(reader.get_block_size());
       return Record();
     }
+    ++delivered_blocks;
+    {
+      const std::unique_lock<std::mutex> lock(room_mutex);
+      room_cv.notify_one();
+    }
     current = 0;
   }
   return std::move(block.data[current++]);
 }
 
+inline OrderQueueLockFree<Indexlr::Record>::Block
+Indexlr::read_block()
+{
+  decltype(output_queue)::Block block(reader.get_block_size());
+  output_queue.read(block);
+  if (block.count == 0) {
+    output_queue.close();
+  } else {
+    ++delivered_blocks;
+    const std::unique_lock<std::mutex> lock(room_mutex);
+    room_cv.notify_one();
+  }
+  return block;
+}
+
 inline void
-Indexlr::Worker::work()
+Indexlr::dispatch()
 {
-  decltype(indexlr.output_queue)::Block output_block(
-    indexlr.reader.get_block_size());
-  uint64_t last_block_num = 0;
-  bool last_block_num_valid = false;
   for (;;) {
-    auto input_block = indexlr.reader.read_block();
+    auto input_block = reader.read_block();
     if (input_block.count == 0) {
       break;
     }
+    wait_for_room();
+    if (closed) {
+      break;
+    }
+    ++dispatched_blocks;
+    ++minimizing_blocks;
+    // Tasks have to be copyable
+    std::shared_ptr<InputBlock> block(new InputBlock(std::move(input_block)));
+    minimizing.run([this, block]() {
+      minimize_block(*block);
+      --minimizing_blocks;
+      const std::unique_lock<std::mutex> lock(room_mutex);
+      room_cv.notify_one();
+    });
+  }
+  minimizing.wait();
+  // Blocks are numbered in the order the reader delivered them, so the end
+  // marker follows the last one
+  decltype(output_queue)::Block end_block(0);
+  end_block.num = dispatched_blocks;
+  output_queue.write(end_block);
+}
 
-    output_block.num = input_block.num;
-    for (size_t idx = 0; idx < input_block.count; idx++) {
-      Record record;
-      auto& reader_record = input_block.data[idx];
-      record.num = reader_record.num;
-      if (indexlr.output_bx()) {
-        record.barcode =
-          indexlr.extract_barcode(reader_record.id, reader_record.comment);
-      }
-      if (indexlr.output_id()) {
-        record.id = std::move(reader_record.id);
-      }
-
-      record.readlen = reader_record.seq.size();
-
-      check_info(indexlr.verbose && indexlr.k > record.readlen,
-                 "Indexlr: skipped seq " + std::to_string(record.num) +
-                   " on line " +
-                   std::to_string(record.num * (indexlr.reader.get_format() ==
-                                                    SeqReader::Format::FASTA
-                                                  ? 2
-                                                  : 4) +
-                                  2) +
-                   "; k (" + std::to_string(indexlr.k) + ") > seq length (" +
-                   std::to_string(record.readlen) + ")");
-
-      check_info(indexlr.verbose && indexlr.w > record.readlen - indexlr.k + 1,
-                 "Indexlr: skipped seq " + std::to_string(record.num) +
-                   " on line " +
-                   std::to_string(record.num * (indexlr.reader.get_format() ==
-                                                    SeqReader::Format::FASTA
-                                                  ? 2
-                                                  : 4) +
-                                  2) +
-                   "; w (" + std::to_string(indexlr.w) + ") > # of hashes (" +
-                   std::to_string(record.readlen - indexlr.k + 1) + ")");
-
-      if (indexlr.k <= record.readlen &&
-          indexlr.w <= record.readlen - indexlr.k + 1) {
-        record.minimizers =
-          indexlr.minimize(reader_record.seq, reader_record.qual);
-      } else {
-        record.minimizers = {};
-      }
+inline void
+Indexlr::wait_for_room()
+{
+  // Blocks in flight are bounded by the output queue size, so that tasks
+  // never wait to write their output
+  std::unique_lock<std::mutex> lock(room_mutex);
+  room_cv.wait(lock, [&]() {
+    return (dispatched_blocks - delivered_blocks < reader.get_buffer_size() &&
+            minimizing_blocks < threads) ||
+           closed;
+  });
+}
 
-      output_block.data[output_block.count++] = std::move(record);
+inline void
+Indexlr::minimize_block(InputBlock& input_block)
+{
+  decltype(output_queue)::Block output_block(input_block.count);
+  output_block.num = input_block.num;
+  for (size_t idx = 0; idx < input_block.count; idx++) {
+    Record record;
+    auto& reader_record = input_block.data[idx];
+    record.num = reader_record.num;
+    if (output_bx()) {
+      record.barcode = extract_barcode(reader_record.id, reader_record.comment);
     }
-    if (output_block.count > 0) {
-      last_block_num = output_block.num;
-      last_block_num_valid = true;
-      indexlr.output_queue.write(output_block);
-      output_block.count = 0;
+    if (output_id()) {
+      record.id = std::move(reader_record.id);
     }
+
+    record.readlen = reader_record.seq.size();
+
+    check_info(verbose && k > record.readlen,
+               "Indexlr: skipped seq " + std::to_string(record.num) +
+                 " on line " +
+                 std::to_string(record.num * (reader.get_format() ==
+                                                  SeqReader::Format::FASTA
+                                                ? 2
+                                                : 4) +
+                                2) +
+                 "; k (" + std::to_string(k) + ") > seq length (" +
+                 std::to_string(record.readlen) + ")");
+
+    check_info(verbose && w > record.readlen - k + 1,
+               "Indexlr: skipped seq " + std::to_string(record.num) +
+                 " on line " +
+                 std::to_string(record.num * (reader.get_format() ==
+                                                  SeqReader::Format::FASTA
+                                                ? 2
+                                                : 4) +
+                                2) +
+                 "; w (" + std::to_string(w) + ") > # of hashes (" +
+                 std::to_string(record.readlen - k + 1) + ")");
+
+    if (k <= record.readlen && w <= record.readlen - k + 1) {
+      record.minimizers = minimize(reader_record.seq, reader_record.qual);
+    } else {
+      record.minimizers = {};
+    }
+
+    output_block.data[output_block.count++] = std::move(record);
   }
-  if (last_block_num_valid) {
-    std::unique_lock<std::mutex> lock(indexlr.last_block_num_mutex);
-    indexlr.last_block_num = std::max(indexlr.last_block_num, last_block_num);
-    indexlr.last_block_num_valid = true;
-    lock.unlock();
-  }
-  indexlr.end_barrier.wait();
-  if (last_block_num_valid && indexlr.last_block_num_valid &&
-      last_block_num == indexlr.last_block_num) {
-    output_block.num = last_block_num + 1;
-    indexlr.output_queue.write(output_block);
-  } else if (!indexlr.last_block_num_valid && id == 0) {
-    output_block.num = 0;
-    indexlr.output_queue.write(output_block);
-  }
+  output_queue.write(output_block);
 }
 
 } // namespace btllib
@@ -0,0 +1,248 @@
+#ifndef BTLLIB_INDEXLR_BINARY_HPP
+#define BTLLIB_INDEXLR_BINARY_HPP
+
+#include "btllib/indexlr.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Binary file formats for Indexlr records, avoiding the cost of formatting and
+ * parsing decimal text. A file starts with a 32 byte header, and all integers
+ * are little-endian.
+ *
+ * The RECORDS layout is a stream of records, each a fixed 32 byte header
+ * (number, read length, ID length, barcode length and minimizer count),
+ * followed by the ID and barcode and 24 bytes per minimizer (minimizer hash,
+ * output hash, and position shifted left by one with the strand in the low
+ * bit). If the file holds minimizer sequences or quality strings, k bytes of
+ * each follow the minimizers.
+ *
+ * The COLUMNAR layout groups records into zlib compressed blocks. Within a
+ * block, each field is stored as a column, and record numbers, lengths and
+ * minimizer positions are delta and variable length encoded.
+ */
+struct IndexlrBinary
+{
+  enum Layout
+  {
+    RECORDS = 0,
+    COLUMNAR = 1
+  };
+
+  /** Fields stored in addition to IDs, barcodes, hashes and positions. */
+  enum Field
+  {
+    SEQ = 1,
+    QUAL = 2
+  };
+
+  static constexpr const char MAGIC[] = "BTLIDXLR";
+  static const uint32_t VERSION = 1;
+  static const size_t HEADER_SIZE = 32;
+  static const size_t RECORD_HEADER_SIZE = 32;
+  static const size_t MINIMIZER_SIZE = 24;
+};
+
+/** Write Indexlr records in one of the IndexlrBinary layouts. Not threadsafe.
+ */
+class IndexlrWriter
+{
+
+public:
+  /**
+   * Construct a writer.
+   *
+   * @param sink_path Filepath to write to. Pass "-" to write to stdout.
+   * @param k k-mer size of the minimizers.
+   * @param w Window size the minimizers were selected with.
+   * @param fields IndexlrBinary::Field bits for the optional fields to store.
+   * @param layout Layout to write the records in.
+   */
+  IndexlrWriter(const std::string& sink_path,
+                size_t k,
+                size_t w,
+                unsigned fields = 0,
+                IndexlrBinary::Layout layout = IndexlrBinary::RECORDS);
+
+  IndexlrWriter(const IndexlrWriter&) = delete;
+  IndexlrWriter(IndexlrWriter&&) = delete;
+
+  IndexlrWriter& operator=(const IndexlrWriter&) = delete;
+  IndexlrWriter& operator=(IndexlrWriter&&) = delete;
+
+  ~IndexlrWriter();
+
+  /** Write out any buffered records and close the file. */
+  void close();
+
+  /** Write a record. */
+  void write(const Indexlr::Record& record);
+
+  /** Number of records per COLUMNAR block. */
+  static const size_t COLUMNAR_BLOCK_RECORDS = 4096;
+  /** Bytes of RECORDS output buffered before writing. */
+  static const size_t BUFFER_SIZE = 1024 * 1024;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  // Columns of a COLUMNAR block being built
+  struct Columns
+  {
+    size_t records = 0;
+    uint64_t last_num = 0;
+    std::string lengths;
+    std::string names;
+    std::string hashes;
+    std::string positions;
+    std::string strands;
+    std::string seqs;
+    std::string quals;
+    size_t strand_bits = 0;
+  };
+  /// @endcond
+
+  void write_record(const Indexlr::Record& record);
+  void add_columns(const Indexlr::Record& record);
+  void flush_columns();
+  void flush();
+
+  const std::string sink_path;
+  const size_t k;
+  const unsigned fields;
+  const IndexlrBinary::Layout layout;
+  FILE* sink;
+  bool closed = false;
+  std::string buffer;
+  Columns columns;
+};
+
+/**
+ * Read Indexlr records written by IndexlrWriter. The file is memory mapped,
+ * so RECORDS files are read in place without copying or parsing. Not
+ * threadsafe.
+ */
+class IndexlrReader
+{
+
+public:
+  /**
+   * Construct a reader.
+   *
+   * @param source_path Filepath to read from.
+   */
+  IndexlrReader(const std::string& source_path);
+
+  IndexlrReader(const IndexlrReader&) = delete;
+  IndexlrReader(IndexlrReader&&) = delete;
+
+  IndexlrReader& operator=(const IndexlrReader&) = delete;
+  IndexlrReader& operator=(IndexlrReader&&) = delete;
+
+  ~IndexlrReader();
+
+  /** Release the file mapping. */
+  void close() noexcept;
+
+  /**
+   * Read the next record.
+   *
+   * @return The record, which converts to false once the end of the file is
+   * reached.
+   */
+  Indexlr::Record read();
+
+  /** Get the k-mer size of the minimizers. */
+  size_t get_k() const { return k; }
+
+  /** Get the window size the minimizers were selected with. */
+  size_t get_w() const { return w; }
+
+  /** Get the IndexlrBinary::Field bits of the fields stored. */
+  unsigned get_fields() const { return fields; }
+
+  /** Get the layout of the file. */
+  IndexlrBinary::Layout get_layout() const { return layout; }
+
+  /// @cond HIDDEN_SYMBOLS
+  class RecordIterator
+  {
+  public:
+    void operator++() { record = reader.read(); }
+    bool operator!=(const RecordIterator& i)
+    {
+      return bool(record) || bool(i.record);
+    }
+    Indexlr::Record operator*() { return std::move(record); }
+    // For wrappers
+    Indexlr::Record next()
+    {
+      auto val = operator*();
+      operator++();
+      return val;
+    }
+
+  private:
+    friend IndexlrReader;
+
+    RecordIterator(IndexlrReader& reader, bool end)
+      : reader(reader)
+    {
+      if (!end) {
+        operator++();
+      }
+    }
+
+    IndexlrReader& reader;
+    Indexlr::Record record;
+  };
+  /// @endcond
+
+  RecordIterator begin() { return RecordIterator(*this, false); }
+  RecordIterator end() { return RecordIterator(*this, true); }
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  // Unread part of a column of the current COLUMNAR block
+  struct Column
+  {
+    const char* pos = nullptr;
+    const char* end = nullptr;
+  };
+
+  struct ColumnCursors
+  {
+    Column lengths, names, hashes, positions, strands, seqs, quals;
+    size_t strand_bit = 0;
+  };
+  /// @endcond
+
+  Indexlr::Record read_record();
+  Indexlr::Record read_columns();
+  bool load_block();
+  void check_available(size_t bytes) const;
+  const char* take(Column& column, size_t bytes) const;
+  uint64_t take_varint(Column& column) const;
+
+  const std::string source_path;
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+  const char* cursor = nullptr;
+  const char* end_of_data = nullptr;
+  size_t k = 0;
+  size_t w = 0;
+  unsigned fields = 0;
+  IndexlrBinary::Layout layout = IndexlrBinary::RECORDS;
+  std::vector<char> block;
+  size_t block_records = 0;
+  uint64_t last_num = 0;
+  ColumnCursors columns;
+};
+
+} // namespace btllib
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * Counters for the hot paths of the library.
+ */
+#ifndef BTLLIB_METRICS_HPP
+#define BTLLIB_METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace btllib {
+
+/**
+ * Counters kept by the library. They are only updated if the library, and
+ * the code including its headers, is compiled with BTLLIB_METRICS defined
+ * (the `metrics` Meson option). Otherwise the instrumentation compiles to
+ * nothing and every counter stays at 0. Times are in nanoseconds.
+ */
+enum class Metric : unsigned
+{
+  /** Bytes of header, sequence and quality parsed by SeqReaders. */
+  SEQREADER_BYTES,
+  /** Records parsed by SeqReaders. */
+  SEQREADER_RECORDS,
+  /** Time SeqReader reader threads waited for room for another block. */
+  SEQREADER_READER_BLOCKED_NS,
+  /** Time SeqReader blocks waited on the executor to be converted. */
+  SEQREADER_PROCESSOR_BLOCKED_NS,
+  /** Time SeqReader consumers waited for a block of records. */
+  SEQREADER_CONSUMER_BLOCKED_NS,
+  /** Blocks written to order queues. */
+  ORDER_QUEUE_WRITES,
+  /** Blocks read from order queues. */
+  ORDER_QUEUE_READS,
+  /** Time order queue writers waited for their slot. */
+  ORDER_QUEUE_WRITE_WAIT_NS,
+  /** Time order queue readers waited for the next block. */
+  ORDER_QUEUE_READ_WAIT_NS,
+  /** Blocks queued right after each write, summed. Divided by the number of
+   * writes, it gives the average queue occupancy. */
+  ORDER_QUEUE_OCCUPANCY,
+  /** k-mers hashed by Indexlr. */
+  INDEXLR_KMERS,
+  /** Minimizers output by Indexlr. */
+  INDEXLR_MINIMIZERS,
+  /** Indexlr minimizer candidates rejected by the quality and Bloom filter
+   * checks. */
+  INDEXLR_FILTER_REJECTS,
+  /** Elements inserted into Bloom filters. */
+  BLOOM_FILTER_INSERTS,
+  /** Elements queried in Bloom filters. */
+  BLOOM_FILTER_QUERIES,
+  /** Elements inserted into counting Bloom filters. */
+  COUNTING_BLOOM_FILTER_INSERTS,
+  /** Counter lookups of counting Bloom filters, including the ones inserts
+   * make to find the counters to increment. */
+  COUNTING_BLOOM_FILTER_QUERIES,
+  /** Compare-and-swaps of counting Bloom filter inserts that were retried
+   * because another thread changed the counters first. */
+  COUNTING_BLOOM_FILTER_CAS_RETRIES,
+  /// @cond HIDDEN_SYMBOLS
+  COUNT
+  /// @endcond
+};
+
+/// @cond HIDDEN_SYMBOLS
+static const unsigned METRIC_COUNT = unsigned(Metric::COUNT);
+
+// Counters of a single thread. Only the owning thread writes them, so adding
+// to them needs no atomic read-modify-write.
+struct MetricsShard
+{
+  MetricsShard();
+  ~MetricsShard();
+
+  MetricsShard(const MetricsShard&) = delete;
+  MetricsShard(MetricsShard&&) = delete;
+
+  MetricsShard& operator=(const MetricsShard&) = delete;
+  MetricsShard& operator=(MetricsShard&&) = delete;
+
+  std::atomic<uint64_t> values[METRIC_COUNT];
+};
+
+inline MetricsShard&
+get_metrics_shard()
+{
+  thread_local static MetricsShard shard;
+  return shard;
+}
+/// @endcond
+
+/** Whether the library was compiled with BTLLIB_METRICS defined. */
+bool
+metrics_enabled();
+
+/**
+ * Add to a counter of the calling thread. Used through BTLLIB_METRIC_ADD, so
+ * that it compiles to nothing when metrics are disabled.
+ *
+ * @param metric Counter to add to.
+ * @param n Amount to add.
+ */
+inline void
+metric_add(const Metric metric, const uint64_t n)
+{
+  auto& value = get_metrics_shard().values[unsigned(metric)];
+  value.store(value.load(std::memory_order_relaxed) + n,
+              std::memory_order_relaxed);
+}
+
+/**
+ * Get the total of a counter over all threads, including threads that have
+ * exited.
+ *
+ * @param metric Counter to get.
+ */
+uint64_t
+get_metric(Metric metric);
+
+/**
+ * Get the name of a counter, e.g. "seqreader_bytes".
+ *
+ * @param metric Counter to get the name of.
+ */
+const char*
+get_metric_name(Metric metric);
+
+/** Set all counters of all threads to 0. */
+void
+reset_metrics();
+
+/**
+ * Get the totals of all counters as a JSON object, keyed by counter name.
+ */
+std::string
+get_metrics_json();
+
+/**
+ * Get the totals of all counters in the Prometheus text exposition format.
+ * Each counter is named "btllib_<name>_total".
+ */
+std::string
+get_metrics_prometheus();
+
+} // namespace btllib
+
+#ifdef BTLLIB_METRICS
+#define BTLLIB_METRIC_ADD(METRIC, N)                                           \
+  btllib::metric_add(btllib::Metric::METRIC, uint64_t(N))
+#define BTLLIB_METRIC_TIMER(NAME)                                              \
+  const auto NAME = std::chrono::steady_clock::now()
+#define BTLLIB_METRIC_ADD_ELAPSED(METRIC, TIMER)                               \
+  BTLLIB_METRIC_ADD(METRIC,                                                    \
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(      \
+                      std::chrono::steady_clock::now() - (TIMER))              \
+                      .count())
+#else
+#define BTLLIB_METRIC_ADD(METRIC, N)
+#define BTLLIB_METRIC_TIMER(NAME)
+#define BTLLIB_METRIC_ADD_ELAPSED(METRIC, TIMER)
+#endif
+
+#endif
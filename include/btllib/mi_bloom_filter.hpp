@@ -5,9 +5,8 @@
 #include "btllib/status.hpp"
 
 #include "sdsl/bit_vector_il.hpp"
-#include "sdsl/rank_support.hpp"
 
-#include <algorithm> // std::random_shuffle
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
@@ -18,11 +17,249 @@
 #include <iostream>
 #include <limits>
 #include <string>
-#include <sys/stat.h> // NOLINT
+#include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h> // NOLINT
+#include <unistd.h>
+
 namespace btllib {
 
+/// @cond HIDDEN_SYMBOLS
+/*
+ * Bit vector with rank support, stored as 512 bit blocks each preceded by the
+ * number of bits set before it. A rank query touches a single block, and the
+ * blocks can be used in place from a memory mapped file
+ * A trailing block holds the total population count
+ */
+class InterleavedBitVector
+{
+public:
+  static const uint64_t BLOCK_BITS = 512;
+  static const uint64_t BLOCK_WORDS = 1 + BLOCK_BITS / 64;
+
+  InterleavedBitVector() = default;
+
+  explicit InterleavedBitVector(const sdsl::bit_vector& bv)
+    : m_size(bv.size())
+    , m_owned(words(bv.size()), 0)
+    , m_blocks(m_owned.data())
+  {
+    const uint64_t* bv_words = bv.data();
+    for (uint64_t i = 0; i < (m_size + 63) / 64; ++i) {
+      m_owned[i / 8 * BLOCK_WORDS + 1 + i % 8] = bv_words[i];
+    }
+    init_ranks();
+  }
+
+  /*
+   * Bit by bit conversion from an sdsl interleaved bit vector, whose blocks
+   * are not accessible. Only used for the legacy file format
+   */
+  template<uint32_t B>
+  explicit InterleavedBitVector(const sdsl::bit_vector_il<B>& bv)
+    : m_size(bv.size())
+    , m_owned(words(bv.size()), 0)
+    , m_blocks(m_owned.data())
+  {
+    for (uint64_t i = 0; i < m_size; ++i) {
+      if (bool(bv[i])) {
+        m_owned[i / BLOCK_BITS * BLOCK_WORDS + 1 + i % BLOCK_BITS / 64] |=
+          uint64_t(1) << (i % 64);
+      }
+    }
+    init_ranks();
+  }
+
+  // View of blocks owned elsewhere, e.g. by a memory mapping
+  InterleavedBitVector(const uint64_t* blocks, uint64_t size)
+    : m_size(size)
+    , m_blocks(blocks)
+  {
+  }
+
+  InterleavedBitVector(const InterleavedBitVector&) = delete;
+  InterleavedBitVector& operator=(const InterleavedBitVector&) = delete;
+
+  InterleavedBitVector(InterleavedBitVector&& bv) noexcept
+  {
+    *this = std::move(bv);
+  }
+
+  InterleavedBitVector& operator=(InterleavedBitVector&& bv) noexcept
+  {
+    const bool owned = bv.m_blocks == bv.m_owned.data();
+    m_size = bv.m_size;
+    m_owned = std::move(bv.m_owned);
+    m_blocks = owned ? m_owned.data() : bv.m_blocks;
+    bv.m_size = 0;
+    bv.m_blocks = nullptr;
+    return *this;
+  }
+
+  // Number of 64 bit words taken by a bit vector of the given size
+  static uint64_t words(uint64_t size)
+  {
+    return (size / BLOCK_BITS + 1) * BLOCK_WORDS;
+  }
+
+  uint64_t size() const { return m_size; }
+
+  const uint64_t* data() const { return m_blocks; }
+
+  // Block holding pos, for prefetching
+  const uint64_t* block(uint64_t pos) const
+  {
+    return m_blocks + pos / BLOCK_BITS * BLOCK_WORDS;
+  }
+
+  bool operator[](uint64_t pos) const
+  {
+    return ((block(pos)[1 + pos % BLOCK_BITS / 64] >> (pos % 64)) & 1) != 0;
+  }
+
+  // Number of bits set before pos
+  uint64_t rank(uint64_t pos) const
+  {
+    const uint64_t* b = block(pos);
+    uint64_t result = b[0];
+    const unsigned word = pos % BLOCK_BITS / 64;
+    for (unsigned i = 0; i < word; ++i) {
+      result += __builtin_popcountll(b[1 + i]);
+    }
+    if (pos % 64 != 0) {
+      result +=
+        __builtin_popcountll(b[1 + word] & ((uint64_t(1) << (pos % 64)) - 1));
+    }
+    return result;
+  }
+
+  // Copies the bits into a plain bit vector of the same size
+  void copy_to(sdsl::bit_vector& bv) const
+  {
+    uint64_t* bv_words = bv.data();
+    for (uint64_t i = 0; i < (m_size + 63) / 64; ++i) {
+      bv_words[i] = m_blocks[i / 8 * BLOCK_WORDS + 1 + i % 8];
+    }
+  }
+
+private:
+  void init_ranks()
+  {
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < m_owned.size(); i += BLOCK_WORDS) {
+      m_owned[i] = count;
+      for (uint64_t j = 1; j < BLOCK_WORDS; ++j) {
+        count += __builtin_popcountll(m_owned[i + j]);
+      }
+    }
+  }
+
+  uint64_t m_size = 0;
+  std::vector<uint64_t> m_owned;
+  const uint64_t* m_blocks = nullptr;
+};
+
+/*
+ * Array of fixed width values packed back to back into 64 bit words. A value
+ * may straddle two words, and a trailing word keeps reading the second one
+ * in bounds, so that get() is branch free
+ */
+class PackedValueArray
+{
+public:
+  PackedValueArray() = default;
+
+  PackedValueArray(uint64_t size, unsigned width)
+    : m_size(size)
+    , m_width(width)
+    , m_mask(width_mask(width))
+    , m_owned(words(size, width), 0)
+    , m_words(m_owned.data())
+  {
+  }
+
+  // View of words owned elsewhere, e.g. by a memory mapping
+  PackedValueArray(const uint64_t* words, uint64_t size, unsigned width)
+    : m_size(size)
+    , m_width(width)
+    , m_mask(width_mask(width))
+    , m_words(words)
+  {
+  }
+
+  PackedValueArray(const PackedValueArray&) = delete;
+  PackedValueArray& operator=(const PackedValueArray&) = delete;
+
+  PackedValueArray(PackedValueArray&& array) noexcept
+  {
+    *this = std::move(array);
+  }
+
+  PackedValueArray& operator=(PackedValueArray&& array) noexcept
+  {
+    const bool owned = array.m_words == array.m_owned.data();
+    m_size = array.m_size;
+    m_width = array.m_width;
+    m_mask = array.m_mask;
+    m_owned = std::move(array.m_owned);
+    m_words = owned ? m_owned.data() : array.m_words;
+    array.m_size = 0;
+    array.m_words = nullptr;
+    return *this;
+  }
+
+  // Number of 64 bit words taken by size values of the given width
+  static uint64_t words(uint64_t size, unsigned width)
+  {
+    return (size * width + 63) / 64 + 1;
+  }
+
+  uint64_t size() const { return m_size; }
+
+  unsigned width() const { return m_width; }
+
+  const uint64_t* data() const { return m_words; }
+
+  // Word holding the start of value i, for prefetching
+  const uint64_t* word(uint64_t i) const { return m_words + i * m_width / 64; }
+
+  uint64_t get(uint64_t i) const
+  {
+    const uint64_t bit = i * m_width;
+    const uint64_t* w = m_words + bit / 64;
+    const unsigned shift = bit % 64;
+    // The second word is shifted in two steps, as a shift by 64 is undefined
+    return ((w[0] >> shift) | ((w[1] << 1) << (63 - shift))) & m_mask;
+  }
+
+  // Only for arrays owning their words, which start zeroed
+  void set(uint64_t i, uint64_t value)
+  {
+    const uint64_t bit = i * m_width;
+    const unsigned shift = bit % 64;
+    m_owned[bit / 64] |= value << shift;
+    if (shift + m_width > 64) {
+      m_owned[bit / 64 + 1] |= value >> (64 - shift);
+    }
+  }
+
+private:
+  static uint64_t width_mask(unsigned width)
+  {
+    return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+  }
+
+  uint64_t m_size = 0;
+  unsigned m_width = 0;
+  uint64_t m_mask = 0;
+  std::vector<uint64_t> m_owned;
+  const uint64_t* m_words = nullptr;
+};
+/// @endcond
+
 template<typename T>
 class MIBloomFilter
 {
@@ -37,6 +274,12 @@ public:
 
   static const unsigned BLOCKSIZE = 512;
 
+  // Number of frames classify() queries at a time
+  static const unsigned QUERY_BATCH_SIZE = 64;
+
+  // Marks unset bit vector positions in at_batch()
+  static const uint64_t NO_RANK = std::numeric_limits<uint64_t>::max();
+
   // Calculates the per frame probability of a random match for single value
   static inline double calc_prob_single_frame(double occupancy,
                                               unsigned hash_num,
@@ -95,7 +338,7 @@ public:
 
   // TODO: include allowed miss in header
   /// @cond HIDDEN_SYMBOLS
-#pragma pack(1) // to maintain consistent values across platforms
+#pragma pack(push, 1) // to maintain consistent values across platforms
   struct FileHeader
   {
     char magic[8]; // NOLINT
@@ -106,6 +349,7 @@ public:
     uint32_t version;
     //		uint8_t allowed_miss;
   };
+#pragma pack(pop)
   /// @endcond
 
   /*
@@ -122,7 +366,7 @@ public:
     , m_sseeds(seeds)
     , m_prob_saturated(0)
   {
-    m_bv = sdsl::bit_vector_il<BLOCKSIZE>(bv);
+    m_bv = InterleavedBitVector(bv);
     bv = sdsl::bit_vector();
     if (!seeds.empty()) {
       m_ss_val = parse_seeds(m_sseeds);
@@ -132,14 +376,152 @@ public:
         assert(m_kmer_size == itr->size());
       }
     }
-    m_rank_support = sdsl::rank_support_il<1>(&m_bv);
     m_d_size = get_pop();
     m_data = new T[m_d_size]();
   }
 
+  /*
+   * Loads a filter stored by save(), or by store() in the legacy two file
+   * format. Files written by save() are memory mapped rather than read, so
+   * loading takes no time and the pages are shared by every process using
+   * the same filter
+   */
   MIBloomFilter<T>(const std::string& filter_file_path)
-    : m_prob_saturated(pow(double(get_pop_saturated()) / double(get_pop()),
-                           m_hash_num)) // TODO: make more streamlined
+  {
+    if (is_mapped_file(filter_file_path)) {
+      load_mapped(filter_file_path);
+    } else {
+      load_legacy(filter_file_path);
+    }
+    m_prob_saturated =
+      pow(double(get_pop_saturated()) / double(get_pop()), m_hash_num);
+  }
+
+  /*
+   * Stores the filter as a single file to the path specified, with each
+   * section aligned to a page so that it can be memory mapped in place
+   * The file is written next to the path and renamed over it, so processes
+   * that mapped a filter previously stored there keep their copy
+   */
+  void save(const std::string& filter_file_path) const
+  {
+    MappedFileHeader header{};
+    memcpy(header.magic, MAPPED_FILE_MAGIC, sizeof(header.magic));
+    header.version = MAPPED_FILE_VERSION;
+    header.id_size = sizeof(T);
+    header.hash_num = m_hash_num;
+    header.kmer = m_kmer_size;
+    header.seed_num = uint32_t(m_sseeds.size());
+    header.bv_size = m_bv.size();
+    header.data_size = m_d_size;
+    header.seeds_offset = align_section(sizeof(MappedFileHeader));
+    header.bv_offset =
+      align_section(header.seeds_offset + m_sseeds.size() * m_kmer_size);
+    header.data_offset = align_section(
+      header.bv_offset + InterleavedBitVector::words(m_bv.size()) * 8);
+    header.value_bits = is_compressed() ? m_packed.width() : 0;
+    const size_t data_bytes = data_size_bytes(m_d_size, header.value_bits);
+    header.file_size = header.data_offset + data_bytes;
+
+    const auto tmp_path = filter_file_path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wbe");
+    check_error(file == nullptr,
+                "MIBloomFilter: File " + tmp_path +
+                  " could not be opened for writing: " + get_strerror());
+    write_section(file, 0, &header, sizeof(header));
+    for (size_t i = 0; i < m_sseeds.size(); ++i) {
+      write_section(file,
+                    header.seeds_offset + i * m_kmer_size,
+                    m_sseeds[i].data(),
+                    m_kmer_size);
+    }
+    write_section(file,
+                  header.bv_offset,
+                  m_bv.data(),
+                  InterleavedBitVector::words(m_bv.size()) * 8);
+    if (is_compressed()) {
+      write_section(file, header.data_offset, m_packed.data(), data_bytes);
+    } else {
+      write_section(file, header.data_offset, m_data, data_bytes);
+    }
+    check_error(fflush(file) != 0 || fsync(fileno(file)) != 0,
+                "MIBloomFilter: Failed to write " + tmp_path + ": " +
+                  get_strerror());
+    check_error(fclose(file) != 0,
+                "MIBloomFilter: Failed to write " + tmp_path + ": " +
+                  get_strerror());
+    check_error(rename(tmp_path.c_str(), filter_file_path.c_str()) != 0,
+                "MIBloomFilter: Failed to rename " + tmp_path + " to " +
+                  filter_file_path + ": " + get_strerror());
+  }
+
+  /*
+   * Checks whether the file at the given path was stored by save()
+   */
+  static bool is_mapped_file(const std::string& filter_file_path)
+  {
+    char magic[sizeof(MAPPED_FILE_MAGIC) - 1];
+    FILE* file = fopen(filter_file_path.c_str(), "rbe");
+    if (file == nullptr) {
+      return false;
+    }
+    const bool read = fread(magic, sizeof(magic), 1, file) == 1;
+    fclose(file);
+    return read && memcmp(magic, MAPPED_FILE_MAGIC, sizeof(magic)) == 0;
+  }
+
+  /*
+   * Replaces the ID data with a bit packed copy, each value taking as many
+   * bits as the largest ID needs plus the saturation and strand bits
+   * get_data() stays constant time at the cost of a shift and a mask
+   * Compressed filters are read only. save() keeps them compressed and
+   * store() writes them out uncompressed
+   */
+  void compress()
+  {
+    if (is_compressed()) {
+      return;
+    }
+    const T max_id = get_max_id();
+    unsigned id_bits = 1;
+    while (id_bits < sizeof(T) * 8 - 2 && (uint64_t(max_id) >> id_bits) != 0) {
+      ++id_bits;
+    }
+    PackedValueArray packed(m_d_size, id_bits + 2);
+    for (size_t i = 0; i < m_d_size; ++i) {
+      const T value = m_data[i];
+      uint64_t packed_value = value & ID_MASK;
+      if ((value & STRAND) != 0) {
+        packed_value |= uint64_t(1) << id_bits;
+      }
+      if ((value & MASK) != 0) {
+        packed_value |= uint64_t(1) << (id_bits + 1);
+      }
+      packed.set(i, packed_value);
+    }
+    // A mapped filter keeps its mapping, whose untouched data pages take no
+    // memory
+    if (m_mapping == nullptr) {
+      delete[] m_data;
+    }
+    m_data = nullptr;
+    m_packed = std::move(packed);
+    m_id_bits = id_bits;
+  }
+
+  bool is_compressed() const
+  {
+    return m_id_bits != 0;
+  }
+
+  // Bytes taken by the ID data
+  size_t get_data_bytes() const
+  {
+    return data_size_bytes(m_d_size, is_compressed() ? m_packed.width() : 0);
+  }
+
+private:
+  void load_legacy(const std::string& filter_file_path)
   {
 #pragma omp parallel for default(none) shared(filter_file_path)
     for (unsigned i = 0; i < 2; ++i) {
@@ -174,13 +556,13 @@ public:
         if (header.hlen > sizeof(struct FileHeader)) {
           // load seeds
           for (unsigned i = 0; i < header.nhash; ++i) {
-            char temp[header.kmer];
+            std::string temp(header.kmer, '\0');
 
-            check_error(fread(temp, header.kmer, 1, file) != 1,
+            check_error(fread(&temp[0], header.kmer, 1, file) != 1,
                         "MIBloomFilter: Failed to load spaced seed string.");
             log_info("MIBloomFilter: Spaced seed " + std::to_string(i) + ": " +
-                     std::string(temp, header.kmer));
-            m_sseeds.push_back(std::string(temp, header.kmer));
+                     temp);
+            m_sseeds.push_back(temp);
           }
 
           m_ss_val = parse_seeds(m_sseeds);
@@ -227,7 +609,7 @@ public:
 
         size_t count_read = fread(m_data, file_size, 1, file);
 
-        check_error(count_read != 1 && fclose(file) != 0,
+        check_error(count_read != 1 || fclose(file) != 0,
                     "MIBloomFilter: File " + filter_file_path +
                       " could not be read.");
       }
@@ -236,8 +618,9 @@ public:
         const std::string bv_filename = filter_file_path + ".sdsl";
         log_info("MIBloomFilter: Loading sdsl interleaved bit vector from: " +
                  bv_filename);
-        load_from_file(m_bv, bv_filename);
-        m_rank_support = sdsl::rank_support_il<1>(&m_bv);
+        sdsl::bit_vector_il<BLOCKSIZE> bv;
+        load_from_file(bv, bv_filename);
+        m_bv = InterleavedBitVector(bv);
       }
     }
 
@@ -245,6 +628,125 @@ public:
              "\nPopcount: " + std::to_string(get_pop()));
   }
 
+  void load_mapped(const std::string& filter_file_path)
+  {
+    const int fd = open(filter_file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    check_error(fd < 0,
+                "MIBloomFilter: File " + filter_file_path +
+                  " could not be read: " + get_strerror());
+    struct stat st;
+    check_error(fstat(fd, &st) != 0,
+                "MIBloomFilter: Failed to stat " + filter_file_path + ": " +
+                  get_strerror());
+    m_mapping_size = size_t(st.st_size);
+    check_error(m_mapping_size < sizeof(MappedFileHeader),
+                "MIBloomFilter: " + filter_file_path + " is truncated.");
+    // Private and writable, so that the pages are shared between processes
+    // until the filter is modified
+    m_mapping = mmap(nullptr,
+                     m_mapping_size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE,
+                     fd,
+                     0);
+    close(fd);
+    check_error(m_mapping == MAP_FAILED,
+                "MIBloomFilter: Failed to map " + filter_file_path + ": " +
+                  get_strerror());
+    char* const base = static_cast<char*>(m_mapping);
+
+    MappedFileHeader header;
+    memcpy(&header, base, sizeof(header));
+    check_error(header.version != MAPPED_FILE_VERSION,
+                "MIBloomFilter: Bloom filter version does not match: " +
+                  std::to_string(header.version) + " expected " +
+                  std::to_string(MAPPED_FILE_VERSION) + ".");
+    check_error(header.id_size != sizeof(T),
+                "MIBloomFilter: " + filter_file_path + " holds " +
+                  std::to_string(header.id_size) + " byte IDs, expected " +
+                  std::to_string(sizeof(T)) + ".");
+    check_error(
+      header.file_size != m_mapping_size ||
+        header.seeds_offset + header.seed_num * header.kmer >
+          header.bv_offset ||
+        header.bv_offset + InterleavedBitVector::words(header.bv_size) * 8 >
+          header.data_offset ||
+        header.value_bits > sizeof(T) * 8 ||
+        (header.value_bits != 0 && header.value_bits < 3) ||
+        header.data_offset +
+            data_size_bytes(header.data_size, header.value_bits) >
+          m_mapping_size ||
+        header.bv_offset % MAPPED_FILE_ALIGNMENT != 0 ||
+        header.data_offset % MAPPED_FILE_ALIGNMENT != 0,
+      "MIBloomFilter: " + filter_file_path +
+        " is truncated or its sections are corrupt.");
+
+    m_hash_num = header.hash_num;
+    m_kmer_size = header.kmer;
+    for (uint32_t i = 0; i < header.seed_num; ++i) {
+      m_sseeds.push_back(std::string(
+        base + header.seeds_offset + size_t(i) * m_kmer_size, m_kmer_size));
+    }
+    if (!m_sseeds.empty()) {
+      m_ss_val = parse_seeds(m_sseeds);
+    }
+
+    const auto* const blocks =
+      reinterpret_cast<const uint64_t*>(base + header.bv_offset);
+    const size_t blocks_size = InterleavedBitVector::words(header.bv_size) * 8;
+    m_bv = InterleavedBitVector(blocks, header.bv_size);
+    m_d_size = header.data_size;
+    if (header.value_bits != 0) {
+      m_packed = PackedValueArray(
+        reinterpret_cast<const uint64_t*>(base + header.data_offset),
+        m_d_size,
+        header.value_bits);
+      m_id_bits = header.value_bits - 2;
+    } else {
+      m_data = reinterpret_cast<T*>(base + header.data_offset);
+    }
+    check_error(get_pop() != m_d_size,
+                "MIBloomFilter: " + filter_file_path +
+                  " bit vector population does not match its data size.");
+
+    // Queries are random, so read ahead only wastes I/O
+    madvise(base + header.bv_offset, blocks_size, MADV_RANDOM);
+    madvise(base + header.data_offset,
+            data_size_bytes(m_d_size, header.value_bits),
+            MADV_RANDOM);
+
+    log_info("MIBloomFilter: Mapped " + filter_file_path +
+             "\nBit vector size: " + std::to_string(m_bv.size()) +
+             "\nPopcount: " + std::to_string(m_d_size));
+  }
+
+  static uint64_t align_section(uint64_t offset)
+  {
+    return (offset + MAPPED_FILE_ALIGNMENT - 1) / MAPPED_FILE_ALIGNMENT *
+           MAPPED_FILE_ALIGNMENT;
+  }
+
+  // Writes data at the given offset, zero filling any gap before it
+  static void write_section(FILE* file,
+                            uint64_t offset,
+                            const void* data,
+                            size_t size)
+  {
+    static const char zeros[MAPPED_FILE_ALIGNMENT] = {};
+    auto pos = uint64_t(ftell(file));
+    while (pos < offset) {
+      const auto gap =
+        size_t(std::min(offset - pos, uint64_t(MAPPED_FILE_ALIGNMENT)));
+      check_error(fwrite(zeros, 1, gap, file) != gap,
+                  "MIBloomFilter: Failed to write filter: " + get_strerror());
+      pos += gap;
+    }
+    check_error(size > 0 && fwrite(data, 1, size, file) != size,
+                "MIBloomFilter: Failed to write filter: " + get_strerror());
+  }
+
+public:
+
   /*
    * Stores the filter as a binary file to the path specified
    * Stores uncompressed because the random data tends to
@@ -270,7 +772,17 @@ public:
         // std::endl;
 
         // write out each block
-        my_file.write(reinterpret_cast<char*>(m_data), m_d_size * sizeof(T));
+        if (is_compressed()) {
+          // The legacy format has no packed representation
+          std::vector<T> values(m_d_size);
+          for (size_t j = 0; j < m_d_size; ++j) {
+            values[j] = value_at(j);
+          }
+          my_file.write(reinterpret_cast<const char*>(values.data()),
+                        m_d_size * sizeof(T));
+        } else {
+          my_file.write(reinterpret_cast<char*>(m_data), m_d_size * sizeof(T));
+        }
 
         my_file.close();
         assert(my_file);
@@ -285,7 +797,9 @@ public:
         // bit
         // vector to: " << bv_filename
         //						<< std::endl;
-        store_to_file(m_bv, bv_filename);
+        sdsl::bit_vector bv(m_bv.size());
+        m_bv.copy_to(bv);
+        store_to_file(sdsl::bit_vector_il<BLOCKSIZE>(bv), bv_filename);
         //				std::cerr << "Number of bit vector
         // buckets is
         //"
@@ -307,12 +821,12 @@ public:
   /*
    * Returns false if unable to insert hashes values
    * Contains strand information
-   * Inserts hash functions in random order
+   * Inserts hash functions in a pseudorandom order derived from the hashes
    */
   bool insert(const uint64_t* hashes, const bool* strand, T val, unsigned max)
   {
+    check_writable();
     unsigned count = 0;
-    std::vector<unsigned> hash_order;
     bool saturated = true;
     // for random number generator seed
     uint64_t rand_value = val;
@@ -324,7 +838,7 @@ public:
     // check values and if value set
     for (unsigned i = 0; i < m_hash_num; ++i) {
       // check if values are already set
-      uint64_t pos = m_rank_support(hashes[i] % m_bv.size());
+      uint64_t pos = m_bv.rank(hashes[i] % m_bv.size());
       T value = strand_dir ^ strand[i] ? val | STRAND : val;
       // check for saturation
       T old_val = m_data[pos];
@@ -337,8 +851,6 @@ public:
 
       if (old_val == value) {
         ++count;
-      } else {
-        hash_order.push_back(i);
       }
 
       if (count >= max) {
@@ -346,12 +858,12 @@ public:
       }
       rand_value ^= hashes[i];
     }
-    std::minstd_rand g(rand_value);
-    std::shuffle(hash_order.begin(), hash_order.end(), g);
-
-    // insert seeds in random order
-    for (const auto& o : hash_order) {
-      uint64_t pos = m_rank_support(hashes[o] % m_bv.size());
+    // insert seeds in an order derived from the hashes. Slots already
+    // holding the value are revisited, but not counted again
+    const HashOrder order(rand_value, m_hash_num);
+    for (unsigned j = 0; j < m_hash_num; ++j) {
+      const unsigned o = order[j];
+      uint64_t pos = m_bv.rank(hashes[o] % m_bv.size());
       T value = strand_dir ^ strand[o] ? val | STRAND : val;
       // check for saturation
       T old_val = set_val(&m_data[pos], value);
@@ -385,12 +897,12 @@ public:
 
   /*
    * Returns false if unable to insert hashes values
-   * Inserts hash functions in random order
+   * Inserts hash functions in a pseudorandom order derived from the hashes
    */
   bool insert(const uint64_t* hashes, T value, unsigned max)
   {
+    check_writable();
     unsigned count = 0;
-    std::vector<unsigned> hash_order;
     // for random number generator seed
     uint64_t rand_value = value;
 
@@ -399,7 +911,7 @@ public:
     // check values and if value set
     for (unsigned i = 0; i < m_hash_num; ++i) {
       // check if values are already set
-      uint64_t pos = m_rank_support(hashes[i] % m_bv.size());
+      uint64_t pos = m_bv.rank(hashes[i] % m_bv.size());
       // check for saturation
       T old_val = m_data[pos];
 
@@ -411,8 +923,6 @@ public:
 
       if (old_val == value) {
         ++count;
-      } else {
-        hash_order.push_back(i);
       }
 
       if (count >= max) {
@@ -421,12 +931,11 @@ public:
 
       rand_value ^= hashes[i];
     }
-    std::minstd_rand g(rand_value);
-    std::shuffle(hash_order.begin(), hash_order.end(), g);
-
-    // insert seeds in random order
-    for (const auto& o : hash_order) {
-      uint64_t pos = m_rank_support(hashes[o] % m_bv.size());
+    // insert seeds in an order derived from the hashes. Slots already
+    // holding the value are revisited, but not counted again
+    const HashOrder order(rand_value, m_hash_num);
+    for (unsigned j = 0; j < m_hash_num; ++j) {
+      uint64_t pos = m_bv.rank(hashes[order[j]] % m_bv.size());
       // check for saturation
       T old_val = set_val(&m_data[pos], value);
 
@@ -459,38 +968,101 @@ public:
 
   void saturate(const uint64_t* hashes)
   {
+    check_writable();
     for (unsigned i = 0; i < m_hash_num; ++i) {
-      uint64_t pos = m_rank_support(hashes[i] % m_bv.size());
+      uint64_t pos = m_bv.rank(hashes[i] % m_bv.size());
       __sync_or_and_fetch(&m_data[pos], MASK);
     }
   }
 
+  /*
+   * Order independent insertion. Every slot of the element is contended for,
+   * and a slot keeps whichever value ranks first by a hash of the slot
+   * position and the value. The final contents are therefore the same for
+   * any insertion order or number of threads, at the cost of the
+   * first-come guarantee of insert(). Elements left without a slot holding
+   * their value are found and saturated in a later pass, once every element
+   * has been placed
+   * value may carry the strand bit, the saturation bit is preserved
+   * Returns whether a slot held the value when this call returned
+   */
+  bool place(const uint64_t* hashes, T value)
+  {
+    check_writable();
+    value &= ANTI_MASK;
+    bool placed = false;
+    for (unsigned i = 0; i < m_hash_num; ++i) {
+      uint64_t pos = m_bv.rank(hashes[i] % m_bv.size());
+      const uint64_t priority = placement_priority(pos, value);
+      T old_val = m_data[pos];
+      for (;;) {
+        const T old_id = old_val & ANTI_MASK;
+        if (old_id == value) {
+          placed = true;
+          break;
+        }
+        if (old_id != 0) {
+          const uint64_t old_priority = placement_priority(pos, old_id);
+          if (old_priority < priority ||
+              (old_priority == priority && old_id < value)) {
+            break;
+          }
+        }
+        const T new_val = value | (old_val & MASK);
+        const T seen_val =
+          __sync_val_compare_and_swap(&m_data[pos], old_val, new_val);
+        if (seen_val == old_val) {
+          placed = true;
+          break;
+        }
+        old_val = seen_val;
+      }
+    }
+    return placed;
+  }
+
   inline std::vector<T> at(const uint64_t* hashes,
                            bool& saturated,
                            unsigned max_miss = 0)
   {
     std::vector<T> results(m_hash_num);
+    if (!at(hashes, results.data(), saturated, max_miss)) {
+      return std::vector<T>();
+    }
+    return results;
+  }
+
+  /*
+   * Same as above, but writes m_hash_num values into a caller provided
+   * buffer. Missed positions are set to 0
+   * Returns false if there are more than max_miss misses
+   */
+  bool at(const uint64_t* hashes,
+          T* results,
+          bool& saturated,
+          unsigned max_miss = 0) const
+  {
     unsigned misses = 0;
     for (unsigned i = 0; i < m_hash_num; ++i) {
       uint64_t pos = hashes[i] % m_bv.size();
       if (m_bv[pos] == 0) {
+        results[i] = 0;
         ++misses;
         saturated = false;
         if (misses > max_miss) {
-          return std::vector<T>();
+          return false;
         }
       } else {
-        uint64_t rank_pos = m_rank_support(pos);
-        T temp_result = m_data[rank_pos];
+        T temp_result = value_at(m_bv.rank(pos));
         if (temp_result > MASK) {
-          results[i] = m_data[rank_pos] & ANTI_MASK;
+          results[i] = temp_result & ANTI_MASK;
         } else {
-          results[i] = m_data[rank_pos];
+          results[i] = temp_result;
           saturated = false;
         }
       }
     }
-    return results;
+    return true;
   }
 
   /*
@@ -506,7 +1078,7 @@ public:
     for (unsigned i = 0; i < m_hash_num; ++i) {
       uint64_t pos = hashes[i] % m_bv.size();
       if (bool(m_bv[pos])) {
-        rank_pos[i] = m_rank_support(pos);
+        rank_pos[i] = m_bv.rank(pos);
         hits[i] = true;
       } else {
         if (++misses > max_miss) {
@@ -528,7 +1100,7 @@ public:
     for (unsigned i = 0; i < m_hash_num; ++i) {
       uint64_t pos = hashes[i] % m_bv.size();
       if (bool(m_bv[pos])) {
-        rank_pos[i] = m_rank_support(pos);
+        rank_pos[i] = m_bv.rank(pos);
       } else {
         return false;
       }
@@ -541,14 +1113,153 @@ public:
     std::vector<uint64_t> rank_pos(m_hash_num);
     for (unsigned i = 0; i < m_hash_num; ++i) {
       uint64_t pos = hashes[i] % m_bv.size();
-      rank_pos[i] = m_rank_support(pos);
+      rank_pos[i] = m_bv.rank(pos);
     }
     return rank_pos;
   }
 
   uint64_t get_rank_pos(const uint64_t hash) const
   {
-    return m_rank_support(hash % m_bv.size());
+    return m_bv.rank(hash % m_bv.size());
+  }
+
+  /*
+   * Caller buffer variants of the above, for allocation free queries
+   * rank_pos and hits must hold m_hash_num values
+   */
+  unsigned at_rank(const uint64_t* hashes,
+                   uint64_t* rank_pos,
+                   bool* hits,
+                   unsigned max_miss) const
+  {
+    unsigned misses = 0;
+    for (unsigned i = 0; i < m_hash_num; ++i) {
+      uint64_t pos = hashes[i] % m_bv.size();
+      if (bool(m_bv[pos])) {
+        rank_pos[i] = m_bv.rank(pos);
+        hits[i] = true;
+      } else {
+        if (++misses > max_miss) {
+          return misses;
+        }
+
+        hits[i] = false;
+      }
+    }
+    return misses;
+  }
+
+  void get_rank_pos(const uint64_t* hashes, uint64_t* rank_pos) const
+  {
+    for (unsigned i = 0; i < m_hash_num; ++i) {
+      rank_pos[i] = m_bv.rank(hashes[i] % m_bv.size());
+    }
+  }
+
+  void get_data(const uint64_t* rank_pos, T* results) const
+  {
+    for (unsigned i = 0; i < m_hash_num; ++i) {
+      results[i] = value_at(rank_pos[i]);
+    }
+  }
+
+  /*
+   * Queries a batch of elements, m_hash_num hash values each
+   * results receives m_hash_num raw data values per element (saturation and
+   * strand bits included), or 0 where the bit vector is not set. ranks is
+   * scratch space of the same size
+   * The bit vector blocks of the whole batch are prefetched, then ranked,
+   * then the data slots are prefetched before they are read, so that cache
+   * misses overlap instead of each one stalling the next
+   * Returns the number of elements with all bits set
+   */
+  size_t at_batch(const uint64_t* hashes,
+                  size_t count,
+                  T* results,
+                  uint64_t* ranks) const
+  {
+    const size_t n = count * m_hash_num;
+    const uint64_t size = m_bv.size();
+    for (size_t i = 0; i < n; ++i) {
+      ranks[i] = hashes[i] % size;
+      __builtin_prefetch(m_bv.block(ranks[i]));
+    }
+    for (size_t i = 0; i < n; ++i) {
+      const uint64_t pos = ranks[i];
+      ranks[i] = m_bv[pos] ? m_bv.rank(pos) : uint64_t(NO_RANK);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      if (ranks[i] != NO_RANK) {
+        __builtin_prefetch(value_address(ranks[i]));
+      }
+    }
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+      bool all_set = true;
+      for (unsigned j = 0; j < m_hash_num; ++j) {
+        const uint64_t rank = ranks[i * m_hash_num + j];
+        if (rank == NO_RANK) {
+          results[i * m_hash_num + j] = 0;
+          all_set = false;
+        } else {
+          results[i * m_hash_num + j] = value_at(rank);
+        }
+      }
+      found += all_set ? 1 : 0;
+    }
+    return found;
+  }
+
+  /*
+   * Reusable scratch space for classify(). One per thread keeps the query
+   * path free of allocations
+   */
+  struct QueryBuffer
+  {
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> ranks;
+    std::vector<T> values;
+  };
+
+  /*
+   * Classifies a sequence by the IDs its frames hit. hasher must produce
+   * m_hash_num hashes per frame, and can be reused across reads with
+   * change_seq(). It is rolled to the end and frames are queried
+   * QUERY_BATCH_SIZE at a time. Every frame with all bits set adds one to
+   * the count of each distinct ID in its slots, saturated or not
+   * counts is indexed by ID and accumulated into; it is only grown if an ID
+   * does not fit
+   * Returns the ID with the most hits in counts, including those of earlier
+   * calls (lowest ID on ties), or 0 if none
+   */
+  T classify(SeedNtHash& hasher,
+             std::vector<size_t>& counts,
+             QueryBuffer& buffer) const
+  {
+    return classify_frames(hasher, counts, buffer);
+  }
+
+  T classify(NtHash& hasher,
+             std::vector<size_t>& counts,
+             QueryBuffer& buffer) const
+  {
+    return classify_frames(hasher, counts, buffer);
+  }
+
+  /*
+   * Convenience overload that hashes seq with the filter's spaced seeds, or
+   * k-mers if it has none. Constructs a hasher per call
+   */
+  T classify(const std::string& seq,
+             std::vector<size_t>& counts,
+             QueryBuffer& buffer) const
+  {
+    if (m_ss_val.empty()) {
+      NtHash nthash(seq, m_hash_num, m_kmer_size);
+      return classify(nthash, counts, buffer);
+    }
+    SeedNtHash nthash(seq, m_ss_val, 1, m_kmer_size);
+    return classify(nthash, counts, buffer);
   }
 
   const std::vector<std::vector<unsigned>>& get_seed_values() const
@@ -574,11 +1285,11 @@ public:
   {
     size_t saturated_counts = 0;
     for (size_t i = 0; i < m_d_size; ++i) {
-      if (m_data[i] > MASK) {
-        ++counts[m_data[i] & ANTI_MASK];
+      if (value_at(i) > MASK) {
+        ++counts[value_at(i) & ANTI_MASK];
         ++saturated_counts;
       } else {
-        ++counts[m_data[i]];
+        ++counts[value_at(i)];
       }
     }
     return saturated_counts;
@@ -592,11 +1303,11 @@ public:
   {
     size_t saturated_counts = 0;
     for (size_t i = 0; i < m_d_size; ++i) {
-      if (m_data[i] > MASK) {
-        ++counts[m_data[i] & ID_MASK];
+      if (value_at(i) > MASK) {
+        ++counts[value_at(i) & ID_MASK];
         ++saturated_counts;
       } else {
-        ++counts[m_data[i] & ANTI_STRAND];
+        ++counts[value_at(i) & ANTI_STRAND];
       }
     }
     return saturated_counts;
@@ -604,11 +1315,7 @@ public:
 
   size_t get_pop() const
   {
-    size_t index = m_bv.size() - 1;
-    while (m_bv[index] == 0) {
-      --index;
-    }
-    return m_rank_support(index) + 1;
+    return m_bv.rank(m_bv.size());
   }
 
   /*
@@ -619,7 +1326,7 @@ public:
   {
     size_t count = 0;
     for (size_t i = 0; i < m_d_size; ++i) {
-      if (m_data[i] != 0) {
+      if (value_at(i) != 0) {
         ++count;
       }
     }
@@ -635,18 +1342,31 @@ public:
   T check_values(T max_val) const
   {
     for (size_t i = 0; i < m_d_size; ++i) {
-      if ((m_data[i] & ANTI_MASK) > max_val) {
-        return m_data[i];
+      if ((value_at(i) & ANTI_MASK) > max_val) {
+        return value_at(i);
       }
     }
     return max_val;
   }
 
+  /*
+   * Largest ID stored in the data array, ignoring saturation and strand
+   * Sizes the frame_probs vector for calc_frame_probs()
+   */
+  T get_max_id() const
+  {
+    T max_id = 0;
+    for (size_t i = 0; i < m_d_size; ++i) {
+      max_id = std::max(max_id, T(value_at(i) & ID_MASK));
+    }
+    return max_id;
+  }
+
   size_t get_pop_saturated() const
   {
     size_t count = 0;
     for (size_t i = 0; i < m_d_size; ++i) {
-      if (m_data[i] > MASK) {
+      if (value_at(i) > MASK) {
         ++count;
       }
     }
@@ -661,6 +1381,7 @@ public:
   // overwrites existing value CAS
   void set_data(uint64_t pos, T id)
   {
+    check_writable();
     T old_value;
     do {
       old_value = m_data[pos];
@@ -673,13 +1394,14 @@ public:
   // saturates values
   void saturate_data(uint64_t pos)
   {
-#pragma omp critical
-    m_data[pos] |= MASK;
+    check_writable();
+    __sync_or_and_fetch(&m_data[pos], MASK);
   }
 
   // Does not overwrite
   void set_data_if_empty(uint64_t pos, T id)
   {
+    check_writable();
     set_val(&m_data[pos], id);
   }
 
@@ -687,14 +1409,14 @@ public:
   {
     std::vector<T> results(rank_pos.size());
     for (unsigned i = 0; i < m_hash_num; ++i) {
-      results[i] = m_data[rank_pos[i]];
+      results[i] = value_at(rank_pos[i]);
     }
     return results;
   }
 
   T get_data(uint64_t rank) const
   {
-    return m_data[rank];
+    return value_at(rank);
   }
 
   /*
@@ -745,7 +1467,8 @@ public:
       sum += c;
     }
     sat_prop /= double(sum);
-#pragma omp parallel for default(none) shared(count_table)
+#pragma omp parallel for default(none)                                         \
+  shared(count_table, frame_probs, occupancy, sum, allowed_miss)
     for (size_t i = 1; i < count_table.size(); ++i) {
       frame_probs[i] =
         calc_prob_single_frame(occupancy,
@@ -761,10 +1484,81 @@ public:
 
   ~MIBloomFilter()
   {
-    delete[] m_data;
+    if (m_mapping != nullptr) {
+      munmap(m_mapping, m_mapping_size);
+    } else {
+      delete[] m_data;
+    }
   }
 
 private:
+  template<typename Hasher>
+  T classify_frames(Hasher& hasher,
+                    std::vector<size_t>& counts,
+                    QueryBuffer& buffer) const
+  {
+    check_error(hasher.get_hash_num() != m_hash_num,
+                "MIBloomFilter: Hasher produces " +
+                  std::to_string(hasher.get_hash_num()) +
+                  " hashes per frame, expected " +
+                  std::to_string(m_hash_num) + ".");
+    const size_t batch_values = QUERY_BATCH_SIZE * m_hash_num;
+    if (buffer.hashes.size() < batch_values) {
+      buffer.hashes.resize(batch_values);
+      buffer.ranks.resize(batch_values);
+      buffer.values.resize(batch_values);
+    }
+
+    bool more = true;
+    while (more) {
+      size_t batch = 0;
+      while (batch < QUERY_BATCH_SIZE && (more = hasher.roll())) {
+        std::copy(hasher.hashes(),
+                  hasher.hashes() + m_hash_num,
+                  buffer.hashes.data() + batch * m_hash_num);
+        ++batch;
+      }
+      at_batch(buffer.hashes.data(),
+               batch,
+               buffer.values.data(),
+               buffer.ranks.data());
+      for (size_t i = 0; i < batch; ++i) {
+        const uint64_t* ranks = buffer.ranks.data() + i * m_hash_num;
+        if (std::find(ranks, ranks + m_hash_num, uint64_t(NO_RANK)) !=
+            ranks + m_hash_num) {
+          continue;
+        }
+        // Slots no element claimed hold 0 and carry no information
+        const T* values = buffer.values.data() + i * m_hash_num;
+        for (unsigned j = 0; j < m_hash_num; ++j) {
+          const T id = values[j] & ID_MASK;
+          bool seen = id == 0;
+          for (unsigned l = 0; l < j && !seen; ++l) {
+            seen = T(values[l] & ID_MASK) == id;
+          }
+          if (seen) {
+            continue;
+          }
+          if (id >= counts.size()) {
+            counts.resize(size_t(id) + 1, 0);
+          }
+          ++counts[id];
+        }
+      }
+    }
+    // counts may hold hits from earlier calls, so the best ID is taken over
+    // all of it
+    T best = 0;
+    size_t best_count = 0;
+    for (size_t id = 1; id < counts.size(); ++id) {
+      if (counts[id] > best_count) {
+        best = T(id);
+        best_count = counts[id];
+      }
+    }
+    return best;
+  }
+
   // Driver function to sort the std::vector elements
   // by second element of pairs
   static bool sort_by_sec(const std::pair<int, int>& a,
@@ -831,6 +1625,44 @@ private:
     return pow(magic, -hash_funct_num);
   }
 
+  T value_at(uint64_t rank) const
+  {
+    if (m_id_bits == 0) {
+      return m_data[rank];
+    }
+    const uint64_t packed = m_packed.get(rank);
+    T value = T(packed & ((uint64_t(1) << m_id_bits) - 1));
+    if (((packed >> m_id_bits) & 1) != 0) {
+      value |= STRAND;
+    }
+    if (((packed >> (m_id_bits + 1)) & 1) != 0) {
+      value |= MASK;
+    }
+    return value;
+  }
+
+  const void* value_address(uint64_t rank) const
+  {
+    return m_id_bits == 0 ? static_cast<const void*>(m_data + rank)
+                          : static_cast<const void*>(m_packed.word(rank));
+  }
+
+  void check_writable() const
+  {
+    if (is_compressed()) {
+      log_error("MIBloomFilter: Compressed filters are read only.");
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+  }
+
+  // value_bits of 0 stands for an array of T
+  static size_t data_size_bytes(uint64_t size, unsigned value_bits)
+  {
+    return value_bits == 0
+             ? size * sizeof(T)
+             : PackedValueArray::words(size, value_bits) * 8;
+  }
+
   /*
    * Returns old value that was inside
    * Does not overwrite if non-zero value already exists
@@ -847,6 +1679,67 @@ private:
     return old_value;
   }
 
+  // Finalizer of splitmix64
+  static uint64_t mix_hash(uint64_t x)
+  {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+  }
+
+  static uint64_t placement_priority(uint64_t pos, T value)
+  {
+    return mix_hash(pos ^ (uint64_t(value) * 0x9e3779b97f4a7c15ULL));
+  }
+
+  /// @cond HIDDEN_SYMBOLS
+  /*
+   * Permutation of 0..n-1 derived from a seed, in place of a shuffle
+   * The indices are visited from a random start with a random stride
+   * coprime to n, so no storage or generator state is needed
+   */
+  class HashOrder
+  {
+  public:
+    HashOrder(uint64_t seed, unsigned n)
+      : n(n)
+    {
+      seed = mix_hash(seed);
+      start = unsigned(seed % n);
+      stride = 1;
+      if (n > 2) {
+        stride = unsigned((seed >> 32) % (n - 1)) + 1;
+        while (gcd(stride, n) != 1) {
+          stride = stride % (n - 1) + 1;
+        }
+      }
+    }
+
+    unsigned operator[](unsigned j) const
+    {
+      return unsigned((start + uint64_t(j) * stride) % n);
+    }
+
+  private:
+    static unsigned gcd(unsigned a, unsigned b)
+    {
+      while (b != 0) {
+        const unsigned t = a % b;
+        a = b;
+        b = t;
+      }
+      return a;
+    }
+
+    unsigned n;
+    unsigned start;
+    unsigned stride;
+  };
+  /// @endcond
+
   static inline unsigned n_choose_k(unsigned n, unsigned k)
   {
     if (k > n) {
@@ -869,9 +1762,16 @@ private:
   // size of bitvector
   size_t m_d_size;
 
-  sdsl::bit_vector_il<BLOCKSIZE> m_bv;
-  T* m_data;
-  sdsl::rank_support_il<1> m_rank_support;
+  InterleavedBitVector m_bv;
+  T* m_data = nullptr;
+
+  // Set if compress() was called, in place of m_data
+  PackedValueArray m_packed;
+  unsigned m_id_bits = 0;
+
+  // Set if the filter is memory mapped from a file stored by save()
+  void* m_mapping = nullptr;
+  size_t m_mapping_size = 0;
 
   unsigned m_hash_num;
   unsigned m_kmer_size;
@@ -883,8 +1783,38 @@ private:
   seed_val m_ss_val;
 
   static const uint32_t MI_BLOOM_FILTER_VERSION = 1;
+
+  /// @cond HIDDEN_SYMBOLS
+  // Header of the single file format. Followed by the spaced seeds, the
+  // interleaved bit vector and the ID data, each at a multiple of
+  // MAPPED_FILE_ALIGNMENT
+  struct MappedFileHeader
+  {
+    char magic[8]; // NOLINT
+    uint32_t version;
+    uint32_t id_size;
+    uint32_t hash_num;
+    uint32_t kmer;
+    uint32_t seed_num;
+    // Width of the bit packed ID data, or 0 if stored as an array of T
+    uint32_t value_bits;
+    uint64_t bv_size;
+    uint64_t data_size;
+    uint64_t seeds_offset;
+    uint64_t bv_offset;
+    uint64_t data_offset;
+    uint64_t file_size;
+  };
+  /// @endcond
+
+  static constexpr const char MAPPED_FILE_MAGIC[] = "MIBFFILE";
+  static const uint32_t MAPPED_FILE_VERSION = 2;
+  static const uint64_t MAPPED_FILE_ALIGNMENT = 4096;
 };
 
+template<typename T>
+constexpr const char MIBloomFilter<T>::MAPPED_FILE_MAGIC[];
+
 } // namespace btllib
 
 #endif
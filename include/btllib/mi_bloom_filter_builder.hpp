@@ -0,0 +1,727 @@
+#ifndef BTLLIB_MI_BLOOM_FILTER_BUILDER_HPP
+#define BTLLIB_MI_BLOOM_FILTER_BUILDER_HPP
+
+#include "btllib/checkpoint.hpp"
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/nthash.hpp"
+#include "btllib/order_queue.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/status.hpp"
+
+#include "sdsl/bit_vector_il.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Builds a multi-index Bloom filter from sequence files or precomputed hash
+ * values, with every element tagged by an ID. The filter takes three passes
+ * over the input to construct: the bit vector is populated, the filter and
+ * its rank support are built from it, and the IDs are placed. A final pass
+ * saturates the elements left without a slot holding their ID and gathers
+ * per-ID coverage. Every pass is spread over a pool of threads. IDs are
+ * placed with MIBloomFilter::place(), whose outcome does not depend on the
+ * order of insertion, so the built filter is the same for any number of
+ * threads.
+ *
+ * Long builds can be checkpointed and resumed after a failure, see
+ * set_checkpoint().
+ */
+template<typename T>
+class MIBloomFilterBuilder
+{
+
+public:
+  /** Per-ID statistics of a built filter. */
+  struct IdCoverage
+  {
+    /** Number of element occurrences inserted with the ID. */
+    size_t elements = 0;
+    /** Number of element occurrences with a slot holding the ID. */
+    size_t represented = 0;
+    /** Number of element occurrences that had to be saturated. */
+    size_t saturated = 0;
+    /** Number of filter slots holding the ID. */
+    size_t slots = 0;
+
+    /** Fraction of the ID's elements that can be classified to it. */
+    double coverage() const
+    {
+      return elements > 0 ? double(represented) / double(elements) : 0.0;
+    }
+  };
+
+  /** Assigns an ID to each record of a sequence file. */
+  using IdAssigner = std::function<T(const SeqReader::Record&)>;
+
+  /**
+   * Construct a builder. Sources are added before calling build().
+   *
+   * @param hash_num Number of hash values per element. Must equal the number
+   * of spaced seeds if any are given.
+   * @param k K-mer size, or the spaced seed length.
+   * @param occupancy Target fraction of bit vector bits set.
+   * @param threads Number of threads to run each pass with.
+   * @param seeds Spaced seeds to hash sequences with. K-mers are hashed if
+   * empty.
+   * @param expected_elements Number of elements used to size the bit vector.
+   * If 0, the sources are scanned for an upper bound before building.
+   */
+  MIBloomFilterBuilder(
+    unsigned hash_num,
+    unsigned k,
+    double occupancy = 0.5,
+    unsigned threads = 4,
+    const std::vector<std::string>& seeds = std::vector<std::string>(),
+    size_t expected_elements = 0);
+
+  MIBloomFilterBuilder(const MIBloomFilterBuilder&) = delete;
+  MIBloomFilterBuilder(MIBloomFilterBuilder&&) = delete;
+
+  MIBloomFilterBuilder& operator=(const MIBloomFilterBuilder&) = delete;
+  MIBloomFilterBuilder& operator=(MIBloomFilterBuilder&&) = delete;
+
+  /**
+   * Add a sequence file whose k-mers are all tagged with the same ID.
+   *
+   * @param path Filepath to read sequences from.
+   * @param id ID of the file's k-mers. Must be non-zero and fit in ID_MASK.
+   */
+  void add_source(const std::string& path, T id)
+  {
+    check_id(id);
+    add_source(path, [id](const SeqReader::Record&) { return id; });
+  }
+
+  /**
+   * Add a sequence file whose records are tagged with IDs of their own, e.g.
+   * one per reference sequence.
+   *
+   * @param path Filepath to read sequences from.
+   * @param assign_id Called once per record, on any thread, to obtain the ID
+   * of its k-mers.
+   */
+  void add_source(const std::string& path, IdAssigner assign_id)
+  {
+    seq_sources.push_back(SeqSource{ path, std::move(assign_id) });
+  }
+
+  /**
+   * Add precomputed elements that are all tagged with the same ID.
+   *
+   * @param hashes Hash values of the elements, hash_num per element.
+   * @param id ID of the elements.
+   */
+  void add_hashes(std::vector<uint64_t> hashes, T id)
+  {
+    check_id(id);
+    add_hashes(std::move(hashes), std::vector<T>(), id);
+  }
+
+  /**
+   * Add precomputed elements, each with an ID of its own.
+   *
+   * @param hashes Hash values of the elements, hash_num per element.
+   * @param ids ID of every element.
+   */
+  void add_hashes(std::vector<uint64_t> hashes, std::vector<T> ids)
+  {
+    check_error(ids.size() * hash_num != hashes.size(),
+                "MIBloomFilterBuilder: Number of IDs does not match the "
+                "number of elements.");
+    for (const auto id : ids) {
+      check_id(id);
+    }
+    add_hashes(std::move(hashes), std::move(ids), 0);
+  }
+
+  /**
+   * Take checkpoints of the build. Whenever the checkpoint interval has
+   * passed, the threads finish the segments they are hashing and the
+   * position in the input is recorded, along with the coverage counts. The
+   * bit vector or filter is then written before the threads go on, so the
+   * snapshot holds exactly the elements before the recorded position. It is
+   * not copied to be written in the background, as FilterPipeline does,
+   * since that would double the memory of the build.
+   *
+   * If the checkpoint exists, build() resumes from it. The builder must then
+   * have been constructed with the same parameters and given the same
+   * sources in the same order, with IDs that depend only on the record.
+   * Precomputed elements are only checkpointed between sources.
+   *
+   * @param checkpoint Checkpoint to take. Must outlive the builder.
+   */
+  void set_checkpoint(Checkpoint& checkpoint)
+  {
+    this->checkpoint = &checkpoint;
+  }
+
+  /**
+   * Build the filter from all added sources. May only be called once.
+   *
+   * @return The built filter.
+   */
+  std::unique_ptr<MIBloomFilter<T>> build();
+
+  /** Get the statistics of each ID, indexed by ID. Populated by build(). */
+  const std::vector<IdCoverage>& get_coverage() const { return coverage; }
+
+  /** Get the number of elements the bit vector was sized for. */
+  size_t get_expected_elements() const { return expected_elements; }
+
+  /** Maximum number of bases handed to a thread at a time. Long sequences
+   * are split, so that a single chromosome keeps every thread busy. */
+  static const size_t SEGMENT_SIZE = 64 * 1024;
+  /** Number of precomputed elements handed to a thread at a time. */
+  static const size_t HASH_CHUNK_SIZE = 4096;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct SeqSource
+  {
+    std::string path;
+    IdAssigner assign_id;
+  };
+
+  struct HashSource
+  {
+    std::vector<uint64_t> hashes;
+    std::vector<T> ids;
+    T id;
+  };
+
+  // Part of a record whose k-mers are hashed by one thread
+  struct Segment
+  {
+    std::shared_ptr<const SeqReader::Record> record;
+    T id;
+    size_t start;
+    size_t end;
+  };
+  /// @endcond
+
+  void add_hashes(std::vector<uint64_t> hashes, std::vector<T> ids, T id)
+  {
+    check_error(hashes.size() % hash_num != 0,
+                "MIBloomFilterBuilder: Number of hash values is not a "
+                "multiple of hash_num.");
+    hash_sources.push_back(HashSource{ std::move(hashes), std::move(ids), id });
+  }
+
+  static void check_id(T id)
+  {
+    check_error(id == 0 || id > MIBloomFilter<T>::ID_MASK,
+                "MIBloomFilterBuilder: Invalid ID " +
+                  std::to_string(uint64_t(id)) +
+                  ". IDs must be between 1 and " +
+                  std::to_string(uint64_t(MIBloomFilter<T>::ID_MASK)) + ".");
+  }
+
+  static IdCoverage& coverage_of(std::vector<IdCoverage>& stats, T id)
+  {
+    if (id >= stats.size()) {
+      stats.resize(size_t(id) + 1);
+    }
+    return stats[id];
+  }
+
+  size_t count_elements();
+  void run_threads(const std::function<void(unsigned)>& worker);
+  template<typename F>
+  void run_pass(unsigned pass, F f);
+  template<typename F>
+  void run_seq_source(size_t index,
+                      size_t first_record,
+                      size_t first_offset,
+                      F& f);
+  template<typename F>
+  void run_hash_source(const HashSource& source, F& f);
+  template<typename F>
+  void hash_segment(unsigned thread, const Segment& segment, F& f) const;
+  bool represented(const MIBloomFilter<T>& filter,
+                   const uint64_t* hashes,
+                   T id) const;
+  void resume_checkpoint();
+  void save_checkpoint(size_t source, size_t record, size_t offset);
+  static std::vector<std::string> save_bit_vector(const sdsl::bit_vector& bv,
+                                                  const std::string& path);
+  static void load_bit_vector(sdsl::bit_vector& bv, const std::string& path);
+
+  const unsigned hash_num;
+  const unsigned k;
+  const double occupancy;
+  const unsigned threads;
+  const std::vector<std::string> seeds;
+  const std::vector<SpacedSeed> parsed_seeds;
+  size_t expected_elements;
+  bool built = false;
+  std::vector<SeqSource> seq_sources;
+  std::vector<HashSource> hash_sources;
+  std::vector<IdCoverage> coverage;
+  std::vector<std::vector<IdCoverage>> thread_coverage;
+  Checkpoint* checkpoint = nullptr;
+  // Writes the bit vector or filter of the current pass
+  Checkpoint::Writer snapshot_writer;
+  unsigned pass = 0;
+  // State of the checkpoint resumed from, if any
+  bool resume = false;
+  Checkpoint::State resumed;
+};
+
+template<typename T>
+inline MIBloomFilterBuilder<T>::MIBloomFilterBuilder(
+  const unsigned hash_num,
+  const unsigned k,
+  const double occupancy,
+  const unsigned threads,
+  const std::vector<std::string>& seeds,
+  const size_t expected_elements)
+  : hash_num(hash_num)
+  , k(k)
+  , occupancy(occupancy)
+  , threads(threads)
+  , seeds(seeds)
+  , parsed_seeds(parse_seeds(seeds))
+  , expected_elements(expected_elements)
+{
+  check_error(hash_num == 0, "MIBloomFilterBuilder: hash_num must be > 0.");
+  check_error(k == 0, "MIBloomFilterBuilder: k must be > 0.");
+  check_error(occupancy <= 0.0 || occupancy >= 1.0,
+              "MIBloomFilterBuilder: occupancy must be between 0 and 1.");
+  check_error(threads == 0, "MIBloomFilterBuilder: threads must be > 0.");
+  if (!seeds.empty()) {
+    check_seeds(seeds, k);
+    check_error(seeds.size() != hash_num,
+                "MIBloomFilterBuilder: hash_num must equal the number of "
+                "spaced seeds.");
+  }
+}
+
+template<typename T>
+inline std::unique_ptr<MIBloomFilter<T>>
+MIBloomFilterBuilder<T>::build()
+{
+  check_error(built, "MIBloomFilterBuilder: build() may only be called once.");
+  built = true;
+
+  thread_coverage.assign(threads, std::vector<IdCoverage>());
+  if (checkpoint != nullptr && checkpoint->exists()) {
+    resume_checkpoint();
+  } else if (expected_elements == 0) {
+    expected_elements = count_elements();
+  }
+  check_error(expected_elements == 0,
+              "MIBloomFilterBuilder: No elements to build a filter from.");
+
+  std::unique_ptr<MIBloomFilter<T>> filter;
+  if (!resume || resumed.stage == 0) {
+    sdsl::bit_vector bv(MIBloomFilter<T>::calc_optimal_size(
+      expected_elements, hash_num, occupancy));
+    if (resume) {
+      load_bit_vector(bv, checkpoint->get_snapshot_path());
+    }
+    log_info("MIBloomFilterBuilder: Populating bit vector of size " +
+             std::to_string(bv.size()) + " for " +
+             std::to_string(expected_elements) + " elements.");
+    snapshot_writer = [&bv](const std::string& path) {
+      return save_bit_vector(bv, path);
+    };
+    const unsigned bv_hash_num = hash_num;
+    run_pass(0, [&](unsigned, const uint64_t* hashes, T) {
+      MIBloomFilter<T>::insert(bv, hashes, bv_hash_num);
+    });
+
+    log_info("MIBloomFilterBuilder: Building rank support.");
+    filter.reset(new MIBloomFilter<T>(hash_num, k, bv, seeds));
+  } else {
+    filter.reset(new MIBloomFilter<T>(checkpoint->get_snapshot_path()));
+  }
+  auto* const snapshot_filter = filter.get();
+  snapshot_writer = [snapshot_filter](const std::string& path) {
+    snapshot_filter->store(path);
+    return std::vector<std::string>{ path, path + ".sdsl" };
+  };
+
+  log_info("MIBloomFilterBuilder: Placing IDs.");
+  run_pass(1, [&](unsigned thread, const uint64_t* hashes, T id) {
+    filter->place(hashes, id);
+    coverage_of(thread_coverage[thread], id).elements++;
+  });
+
+  log_info("MIBloomFilterBuilder: Saturating unrepresented elements.");
+  run_pass(2, [&](unsigned thread, const uint64_t* hashes, T id) {
+    auto& stats = coverage_of(thread_coverage[thread], id);
+    if (represented(*filter, hashes, id)) {
+      stats.represented++;
+    } else {
+      filter->saturate(hashes);
+      stats.saturated++;
+    }
+  });
+
+  coverage.clear();
+  for (const auto& stats : thread_coverage) {
+    for (size_t id = 0; id < stats.size(); id++) {
+      auto& total = coverage_of(coverage, T(id));
+      total.elements += stats[id].elements;
+      total.represented += stats[id].represented;
+      total.saturated += stats[id].saturated;
+    }
+  }
+  std::vector<size_t> slots(std::max(coverage.size(), size_t(1)), 0);
+  filter->get_id_counts(slots);
+  for (size_t id = 0; id < coverage.size(); id++) {
+    coverage[id].slots = slots[id];
+  }
+
+  return filter;
+}
+
+template<typename T>
+inline size_t
+MIBloomFilterBuilder<T>::count_elements()
+{
+  size_t elements = 0;
+  for (const auto& source : hash_sources) {
+    elements += source.hashes.size() / hash_num;
+  }
+  // Every k-mer is counted, so duplicates and k-mers with invalid bases
+  // make this an upper bound
+  for (const auto& source : seq_sources) {
+    SeqReader reader(source.path, SeqReader::Flag::AUTO_MODE);
+    std::atomic<size_t> kmers{ 0 };
+    run_threads([&](unsigned) {
+      size_t thread_kmers = 0;
+      SeqReader::Record record;
+      while ((record = reader.read())) {
+        if (record.seq.size() >= k) {
+          thread_kmers += record.seq.size() - k + 1;
+        }
+      }
+      kmers += thread_kmers;
+    });
+    elements += kmers;
+  }
+  return elements;
+}
+
+template<typename T>
+inline void
+MIBloomFilterBuilder<T>::run_threads(
+  const std::function<void(unsigned)>& worker)
+{
+  std::vector<std::unique_ptr<std::thread>> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    workers.push_back(
+      std::unique_ptr<std::thread>(new std::thread(worker, i)));
+  }
+  try {
+    for (auto& thread : workers) {
+      thread->join();
+    }
+  } catch (const std::system_error& e) {
+    log_error("MIBloomFilterBuilder thread join failure: " +
+              std::string(e.what()));
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+  }
+}
+
+template<typename T>
+template<typename F>
+inline void
+MIBloomFilterBuilder<T>::run_pass(const unsigned pass, F f)
+{
+  this->pass = pass;
+  const bool resume_pass = resume && resumed.stage == pass;
+  if (resume && resumed.stage > pass) {
+    return;
+  }
+  // Sequence files come first, then precomputed elements
+  const size_t sources = seq_sources.size() + hash_sources.size();
+  for (size_t i = 0; i < sources; i++) {
+    size_t first_record = 0, first_offset = 0;
+    if (resume_pass) {
+      if (i < resumed.source) {
+        continue;
+      }
+      if (i == resumed.source) {
+        first_record = resumed.record;
+        first_offset = resumed.offset;
+      }
+    }
+    if (checkpoint != nullptr && checkpoint->due()) {
+      save_checkpoint(i, first_record, first_offset);
+    }
+    if (i < seq_sources.size()) {
+      run_seq_source(i, first_record, first_offset, f);
+    } else {
+      run_hash_source(hash_sources[i - seq_sources.size()], f);
+    }
+  }
+  resume = resume && !resume_pass;
+}
+
+template<typename T>
+template<typename F>
+inline void
+MIBloomFilterBuilder<T>::run_seq_source(const size_t index,
+                                        const size_t first_record,
+                                        const size_t first_offset,
+                                        F& f)
+{
+  const auto& source = seq_sources[index];
+  SeqReader reader(source.path, SeqReader::Flag::AUTO_MODE);
+  std::mutex mutex;
+  std::condition_variable cv;
+  // read() buffers records per thread, so the threads take turns consuming
+  // a shared block instead
+  OrderQueueMPMC<SeqReader::Record>::Block block(0);
+  size_t block_pos = 0;
+  std::shared_ptr<const SeqReader::Record> record;
+  T record_id = 0;
+  size_t next_start = 0;
+  bool done = false;
+  // Threads hashing segments, and whether they are to stop taking new ones
+  // for a checkpoint
+  unsigned busy = 0;
+  bool pausing = false;
+
+  run_threads([&](unsigned thread) {
+    std::vector<Segment> segments;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      cv.wait(lock, [&]() { return !pausing; });
+      if (checkpoint != nullptr && !done && checkpoint->due()) {
+        pausing = true;
+        cv.wait(lock, [&]() { return busy == 0; });
+        // Every k-mer before the next one to be handed out has been hashed,
+        // and none after it, until the snapshot is written
+        if (!record) {
+          save_checkpoint(index, first_record, first_offset);
+        } else if (next_start + k > record->seq.size()) {
+          save_checkpoint(index, record->num + 1, 0);
+        } else {
+          save_checkpoint(index, record->num, next_start);
+        }
+        pausing = false;
+        cv.notify_all();
+      }
+
+      segments.clear();
+      size_t bases = 0;
+      while (bases < SEGMENT_SIZE && !done) {
+        if (!record || next_start + k > record->seq.size()) {
+          if (block_pos >= block.count) {
+            block = reader.read_block();
+            block_pos = 0;
+            if (block.count == 0) {
+              done = true;
+              break;
+            }
+          }
+          SeqReader::Record next = std::move(block.data[block_pos++]);
+          // Records before the checkpoint resumed from are skipped
+          if (next.num < first_record) {
+            continue;
+          }
+          const bool partial = next.num == first_record;
+          record_id = source.assign_id(next);
+          check_id(record_id);
+          record = std::make_shared<const SeqReader::Record>(std::move(next));
+          next_start = partial ? first_offset : 0;
+          continue;
+        }
+        // Consecutive segments overlap by k - 1 bases, so that every
+        // k-mer is hashed exactly once
+        const size_t end = std::min(record->seq.size(),
+                                    next_start + SEGMENT_SIZE - bases + k - 1);
+        segments.push_back(Segment{ record, record_id, next_start, end });
+        bases += end - next_start;
+        next_start = end - k + 1;
+      }
+      if (segments.empty()) {
+        break;
+      }
+      ++busy;
+      lock.unlock();
+      for (const auto& segment : segments) {
+        hash_segment(thread, segment, f);
+      }
+      lock.lock();
+      if (--busy == 0 && pausing) {
+        cv.notify_all();
+      }
+    }
+  });
+}
+
+template<typename T>
+template<typename F>
+inline void
+MIBloomFilterBuilder<T>::run_hash_source(const HashSource& source, F& f)
+{
+  const size_t elements = source.hashes.size() / hash_num;
+  std::atomic<size_t> next_chunk{ 0 };
+  run_threads([&](unsigned thread) {
+    for (;;) {
+      const size_t start = next_chunk.fetch_add(HASH_CHUNK_SIZE);
+      if (start >= elements) {
+        break;
+      }
+      const size_t end = std::min(elements, start + HASH_CHUNK_SIZE);
+      for (size_t i = start; i < end; i++) {
+        f(thread,
+          source.hashes.data() + i * hash_num,
+          source.ids.empty() ? source.id : source.ids[i]);
+      }
+    }
+  });
+}
+
+template<typename T>
+template<typename F>
+inline void
+MIBloomFilterBuilder<T>::hash_segment(const unsigned thread,
+                                      const Segment& segment,
+                                      F& f) const
+{
+  const char* const seq = segment.record->seq.data() + segment.start;
+  const size_t seq_len = segment.end - segment.start;
+  if (parsed_seeds.empty()) {
+    NtHash nthash(seq, seq_len, hash_num, k);
+    while (nthash.roll()) {
+      f(thread, nthash.hashes(), segment.id);
+    }
+  } else {
+    SeedNtHash nthash(seq, seq_len, parsed_seeds, 1, k);
+    while (nthash.roll()) {
+      f(thread, nthash.hashes(), segment.id);
+    }
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterBuilder<T>::resume_checkpoint()
+{
+  resume = true;
+  resumed = checkpoint->get_state();
+  check_error(resumed.get_counter("hash_num") != hash_num ||
+                resumed.get_counter("k") != k,
+              "MIBloomFilterBuilder: Checkpoint " +
+                checkpoint->get_snapshot_path() +
+                " is of a build with different parameters.");
+  expected_elements = resumed.get_counter("expected_elements");
+  log_info("MIBloomFilterBuilder: Resuming pass " +
+           std::to_string(resumed.stage) + " from source " +
+           std::to_string(resumed.source) + ", record " +
+           std::to_string(resumed.record) + ".");
+  const auto it = resumed.counters.find("elements");
+  const size_t ids = it == resumed.counters.end() ? 0 : it->second.size();
+  for (size_t id = 0; id < ids; id++) {
+    auto& stats = coverage_of(thread_coverage[0], T(id));
+    stats.elements = resumed.get_counter("elements", id);
+    stats.represented = resumed.get_counter("represented", id);
+    stats.saturated = resumed.get_counter("saturated", id);
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterBuilder<T>::save_checkpoint(const size_t source,
+                                         const size_t record,
+                                         const size_t offset)
+{
+  Checkpoint::State state;
+  state.stage = pass;
+  state.source = source;
+  state.record = record;
+  state.offset = offset;
+  state.counters["hash_num"] = { hash_num };
+  state.counters["k"] = { k };
+  state.counters["expected_elements"] = { uint64_t(expected_elements) };
+  auto& element_counts = state.counters["elements"];
+  auto& represented_counts = state.counters["represented"];
+  auto& saturated_counts = state.counters["saturated"];
+  for (const auto& stats : thread_coverage) {
+    if (element_counts.size() < stats.size()) {
+      element_counts.resize(stats.size());
+      represented_counts.resize(stats.size());
+      saturated_counts.resize(stats.size());
+    }
+    for (size_t id = 0; id < stats.size(); id++) {
+      element_counts[id] += stats[id].elements;
+      represented_counts[id] += stats[id].represented;
+      saturated_counts[id] += stats[id].saturated;
+    }
+  }
+  checkpoint->save(std::move(state), snapshot_writer);
+  // The threads write to the bit vector or filter as soon as they resume
+  checkpoint->wait();
+}
+
+template<typename T>
+inline std::vector<std::string>
+MIBloomFilterBuilder<T>::save_bit_vector(const sdsl::bit_vector& bv,
+                                         const std::string& path)
+{
+  std::ofstream ofs(path, std::ios::out | std::ios::binary);
+  check_stream(ofs, path);
+  const uint64_t size = bv.size();
+  ofs.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  ofs.write(reinterpret_cast<const char*>(bv.data()),
+            std::streamsize((size + 63) / 64 * sizeof(uint64_t)));
+  ofs.flush();
+  check_stream(ofs, path);
+  return std::vector<std::string>{ path };
+}
+
+template<typename T>
+inline void
+MIBloomFilterBuilder<T>::load_bit_vector(sdsl::bit_vector& bv,
+                                         const std::string& path)
+{
+  std::ifstream ifs(path, std::ios::in | std::ios::binary);
+  check_stream(ifs, path);
+  uint64_t size = 0;
+  ifs.read(reinterpret_cast<char*>(&size), sizeof(size));
+  check_error(!ifs || size != bv.size(),
+              "MIBloomFilterBuilder: Bit vector " + path +
+                " is of a different size.");
+  ifs.read(reinterpret_cast<char*>(bv.data()),
+           std::streamsize((size + 63) / 64 * sizeof(uint64_t)));
+  check_stream(ifs, path);
+}
+
+template<typename T>
+inline bool
+MIBloomFilterBuilder<T>::represented(const MIBloomFilter<T>& filter,
+                                     const uint64_t* hashes,
+                                     const T id) const
+{
+  for (unsigned i = 0; i < hash_num; i++) {
+    const auto value = filter.get_data(filter.get_rank_pos(hashes[i]));
+    if (T(value & MIBloomFilter<T>::ANTI_MASK) == id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace btllib
+
+#endif
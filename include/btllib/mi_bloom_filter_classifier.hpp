@@ -0,0 +1,479 @@
+#ifndef BTLLIB_MI_BLOOM_FILTER_CLASSIFIER_HPP
+#define BTLLIB_MI_BLOOM_FILTER_CLASSIFIER_HPP
+
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/nthash.hpp"
+#include "btllib/order_queue.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/status.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Classifies the reads of a sequence file against a multi-index Bloom filter.
+ * Reads are taken from the file a block at a time by a pool of threads, every
+ * frame of a read is queried, and the hits are tallied per ID and strand. The
+ * best ID is reported with the probability of reaching its hit count by
+ * chance, as given by the filter's per-frame false positive model. Results
+ * are returned in input order.
+ */
+template<typename T>
+class MIBloomFilterClassifier
+{
+
+public:
+  /** Frames of a read that hit an ID. */
+  struct IdHits
+  {
+    T id = 0;
+    /** Hits on the strand the ID's sequences were inserted in. */
+    size_t forward_hits = 0;
+    /** Hits on the opposite strand. */
+    size_t reverse_hits = 0;
+
+    size_t hits() const { return forward_hits + reverse_hits; }
+  };
+
+  /** Classification of a single read. */
+  struct Result
+  {
+    /** Number of the read in the input file. */
+    size_t num = std::numeric_limits<size_t>::max();
+    std::string id;
+    /** Best scoring ID, or 0 if no frame hit any ID. */
+    T best_id = 0;
+    /** Number of frames the read was split into. */
+    size_t frames = 0;
+    /** Score of the best ID. The hits on either strand, or on the majority
+     * strand if classifying strand-aware. */
+    size_t hits = 0;
+    /** Probability of at least this many hits on a random read. */
+    double p_value = 1.0;
+    /** Every ID hit by the read, best first. */
+    std::vector<IdHits> ids;
+
+    operator bool() const
+    {
+      return num != std::numeric_limits<size_t>::max();
+    }
+  };
+
+  /**
+   * Construct a classifier and start classifying the reads of a file.
+   *
+   * @param filter Filter to query. Must outlive the classifier.
+   * @param seq_path Filepath to read sequences from.
+   * @param threads Number of threads classifying reads.
+   * @param allowed_miss Number of unset bits a frame may have and still
+   * count as a hit.
+   * @param strand_aware Score the IDs by the strand with the most hits. The
+   * filter must have been built with strand information.
+   */
+  MIBloomFilterClassifier(MIBloomFilter<T>& filter,
+                          const std::string& seq_path,
+                          unsigned threads = 4,
+                          unsigned allowed_miss = 0,
+                          bool strand_aware = false);
+
+  MIBloomFilterClassifier(const MIBloomFilterClassifier&) = delete;
+  MIBloomFilterClassifier(MIBloomFilterClassifier&&) = delete;
+
+  MIBloomFilterClassifier& operator=(const MIBloomFilterClassifier&) = delete;
+  MIBloomFilterClassifier& operator=(MIBloomFilterClassifier&&) = delete;
+
+  ~MIBloomFilterClassifier() { close(); }
+
+  /** Stop classifying and release the threads. Results not yet read are
+   * discarded. */
+  void close();
+
+  /**
+   * Obtain the classification of the next read, in input order. Meant for a
+   * single consumer thread.
+   *
+   * @return The read's result, or an empty result once every read has been
+   * returned. Results convert to false when empty.
+   */
+  Result read();
+
+  /** Get the per-frame probability of a random hit, indexed by ID. */
+  const std::vector<double>& get_frame_probs() const { return frame_probs; }
+
+  /**
+   * Probability of at least hits successes in frames trials, each
+   * succeeding with probability frame_prob.
+   */
+  static double calc_p_value(size_t frames, size_t hits, double frame_prob);
+
+  /** Number of result blocks waiting to be read. */
+  static const size_t QUEUE_SIZE = 64;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  // Per thread query buffers and tallies, reused across reads
+  struct Scratch
+  {
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> ranks;
+    std::vector<T> values;
+    std::vector<char> forward;
+    std::vector<size_t> forward_hits;
+    std::vector<size_t> reverse_hits;
+    std::vector<T> touched;
+    std::unique_ptr<NtHash> nthash;
+    std::unique_ptr<SeedNtHash> seed_nthash;
+  };
+  /// @endcond
+
+  void start_workers();
+  void classify(const SeqReader::Record& record,
+                Result& result,
+                Scratch& scratch) const;
+  template<typename Hasher>
+  void tally_frames(Hasher& hasher, Result& result, Scratch& scratch) const;
+  void report(Result& result, Scratch& scratch) const;
+
+  const MIBloomFilter<T>& filter;
+  const unsigned threads;
+  const unsigned allowed_miss;
+  const bool strand_aware;
+  const T max_id;
+  std::vector<double> frame_probs;
+  SeqReader reader;
+  std::mutex input_mutex;
+  bool input_done = false;
+  size_t next_block_num = 0;
+  OrderQueueMPSC<Result> output_queue;
+  std::mutex output_mutex;
+  typename OrderQueueMPSC<Result>::Block ready_block;
+  size_t ready_pos = 0;
+  bool output_done = false;
+  std::atomic<bool> closed{ false };
+  std::vector<std::unique_ptr<std::thread>> workers;
+};
+
+template<typename T>
+inline MIBloomFilterClassifier<T>::MIBloomFilterClassifier(
+  MIBloomFilter<T>& filter,
+  const std::string& seq_path,
+  const unsigned threads,
+  const unsigned allowed_miss,
+  const bool strand_aware)
+  : filter(filter)
+  , threads(threads)
+  , allowed_miss(allowed_miss)
+  , strand_aware(strand_aware)
+  , max_id(filter.get_max_id())
+  , frame_probs(size_t(max_id) + 1, 0.0)
+  , reader(seq_path, SeqReader::Flag::AUTO_MODE)
+  , output_queue(QUEUE_SIZE, reader.get_block_size())
+  , ready_block(reader.get_block_size())
+{
+  check_error(threads == 0, "MIBloomFilterClassifier: threads must be > 0.");
+  check_error(allowed_miss >= filter.get_hash_num(),
+              "MIBloomFilterClassifier: allowed_miss must be less than the "
+              "filter's number of hashes.");
+  if (strand_aware) {
+    filter.calc_frame_probs_strand(frame_probs, allowed_miss);
+  } else {
+    check_error(filter.check_values(max_id) != max_id,
+                "MIBloomFilterClassifier: Filter holds strand information, "
+                "classify strand-aware instead.");
+    filter.calc_frame_probs(frame_probs, allowed_miss);
+  }
+  start_workers();
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::close()
+{
+  bool closed_expected = false;
+  if (closed.compare_exchange_strong(closed_expected, true)) {
+    output_queue.close();
+    reader.close();
+    try {
+      for (auto& worker : workers) {
+        worker->join();
+      }
+    } catch (const std::system_error& e) {
+      log_error("MIBloomFilterClassifier thread join failure: " +
+                std::string(e.what()));
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+  }
+}
+
+template<typename T>
+inline typename MIBloomFilterClassifier<T>::Result
+MIBloomFilterClassifier<T>::read()
+{
+  const std::unique_lock<std::mutex> lock(output_mutex);
+  if (closed) {
+    return Result();
+  }
+  if (ready_pos >= ready_block.count) {
+    if (output_done) {
+      return Result();
+    }
+    ready_block.count = 0;
+    ready_pos = 0;
+    output_queue.read(ready_block);
+    // Only the end of output marker is empty
+    if (ready_block.count == 0) {
+      output_done = true;
+      return Result();
+    }
+  }
+  return std::move(ready_block.data[ready_pos++]);
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::start_workers()
+{
+  for (unsigned i = 0; i < threads; i++) {
+    workers.push_back(std::unique_ptr<std::thread>(new std::thread([this]() {
+      Scratch scratch;
+      scratch.forward_hits.resize(size_t(max_id) + 1);
+      scratch.reverse_hits.resize(size_t(max_id) + 1);
+      typename OrderQueueMPSC<Result>::Block results(0);
+      for (;;) {
+        OrderQueueMPMC<SeqReader::Record>::Block records(0);
+        {
+          // Blocks are renumbered here, as the reader's numbering is not
+          // dense once it is exhausted
+          const std::unique_lock<std::mutex> lock(input_mutex);
+          if (input_done) {
+            break;
+          }
+          records = reader.read_block();
+          if (records.count == 0) {
+            input_done = true;
+          }
+          results.num = next_block_num++;
+        }
+        if (results.data.size() < records.count) {
+          results.data.resize(records.count);
+        }
+        for (size_t j = 0; j < records.count; j++) {
+          classify(records.data[j], results.data[j], scratch);
+        }
+        results.count = records.count;
+        output_queue.write(results);
+        if (records.count == 0) {
+          break;
+        }
+      }
+    })));
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::classify(const SeqReader::Record& record,
+                                     Result& result,
+                                     Scratch& scratch) const
+{
+  result.num = record.num;
+  result.id = record.id;
+  result.best_id = 0;
+  result.frames = 0;
+  result.hits = 0;
+  result.p_value = 1.0;
+  result.ids.clear();
+
+  const unsigned k = filter.get_kmer_size();
+  if (record.seq.size() < k) {
+    return;
+  }
+  // Hashers keep a pointer to the sequence, which outlives the call
+  const auto& seeds = filter.get_seed_values();
+  if (seeds.empty()) {
+    if (scratch.nthash) {
+      scratch.nthash->change_seq(record.seq);
+    } else {
+      scratch.nthash = std::unique_ptr<NtHash>(
+        new NtHash(record.seq, filter.get_hash_num(), k));
+    }
+    tally_frames(*scratch.nthash, result, scratch);
+  } else {
+    if (scratch.seed_nthash) {
+      scratch.seed_nthash->change_seq(record.seq);
+    } else {
+      scratch.seed_nthash =
+        std::unique_ptr<SeedNtHash>(new SeedNtHash(record.seq, seeds, 1, k));
+    }
+    tally_frames(*scratch.seed_nthash, result, scratch);
+  }
+  report(result, scratch);
+}
+
+template<typename T>
+template<typename Hasher>
+inline void
+MIBloomFilterClassifier<T>::tally_frames(Hasher& hasher,
+                                         Result& result,
+                                         Scratch& scratch) const
+{
+  const unsigned hash_num = filter.get_hash_num();
+  const unsigned batch_size = MIBloomFilter<T>::QUERY_BATCH_SIZE;
+  if (scratch.hashes.size() < size_t(batch_size) * hash_num) {
+    scratch.hashes.resize(size_t(batch_size) * hash_num);
+    scratch.ranks.resize(size_t(batch_size) * hash_num);
+    scratch.values.resize(size_t(batch_size) * hash_num);
+    scratch.forward.resize(batch_size);
+  }
+
+  bool more = true;
+  while (more) {
+    size_t batch = 0;
+    while (batch < batch_size && (more = hasher.roll())) {
+      std::copy(hasher.hashes(),
+                hasher.hashes() + hash_num,
+                scratch.hashes.data() + batch * hash_num);
+      scratch.forward[batch] = char(hasher.forward());
+      ++batch;
+    }
+    result.frames += batch;
+    filter.at_batch(scratch.hashes.data(),
+                    batch,
+                    scratch.values.data(),
+                    scratch.ranks.data());
+
+    for (size_t i = 0; i < batch; ++i) {
+      const uint64_t* ranks = scratch.ranks.data() + i * hash_num;
+      const auto misses = size_t(
+        std::count(ranks,
+                   ranks + hash_num,
+                   uint64_t(MIBloomFilter<T>::NO_RANK)));
+      if (misses > allowed_miss) {
+        continue;
+      }
+      // Every distinct ID in the frame's slots is hit once. Unclaimed slots
+      // hold 0 and carry no information
+      const T* values = scratch.values.data() + i * hash_num;
+      for (unsigned j = 0; j < hash_num; ++j) {
+        if (ranks[j] == MIBloomFilter<T>::NO_RANK || values[j] == 0) {
+          continue;
+        }
+        const T id = values[j] & MIBloomFilter<T>::ID_MASK;
+        bool seen = false;
+        for (unsigned l = 0; l < j && !seen; ++l) {
+          seen = ranks[l] != MIBloomFilter<T>::NO_RANK &&
+                 T(values[l] & MIBloomFilter<T>::ID_MASK) == id;
+        }
+        if (seen) {
+          continue;
+        }
+        if (scratch.forward_hits[id] == 0 && scratch.reverse_hits[id] == 0) {
+          scratch.touched.push_back(id);
+        }
+        // The strand bit records the k-mer's orientation relative to its
+        // canonical form at insertion
+        const bool reverse = (values[j] & MIBloomFilter<T>::STRAND) != 0;
+        if (reverse != bool(scratch.forward[i])) {
+          ++scratch.reverse_hits[id];
+        } else {
+          ++scratch.forward_hits[id];
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::report(Result& result, Scratch& scratch) const
+{
+  for (const auto id : scratch.touched) {
+    IdHits id_hits;
+    id_hits.id = id;
+    id_hits.forward_hits = scratch.forward_hits[id];
+    id_hits.reverse_hits = scratch.reverse_hits[id];
+    result.ids.push_back(id_hits);
+    scratch.forward_hits[id] = 0;
+    scratch.reverse_hits[id] = 0;
+  }
+  scratch.touched.clear();
+  if (result.ids.empty()) {
+    return;
+  }
+
+  const bool by_strand = strand_aware;
+  const auto score = [by_strand](const IdHits& id_hits) {
+    return by_strand ? std::max(id_hits.forward_hits, id_hits.reverse_hits)
+                     : id_hits.hits();
+  };
+  std::sort(result.ids.begin(),
+            result.ids.end(),
+            [&](const IdHits& a, const IdHits& b) {
+              const auto score_a = score(a), score_b = score(b);
+              return score_a != score_b ? score_a > score_b : a.id < b.id;
+            });
+  result.best_id = result.ids.front().id;
+  result.hits = score(result.ids.front());
+  result.p_value =
+    calc_p_value(result.frames, result.hits, frame_probs[result.best_id]);
+}
+
+template<typename T>
+inline double
+MIBloomFilterClassifier<T>::calc_p_value(const size_t frames,
+                                         const size_t hits,
+                                         const double frame_prob)
+{
+  if (hits == 0) {
+    return 1.0;
+  }
+  if (hits > frames || frame_prob <= 0.0) {
+    return 0.0;
+  }
+  if (frame_prob >= 1.0) {
+    return 1.0;
+  }
+  // Each binomial term follows from its neighbour, so that no factorials are
+  // evaluated. Summing away from the mode keeps the terms decreasing, so a
+  // first term that underflows means the whole sum is negligible
+  const double log_p = std::log(frame_prob);
+  const double log_q = std::log1p(-frame_prob);
+  const double ratio = frame_prob / (1.0 - frame_prob);
+  const bool upper = double(hits) > double(frames) * frame_prob;
+  const size_t first = upper ? hits : hits - 1;
+  double log_term = double(first) * log_p + double(frames - first) * log_q;
+  const size_t smaller = std::min(first, frames - first);
+  for (size_t i = 0; i < smaller; i++) {
+    log_term += std::log(double(frames - i)) - std::log(double(i + 1));
+  }
+  double term = std::exp(log_term);
+  double sum = term;
+  if (upper) {
+    for (size_t x = first; x < frames && term >= sum * 1e-17; x++) {
+      term *= double(frames - x) / double(x + 1) * ratio;
+      sum += term;
+    }
+    return std::min(sum, 1.0);
+  }
+  for (size_t x = first; x > 0 && term >= sum * 1e-17; x--) {
+    term *= double(x) / double(frames - x + 1) / ratio;
+    sum += term;
+  }
+  return std::max(1.0 - sum, 0.0);
+}
+
+} // namespace btllib
+
+#endif
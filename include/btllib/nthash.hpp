@@ -12,6 +12,7 @@
 #include "btllib/status.hpp"
 
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <string>
@@ -137,6 +138,23 @@ public:
    */
   bool peek_back(char char_in);
 
+  /**
+   * Hash up to max_kmers k-mers, as if roll() was called for each of them,
+   * storing their hash values and positions in contiguous arrays.
+   *
+   * @param hash_values Array with room for get_hash_num() values per k-mer,
+   * the values of k-mer i are stored from index i * get_hash_num().
+   * @param positions Array with room for a value per k-mer, set to the
+   * positions of the k-mers. May be nullptr.
+   * @param max_kmers Maximum number of k-mers to hash.
+   *
+   * @return Number of k-mers hashed, less than max_kmers only at the end of
+   * the sequence.
+   */
+  size_t roll_batch(uint64_t* hash_values,
+                    uint64_t* positions,
+                    size_t max_kmers);
+
   void sub(const std::vector<unsigned>& positions,
            const std::vector<unsigned char>& new_bases);
 
@@ -369,6 +387,23 @@ public:
    */
   bool peek_back(char char_in);
 
+  /**
+   * Hash up to max_kmers k-mers, as if roll() was called for each of them,
+   * storing their hash values and positions in contiguous arrays.
+   *
+   * @param hash_values Array with room for get_hash_num() values per k-mer,
+   * the values of k-mer i are stored from index i * get_hash_num().
+   * @param positions Array with room for a value per k-mer, set to the
+   * positions of the k-mers. May be nullptr.
+   * @param max_kmers Maximum number of k-mers to hash.
+   *
+   * @return Number of k-mers hashed, less than max_kmers only at the end of
+   * the sequence.
+   */
+  size_t roll_batch(uint64_t* hash_values,
+                    uint64_t* positions,
+                    size_t max_kmers);
+
   const uint64_t* hashes() const { return nthash.hashes(); }
 
   void change_seq(const std::string& seq, size_t pos = 0)
@@ -824,10 +859,33 @@ BTLLIB_NTHASH_PEEK(
   },
   nthash.)
 
+// NOLINTNEXTLINE
+#define BTLLIB_NTHASH_ROLL_BATCH(CLASS)                                        \
+  inline size_t CLASS::roll_batch(uint64_t* const hash_values,                 \
+                                  uint64_t* const positions,                   \
+                                  const size_t max_kmers)                      \
+  {                                                                            \
+    const unsigned values = get_hash_num();                                    \
+    size_t n = 0;                                                              \
+    while (n < max_kmers && roll()) {                                          \
+      std::memcpy(                                                             \
+        hash_values + n * values, hashes(), values * sizeof(uint64_t));        \
+      if (positions != nullptr) {                                              \
+        positions[n] = get_pos();                                              \
+      }                                                                        \
+      ++n;                                                                     \
+    }                                                                          \
+    return n;                                                                  \
+  }
+
+BTLLIB_NTHASH_ROLL_BATCH(NtHash)
+BTLLIB_NTHASH_ROLL_BATCH(SeedNtHash)
+
 #undef BTLLIB_NTHASH_INIT
 #undef BTLLIB_NTHASH_ROLL
 #undef BTLLIB_NTHASH_ROLL_BACK
 #undef BTLLIB_NTHASH_PEEK
+#undef BTLLIB_NTHASH_ROLL_BATCH
 
 } // namespace btllib
 
@@ -1,11 +1,16 @@
 #ifndef BTLLIB_ORDER_QUEUE_HPP
 #define BTLLIB_ORDER_QUEUE_HPP
 
+#include "btllib/metrics.hpp"
+#include "btllib/status.hpp"
+
 #include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -20,6 +25,8 @@ namespace btllib {
  * 2) OrderQueueMPSC: Multiple Producer Single Consumer
  * 3) OrderQueueSPMC: Single Producer Multiple Consumer
  * 4) OrderQueueMPMC: Multiple Producer Multiple Consumer
+ * OrderQueueLockFree is a drop-in alternative to all four that does
+ * not take locks unless a thread has to wait for a long time.
  * The variations imply which aspect of the queue is thread-safe.
  * If the queue is multiple producer, then insertion into the queue
  * is thread-safe. If the queue is multiple consumer, then removal
@@ -183,10 +190,12 @@ protected:
       PRE_WRITE_LOCK;                                                          \
       const auto num = block.num;                                              \
       auto& target = this->slots[num % this->queue_size];                      \
+      BTLLIB_METRIC_TIMER(wait_start);                                         \
       std::unique_lock<std::mutex> busy_lock(target.busy);                     \
       target.occupancy_changed.wait(busy_lock, [&] {                           \
         return (!target.occupied EXTRA_WRITE_LOCK_CONDS) || this->closed;      \
       });                                                                      \
+      BTLLIB_METRIC_ADD_ELAPSED(ORDER_QUEUE_WRITE_WAIT_NS, wait_start);        \
       if (this->closed) {                                                      \
         return;                                                                \
       }                                                                        \
@@ -195,16 +204,20 @@ protected:
       target.occupied = true;                                                  \
       target.occupancy_changed.NOTIFY_WRITE();                                 \
       ++(this->element_count);                                                 \
+      BTLLIB_METRIC_ADD(ORDER_QUEUE_WRITES, 1);                                \
+      BTLLIB_METRIC_ADD(ORDER_QUEUE_OCCUPANCY, this->element_count);           \
     }                                                                          \
                                                                                \
     void read(Block& block)                                                    \
     {                                                                          \
+      BTLLIB_METRIC_TIMER(wait_start);                                         \
       PRE_READ_LOCK;                                                           \
       auto& target = this->slots[this->read_counter % this->queue_size];       \
       std::unique_lock<std::mutex> busy_lock(target.busy);                     \
       target.occupancy_changed.wait(busy_lock, [&] {                           \
         return (target.occupied EXTRA_READ_LOCK_CONDS) || this->closed;        \
       });                                                                      \
+      BTLLIB_METRIC_ADD_ELAPSED(ORDER_QUEUE_READ_WAIT_NS, wait_start);         \
       if (this->closed) {                                                      \
         return;                                                                \
       }                                                                        \
@@ -214,6 +227,7 @@ protected:
       target.occupied = false;                                                 \
       target.occupancy_changed.NOTIFY_READ();                                  \
       --(this->element_count);                                                 \
+      BTLLIB_METRIC_ADD(ORDER_QUEUE_READS, 1);                                 \
     }                                                                          \
                                                                                \
   private:                                                                     \
@@ -253,6 +267,161 @@ ORDER_QUEUE_XPXC(MPMC,
 
 #undef ORDER_QUEUE_XPXC
 
+/**
+ * @brief Lock-free variant of OrderQueue, safe for multiple producers
+ * and multiple consumers. Every slot carries a sequence number that
+ * tells whose turn it is: a block numbered `num` can be written to
+ * its slot once the sequence number equals `num`, and a reader can
+ * claim it once the sequence number equals `num + 1` and all earlier
+ * blocks have been claimed. Threads spin briefly while waiting for
+ * their turn and then park on the slot, so the locks are only touched
+ * when a thread has run out of work.
+ *
+ * @tparam T The type of the elements in the queue.
+ */
+template<typename T>
+class OrderQueueLockFree
+{
+
+public:
+  using Block = typename OrderQueue<T>::Block;
+
+  OrderQueueLockFree(const size_t queue_size, const size_t block_size)
+    : slots(new Slot[queue_size])
+    , queue_size(queue_size)
+    , block_size(block_size)
+  {
+    // With a single slot, the sequence number a read leaves for the next
+    // block is the one that marks it as written
+    check_error(queue_size < 2,
+                "OrderQueueLockFree: queue size must be at least 2.");
+    for (size_t i = 0; i < queue_size; i++) {
+      slots[i].block = Block(block_size);
+      slots[i].seq = i;
+    }
+  }
+
+  OrderQueueLockFree(const OrderQueueLockFree&) = delete;
+  OrderQueueLockFree(OrderQueueLockFree&&) = delete;
+
+  ~OrderQueueLockFree() { close(); }
+
+  void write(Block& block)
+  {
+    const auto num = block.num;
+    auto& target = slots[num % queue_size];
+    BTLLIB_METRIC_TIMER(wait_start);
+    wait(target, [&]() { return target.seq == num; });
+    BTLLIB_METRIC_ADD_ELAPSED(ORDER_QUEUE_WRITE_WAIT_NS, wait_start);
+    if (closed) {
+      return;
+    }
+    target.block = std::move(block);
+    ++element_count;
+    BTLLIB_METRIC_ADD(ORDER_QUEUE_WRITES, 1);
+    BTLLIB_METRIC_ADD(ORDER_QUEUE_OCCUPANCY, element_count);
+    target.seq = num + 1;
+    wake(target);
+  }
+
+  void read(Block& block)
+  {
+    BTLLIB_METRIC_TIMER(wait_start);
+    for (;;) {
+      auto ticket = read_counter.load();
+      auto& target = slots[ticket % queue_size];
+      wait(target, [&]() {
+        return target.seq == ticket + 1 || read_counter != ticket;
+      });
+      if (closed) {
+        return;
+      }
+      // The next block is only claimed once it is in place, so whoever
+      // receives a block knows that all preceding blocks have been received.
+      if (target.seq == ticket + 1 &&
+          read_counter.compare_exchange_strong(ticket, ticket + 1)) {
+        BTLLIB_METRIC_ADD_ELAPSED(ORDER_QUEUE_READ_WAIT_NS, wait_start);
+        BTLLIB_METRIC_ADD(ORDER_QUEUE_READS, 1);
+        block = std::move(target.block);
+        --element_count;
+        target.seq = ticket + queue_size;
+        wake(target);
+        return;
+      }
+    }
+  }
+
+  size_t elements() const { return element_count; }
+
+  void close()
+  {
+    bool closed_expected = false;
+    if (closed.compare_exchange_strong(closed_expected, true)) {
+      for (size_t i = 0; i < queue_size; i++) {
+        const std::unique_lock<std::mutex> lock(slots[i].park_mutex);
+        slots[i].park_cv.notify_all();
+      }
+    }
+  }
+
+  bool is_closed() const { return closed; }
+
+  size_t get_queue_size() const { return queue_size; }
+  size_t get_block_size() const { return block_size; }
+
+  /** Number of busy polls before yielding the CPU while waiting. */
+  static const unsigned SPIN_ITERATIONS = 64;
+  /** Number of polls with yielding before parking the thread. */
+  static const unsigned YIELD_ITERATIONS = 64;
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct Slot
+  {
+    Block block{ 0 };
+    std::atomic<size_t> seq{ 0 };
+    std::atomic<unsigned> parked{ 0 };
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
+  };
+  /// @endcond
+
+  template<typename Ready>
+  void wait(Slot& slot, const Ready& ready)
+  {
+    const auto ready_or_closed = [&]() { return ready() || closed; };
+    for (unsigned i = 0; i < SPIN_ITERATIONS + YIELD_ITERATIONS; i++) {
+      if (ready_or_closed()) {
+        return;
+      }
+      if (i >= SPIN_ITERATIONS) {
+        std::this_thread::yield();
+      }
+    }
+    std::unique_lock<std::mutex> lock(slot.park_mutex);
+    ++slot.parked;
+    slot.park_cv.wait(lock, ready_or_closed);
+    --slot.parked;
+  }
+
+  static void wake(Slot& slot)
+  {
+    // Both the sequence number update and this check are sequentially
+    // consistent, so a parking thread either sees the new sequence number or
+    // is seen here.
+    if (slot.parked > 0) {
+      const std::unique_lock<std::mutex> lock(slot.park_mutex);
+      slot.park_cv.notify_all();
+    }
+  }
+
+  std::unique_ptr<Slot[]> slots;
+  const size_t queue_size, block_size;
+  std::atomic<size_t> read_counter{ 0 };
+  std::atomic<size_t> element_count{ 0 };
+  std::atomic<bool> closed{ false };
+};
+
 } // namespace btllib
 
 #endif
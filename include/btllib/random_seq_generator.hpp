@@ -1,11 +1,74 @@
 #ifndef BTLLIB_RANDOM_SEQ_HPP
 #define BTLLIB_RANDOM_SEQ_HPP
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <string>
 
 namespace btllib {
 
+/**
+ * Fast pseudorandom number generator (xoshiro256**). Not suitable for
+ * cryptography. Satisfies the requirements of a uniform random bit
+ * generator, so it can be used with the distributions of <random>.
+ */
+class RandomEngine
+{
+
+public:
+  using result_type = uint64_t;
+
+  /**
+   * Construct a generator. Generators with the same seed and stream produce
+   * the same numbers, and generators with different streams produce
+   * independent numbers, so giving every sequence or thread a stream of its
+   * own makes the output reproducible regardless of scheduling.
+   *
+   * @param seed Seed.
+   * @param stream Stream of the seed to use.
+   */
+  explicit RandomEngine(uint64_t seed, uint64_t stream = 0);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max()
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  /** Get the next 64 random bits. */
+  result_type operator()()
+  {
+    const uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+  }
+
+  /** Get a random number in [0, 1). */
+  double uniform() { return double((*this)() >> 11) / double(1ULL << 53); }
+
+  /** Get a random number in [0, n), for n < 2^32. */
+  uint64_t below(const uint64_t n)
+  {
+    return ((*this)() >> 32) * n >> 32; // NOLINT
+  }
+
+private:
+  static uint64_t rotl(const uint64_t x, const int k)
+  {
+    return (x << k) | (x >> (64 - k)); // NOLINT
+  }
+
+  uint64_t state[4];
+};
+
 class RandomSequenceGenerator
 {
 public:
@@ -33,16 +96,44 @@ public:
   RandomSequenceGenerator(SequenceType type, Masking masking = Masking::NONE);
 
   /**
-   * Generate a new random sequence.
+   * Construct a random sequence generator object whose output is
+   * reproducible.
+   *
+   * @param type Sequence type (DNA, RNA, or protein)
+   * @param masking If set to SOFT, lower-case values will also be generated. If
+   * HARD, the sequences will include N/X positions.
+   * @param seed Seed. The n-th call to generate(length) generates the same
+   * sequence for the same seed.
+   */
+  RandomSequenceGenerator(SequenceType type, Masking masking, uint64_t seed);
+
+  /**
+   * Generate a new random sequence. Threadsafe.
    *
    * @param length Sequence length
    */
   std::string generate(size_t length);
 
+  /**
+   * Generate a new random sequence with the given generator. Characters are
+   * drawn several at a time from each 64-bit random number, e.g. 32 DNA bases
+   * at 2 bits each.
+   *
+   * @param length Sequence length
+   * @param rng Random number generator to use.
+   * @param seq String to store the sequence in, replacing its contents.
+   */
+  void generate(size_t length, RandomEngine& rng, std::string& seq) const;
+
 private:
   std::string chars;
+  unsigned bits_per_char = 0;
+  std::string char_quads;
+  bool seeded = false;
+  uint64_t seed = 0;
+  std::atomic<uint64_t> calls{ 0 };
 };
 
 } // namespace btllib
 
-#endif
\ No newline at end of file
+#endif
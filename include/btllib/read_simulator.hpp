@@ -0,0 +1,146 @@
+#ifndef BTLLIB_READ_SIMULATOR_HPP
+#define BTLLIB_READ_SIMULATOR_HPP
+
+#include "btllib/executor.hpp"
+#include "btllib/random_seq_generator.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/seq_writer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace btllib {
+
+/** Distribution of the lengths of simulated reads. */
+class ReadLengthDistribution
+{
+
+public:
+  enum class Type
+  {
+    FIXED,
+    UNIFORM,
+    NORMAL,
+    LOG_NORMAL
+  };
+
+  /** Every read is of the given length. */
+  static ReadLengthDistribution fixed(size_t length);
+
+  /** Read lengths are uniformly distributed in [min_length, max_length]. */
+  static ReadLengthDistribution uniform(size_t min_length, size_t max_length);
+
+  /** Read lengths are normally distributed, e.g. for short reads. */
+  static ReadLengthDistribution normal(double mean, double sd);
+
+  /**
+   * Read lengths are log-normally distributed, e.g. for long reads. The mean
+   * and standard deviation are of the lengths, not of their logarithm.
+   */
+  static ReadLengthDistribution log_normal(double mean, double sd);
+
+  /**
+   * Draw a read length. Lengths are at least 1.
+   *
+   * @param rng Random number generator to use.
+   */
+  size_t sample(RandomEngine& rng) const;
+
+  Type get_type() const { return type; }
+
+private:
+  ReadLengthDistribution(Type type, double a, double b);
+
+  Type type;
+  double a, b;
+};
+
+/**
+ * Simulate sequencing reads from a set of reference sequences. Every read is
+ * taken from a random position of a random reference, with references picked
+ * in proportion to their length, and from either strand. Sequencing errors
+ * are then introduced at the given per-base rates.
+ *
+ * Read n only depends on the seed and n, so the output is the same
+ * regardless of the number of threads.
+ */
+class ReadSimulator
+{
+
+public:
+  /**
+   * Construct a read simulator.
+   *
+   * @param references Sequences to take reads from.
+   * @param lengths Distribution of read lengths. Reads longer than their
+   * reference are cut to the reference length.
+   * @param seed Seed of the simulation.
+   * @param substitution_rate Probability of a base being substituted by
+   * another.
+   * @param insertion_rate Probability of a random base being inserted before
+   * a base.
+   * @param deletion_rate Probability of a base being deleted.
+   * @param both_strands Whether half of the reads are reverse complemented.
+   */
+  ReadSimulator(std::vector<std::string> references,
+                ReadLengthDistribution lengths,
+                uint64_t seed,
+                double substitution_rate = 0.0,
+                double insertion_rate = 0.0,
+                double deletion_rate = 0.0,
+                bool both_strands = true);
+
+  /**
+   * Simulate a read. The read ID is its number plus one, and the comment
+   * gives its origin as "<reference>:<start>-<end>:<strand>", with the
+   * reference numbered from 0 and a 0-based, half-open interval. The quality
+   * of erroneous bases is QUAL_ERROR and of other bases QUAL_CORRECT.
+   *
+   * @param num Read number.
+   * @param record Record to store the read in.
+   */
+  void simulate(size_t num, SeqReader::Record& record) const;
+
+  /**
+   * Simulate reads [first, first + count) in parallel and write them in
+   * order.
+   *
+   * @param writer Writer to write the reads to.
+   * @param count Number of reads to simulate.
+   * @param first Number of the first read.
+   * @param executor Executor to simulate the reads on.
+   *
+   * @return Number of bases written.
+   */
+  uint64_t write(SeqWriter& writer,
+                 size_t count,
+                 size_t first = 0,
+                 Executor& executor = Executor::global()) const;
+
+  /** Quality score of bases without sequencing errors. */
+  static const char QUAL_CORRECT = 'I';
+  /** Quality score of substituted and inserted bases. */
+  static const char QUAL_ERROR = '#';
+  /** Number of reads simulated by a single task of write(). */
+  static const size_t BATCH_SIZE = 1024;
+
+private:
+  size_t add_errors(const char* ref,
+                    size_t ref_len,
+                    size_t read_len,
+                    RandomEngine& rng,
+                    SeqReader::Record& record) const;
+
+  std::vector<std::string> references;
+  std::vector<size_t> reference_ends;
+  ReadLengthDistribution lengths;
+  uint64_t seed;
+  double substitution_rate, insertion_rate, deletion_rate;
+  bool both_strands;
+};
+
+} // namespace btllib
+
+#endif
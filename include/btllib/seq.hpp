@@ -6,6 +6,7 @@
 
 #include "btllib/status.hpp"
 
+#include <cstddef>
 #include <string>
 
 namespace btllib {
@@ -13,6 +14,32 @@ namespace btllib {
 extern const char COMPLEMENTS[256];
 extern const char CAPITALS[256];
 
+/**
+ * Instruction sets the sequence manipulation functions can use. The best one
+ * supported by the CPU is picked at run time.
+ */
+enum class SimdLevel
+{
+  SCALAR,
+  SSE4,
+  AVX2,
+  AVX512
+};
+
+/** Get the instruction set the sequence manipulation functions use. */
+SimdLevel
+get_simd_level();
+
+/**
+ * Limit the instruction set the sequence manipulation functions use, e.g. to
+ * compare their speed. Levels the CPU does not support are lowered to the
+ * best supported one.
+ *
+ * @param level Instruction set to use.
+ */
+void
+set_simd_level(SimdLevel level);
+
 /**
  * Reverse complement a sequence in-place.
  *
@@ -32,6 +59,56 @@ reverse_complement(std::string& seq);
 std::string
 get_reverse_complement(const std::string& seq);
 
+/**
+ * Complement a sequence in-place. Characters that are not IUPAC codes become
+ * null characters.
+ *
+ * @param seq Sequence to complement.
+ */
+void
+complement(std::string& seq);
+
+/**
+ * Convert a sequence to upper case in-place, stopping at the first character
+ * that is not a letter, '-' or '.'.
+ *
+ * @param seq Sequence to convert.
+ *
+ * @return Position of the first invalid character, or std::string::npos if
+ * the whole sequence was converted.
+ */
+size_t
+fold_case(std::string& seq);
+
+/**
+ * Find the first character of a sequence that is not an IUPAC code.
+ *
+ * @param seq Sequence to check.
+ *
+ * @return Position of the first invalid character, or std::string::npos if
+ * there is none.
+ */
+size_t
+find_invalid_iupac(const std::string& seq);
+
+/**
+ * Remove soft masked (lower case) characters from both ends of a sequence.
+ *
+ * @param seq Sequence to trim.
+ */
+void
+trim_masked(std::string& seq);
+
+/**
+ * Remove soft masked (lower case) characters from both ends of a sequence,
+ * and the corresponding quality scores.
+ *
+ * @param seq Sequence to trim.
+ * @param qual Quality string of the sequence. Left as is if empty.
+ */
+void
+trim_masked(std::string& seq, std::string& qual);
+
 } // namespace btllib
 
 #endif
\ No newline at end of file
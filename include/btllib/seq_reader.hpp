@@ -3,8 +3,10 @@
 
 #include "btllib/cstring.hpp"
 #include "btllib/data_stream.hpp"
+#include "btllib/executor.hpp"
 #include "btllib/order_queue.hpp"
 #include "btllib/seq.hpp"
+#include "btllib/seq_reader_bam_module.hpp"
 #include "btllib/seq_reader_fasta_module.hpp"
 #include "btllib/seq_reader_fastq_module.hpp"
 #include "btllib/seq_reader_gfa2_module.hpp"
@@ -15,7 +17,9 @@
 
 #include <atomic>
 #include <cctype>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -36,9 +40,12 @@ namespace btllib {
 
 /** Read a FASTA, FASTQ, SAM, or GFA2 file. When reading SAM files,
  * `samtools fastq` is used to convert from the SAM format to the
- * FASTQ format. Capable of reading gzip (.gz), bzip2 (.bz2), xz (.xz),
- * zip (.zip), 7zip (.7z), lrzip (.lrz), BAM (.bam) and CRAM (.cram),
- * and URL (http://, https://, ftp://) files. Threadsafe. */
+ * FASTQ format. BAM (.bam) files are decoded natively, following the same
+ * conventions. Capable of reading gzip (.gz), bzip2 (.bz2), xz (.xz),
+ * zip (.zip), 7zip (.7z), lrzip (.lrz), CRAM (.cram),
+ * and URL (http://, https://, ftp://) files. Threadsafe. Records are parsed
+ * by a dedicated reader thread and converted into Record objects by tasks on
+ * the library's shared Executor. */
 class SeqReader
 {
 public:
@@ -57,15 +64,20 @@ public:
     static const unsigned SHORT_MODE = 4;
     /** Optimizes performance for long sequences (approx. >5kbp) */
     static const unsigned LONG_MODE = 8;
+    /** Sizes blocks by bytes rather than record count and adapts queue depth
+     * to consumer speed. Suitable for inputs with mixed or unknown sequence
+     * lengths. */
+    static const unsigned AUTO_MODE = 16;
   };
 
   /**
    * Construct a SeqReader to read sequences from a given path.
    *
    * @param source_path Filepath to read from. Pass "-" to read from stdin.
-   * @param flags Modifier flags. Specifiying either short or long mode flag is
-   * mandatory; other flags are optional.
-   * @param threads Maximum number of helper threads to use. Must be at least 1.
+   * @param flags Modifier flags. Specifiying one of short, long, or auto mode
+   * flags is mandatory; other flags are optional.
+   * @param threads Maximum number of blocks converted at once on the shared
+   * Executor. Must be at least 1.
    */
   SeqReader(const std::string& source_path,
             unsigned flags,
@@ -85,6 +97,7 @@ public:
   bool trim_masked() const { return bool(flags & Flag::TRIM_MASKED); }
   bool short_mode() const { return bool(flags & Flag::SHORT_MODE); }
   bool long_mode() const { return bool(flags & Flag::LONG_MODE); }
+  bool auto_mode() const { return bool(flags & Flag::AUTO_MODE); }
 
   enum class Format
   {
@@ -160,8 +173,38 @@ public:
   RecordIterator begin() { return RecordIterator(*this, false); }
   RecordIterator end() { return RecordIterator(*this, true); }
 
+  /** Maximum number of blocks the internal queues can hold. */
   size_t get_buffer_size() const { return buffer_size; }
+  /** Maximum number of records in a block. In auto mode, blocks are also
+   * capped at get_block_bytes() bytes and may hold fewer records. */
   size_t get_block_size() const { return block_size; }
+  /** Target number of sequence bytes per block, 0 if blocks are sized by
+   * record count only. */
+  size_t get_block_bytes() const { return block_bytes; }
+  /** Current number of blocks allowed in flight between the reader thread
+   * and the consumers. Fixed to get_buffer_size() outside of auto mode. */
+  size_t get_queue_depth() const { return queue_depth; }
+
+  /** Time (in seconds) the reader thread has spent waiting for room in the
+   * queue. A large value means the consumers are the bottleneck. */
+  double get_reader_blocked_time() const
+  {
+    return double(reader_blocked_ns) / NS_PER_SECOND;
+  }
+  /** Time (in seconds) blocks from the reader thread have spent queued on
+   * the executor before being converted. A large value means the executor
+   * is oversubscribed. */
+  double get_processors_blocked_time() const
+  {
+    return double(processors_blocked_ns) / NS_PER_SECOND;
+  }
+  /** Time (in seconds) the consumers, summed over all threads calling read()
+   * or read_block(), have spent waiting for records. A large value means the
+   * reader is the bottleneck. */
+  double get_consumer_blocked_time() const
+  {
+    return double(consumer_blocked_ns) / NS_PER_SECOND;
+  }
 
   static const size_t SHORT_MODE_BUFFER_SIZE = 32;
   static const size_t SHORT_MODE_BLOCK_SIZE = 32;
@@ -169,6 +212,14 @@ public:
   static const size_t LONG_MODE_BUFFER_SIZE = 4;
   static const size_t LONG_MODE_BLOCK_SIZE = 1;
 
+  static const size_t AUTO_MODE_BUFFER_SIZE = 64;
+  static const size_t AUTO_MODE_MIN_BUFFER_SIZE = 4;
+  static const size_t AUTO_MODE_BLOCK_SIZE = 256;
+  static const size_t AUTO_MODE_BLOCK_BYTES = 512 * 1024;
+  static const size_t AUTO_MODE_MEMORY_BUDGET = 256 * 1024 * 1024;
+  // Number of blocks between queue depth adjustments
+  static const size_t AUTO_MODE_ADAPT_PERIOD = 8;
+
   static const size_t FORMAT_BUFFER_SIZE = 16384;
 
 private:
@@ -188,6 +239,7 @@ private:
 
   struct RecordCString
   {
+    size_t num = 0;
     CString header;
     CString seq;
     CString qual;
@@ -201,18 +253,69 @@ private:
   std::atomic<bool> closed{ false };
   Buffer buffer;
   std::unique_ptr<std::thread> reader_thread;
-  std::vector<std::unique_ptr<std::thread>> processor_threads;
   std::mutex format_mutex;
   std::condition_variable format_cv;
   std::atomic<bool> reader_end{ false };
   RecordCString* reader_record = nullptr;
   const std::atomic<size_t> buffer_size;
   const std::atomic<size_t> block_size;
-  OrderQueueSPMC<RecordCString> cstring_queue;
-  OrderQueueMPMC<Record> output_queue;
-  std::atomic<size_t> dummy_block_num{ 0 };
+  const std::atomic<size_t> block_bytes;
+  OrderQueueLockFree<Record> output_queue;
   const long id;
 
+  // Records parsed by the reader thread. Their contents are allocated from
+  // the block's arena, which travels with the records when blocks are
+  // swapped and is reset when the block is reused
+  struct CStringBlock
+  {
+    explicit CStringBlock(size_t size);
+
+    CStringBlock(const CStringBlock&) = delete;
+    CStringBlock(CStringBlock&&) = delete;
+
+    CStringBlock& operator=(const CStringBlock&) = delete;
+    CStringBlock& operator=(CStringBlock&& block) noexcept;
+
+    void resize(size_t size);
+    void recycle();
+
+    std::vector<RecordCString> data;
+    size_t count = 0;
+    size_t num = 0;
+    std::unique_ptr<CStringArena> arena;
+  };
+
+  using OutputBlock = decltype(output_queue)::Block;
+
+  // Blocks are recycled between the reader thread and the conversion tasks,
+  // so that their strings keep their capacity
+  TaskGroup processing;
+  std::mutex free_blocks_mutex;
+  std::vector<std::unique_ptr<CStringBlock>> free_cstring_blocks;
+  std::vector<std::unique_ptr<OutputBlock>> free_output_blocks;
+  std::atomic<size_t> processing_blocks{ 0 };
+
+  static constexpr double NS_PER_SECOND = 1e9;
+
+  // Reader thread only
+  size_t reader_record_num = 0;
+  size_t reader_block_bytes = 0;
+  size_t reader_total_bytes = 0;
+  std::chrono::steady_clock::time_point last_adapt_time;
+  uint64_t last_adapt_reader_blocked_ns = 0;
+  uint64_t last_adapt_consumer_blocked_ns = 0;
+
+  std::atomic<size_t> queue_depth;
+  std::atomic<size_t> produced_blocks{ 0 };
+  std::atomic<size_t> delivered_blocks{ 0 };
+  std::atomic<bool> reader_waiting{ false };
+  std::mutex room_mutex;
+  std::condition_variable room_cv;
+
+  std::atomic<uint64_t> reader_blocked_ns{ 0 };
+  std::atomic<uint64_t> processors_blocked_ns{ 0 };
+  std::atomic<uint64_t> consumer_blocked_ns{ 0 };
+
   // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
   thread_local static std::unique_ptr<decltype(output_queue)::Block>
     // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
@@ -230,7 +333,8 @@ private:
   bool load_buffer();
   void determine_format();
   void start_reader();
-  void start_processors();
+  void submit_block(CStringBlock& records);
+  void process_block(CStringBlock& records_in, OutputBlock& records_out);
 
   CString tmp;
   bool readline_buffer_append(CString& s);
@@ -240,24 +344,27 @@ private:
   int getc_buffer();
   int ungetc_buffer(int c);
 
-  void update_cstring_records(OrderQueueSPMC<RecordCString>::Block& records,
-                              size_t& counter);
+  size_t initial_block_size() const
+  {
+    return auto_mode() ? 1 : size_t(block_size);
+  }
+
+  void update_cstring_records(CStringBlock& records, size_t& counter);
+  void write_cstring_records(CStringBlock& records, size_t& counter);
+  void wait_for_queue_room();
+  void adapt_queue_depth();
+  void block_delivered();
+  void notify_room();
 
   /// @cond HIDDEN_SYMBOLS
   template<typename Module>
-  void read_from_buffer(Module& module,
-                        OrderQueueSPMC<RecordCString>::Block& records,
-                        size_t& counter);
+  void read_from_buffer(Module& module, CStringBlock& records, size_t& counter);
 
   template<typename Module>
-  void read_transition(Module& module,
-                       OrderQueueSPMC<RecordCString>::Block& records,
-                       size_t& counter);
+  void read_transition(Module& module, CStringBlock& records, size_t& counter);
 
   template<typename Module>
-  void read_from_file(Module& module,
-                      OrderQueueSPMC<RecordCString>::Block& records,
-                      size_t& counter);
+  void read_from_file(Module& module, CStringBlock& records, size_t& counter);
   /// @endcond
 
   friend class SeqReaderFastaModule;
@@ -272,6 +379,9 @@ private:
   friend class SeqReaderMultilineFastqModule;
   SeqReaderMultilineFastqModule multiline_fastq_module;
 
+  friend class SeqReaderBamModule;
+  SeqReaderBamModule bam_module;
+
   friend class SeqReaderSamModule;
   SeqReaderSamModule sam_module;
 
@@ -286,7 +396,7 @@ private:
 template<typename Module>
 inline void
 SeqReader::read_from_buffer(Module& module,
-                            OrderQueueSPMC<RecordCString>::Block& records,
+                            CStringBlock& records,
                             size_t& counter)
 {
   while (!reader_end) {
@@ -302,7 +412,7 @@ SeqReader::read_from_buffer(Module& module,
 template<typename Module>
 inline void
 SeqReader::read_transition(Module& module,
-                           OrderQueueSPMC<RecordCString>::Block& records,
+                           CStringBlock& records,
                            size_t& counter)
 {
   if (!reader_end) {
@@ -319,7 +429,7 @@ SeqReader::read_transition(Module& module,
 template<typename Module>
 inline void
 SeqReader::read_from_file(Module& module,
-                          OrderQueueSPMC<RecordCString>::Block& records,
+                          CStringBlock& records,
                           size_t& counter)
 {
   while (!reader_end) {
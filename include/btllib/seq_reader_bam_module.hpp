@@ -0,0 +1,92 @@
+#ifndef BTLLIB_SEQ_READER_BAM_MODULE_HPP
+#define BTLLIB_SEQ_READER_BAM_MODULE_HPP
+
+#include "btllib/bgzf.hpp"
+#include "btllib/cstring.hpp"
+#include "btllib/status.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace btllib {
+
+/// @cond HIDDEN_SYMBOLS
+// Decodes BAM files in-process. BGZF blocks are inflated on the reader's
+// helper threads and alignments are converted straight into FASTQ records,
+// with the same conventions as `samtools fastq`: secondary and supplementary
+// alignments are skipped, reverse strand alignments are reverse complemented,
+// and /1 and /2 are appended to the names of paired reads.
+class SeqReaderBamModule
+{
+
+private:
+  friend class SeqReader;
+
+  static const uint16_t FLAG_REVERSE = 0x10;
+  static const uint16_t FLAG_READ1 = 0x40;
+  static const uint16_t FLAG_READ2 = 0x80;
+  static const uint16_t FLAG_SECONDARY = 0x100;
+  static const uint16_t FLAG_SUPPLEMENTARY = 0x800;
+
+  // Quality assigned to alignments without quality scores, as in samtools
+  static const char DEFAULT_QUAL = '!' + 1;
+
+  std::unique_ptr<BgzfReader> bgzf;
+  std::vector<char> alignment;
+
+  static bool is_bam_file(const std::string& path);
+  static bool buffer_valid(const char* buffer, size_t size);
+  template<typename ReaderType, typename RecordType>
+  bool read_buffer(ReaderType& reader, RecordType& record);
+  template<typename ReaderType, typename RecordType>
+  bool read_transition(ReaderType& reader, RecordType& record);
+  template<typename ReaderType, typename RecordType>
+  bool read_file(ReaderType& reader, RecordType& record);
+
+  void read_exact(char* out, size_t size);
+  void read_header();
+  bool read_alignment(CString& header, CString& seq, CString& qual);
+};
+
+template<typename ReaderType, typename RecordType>
+inline bool
+SeqReaderBamModule::read_buffer(ReaderType& reader, RecordType& record)
+{
+  (void)record;
+  // BGZF files never end with a newline, so a trailing one was added by the
+  // reader
+  const size_t size = reader.buffer.end - reader.buffer.start -
+                      (reader.buffer.eof_newline_inserted ? 1 : 0);
+  bgzf = std::unique_ptr<BgzfReader>(
+    new BgzfReader(reader.source,
+                   reader.buffer.data.data() + reader.buffer.start,
+                   size,
+                   reader.threads));
+  reader.buffer.start = reader.buffer.end;
+  read_header();
+  return false;
+}
+
+template<typename ReaderType, typename RecordType>
+inline bool
+SeqReaderBamModule::read_transition(ReaderType& reader, RecordType& record)
+{
+  (void)reader;
+  (void)record;
+  return false;
+}
+
+template<typename ReaderType, typename RecordType>
+inline bool
+SeqReaderBamModule::read_file(ReaderType& reader, RecordType& record)
+{
+  (void)reader;
+  return read_alignment(record.header, record.seq, record.qual);
+}
+/// @endcond
+
+} // namespace btllib
+
+#endif
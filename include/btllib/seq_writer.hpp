@@ -2,11 +2,18 @@
 #define BTLLIB_SEQ_WRITER_HPP
 
 #include "btllib/data_stream.hpp"
+#include "btllib/order_queue.hpp"
 #include "btllib/seq.hpp"
+#include "btllib/seq_reader.hpp"
 
+#include <atomic>
 #include <cstdio>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace btllib {
 
@@ -18,7 +25,8 @@ namespace btllib {
 /** Write FASTA or FASTQ sequences to a file. Capable of writing gzip (.gz),
  * bzip2 (.bz2), xz (.xz), zip (.zip), 7zip (.7z), and lrzip (.lrz) files. Add
  * the appropriate extension to the output filename to automatically compress.
- * Threadsafe. */
+ * Records are staged in memory and written out by a background thread, so
+ * the output is only complete once the writer is closed. Threadsafe. */
 class SeqWriter
 {
 
@@ -32,14 +40,27 @@ public:
   /**
    * Construct a SeqWriter to write sequences to a given path.
    *
-   * @param source_path Filepath to write to. Pass "-" to write to stdout.
+   * @param sink_path Filepath to write to. Pass "-" to write to stdout.
    * @param format Which format to write the output as.
    * @param append Whether to append to the target file or write anew.
+   * @param threads Number of threads compressing gzip (.gz) output
+   * in-process. The output is BGZF, which is readable by any gzip tool and
+   * indexable by IndexedSeqReader. If 0, an external tool compresses instead.
    */
   SeqWriter(const std::string& sink_path,
             Format format = FASTA,
-            bool append = false);
+            bool append = false,
+            unsigned threads = 0);
 
+  SeqWriter(const SeqWriter&) = delete;
+  SeqWriter(SeqWriter&&) = delete;
+
+  SeqWriter& operator=(const SeqWriter&) = delete;
+  SeqWriter& operator=(SeqWriter&&) = delete;
+
+  ~SeqWriter();
+
+  /** Write out all staged records and close the file. */
   void close();
 
   /**
@@ -55,15 +76,69 @@ public:
              const std::string& seq,
              const std::string& qual = "");
 
+  /**
+   * Write a batch of records, in order. Cheaper than writing the records one
+   * by one, as the staging buffer is only locked once.
+   *
+   * @param records Records to write.
+   * @param count Number of records to write.
+   */
+  void write_block(const SeqReader::Record* records, size_t count);
+
+  /** Write a batch of records, in order. */
+  void write_block(const std::vector<SeqReader::Record>& records)
+  {
+    write_block(records.data(), records.size());
+  }
+
+  /** Write a block of records as returned by SeqReader::read_block(). */
+  void write_block(const OrderQueueMPMC<SeqReader::Record>::Block& block)
+  {
+    write_block(block.data.data(), block.count);
+  }
+
+  /** Staged records are handed off for writing once they reach this size. */
+  static const size_t CHUNK_SIZE = 1024 * 1024;
+  /** Number of staging buffers. Threads are spread over them by ID. */
+  static const size_t STAGING_BUFFERS = 16;
+  /** Number of chunks waiting to be compressed or written. */
+  static const size_t QUEUE_SIZE = 32;
+
 private:
+  /// @cond HIDDEN_SYMBOLS
+  struct Staging
+  {
+    std::mutex mutex;
+    std::string buffer;
+  };
+  /// @endcond
+
+  Staging& get_staging();
+  void format_record(std::string& out,
+                     const std::string& id,
+                     const std::string& comment,
+                     const std::string& seq,
+                     const std::string& qual) const;
+  void submit(std::string& chunk);
+  void start_compressors();
+  void start_flusher();
+
   const std::string sink_path;
+  const bool compress;
   DataSink sink;
-  bool closed;
+  std::atomic<bool> closed{ false };
   Format format;
   char headerchar;
-  std::mutex mutex;
+  const unsigned threads;
+  std::unique_ptr<Staging[]> staging;
+  std::atomic<size_t> next_chunk_num{ 0 };
+  OrderQueueMPMC<std::string> raw_queue;
+  OrderQueueMPSC<std::string> output_queue;
+  std::atomic<size_t> end_num{ std::numeric_limits<size_t>::max() };
+  std::vector<std::unique_ptr<std::thread>> compressor_threads;
+  std::unique_ptr<std::thread> flusher_thread;
 };
 
 } // namespace btllib
 
-#endif
\ No newline at end of file
+#endif
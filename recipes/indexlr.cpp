@@ -1,11 +1,14 @@
 #include "btllib/indexlr.hpp"
 #include "btllib/bloom_filter.hpp"
+#include "btllib/indexlr_binary.hpp"
+#include "btllib/order_queue.hpp"
 #include "btllib/status.hpp"
 
 #include "config.hpp"
 
+#include <atomic>
 #include <cassert>
-#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -15,17 +18,12 @@
 #include <iostream>
 #include <limits>
 #include <memory>
-#include <mutex>
-#include <queue>
-#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 const static std::string PROGNAME = "indexlr";
 const static std::string VERSION = btllib::PROJECT_VERSION;
-const static size_t OUTPUT_PERIOD_SHORT = 512;
-const static size_t OUTPUT_PERIOD_LONG = 2;
-const static size_t INITIAL_OUTPUT_STREAM_SIZE = 100;
 const static size_t QUEUE_SIZE = 64;
 const static size_t MAX_THREADS = 5;
 const static size_t DEFAULT_THREADS = MAX_THREADS;
@@ -37,13 +35,111 @@ print_error_msg(const std::string& msg)
   std::cerr << PROGNAME << ' ' << VERSION << ": " << msg << std::endl;
 }
 
+// Which fields of a record are written, in output order
+struct OutputFormat
+{
+  bool id, bx, len, pos, strand, seq, qual;
+};
+
+static const char DIGIT_PAIRS[] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+// Write the decimal digits of val two at a time
+static char*
+write_uint(char* p, uint64_t val)
+{
+  char digits[20];
+  char* const end = digits + sizeof(digits);
+  char* start = end;
+  while (val >= 100) {
+    const auto pair = (val % 100) * 2;
+    val /= 100;
+    *--start = DIGIT_PAIRS[pair + 1];
+    *--start = DIGIT_PAIRS[pair];
+  }
+  if (val >= 10) {
+    *--start = DIGIT_PAIRS[val * 2 + 1];
+    *--start = DIGIT_PAIRS[val * 2];
+  } else {
+    *--start = char('0' + val);
+  }
+  memcpy(p, start, end - start);
+  return p + (end - start);
+}
+
+static char*
+write_str(char* p, const std::string& str)
+{
+  memcpy(p, str.data(), str.size());
+  return p + str.size();
+}
+
+// Append a line of text for a record. The output is sized for the longest
+// possible line up front, then trimmed.
+static void
+format_record(const btllib::Indexlr::Record& record,
+              const OutputFormat& format,
+              std::string& out)
+{
+  const size_t max_uint_len = 20;
+  size_t max_len = record.id.size() + record.barcode.size() + max_uint_len + 4;
+  for (const auto& min : record.minimizers) {
+    max_len += 3 * max_uint_len + 6 + min.seq.size() + min.qual.size();
+  }
+  const size_t start = out.size();
+  out.resize(start + max_len);
+  char* p = &out[start];
+  if (format.id) {
+    p = write_str(p, record.id);
+    *p++ = '\t';
+  }
+  if (format.bx) {
+    p = write_str(p, record.barcode);
+    *p++ = '\t';
+  }
+  if (format.len) {
+    p = write_uint(p, record.readlen);
+    *p++ = '\t';
+  }
+  bool first = true;
+  for (const auto& min : record.minimizers) {
+    if (!first) {
+      *p++ = ' ';
+    }
+    first = false;
+    p = write_uint(p, min.out_hash);
+    if (format.pos) {
+      *p++ = ':';
+      p = write_uint(p, min.pos);
+    }
+    if (format.strand) {
+      *p++ = ':';
+      *p++ = min.forward ? '+' : '-';
+    }
+    if (format.seq) {
+      *p++ = ':';
+      p = write_str(p, min.seq);
+    }
+    if (format.qual) {
+      *p++ = ':';
+      p = write_str(p, min.qual);
+    }
+  }
+  *p++ = '\n';
+  out.resize(p - out.data());
+}
+
 static void
 print_usage()
 {
   std::cerr
     << "Usage: " << PROGNAME
     << " -k K -w W [-q Q]  [-r repeat_bf_path] [-s solid_bf_path] [--id] "
-       "[--bx] [--pos] [--seq] [--qual]"
+       "[--bx] [--pos] [--seq] [--qual] [--binary | --columnar] "
        "[-o FILE] FILE...\n\n"
        "  -k K        Use K as k-mer size.\n"
        "  -w W        Use W as sliding-window size.\n"
@@ -72,6 +168,11 @@ print_usage()
        "  --long      Enable long mode which is more efficient for "
        "long sequences (e.g. long "
        "reads, contigs, reference).\n"
+       "  --binary    Write binary records instead of text. IDs, barcodes, "
+       "lengths, positions, strands,\n"
+       "              and minimizer hashes are always included. Read the "
+       "output with btllib::IndexlrReader.\n"
+       "  --columnar  Write binary records in compressed column blocks.\n"
        "  -r repeat_bf_path  Use a Bloom filter to filter out "
        "repetitive minimizers.\n"
        "  -s solid_bf_path  Use a Bloom filter to only select solid "
@@ -100,7 +201,7 @@ main(int argc, char* argv[])
     bool k_set = false;
     bool q_set = false;
     int with_id = 0, with_bx = 0, with_len = 0, with_pos = 0, with_strand = 0,
-        with_seq = 0, with_qual = 0;
+        with_seq = 0, with_qual = 0, binary = 0, columnar = 0;
     std::unique_ptr<btllib::KmerBloomFilter> repeat_bf, solid_bf;
     bool with_repeat = false, with_solid = false;
     int long_mode = 0;
@@ -115,6 +216,8 @@ main(int argc, char* argv[])
       { "seq", no_argument, &with_seq, 1 },
       { "qual", no_argument, &with_qual, 1 },
       { "long", no_argument, &long_mode, 1 },
+      { "binary", no_argument, &binary, 1 },
+      { "columnar", no_argument, &columnar, 1 },
       { "help", no_argument, &help, 1 },
       { "version", no_argument, &version, 1 },
       { nullptr, 0, nullptr, 0 }
@@ -237,11 +340,33 @@ main(int argc, char* argv[])
       flags |= btllib::Indexlr::Flag::SHORT_MODE;
     }
 
+    const OutputFormat format{ bool(with_id) || !bool(with_bx),
+                               bool(with_bx),
+                               bool(with_len),
+                               bool(with_pos),
+                               bool(with_strand),
+                               bool(with_seq),
+                               bool(with_qual) };
     btllib::Indexlr::Record record;
-    FILE* out;
-    if (outfile == "-") {
-      out = stdout;
-    } else {
+    std::unique_ptr<btllib::IndexlrWriter> binary_writer;
+    FILE* out = stdout;
+    if (bool(binary) || bool(columnar)) {
+      unsigned fields = 0;
+      if (bool(with_seq)) {
+        fields |= btllib::IndexlrBinary::SEQ;
+      }
+      if (bool(with_qual)) {
+        fields |= btllib::IndexlrBinary::QUAL;
+      }
+      binary_writer =
+        std::unique_ptr<btllib::IndexlrWriter>(new btllib::IndexlrWriter(
+          outfile,
+          k,
+          w,
+          fields,
+          bool(columnar) ? btllib::IndexlrBinary::COLUMNAR
+                         : btllib::IndexlrBinary::RECORDS));
+    } else if (outfile != "-") {
 #ifdef __linux__
       out = fopen(outfile.c_str(), "we");
 #else
@@ -275,95 +400,64 @@ main(int argc, char* argv[])
         indexlr = std::unique_ptr<btllib::Indexlr>(
           new btllib::Indexlr(infile, k, w, q, flags, t, verbose));
       }
-      std::queue<std::string> output_queue;
-      std::mutex output_queue_mutex;
-      std::condition_variable queue_empty, queue_full;
-      size_t max_seen_output_size = INITIAL_OUTPUT_STREAM_SIZE;
-      const size_t output_period =
-        bool(long_mode) ? OUTPUT_PERIOD_LONG : OUTPUT_PERIOD_SHORT;
-      std::unique_ptr<std::thread> info_compiler(new std::thread([&]() {
-        std::stringstream ss;
+      if (binary_writer) {
         while ((record = indexlr->read())) {
-          if (bool(with_id) || (!bool(with_id) && !bool(with_bx))) {
-            ss << record.id << '\t';
-          }
-          if (bool(with_bx)) {
-            ss << record.barcode << '\t';
-          }
-          if (bool(with_len)) {
-            ss << record.readlen << '\t';
-          }
-          int j = 0;
-          for (const auto& min : record.minimizers) {
-            if (j > 0) {
-              ss << ' ';
-            }
-            ss << min.out_hash;
-            if (bool(with_pos)) {
-              ss << ':' << min.pos;
-            }
-            if (bool(with_strand)) {
-              ss << ':' << (min.forward ? '+' : '-');
-            }
-            if (bool(with_seq)) {
-              ss << ':' << min.seq;
-            }
-            if (bool(with_qual)) {
-              ss << ':' << min.qual;
-            }
-            j++;
-          }
-          ss << '\n';
-          if (record.num % output_period == output_period - 1) {
-            auto ss_str = ss.str();
-            max_seen_output_size =
-              std::max(max_seen_output_size, ss_str.size());
-            std::unique_lock<std::mutex> lock(output_queue_mutex);
-            while (output_queue.size() == QUEUE_SIZE) {
-              queue_full.wait(lock);
-            }
-            output_queue.push(std::move(ss_str));
-            queue_empty.notify_one();
-            lock.unlock();
-            std::string newstring;
-            newstring.reserve(max_seen_output_size);
-            ss.str(newstring);
-          }
+          binary_writer->write(record);
         }
-        {
-          std::unique_lock<std::mutex> lock(output_queue_mutex);
-          if (!ss.str().empty()) {
-            output_queue.push(ss.str());
+        continue;
+      }
+      // Each thread formats whole blocks, which are written in block order
+      btllib::OrderQueueLockFree<std::string> output_queue(QUEUE_SIZE, 1);
+      std::atomic<size_t> formatted_blocks{ 0 };
+      const auto format_blocks = [&]() {
+        decltype(output_queue)::Block output_block(1);
+        for (;;) {
+          const auto block = indexlr->read_block();
+          if (block.count == 0) {
+            break;
           }
-          output_queue.push(std::string());
-          queue_empty.notify_one();
+          auto& text = output_block.data[0];
+          text.clear();
+          for (size_t i = 0; i < block.count; i++) {
+            format_record(block.data[i], format, text);
+          }
+          output_block.num = block.num;
+          output_block.count = 1;
+          output_queue.write(output_block);
+          ++formatted_blocks;
         }
-      }));
+      };
+      std::vector<std::unique_ptr<std::thread>> formatters;
+      for (unsigned i = 0; i < t; i++) {
+        formatters.push_back(
+          std::unique_ptr<std::thread>(new std::thread(format_blocks)));
+      }
       std::unique_ptr<std::thread> output_worker(new std::thread([&]() {
-        std::string to_write;
+        decltype(output_queue)::Block block(1);
         for (;;) {
-          {
-            std::unique_lock<std::mutex> lock(output_queue_mutex);
-            while (output_queue.empty()) {
-              queue_empty.wait(lock);
-            }
-            to_write = std::move(output_queue.front());
-            output_queue.pop();
-            queue_full.notify_one();
-          }
-          if (to_write.empty()) {
+          output_queue.read(block);
+          if (block.count == 0) {
             break;
           }
+          const auto& to_write = block.data[0];
           btllib::check_error(
             fwrite(to_write.c_str(), 1, to_write.size(), out) !=
               to_write.size(),
             "Indexlr: fwrite failed.");
+          block.count = 0;
         }
       }));
-      info_compiler->join();
+      for (auto& formatter : formatters) {
+        formatter->join();
+      }
+      decltype(output_queue)::Block end_block(1);
+      end_block.num = formatted_blocks;
+      output_queue.write(end_block);
       output_worker->join();
     }
-    if (out != stdout) {
+    if (binary_writer) {
+      binary_writer->close();
+    } else if (out != stdout) {
       const auto ret = fclose(out);
       btllib::check_error(ret != 0,
                           "Indexlr: fclose failed: " + btllib::get_strerror());
@@ -0,0 +1,117 @@
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/status.hpp"
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+
+const static std::string PROGNAME = "mibf-compress";
+const static std::string VERSION = btllib::PROJECT_VERSION;
+const static unsigned DEFAULT_ID_BITS = 16;
+
+static void
+print_error_msg(const std::string& msg)
+{
+  std::cerr << PROGNAME << ' ' << VERSION << ": " << msg << std::endl;
+}
+
+static void
+print_usage()
+{
+  std::cerr
+    << "Usage: " << PROGNAME
+    << " [-i BITS] INPUT OUTPUT\n\n"
+       "  Convert a multi-index Bloom filter to the single file format with "
+       "bit packed IDs.\n"
+       "  Each ID takes as many bits as the largest ID in the filter needs, "
+       "plus two.\n\n"
+       "  -i BITS     ID width of the input filter: 8, 16, or 32 [16].\n"
+       "  --help      Display this help and exit.\n"
+       "  --version   Display version and exit.\n"
+       "  INPUT       Filter stored by MIBloomFilter::save() or store().\n"
+       "  OUTPUT      Path to write the compressed filter to."
+    << std::endl;
+}
+
+template<typename T>
+static void
+compress(const std::string& input, const std::string& output)
+{
+  btllib::MIBloomFilter<T> filter(input);
+  const size_t bytes = filter.get_data_bytes();
+  filter.compress();
+  const size_t compressed_bytes = filter.get_data_bytes();
+  filter.save(output);
+  btllib::log_info(PROGNAME + ": ID data compressed from " +
+                   std::to_string(bytes) + " to " +
+                   std::to_string(compressed_bytes) + " bytes.");
+}
+
+int
+main(int argc, char* argv[])
+{
+  try {
+    int c;
+    int optindex = 0;
+    int help = 0, version = 0;
+    unsigned id_bits = DEFAULT_ID_BITS;
+    bool failed = false;
+    static const struct option longopts[] = {
+      { "help", no_argument, &help, 1 },
+      { "version", no_argument, &version, 1 },
+      { nullptr, 0, nullptr, 0 }
+    };
+    while ((c = getopt_long(argc, // NOLINT(concurrency-mt-unsafe)
+                            argv,
+                            "i:",
+                            longopts,
+                            &optindex)) != -1) {
+      switch (c) {
+        case 0:
+          break;
+        case 'i':
+          id_bits = std::stoul(optarg);
+          break;
+        default:
+          std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+      }
+    }
+    if (help != 0) {
+      print_usage();
+      std::exit(EXIT_SUCCESS); // NOLINT(concurrency-mt-unsafe)
+    } else if (version != 0) {
+      std::cerr << PROGNAME << ' ' << VERSION << std::endl;
+      std::exit(EXIT_SUCCESS); // NOLINT(concurrency-mt-unsafe)
+    }
+    if (id_bits != 8 && id_bits != 16 && id_bits != 32) {
+      print_error_msg("option has incorrect value -- 'i'");
+      failed = true;
+    }
+    if (argc - optind != 2) {
+      print_error_msg("expected an input and an output file operand");
+      failed = true;
+    }
+    if (failed) {
+      std::cerr << "Try '" << PROGNAME << " --help' for more information.\n";
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+
+    const std::string input(argv[optind]), output(argv[optind + 1]);
+    if (id_bits == 8) {
+      compress<uint8_t>(input, output);
+    } else if (id_bits == 16) {
+      compress<uint16_t>(input, output);
+    } else {
+      compress<uint32_t>(input, output);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << '\n';
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+  }
+
+  return 0;
+}
@@ -1,22 +1,32 @@
+#include "btllib/executor.hpp"
 #include "btllib/random_seq_generator.hpp"
+#include "btllib/read_simulator.hpp"
+#include "btllib/seq_reader.hpp"
 #include "btllib/seq_writer.hpp"
 #include "btllib/status.hpp"
 #include "config.hpp"
 
+#include <algorithm>
 #include <argparse/argparse.hpp>
 #include <chrono>
 #include <iostream>
-#include <omp.h>
 #include <random>
+#include <string>
 #include <thread>
+#include <vector>
 
 struct Arguments
 {
   btllib::RandomSequenceGenerator::SequenceType seq_type;
   btllib::RandomSequenceGenerator::Masking mask;
   unsigned num_sequences;
-  int num_threads;
-  size_t min_length, max_length;
+  unsigned num_threads;
+  std::string length_dist;
+  double length_a, length_b;
+  uint64_t seed;
+  std::string reference_path;
+  double substitution_rate = 0, insertion_rate = 0, deletion_rate = 0;
+  bool fastq;
   std::string out_path;
 
   Arguments(int argc, char** argv)
@@ -39,13 +49,38 @@ struct Arguments
     parser.add_argument("-l")
       .help(
         "Sequence length. To generate sequences with random lengths from the "
-        "range [a, b], use a:b")
+        "range [a, b], use a:b. For normal and lognormal length "
+        "distributions, use mean:sd")
       .required();
 
+    parser.add_argument("-d")
+      .help("Length distribution (uniform | normal | lognormal)")
+      .default_value(std::string("uniform"));
+
+    parser.add_argument("-r")
+      .help("Simulate reads from the sequences of this FASTA/FASTQ file, "
+            "instead of generating random sequences")
+      .default_value(std::string(""));
+
+    parser.add_argument("-e")
+      .help("Per-base substitution, insertion, and deletion rates of "
+            "simulated reads, as s:i:d")
+      .default_value(std::string("0:0:0"));
+
+    parser.add_argument("--seed")
+      .help("Random seed. The same seed generates the same sequences, "
+            "regardless of the number of threads. Random if not given")
+      .scan<'u', uint64_t>();
+
+    parser.add_argument("--fastq")
+      .help("Write simulated reads as FASTQ")
+      .default_value(false)
+      .implicit_value(true);
+
     parser.add_argument("-t")
       .help("Number of parallel threads")
-      .default_value(1)
-      .scan<'i', int>();
+      .default_value(1U)
+      .scan<'u', unsigned>();
 
     parser.add_argument("-o")
       .help("Path to output file. Use '-' to write to stdout.")
@@ -86,17 +121,51 @@ struct Arguments
     auto length_range = parser.get("-l");
     auto i_sep = length_range.find(':');
     if (i_sep == std::string::npos) {
-      min_length = std::stoull(length_range);
-      max_length = std::stoull(length_range);
+      length_a = std::stod(length_range);
+      length_b = length_a;
     } else {
       auto a = length_range.substr(0, i_sep);
       auto b = length_range.substr(i_sep + 1, length_range.size() - i_sep - 1);
-      min_length = std::stoull(a);
-      max_length = std::stoull(b);
+      length_a = std::stod(a);
+      length_b = std::stod(b);
     }
 
+    length_dist = parser.get("-d");
+    btllib::check_error(length_dist != "uniform" && length_dist != "normal" &&
+                          length_dist != "lognormal",
+                        "Invalid length distribution: " + length_dist +
+                          ". Should be 'uniform', 'normal', or 'lognormal'.");
+
+    reference_path = parser.get("-r");
+    const auto rates = parser.get("-e");
+    const auto i_sep1 = rates.find(':');
+    const auto i_sep2 = rates.find(':', i_sep1 + 1);
+    btllib::check_error(i_sep1 == std::string::npos ||
+                          i_sep2 == std::string::npos,
+                        "Invalid error rates: " + rates + ". Should be s:i:d.");
+    substitution_rate = std::stod(rates.substr(0, i_sep1));
+    insertion_rate = std::stod(rates.substr(i_sep1 + 1, i_sep2 - i_sep1 - 1));
+    deletion_rate = std::stod(rates.substr(i_sep2 + 1));
+    for (const double rate :
+         { substitution_rate, insertion_rate, deletion_rate }) {
+      btllib::check_error(!(rate >= 0 && rate <= 1),
+                          "Invalid error rates: " + rates +
+                            ". Each rate should be between 0 and 1.");
+    }
+    btllib::check_error(substitution_rate + insertion_rate + deletion_rate > 1,
+                        "Invalid error rates: " + rates +
+                          ". The rates should add up to at most 1.");
+
+    if (parser.is_used("--seed")) {
+      seed = parser.get<uint64_t>("--seed");
+    } else {
+      std::random_device rd;
+      seed = (uint64_t(rd()) << 32) | rd(); // NOLINT
+    }
+
+    fastq = parser.get<bool>("--fastq");
     num_sequences = parser.get<unsigned>("-n");
-    num_threads = parser.get<int>("-t");
+    num_threads = parser.get<unsigned>("-t");
     out_path = parser.get("-o");
   }
 };
@@ -119,10 +188,10 @@ public:
   {
   }
 
-  void add_sequence(size_t seq_len)
+  void add_sequences(unsigned num_seqs, uint64_t seqs_len)
   {
-    generated_bp += seq_len;
-    ++generated_seqs;
+    generated_bp += seqs_len;
+    generated_seqs += num_seqs;
     auto current_time = std::chrono::system_clock::now();
     std::chrono::duration<double> elapsed = (current_time - last_log);
     if (elapsed.count() > LOG_DELAY_SECONDS) {
@@ -158,19 +227,94 @@ public:
   }
 };
 
+// Sequences are generated in parallel in batches of this size, and the batches
+// are written in order
+static const size_t LOG_BATCH_SIZE = 64 * 1024;
+static const size_t GRAIN = 256;
+
+static btllib::ReadLengthDistribution
+get_length_distribution(const Arguments& args)
+{
+  if (args.length_dist == "normal") {
+    return btllib::ReadLengthDistribution::normal(args.length_a,
+                                                  args.length_b);
+  }
+  if (args.length_dist == "lognormal") {
+    return btllib::ReadLengthDistribution::log_normal(args.length_a,
+                                                      args.length_b);
+  }
+  return btllib::ReadLengthDistribution::uniform(size_t(args.length_a),
+                                                 size_t(args.length_b));
+}
+
+static void
+simulate_reads(const Arguments& args, btllib::SeqWriter& writer, Logger& log)
+{
+  std::vector<std::string> references;
+  {
+    btllib::SeqReader reader(args.reference_path,
+                             btllib::SeqReader::Flag::LONG_MODE);
+    for (const auto record : reader) {
+      references.push_back(record.seq);
+    }
+  }
+  const btllib::ReadSimulator simulator(references,
+                                        get_length_distribution(args),
+                                        args.seed,
+                                        args.substitution_rate,
+                                        args.insertion_rate,
+                                        args.deletion_rate);
+  for (size_t first = 0; first < args.num_sequences; first += LOG_BATCH_SIZE) {
+    const size_t count =
+      std::min(size_t(LOG_BATCH_SIZE), args.num_sequences - first);
+    log.add_sequences(count, simulator.write(writer, count, first));
+  }
+}
+
+static void
+generate_sequences(const Arguments& args,
+                   btllib::SeqWriter& writer,
+                   Logger& log)
+{
+  const btllib::RandomSequenceGenerator rnd(args.seq_type, args.mask);
+  const auto lengths = get_length_distribution(args);
+  std::vector<btllib::SeqReader::Record> records(LOG_BATCH_SIZE);
+  for (size_t first = 0; first < args.num_sequences; first += LOG_BATCH_SIZE) {
+    const size_t count =
+      std::min(size_t(LOG_BATCH_SIZE), args.num_sequences - first);
+    btllib::parallel_for(0, count, GRAIN, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        // Every sequence has a stream of its own, so that the output does not
+        // depend on the number of threads
+        btllib::RandomEngine rng(args.seed, first + i);
+        auto& record = records[i];
+        record.id = std::to_string(first + i + 1);
+        rnd.generate(lengths.sample(rng), rng, record.seq);
+        if (args.fastq) {
+          record.qual.assign(record.seq.size(),
+                             btllib::ReadSimulator::QUAL_CORRECT);
+        }
+      }
+    });
+    writer.write_block(records.data(), count);
+    uint64_t bp = 0;
+    for (size_t i = 0; i < count; i++) {
+      bp += records[i].seq.size();
+    }
+    log.add_sequences(count, bp);
+  }
+}
+
 int
 main(int argc, char** argv)
 {
   try {
     Arguments args(argc, argv);
-    omp_set_num_threads(args.num_threads);
+    btllib::Executor::configure(args.num_threads);
 
-    std::random_device rd;
-    std::default_random_engine rng(rd());
-    std::uniform_int_distribution<size_t> dist(args.min_length,
-                                               args.max_length);
-    btllib::SeqWriter writer(args.out_path);
-    btllib::RandomSequenceGenerator rnd(args.seq_type, args.mask);
+    btllib::SeqWriter writer(args.out_path,
+                             args.fastq ? btllib::SeqWriter::FASTQ
+                                        : btllib::SeqWriter::FASTA);
 
     std::string unit =
       args.seq_type == btllib::RandomSequenceGenerator::SequenceType::PROTEIN
@@ -178,12 +322,10 @@ main(int argc, char** argv)
         : "bp";
     Logger log(args.num_sequences, unit);
 
-#pragma omp parallel for shared(args, rnd, rng, dist, writer, log) default(none)
-    for (unsigned i = 0; i < args.num_sequences; i++) {
-      std::string seq = rnd.generate(dist(rng));
-      writer.write(std::to_string(i + 1), "", seq, "");
-#pragma omp critical
-      log.add_sequence(seq.size());
+    if (args.reference_path.empty()) {
+      generate_sequences(args, writer, log);
+    } else {
+      simulate_reads(args, writer, log);
     }
 
     log.stop();
@@ -193,4 +335,4 @@ main(int argc, char** argv)
   }
 
   return 0;
-}
\ No newline at end of file
+}
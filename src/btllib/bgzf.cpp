@@ -0,0 +1,411 @@
+#include "btllib/bgzf.hpp"
+#include "btllib/status.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace btllib {
+
+static uint16_t
+read_le16(const char* p)
+{
+  const auto* u = reinterpret_cast<const unsigned char*>(p);
+  return uint16_t(u[0] | (u[1] << 8));
+}
+
+static uint32_t
+read_le32(const char* p)
+{
+  const auto* u = reinterpret_cast<const unsigned char*>(p);
+  return uint32_t(u[0]) | (uint32_t(u[1]) << 8) | (uint32_t(u[2]) << 16) |
+         (uint32_t(u[3]) << 24);
+}
+
+static uint64_t
+read_le64(const char* p)
+{
+  return uint64_t(read_le32(p)) | (uint64_t(read_le32(p + 4)) << 32);
+}
+
+static void
+write_le(char* p, const uint64_t val, const int bytes)
+{
+  for (int i = 0; i < bytes; i++) {
+    p[i] = char((val >> (8 * i)) & 0xFF);
+  }
+}
+
+static void
+write_le64(char* p, const uint64_t val)
+{
+  write_le(p, val, 8);
+}
+
+static size_t
+pread_full(const int fd, char* buf, const size_t size, const uint64_t offset)
+{
+  size_t total = 0;
+  while (total < size) {
+    const auto ret =
+      pread(fd, buf + total, size - total, off_t(offset + total));
+    if (ret == 0) {
+      break;
+    }
+    check_error(ret < 0, "BGZF: pread failed: " + get_strerror());
+    total += size_t(ret);
+  }
+  return total;
+}
+
+bool
+is_bgzf(const char* data, const size_t size)
+{
+  const auto* u = reinterpret_cast<const unsigned char*>(data);
+  return size >= BGZF_HEADER_SIZE && u[0] == 31 && u[1] == 139 && u[2] == 8 &&
+         (u[3] & 4) != 0 && read_le16(data + 10) == 6 && u[12] == 'B' &&
+         u[13] == 'C' && read_le16(data + 14) == 2;
+}
+
+bool
+is_bgzf(const std::string& path)
+{
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  char header[BGZF_HEADER_SIZE];
+  const auto size = pread_full(fd, header, BGZF_HEADER_SIZE, 0);
+  ::close(fd);
+  return is_bgzf(header, size);
+}
+
+uint32_t
+bgzf_block_csize(const char* header)
+{
+  return uint32_t(read_le16(header + 16)) + 1;
+}
+
+uint32_t
+bgzf_block_usize(const char* block, const uint32_t csize)
+{
+  return read_le32(block + csize - 4);
+}
+
+size_t
+bgzf_inflate_block(const char* block, const uint32_t csize, char* out)
+{
+  check_error(csize < BGZF_HEADER_SIZE + BGZF_FOOTER_SIZE,
+              "BGZF: truncated block.");
+  z_stream zs{};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block)) +
+               BGZF_HEADER_SIZE;
+  zs.avail_in = uInt(csize - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE);
+  zs.next_out = reinterpret_cast<Bytef*>(out);
+  zs.avail_out = uInt(BGZF_MAX_BLOCK_SIZE);
+  check_error(inflateInit2(&zs, -15) != Z_OK, "BGZF: inflateInit2 failed.");
+  const auto ret = inflate(&zs, Z_FINISH);
+  const size_t usize = zs.total_out;
+  inflateEnd(&zs);
+  check_error(ret != Z_STREAM_END, "BGZF: block decompression failed.");
+  check_error(usize != bgzf_block_usize(block, csize),
+              "BGZF: decompressed block size does not match the footer.");
+  const auto crc = crc32(
+    crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(out), uInt(usize));
+  check_error(crc != read_le32(block + csize - 8),
+              "BGZF: block CRC mismatch.");
+  return usize;
+}
+
+size_t
+bgzf_deflate_block(const char* data,
+                   const size_t size,
+                   char* out,
+                   const int level)
+{
+  check_error(size > BGZF_MAX_BLOCK_SIZE - 1024,
+              "BGZF: too much data for a single block.");
+  static const unsigned char header[BGZF_HEADER_SIZE] = {
+    31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 0, 0
+  };
+  std::memcpy(out, header, BGZF_HEADER_SIZE);
+
+  z_stream zs{};
+  check_error(deflateInit2(
+                &zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK,
+              "BGZF: deflateInit2 failed.");
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  zs.avail_in = uInt(size);
+  zs.next_out = reinterpret_cast<Bytef*>(out) + BGZF_HEADER_SIZE;
+  zs.avail_out =
+    uInt(BGZF_MAX_BLOCK_SIZE - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE);
+  const auto ret = deflate(&zs, Z_FINISH);
+  const size_t deflated = zs.total_out;
+  deflateEnd(&zs);
+  check_error(ret != Z_STREAM_END, "BGZF: block compression failed.");
+
+  const size_t csize = BGZF_HEADER_SIZE + deflated + BGZF_FOOTER_SIZE;
+  write_le(out + 16, csize - 1, 2);
+  const auto crc = crc32(
+    crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), uInt(size));
+  write_le(out + csize - 8, crc, 4);
+  write_le(out + csize - 4, size, 4);
+  return csize;
+}
+
+// Appends the blocks from coffset, which starts a block at uoffset in the
+// decompressed data, to the end of the file
+static void
+scan_bgzf_blocks_from(const int fd,
+                      uint64_t coffset,
+                      uint64_t uoffset,
+                      std::vector<BgzfBlock>& blocks)
+{
+  char header[BGZF_HEADER_SIZE];
+  char footer[BGZF_FOOTER_SIZE];
+  for (;;) {
+    const auto size = pread_full(fd, header, BGZF_HEADER_SIZE, coffset);
+    if (size == 0) {
+      break;
+    }
+    check_error(!is_bgzf(header, size),
+                "BGZF: invalid block header at offset " +
+                  std::to_string(coffset) + ".");
+    BgzfBlock block;
+    block.coffset = coffset;
+    block.uoffset = uoffset;
+    block.csize = bgzf_block_csize(header);
+    check_error(pread_full(fd,
+                           footer,
+                           BGZF_FOOTER_SIZE,
+                           coffset + block.csize - BGZF_FOOTER_SIZE) !=
+                  BGZF_FOOTER_SIZE,
+                "BGZF: truncated block at offset " + std::to_string(coffset) +
+                  ".");
+    block.usize = read_le32(footer + 4);
+    blocks.push_back(block);
+    coffset += block.csize;
+    uoffset += block.usize;
+  }
+}
+
+std::vector<BgzfBlock>
+scan_bgzf_blocks(const int fd)
+{
+  std::vector<BgzfBlock> blocks;
+  scan_bgzf_blocks_from(fd, 0, 0, blocks);
+  return blocks;
+}
+
+std::vector<BgzfBlock>
+load_gzi(const std::string& gzi_path, const int fd)
+{
+  std::FILE* f = std::fopen(gzi_path.c_str(), "rb");
+  check_error(f == nullptr,
+              "BGZF: failed to open " + gzi_path + ": " + get_strerror());
+  char buf[16];
+  check_error(std::fread(buf, 1, 8, f) != 8,
+              "BGZF: failed to read " + gzi_path + ".");
+  const auto entries = read_le64(buf);
+
+  // The first block at offset 0 is implicit in the .gzi format
+  std::vector<BgzfBlock> blocks(1);
+  blocks.reserve(entries + 1);
+  for (uint64_t i = 0; i < entries; i++) {
+    check_error(std::fread(buf, 1, 16, f) != 16,
+                "BGZF: failed to read " + gzi_path + ".");
+    BgzfBlock block;
+    block.coffset = read_le64(buf);
+    block.uoffset = read_le64(buf + 8);
+    blocks.back().csize = uint32_t(block.coffset - blocks.back().coffset);
+    blocks.back().usize = uint32_t(block.uoffset - blocks.back().uoffset);
+    blocks.push_back(block);
+  }
+  std::fclose(f);
+
+  // The size of the last indexed block is not in the index, and blocks may
+  // follow it that are not indexed, e.g. the EOF marker block bgzip leaves
+  // out, so the blocks from there on are read from their headers
+  const auto last = blocks.back();
+  blocks.pop_back();
+  scan_bgzf_blocks_from(fd, last.coffset, last.uoffset, blocks);
+  return blocks;
+}
+
+void
+save_gzi(const std::string& gzi_path, const std::vector<BgzfBlock>& blocks)
+{
+  std::FILE* f = std::fopen(gzi_path.c_str(), "wb");
+  check_error(f == nullptr,
+              "BGZF: failed to open " + gzi_path + ": " + get_strerror());
+  char buf[16];
+  const uint64_t entries = blocks.empty() ? 0 : blocks.size() - 1;
+  write_le64(buf, entries);
+  check_error(std::fwrite(buf, 1, 8, f) != 8,
+              "BGZF: failed to write " + gzi_path + ".");
+  for (size_t i = 1; i < blocks.size(); i++) {
+    write_le64(buf, blocks[i].coffset);
+    write_le64(buf + 8, blocks[i].uoffset);
+    check_error(std::fwrite(buf, 1, 16, f) != 16,
+                "BGZF: failed to write " + gzi_path + ".");
+  }
+  check_error(std::fclose(f) != 0,
+              "BGZF: failed to close " + gzi_path + ": " + get_strerror());
+}
+
+BgzfReader::BgzfReader(FILE* source,
+                       const char* prefix,
+                       const size_t prefix_size,
+                       const unsigned threads)
+  : source(source)
+  , prefix(prefix, prefix + prefix_size)
+  , threads(threads)
+{
+  check_error(threads == 0, "BgzfReader: Number of threads cannot be 0.");
+}
+
+BgzfReader::~BgzfReader()
+{
+  close();
+}
+
+void
+BgzfReader::close() noexcept
+{
+  try {
+    // Tasks inflate into the chunks, so they finish before the chunks go
+    for (auto& chunk : inflating) {
+      chunk->inflating.wait();
+    }
+    inflating.clear();
+  } catch (const std::system_error& e) {
+    log_error("BgzfReader task wait failure: " + std::string(e.what()));
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+  }
+}
+
+size_t
+BgzfReader::read_source(char* out, const size_t size)
+{
+  size_t total = 0;
+  if (prefix_pos < prefix.size()) {
+    total = std::min(size, prefix.size() - prefix_pos);
+    std::memcpy(out, prefix.data() + prefix_pos, total);
+    prefix_pos += total;
+  }
+  while (total < size && std::feof(source) == 0 && std::ferror(source) == 0) {
+    total += std::fread(out + total, 1, size - total, source);
+  }
+  check_error(std::ferror(source) != 0,
+              "BgzfReader: failed to read the stream: " + get_strerror());
+  return total;
+}
+
+bool
+BgzfReader::load_chunk(Chunk& chunk)
+{
+  chunk.compressed.resize(BLOCKS_PER_CHUNK * BGZF_MAX_BLOCK_SIZE);
+  chunk.compressed_size = 0;
+  // Limited by the number of blocks, as that bounds the inflated size
+  for (size_t i = 0; i < BLOCKS_PER_CHUNK; i++) {
+    char* const block = chunk.compressed.data() + chunk.compressed_size;
+    const auto header_size = read_source(block, BGZF_HEADER_SIZE);
+    if (header_size == 0) {
+      stream_end = true;
+      break;
+    }
+    check_error(!is_bgzf(block, header_size),
+                "BgzfReader: invalid BGZF block header.");
+    const auto csize = bgzf_block_csize(block);
+    check_error(read_source(block + BGZF_HEADER_SIZE,
+                            csize - BGZF_HEADER_SIZE) !=
+                  csize - BGZF_HEADER_SIZE,
+                "BgzfReader: truncated BGZF block.");
+    chunk.compressed_size += csize;
+  }
+  return chunk.compressed_size > 0;
+}
+
+void
+BgzfReader::inflate_chunk(Chunk& chunk)
+{
+  chunk.inflated.resize(BLOCKS_PER_CHUNK * BGZF_MAX_BLOCK_SIZE);
+  chunk.inflated_size = 0;
+  size_t pos = 0;
+  while (pos < chunk.compressed_size) {
+    const char* const block = chunk.compressed.data() + pos;
+    const auto csize = bgzf_block_csize(block);
+    chunk.inflated_size += bgzf_inflate_block(
+      block, csize, chunk.inflated.data() + chunk.inflated_size);
+    pos += csize;
+  }
+}
+
+void
+BgzfReader::start_inflating()
+{
+  while (!stream_end && inflating.size() < threads) {
+    std::unique_ptr<Chunk> chunk = std::move(spare);
+    if (!chunk) {
+      chunk = std::unique_ptr<Chunk>(new Chunk());
+    }
+    if (!load_chunk(*chunk)) {
+      spare = std::move(chunk);
+      break;
+    }
+    Chunk* const loaded = chunk.get();
+    loaded->inflating.run([loaded]() { inflate_chunk(*loaded); });
+    inflating.push_back(std::move(chunk));
+  }
+}
+
+bool
+BgzfReader::next_chunk()
+{
+  if (current) {
+    spare = std::move(current);
+  }
+  start_inflating();
+  if (inflating.empty()) {
+    return false;
+  }
+  current = std::move(inflating.front());
+  inflating.pop_front();
+  current_pos = 0;
+  // The next chunk is inflated while this one is read
+  start_inflating();
+  current->inflating.wait();
+  return true;
+}
+
+size_t
+BgzfReader::read(char* out, const size_t size)
+{
+  size_t total = 0;
+  while (total < size) {
+    if (!current || current_pos == current->inflated_size) {
+      if (!next_chunk()) {
+        break;
+      }
+      continue;
+    }
+    const auto bytes =
+      std::min(size - total, current->inflated_size - current_pos);
+    std::memcpy(out + total, current->inflated.data() + current_pos, bytes);
+    current_pos += bytes;
+    total += bytes;
+  }
+  return total;
+}
+
+} // namespace btllib
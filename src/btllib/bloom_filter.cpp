@@ -1,13 +1,17 @@
 #include "btllib/bloom_filter.hpp"
+#include "btllib/executor.hpp"
+#include "btllib/metrics.hpp"
 #include "btllib/nthash.hpp"
 #include "btllib/status.hpp"
 
 #include "cpptoml.h"
 
+#include <algorithm>
 #include <atomic>
 #include <climits>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <string>
@@ -48,6 +52,7 @@ BloomFilter::BloomFilter(size_t bytes, unsigned hash_num, std::string hash_fn)
 void
 BloomFilter::insert(const uint64_t* hashes)
 {
+  BTLLIB_METRIC_ADD(BLOOM_FILTER_INSERTS, 1);
   for (unsigned i = 0; i < hash_num; ++i) {
     const auto normalized = hashes[i] % array_bits;
     array[normalized / CHAR_BIT] |= BIT_MASKS[normalized % CHAR_BIT];
@@ -57,6 +62,7 @@ BloomFilter::insert(const uint64_t* hashes)
 bool
 BloomFilter::contains(const uint64_t* hashes) const
 {
+  BTLLIB_METRIC_ADD(BLOOM_FILTER_QUERIES, 1);
   for (unsigned i = 0; i < hash_num; ++i) {
     const auto normalized = hashes[i] % array_bits;
     const auto mask = BIT_MASKS[normalized % CHAR_BIT];
@@ -70,6 +76,8 @@ BloomFilter::contains(const uint64_t* hashes) const
 bool
 BloomFilter::contains_insert(const uint64_t* hashes)
 {
+  BTLLIB_METRIC_ADD(BLOOM_FILTER_INSERTS, 1);
+  BTLLIB_METRIC_ADD(BLOOM_FILTER_QUERIES, 1);
   uint8_t found = 1;
   for (unsigned i = 0; i < hash_num; ++i) {
     const auto normalized = hashes[i] % array_bits;
@@ -80,14 +88,67 @@ BloomFilter::contains_insert(const uint64_t* hashes)
   return bool(found);
 }
 
+void
+BloomFilter::prefetch(const uint64_t* hashes, const size_t count) const
+{
+  const size_t n = count * hash_num;
+  for (size_t i = 0; i < n; ++i) {
+    __builtin_prefetch(array.get() + (hashes[i] % array_bits) / CHAR_BIT);
+  }
+}
+
+void
+BloomFilter::insert_batch(const uint64_t* hashes, const size_t count)
+{
+  for (size_t b = 0; b < count; b += BLOOM_FILTER_BATCH_SIZE) {
+    const size_t end = std::min(count, b + BLOOM_FILTER_BATCH_SIZE);
+    prefetch(hashes + b * hash_num, end - b);
+    for (size_t i = b; i < end; ++i) {
+      insert(hashes + i * hash_num);
+    }
+  }
+}
+
+size_t
+BloomFilter::contains_batch(const uint64_t* hashes,
+                            const size_t count,
+                            bool* const results) const
+{
+  size_t found = 0;
+  for (size_t b = 0; b < count; b += BLOOM_FILTER_BATCH_SIZE) {
+    const size_t end = std::min(count, b + BLOOM_FILTER_BATCH_SIZE);
+    prefetch(hashes + b * hash_num, end - b);
+    for (size_t i = b; i < end; ++i) {
+      results[i] = contains(hashes + i * hash_num);
+      found += results[i] ? 1 : 0;
+    }
+  }
+  return found;
+}
+
+void
+BloomFilter::copy_from(const BloomFilter& other)
+{
+  check_error(other.array_size != array_size || other.hash_num != hash_num,
+              "BloomFilter: cannot copy a filter of a different size.");
+  parallel_for(0, array_size, COPY_GRAIN, [&](size_t start, size_t end) {
+    std::memcpy((void*)(array.get() + start),
+                (const void*)(other.array.get() + start),
+                (end - start) * sizeof(array[0]));
+  });
+}
+
 uint64_t
 BloomFilter::get_pop_cnt() const
 {
-  uint64_t pop_cnt = 0;
-#pragma omp parallel for default(none) reduction(+ : pop_cnt)
-  for (size_t i = 0; i < array_size; ++i) {
-    pop_cnt += pop_cnt_byte(array[i]);
-  }
+  std::atomic<uint64_t> pop_cnt{ 0 };
+  parallel_for(0, array_size, POP_CNT_GRAIN, [&](size_t start, size_t end) {
+    uint64_t chunk_pop_cnt = 0;
+    for (size_t i = start; i < end; ++i) {
+      chunk_pop_cnt += pop_cnt_byte(array[i]);
+    }
+    pop_cnt += chunk_pop_cnt;
+  });
   return pop_cnt;
 }
 
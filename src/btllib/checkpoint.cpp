@@ -0,0 +1,221 @@
+#include "btllib/checkpoint.hpp"
+#include "btllib/status.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace btllib {
+
+static const char* const CHECKPOINT_MAGIC = "btllib_checkpoint";
+static const unsigned CHECKPOINT_VERSION = 1;
+
+static void
+sync_path(const std::string& path)
+{
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  check_error(fd < 0,
+              "Checkpoint: failed to open " + path + ": " + get_strerror());
+  const int ret = fsync(fd);
+  close(fd);
+  check_error(ret != 0,
+              "Checkpoint: failed to sync " + path + ": " + get_strerror());
+}
+
+static std::string
+get_dirname(const std::string& path)
+{
+  const auto slash = path.rfind('/');
+  if (slash == std::string::npos) {
+    return ".";
+  }
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+uint64_t
+Checkpoint::State::get_counter(const std::string& name, const size_t i) const
+{
+  const auto it = counters.find(name);
+  if (it == counters.end() || i >= it->second.size()) {
+    return 0;
+  }
+  return it->second[i];
+}
+
+Checkpoint::Checkpoint(std::string prefix, const double interval)
+  : prefix(std::move(prefix))
+  , interval(interval)
+  , next_due(std::chrono::steady_clock::now() +
+             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+               std::chrono::duration<double>(interval)))
+{
+  check_error(this->prefix.empty(), "Checkpoint: prefix is empty.");
+  load();
+}
+
+Checkpoint::~Checkpoint()
+{
+  wait();
+}
+
+void
+Checkpoint::load()
+{
+  const auto path = prefix + ".checkpoint";
+  std::ifstream ifs(path);
+  if (!ifs) {
+    return;
+  }
+  std::string line, key;
+  std::getline(ifs, line);
+  std::istringstream header(line);
+  unsigned version = 0;
+  header >> key >> version;
+  check_error(key != CHECKPOINT_MAGIC, path + " is not a checkpoint.");
+  check_error(version != CHECKPOINT_VERSION,
+              path + ": unsupported checkpoint version " +
+                std::to_string(version) + ".");
+
+  while (std::getline(ifs, line)) {
+    std::istringstream fields(line);
+    fields >> key;
+    if (key == "slot") {
+      fields >> slot;
+    } else if (key == "stage") {
+      fields >> state.stage;
+    } else if (key == "source") {
+      fields >> state.source;
+    } else if (key == "record") {
+      fields >> state.record;
+    } else if (key == "offset") {
+      fields >> state.offset;
+    } else if (key == "file") {
+      files.push_back(line.substr(key.size() + 1));
+    } else if (key == "counter") {
+      std::string name;
+      size_t n = 0;
+      fields >> name >> n;
+      auto& values = state.counters[name];
+      values.resize(n);
+      for (auto& value : values) {
+        fields >> value;
+      }
+    } else {
+      fields.setstate(std::ios::failbit);
+    }
+    check_error(fields.fail(), path + ": invalid line: " + line);
+  }
+  check_error(files.empty(), path + ": no snapshot files.");
+  // The next checkpoint goes to the other slot, so that this one is kept
+  // until the next one is complete
+  slot = 1 - slot;
+}
+
+void
+Checkpoint::save(State state, Writer writer)
+{
+  wait();
+  next_due = std::chrono::steady_clock::now() +
+             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+               std::chrono::duration<double>(interval));
+  const unsigned current_slot = slot;
+  slot = 1 - slot;
+  pending_state = std::move(state);
+  writer_thread = std::unique_ptr<std::thread>(new std::thread(
+    &Checkpoint::write, this, current_slot, std::move(writer)));
+}
+
+void
+Checkpoint::write(const unsigned slot, const Writer& writer)
+{
+  const auto& state = pending_state;
+  const auto snapshot_path = prefix + '.' + std::to_string(slot);
+  auto written = writer(snapshot_path);
+  for (const auto& file : written) {
+    sync_path(file);
+  }
+
+  const auto path = prefix + ".checkpoint";
+  const auto tmp_path = path + ".tmp";
+  {
+    std::ofstream ofs(tmp_path);
+    check_stream(ofs, tmp_path);
+    ofs << CHECKPOINT_MAGIC << ' ' << CHECKPOINT_VERSION << '\n'
+        << "slot " << slot << '\n'
+        << "stage " << state.stage << '\n'
+        << "source " << state.source << '\n'
+        << "record " << state.record << '\n'
+        << "offset " << state.offset << '\n';
+    ofs << "file " << snapshot_path << '\n';
+    for (const auto& file : written) {
+      if (file != snapshot_path) {
+        ofs << "file " << file << '\n';
+      }
+    }
+    for (const auto& counter : state.counters) {
+      ofs << "counter " << counter.first << ' ' << counter.second.size();
+      for (const auto value : counter.second) {
+        ofs << ' ' << value;
+      }
+      ofs << '\n';
+    }
+    ofs.flush();
+    check_stream(ofs, tmp_path);
+  }
+  sync_path(tmp_path);
+  check_error(std::rename(tmp_path.c_str(), path.c_str()) != 0,
+              "Checkpoint: failed to rename " + tmp_path + ": " +
+                get_strerror());
+  sync_path(get_dirname(path));
+
+  pending_files.clear();
+  pending_files.push_back(snapshot_path);
+  for (auto& file : written) {
+    if (file != snapshot_path) {
+      pending_files.push_back(std::move(file));
+    }
+  }
+}
+
+void
+Checkpoint::wait()
+{
+  if (writer_thread) {
+    writer_thread->join();
+    writer_thread.reset();
+    // The background write owns the new state until it is waited for
+    state = std::move(pending_state);
+    files = std::move(pending_files);
+    pending_state = State();
+    pending_files.clear();
+  }
+}
+
+void
+Checkpoint::remove()
+{
+  wait();
+  // The other slot holds the previous checkpoint, or an interrupted one
+  const auto snapshot_path = get_snapshot_path();
+  const auto other_path = prefix + '.' + std::to_string(slot);
+  for (const auto& file : files) {
+    std::remove(file.c_str());
+    if (file.compare(0, snapshot_path.size(), snapshot_path) == 0) {
+      std::remove((other_path + file.substr(snapshot_path.size())).c_str());
+    }
+  }
+  std::remove((prefix + ".checkpoint").c_str());
+  std::remove((prefix + ".checkpoint.tmp").c_str());
+  files.clear();
+  state = State();
+}
+
+} // namespace btllib
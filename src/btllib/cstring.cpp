@@ -1,37 +1,78 @@
 #include "btllib/cstring.hpp"
 
-#include <cmath>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <memory>
 #include <string>
 
 namespace btllib {
 
-CString::CString(const CString& cstr)
+char*
+CStringArena::allocate(const size_t size)
 {
-  if (cstr.s_size + 1 > s_cap) {
-    change_cap(cstr.s_size + 1);
+  // Slabs kept from before a reset are filled in order
+  for (; current < slabs.size(); current++, used = 0) {
+    if (slabs[current].size - used >= size) {
+      char* const p = slabs[current].data.get() + used;
+      used += size;
+      return p;
+    }
   }
-  s_size = cstr.s_size;
-  std::memcpy(s, cstr.s, s_size + 1);
+  Slab slab;
+  slab.size = std::max(size_t(SLAB_SIZE), size);
+  slab.data = std::unique_ptr<char[]>(new char[slab.size]);
+  slabs.push_back(std::move(slab));
+  current = slabs.size() - 1;
+  used = size;
+  return slabs[current].data.get();
+}
+
+bool
+CStringArena::extend(const char* p, const size_t size, const size_t new_size)
+{
+  if (current >= slabs.size() ||
+      p + size != slabs[current].data.get() + used ||
+      used + (new_size - size) > slabs[current].size) {
+    return false;
+  }
+  used += new_size - size;
+  return true;
+}
+
+void
+CStringArena::reset()
+{
+  current = 0;
+  used = 0;
+}
+
+size_t
+CStringArena::get_capacity() const
+{
+  size_t capacity = 0;
+  for (const auto& slab : slabs) {
+    capacity += slab.size;
+  }
+  return capacity;
+}
+
+CString::CString(const CString& cstr)
+{
+  small[0] = '\0';
+  append(cstr.s, cstr.s_size);
 }
 
 CString::CString(CString&& cstr) noexcept
-  : s_size(cstr.s_size)
 {
-  std::swap(s, cstr.s);
-  cstr.clear();
-  std::swap(s_cap, cstr.s_cap);
+  take(cstr);
 }
 
 CString::CString(const std::string& str)
 {
-  if (str.size() + 1 > s_cap) {
-    change_cap(str.size() + 1);
-  }
-  s_size = str.size();
-  std::memcpy(s, str.c_str(), s_size + 1);
+  small[0] = '\0';
+  append(str.c_str(), str.size());
 }
 
 CString&
@@ -40,79 +81,50 @@ CString::operator=(const CString& cstr)
   if (this == &cstr) {
     return *this;
   }
-  if (cstr.s_size + 1 > s_cap) {
-    change_cap(cstr.s_size + 1);
-  }
-  s_size = cstr.s_size;
-  std::memcpy(s, cstr.s, s_size + 1);
+  clear();
+  append(cstr.s, cstr.s_size);
   return *this;
 }
 
 CString&
 CString::operator=(CString&& cstr) noexcept
 {
-  std::swap(s, cstr.s);
-  s_size = cstr.s_size;
-  cstr.clear();
-  std::swap(s_cap, cstr.s_cap);
+  if (this == &cstr) {
+    return *this;
+  }
+  if (s_heap) {
+    free(s); // NOLINT
+  }
+  take(cstr);
   return *this;
 }
 
 CString&
 CString::operator=(const std::string& str)
 {
-  if (str.size() + 1 > s_cap) {
-    change_cap(str.size() + 1);
-  }
-  s_size = str.size();
-  std::memcpy(s, str.c_str(), s_size + 1);
+  clear();
+  append(str.c_str(), str.size());
   return *this;
 }
 
 CString&
 CString::operator+=(const CString& cstr)
 {
-  const auto new_size = s_size + cstr.s_size;
-  if (new_size + 1 > s_cap) {
-    const auto factor = size_t(std::pow(
-      2,
-      std::ceil(std::log2(double(new_size + 1)) - std::log2(double(s_size)))));
-    change_cap(s_size * factor);
-  }
-  std::memcpy(s + s_size, cstr.s, cstr.s_size);
-  s_size = new_size;
+  append(cstr.s, cstr.s_size);
   return *this;
 }
 
 CString&
 CString::operator+=(const std::string& str)
 {
-  const auto new_size = s_size + str.size();
-  if (new_size + 1 > s_cap) {
-    const auto factor = size_t(std::pow(
-      2,
-      std::ceil(std::log2(double(new_size + 1)) - std::log2(double(s_size)))));
-    change_cap(s_size * factor);
-  }
-  std::memcpy(s + s_size, str.c_str(), str.size());
-  s[new_size] = '\0';
-  s_size = new_size;
+  append(str.c_str(), str.size());
   return *this;
 }
 
 CString&
 CString::operator+=(const char c)
 {
-  const auto new_size = s_size + 1;
-  if (new_size + 1 > s_cap) {
-    const auto factor = size_t(std::pow(
-      2,
-      std::ceil(std::log2(double(new_size + 1)) - std::log2(double(s_size)))));
-    change_cap(s_size * factor);
-  }
-  s[new_size - 1] = c;
-  s[new_size] = '\0';
-  s_size = new_size;
+  append(&c, 1);
   return *this;
 }
 
@@ -133,15 +145,75 @@ CString::pop_back()
 void
 CString::change_cap(const size_t new_cap)
 {
+  if (s_heap) {
+    s_cap = new_cap;
+    s = (char*)std::realloc(s, new_cap); // NOLINT
+    return;
+  }
+  if (new_cap <= s_cap) {
+    return;
+  }
+  char* buf = nullptr;
+  if (arena != nullptr) {
+    if (s != small && arena->extend(s, s_cap, new_cap)) {
+      s_cap = new_cap;
+      return;
+    }
+    buf = arena->allocate(new_cap);
+  } else {
+    buf = (char*)std::malloc(new_cap); // NOLINT
+    s_heap = true;
+  }
+  std::memcpy(buf, s, s_size);
+  buf[s_size] = '\0';
+  s = buf;
   s_cap = new_cap;
-  s = (char*)std::realloc(s, new_cap); // NOLINT
+}
+
+void
+CString::reserve(const size_t cap)
+{
+  if (cap > s_cap) {
+    change_cap(std::max(cap, 2 * s_cap));
+  }
+}
+
+void
+CString::append(const char* const str, const size_t n)
+{
+  reserve(s_size + n + 1);
+  std::memcpy(s + s_size, str, n);
+  s_size += n;
+  s[s_size] = '\0';
+}
+
+void
+CString::set_arena(CStringArena* const arena)
+{
+  if (!s_heap && s != small) {
+    s = small;
+    s_cap = SMALL_CAP;
+    clear();
+  }
+  this->arena = arena;
+}
+
+void
+CString::make_heap()
+{
+  if (!s_heap) {
+    char* const buf = (char*)std::malloc(s_cap); // NOLINT
+    std::memcpy(buf, s, std::min(s_size + 1, s_cap));
+    s = buf;
+    s_heap = true;
+  }
 }
 
 void
 CString::resize(const size_t n, const char c)
 {
   if (n > s_size) {
-    change_cap(n + 1);
+    reserve(n + 1);
     for (size_t i = s_size; i < n; i++) {
       s[i] = c;
     }
@@ -164,4 +236,27 @@ CString::erase(const size_t pos, size_t len)
   return *this;
 }
 
-} // namespace btllib
\ No newline at end of file
+void
+CString::take(CString& cstr)
+{
+  s_size = cstr.s_size;
+  arena = cstr.arena;
+  if (cstr.s == cstr.small) {
+    s = small;
+    s_cap = SMALL_CAP;
+    s_heap = false;
+    std::memcpy(
+      small, cstr.small, std::min(s_size + 1, size_t(SMALL_CAP)));
+  } else {
+    // Heap and arena contents change owner without a copy
+    s = cstr.s;
+    s_cap = cstr.s_cap;
+    s_heap = cstr.s_heap;
+    cstr.s = cstr.small;
+    cstr.s_cap = SMALL_CAP;
+    cstr.s_heap = false;
+  }
+  cstr.clear();
+}
+
+} // namespace btllib
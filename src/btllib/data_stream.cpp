@@ -5,22 +5,29 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <fcntl.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <zlib.h>
 
 namespace btllib {
 
@@ -89,19 +96,193 @@ const Datatype DATATYPES[12]{
 };
 // clang-format on
 
+static const size_t DECOMPRESSION_BUFFER_SIZE = 128 * 1024;
+static const int DECOMPRESSION_SOCKET_BUFFER_SIZE = 1024 * 1024;
+static const std::chrono::seconds DECOMPRESSION_WORKER_IDLE_TIMEOUT(60);
+
+/// @cond HIDDEN_SYMBOLS
+// A gzip file being decompressed into one end of a socket pair, while the
+// DataStream reads from the other
+struct DecompressionJob
+{
+  std::string path;
+  int fd = -1;
+  std::mutex mutex;
+  std::condition_variable finished_cv;
+  bool finished = false;
+};
+
+// Threads that decompress gzip files. Idle threads wait for the next job for
+// a while, so that opening many files in a row does not start a thread each
+// time. A job never waits for a busy thread, as its reader may be holding up
+// the other jobs.
+class DecompressionPool
+{
+
+public:
+  static DecompressionPool& get()
+  {
+    // Never destroyed, as idle threads may outlive static destructors
+    static auto* const pool = new DecompressionPool();
+    return *pool;
+  }
+
+  void submit(const std::shared_ptr<DecompressionJob>& job)
+  {
+    const std::unique_lock<std::mutex> lock(mutex);
+    jobs.push_back(job);
+    if (jobs.size() > idle) {
+      std::thread(&DecompressionPool::work, this).detach();
+    } else {
+      job_available.notify_one();
+    }
+  }
+
+private:
+  DecompressionPool() = default;
+
+  void work();
+
+  std::mutex mutex;
+  std::condition_variable job_available;
+  std::deque<std::shared_ptr<DecompressionJob>> jobs;
+  size_t idle = 0;
+};
+/// @endcond
+
+static void
+decompress(DecompressionJob& job)
+{
+  const int in_fd = open(job.path.c_str(), O_RDONLY | O_CLOEXEC);
+  check_error(in_fd < 0, "Failed to open " + job.path + ": " + get_strerror());
+  gzFile gz = gzdopen(in_fd, "rb");
+  check_error(gz == nullptr, "Failed to open " + job.path + " with zlib.");
+  gzbuffer(gz, DECOMPRESSION_BUFFER_SIZE);
+
+  std::unique_ptr<char[]> buffer(new char[DECOMPRESSION_BUFFER_SIZE]);
+  bool reader_closed = false;
+  int len;
+  while (!reader_closed &&
+         (len = gzread(gz, buffer.get(), DECOMPRESSION_BUFFER_SIZE)) > 0) {
+    for (int written = 0; written < len;) {
+      const auto ret =
+        send(job.fd, buffer.get() + written, len - written, MSG_NOSIGNAL);
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // The stream was closed before it was read to the end
+        reader_closed = true;
+        break;
+      }
+      written += int(ret);
+    }
+  }
+  if (!reader_closed) {
+    int err = Z_OK;
+    const char* const msg = gzerror(gz, &err);
+    check_error(err != Z_OK,
+                "Failed to decompress " + job.path + ": " + std::string(msg));
+  }
+  gzclose(gz);
+  ::close(job.fd);
+
+  const std::unique_lock<std::mutex> lock(job.mutex);
+  job.finished = true;
+  job.finished_cv.notify_all();
+}
+
+void
+DecompressionPool::work()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    ++idle;
+    const bool available = job_available.wait_for(
+      lock, DECOMPRESSION_WORKER_IDLE_TIMEOUT, [&]() { return !jobs.empty(); });
+    --idle;
+    if (!available) {
+      return;
+    }
+    const auto job = jobs.front();
+    jobs.pop_front();
+    lock.unlock();
+    decompress(*job);
+    lock.lock();
+  }
+}
+
+// Whether the path is a gzip file with no other layers for the tools to peel
+static bool
+is_plain_gzip(const std::string& path)
+{
+  std::string trimmed;
+  if (endswith(path, ".gz")) {
+    trimmed = path.substr(0, path.size() - 3);
+  } else if (endswith(path, ".z")) {
+    trimmed = path.substr(0, path.size() - 2);
+  } else {
+    return false;
+  }
+  for (const auto& datatype : DATATYPES) {
+    for (const auto& prefix : datatype.prefixes) {
+      if (startswith(path, prefix)) {
+        return false;
+      }
+    }
+    for (const auto& suffix : datatype.suffixes) {
+      if (endswith(trimmed, suffix)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 static std::string
 get_pipeline_cmd(const std::string& path, DataStream::Operation op);
 
-DataStream::DataStream(const std::string& path, Operation op)
+DataStream::DataStream(const std::string& path,
+                       Operation op,
+                       const bool raw)
   : streampath(path)
   , op(op)
 {
+  const auto start = std::chrono::steady_clock::now();
   if (path == "-") {
     if (op == READ) {
       file = stdin;
     } else {
       file = stdout;
     }
+  } else if (raw) {
+    if (op == READ) {
+      check_file_accessibility(path);
+    }
+    file = std::fopen(path.c_str(),
+                      op == READ ? "rb" : (op == APPEND ? "ab" : "wb"));
+    check_error(file == nullptr,
+                "Failed to open " + path + ": " + get_strerror());
+  } else if (op == READ && is_plain_gzip(path)) {
+    check_file_accessibility(path);
+    int fds[2];
+    check_error(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0,
+                "Failed to create a socket pair: " + get_strerror());
+    // Larger buffers let the decompressor run further ahead of the reader
+    setsockopt(fds[1],
+               SOL_SOCKET,
+               SO_SNDBUF,
+               &DECOMPRESSION_SOCKET_BUFFER_SIZE,
+               sizeof(DECOMPRESSION_SOCKET_BUFFER_SIZE));
+    shutdown(fds[0], SHUT_WR);
+    shutdown(fds[1], SHUT_RD);
+    file = fdopen(fds[0], "r");
+    check_error(file == nullptr,
+                "Failed to open " + path + ": " + get_strerror());
+    decompression = std::make_shared<DecompressionJob>();
+    decompression->path = path;
+    decompression->fd = fds[1];
+    DecompressionPool::get().submit(decompression);
   } else {
     pipeline = std::unique_ptr<ProcessPipeline>(
       new ProcessPipeline(get_pipeline_cmd(path, op)));
@@ -111,6 +292,14 @@ DataStream::DataStream(const std::string& path, Operation op)
       file = pipeline->in;
     }
   }
+  if (path != "-") {
+    set_stdio_buffer();
+  }
+  setup_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count();
+  total_setup_ns() += setup_ns;
+  ++open_count();
 }
 
 void
@@ -118,10 +307,99 @@ DataStream::close()
 {
   bool closed_expected = false;
   if (closed.compare_exchange_strong(closed_expected, true)) {
-    if (streampath != "-") {
+    if (pipeline) {
       pipeline->end();
+    } else if (decompression) {
+      // Closing the socket stops the decompressor if it is not done
+      std::fclose(file);
+      std::unique_lock<std::mutex> lock(decompression->mutex);
+      decompression->finished_cv.wait(
+        lock, [&]() { return decompression->finished; });
+    } else if (streampath != "-") {
+      std::fclose(file);
+    }
+    free(stdio_buffer); // NOLINT(cppcoreguidelines-no-malloc)
+    stdio_buffer = nullptr;
+  }
+}
+
+void
+DataStream::set_stdio_buffer()
+{
+  if (file == nullptr) {
+    return;
+  }
+  const auto page_size = size_t(sysconf(_SC_PAGESIZE));
+  void* buffer = nullptr;
+  if (posix_memalign(&buffer, page_size, STDIO_BUFFER_SIZE) != 0) {
+    return;
+  }
+  if (setvbuf(file, static_cast<char*>(buffer), _IOFBF, STDIO_BUFFER_SIZE) !=
+      0) {
+    free(buffer); // NOLINT(cppcoreguidelines-no-malloc)
+    return;
+  }
+  stdio_buffer = static_cast<char*>(buffer);
+}
+
+size_t
+DataStream::read(char* const data, const size_t size)
+{
+  const int fd = get_fd();
+  size_t total = 0;
+  while (total < size) {
+    const auto ret = ::read(fd, data + total, size - total);
+    if (ret < 0) {
+      check_error(errno != EINTR,
+                  "Failed to read from " + streampath + ": " + get_strerror());
+      continue;
     }
+    if (ret == 0) {
+      break;
+    }
+    total += size_t(ret);
   }
+  return total;
+}
+
+// Whether each tool exists, so that it is only looked up once per process
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static std::mutex tool_cache_mutex;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static std::map<std::string, bool> tool_cache;
+
+static bool
+tool_exists(const std::string& existence_cmd)
+{
+  const std::unique_lock<std::mutex> lock(tool_cache_mutex);
+  const auto it = tool_cache.find(existence_cmd);
+  if (it != tool_cache.end()) {
+    return it->second;
+  }
+
+  bool found = false;
+  const pid_t pid = fork();
+  if (pid == 0) {
+    const int null_fd = open("/dev/null", O_WRONLY, 0);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+
+    execlp("sh", "sh", "-c", existence_cmd.c_str(), NULL);
+    log_error("exec failed: sh -c \"" + existence_cmd + "\'");
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+  } else {
+    check_error(pid == -1, "Error on fork.");
+    int status;
+    check_error(waitpid(pid, &status, 0) != pid,
+                "waitpid error: " + get_strerror());
+    if (!(WIFSIGNALED(status)) &&
+        ((WIFEXITED(status)) && (WEXITSTATUS(status) == 0))) { // NOLINT
+      found = true;
+    }
+  }
+  tool_cache[existence_cmd] = found;
+  return found;
 }
 
 static std::string
@@ -132,26 +410,9 @@ get_datatype_cmd(const std::string& path,
   bool found_cmd = false;
   int cmd_idx = 0;
   for (const auto& existence_cmd : datatype.cmds_check_existence) {
-    const pid_t pid = fork();
-    if (pid == 0) {
-      const int null_fd = open("/dev/null", O_WRONLY, 0);
-      dup2(null_fd, STDOUT_FILENO);
-      dup2(null_fd, STDERR_FILENO);
-      close(null_fd);
-
-      execlp("sh", "sh", "-c", existence_cmd.c_str(), NULL);
-      log_error("exec failed: sh -c \"" + existence_cmd + "\'");
-      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
-    } else {
-      check_error(pid == -1, "Error on fork.");
-      int status;
-      check_error(waitpid(pid, &status, 0) != pid,
-                  "waitpid error: " + get_strerror());
-      if (!(WIFSIGNALED(status)) &&
-          ((WIFEXITED(status)) && (WEXITSTATUS(status) == 0))) { // NOLINT
-        found_cmd = true;
-        break;
-      }
+    if (tool_exists(existence_cmd)) {
+      found_cmd = true;
+      break;
     }
     cmd_idx++;
   }
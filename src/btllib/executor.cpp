@@ -0,0 +1,290 @@
+#include "btllib/executor.hpp"
+#include "btllib/status.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace btllib {
+
+// Executor and worker index of the calling thread, if it is a worker
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static thread_local const Executor* current_executor = nullptr;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static thread_local size_t current_worker = 0;
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static std::mutex global_mutex;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static unsigned global_threads = 0;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static bool global_pin_threads = false;
+// The shared executor is never destroyed, so that its workers outlive any
+// object still using them while the process exits
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static Executor* global_executor = nullptr;
+
+Executor::Executor(unsigned threads, const bool pin_threads)
+  : pinned(pin_threads)
+{
+  if (threads == 0) {
+    threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    workers.push_back(std::unique_ptr<Worker>(new Worker()));
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    workers[i]->thread = std::unique_ptr<std::thread>(
+      new std::thread([this, i]() { work(i); }));
+  }
+}
+
+Executor::~Executor()
+{
+  {
+    const std::unique_lock<std::mutex> lock(sleep_mutex);
+    stopping = true;
+    sleep_cv.notify_all();
+  }
+  try {
+    for (auto& worker : workers) {
+      worker->thread->join();
+    }
+  } catch (const std::system_error& e) {
+    log_error("Executor thread join failure: " + std::string(e.what()));
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+  }
+}
+
+Executor&
+Executor::global()
+{
+  const std::unique_lock<std::mutex> lock(global_mutex);
+  if (global_executor == nullptr) {
+    global_executor = new Executor(global_threads, global_pin_threads);
+  }
+  return *global_executor;
+}
+
+void
+Executor::configure(const unsigned threads, const bool pin_threads)
+{
+  const std::unique_lock<std::mutex> lock(global_mutex);
+  check_warning(global_executor != nullptr,
+                "Executor: The shared executor is already running, "
+                "configure() has no effect.");
+  global_threads = threads;
+  global_pin_threads = pin_threads;
+}
+
+void
+Executor::submit(Task task)
+{
+  // Workers keep their own tasks local, so that related work stays on a core
+  // until another worker runs out of tasks
+  const size_t index =
+    in_worker() ? current_worker : next_worker++ % workers.size();
+  {
+    auto& worker = *workers[index];
+    const std::unique_lock<std::mutex> lock(worker.mutex);
+    ++queued;
+    worker.tasks.push_back(std::move(task));
+  }
+  if (sleeping > 0) {
+    const std::unique_lock<std::mutex> lock(sleep_mutex);
+    sleep_cv.notify_one();
+  }
+}
+
+bool
+Executor::run_pending()
+{
+  Task task;
+  const bool found = in_worker() ? take(current_worker, task)
+                                 : steal(workers.size(), task);
+  if (found) {
+    task();
+    ++executed;
+  }
+  return found;
+}
+
+bool
+Executor::in_worker() const
+{
+  return current_executor == this;
+}
+
+void
+Executor::work(const size_t index)
+{
+  current_executor = this;
+  current_worker = index;
+  if (pinned) {
+    pin(index);
+  }
+  Task task;
+  for (;;) {
+    if (take(index, task)) {
+      task();
+      task = nullptr;
+      ++executed;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    ++sleeping;
+    sleep_cv.wait(lock, [&]() { return queued > 0 || stopping; });
+    --sleeping;
+    if (queued == 0 && stopping) {
+      break;
+    }
+  }
+}
+
+bool
+Executor::take(const size_t index, Task& task)
+{
+  auto& worker = *workers[index];
+  {
+    const std::unique_lock<std::mutex> lock(worker.mutex);
+    if (!worker.tasks.empty()) {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+      --queued;
+      return true;
+    }
+  }
+  return steal(index, task);
+}
+
+bool
+Executor::steal(const size_t thief, Task& task)
+{
+  if (queued == 0) {
+    return false;
+  }
+  // Threads outside the pool pass an index past the last worker and may
+  // take from any of them
+  const size_t n = workers.size();
+  for (size_t i = 0; i < n; i++) {
+    const size_t victim = (thief + 1 + i) % n;
+    if (victim == thief) {
+      continue;
+    }
+    auto& worker = *workers[victim];
+    const std::unique_lock<std::mutex> lock(worker.mutex);
+    if (!worker.tasks.empty()) {
+      task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+      --queued;
+      ++stolen;
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+Executor::pin(const size_t index)
+{
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    log_warning("Executor: Could not get the CPU affinity: " +
+                get_strerror());
+    return;
+  }
+  const auto count = size_t(CPU_COUNT(&allowed));
+  if (count == 0) {
+    return;
+  }
+  size_t target = index % count;
+  for (size_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+    if (target-- == 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      const int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      check_warning(ret != 0,
+                    "Executor: Could not pin worker " + std::to_string(index) +
+                      " to CPU " + std::to_string(cpu) + ": " +
+                      std::strerror(ret));
+      return;
+    }
+  }
+#else
+  (void)index;
+  log_warning("Executor: Pinning threads is not supported on this platform.");
+#endif
+}
+
+void
+TaskGroup::run(Executor::Task task)
+{
+  ++pending;
+  executor.submit([this, task]() {
+    task();
+    // The waiter checks for completion under the same lock, so the group
+    // outlives this call
+    const std::unique_lock<std::mutex> lock(mutex);
+    if (--pending == 0) {
+      cv.notify_all();
+    }
+  });
+}
+
+void
+TaskGroup::wait()
+{
+  for (;;) {
+    {
+      const std::unique_lock<std::mutex> lock(mutex);
+      if (pending == 0) {
+        return;
+      }
+    }
+    if (executor.run_pending()) {
+      continue;
+    }
+    // Tasks queued later are picked up after a short wait
+    std::unique_lock<std::mutex> lock(mutex);
+    if (cv.wait_for(lock, std::chrono::milliseconds(1), [&]() {
+          return pending == 0;
+        })) {
+      return;
+    }
+  }
+}
+
+void
+parallel_for(const size_t begin,
+             const size_t end,
+             size_t grain,
+             const std::function<void(size_t, size_t)>& body,
+             Executor& executor)
+{
+  grain = std::max(grain, size_t(1));
+  TaskGroup group(executor);
+  for (size_t start = begin; start < end;) {
+    const size_t stop = start + std::min(grain, end - start);
+    group.run([&body, start, stop]() { body(start, stop); });
+    start = stop;
+  }
+  group.wait();
+}
+
+} // namespace btllib
@@ -0,0 +1,649 @@
+#include "btllib/indexed_seq_reader.hpp"
+#include "btllib/bgzf.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/status.hpp"
+#include "btllib/util.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace btllib {
+
+/// @cond HIDDEN_SYMBOLS
+// Buffered line reader over the uncompressed contents of the source
+class IndexedSeqReader::LineScanner
+{
+public:
+  LineScanner(const IndexedSeqReader& reader,
+              BlockCache& cache,
+              const uint64_t offset)
+    : reader(reader)
+    , cache(cache)
+    , buf(READ_SIZE)
+    , buf_offset(offset)
+  {
+  }
+
+  bool next()
+  {
+    for (;;) {
+      auto* const newline = static_cast<char*>(
+        std::memchr(buf.data() + buf_start, '\n', buf_end - buf_start));
+      if (newline != nullptr) {
+        set_line(size_t(newline - buf.data()) + 1, 1);
+        return true;
+      }
+      if (eof) {
+        if (buf_start < buf_end) {
+          set_line(buf_end, 0);
+          return true;
+        }
+        return false;
+      }
+      refill();
+    }
+  }
+
+  const char* line = nullptr;
+  size_t size = 0;
+  size_t width = 0;
+  uint64_t line_offset = 0;
+
+private:
+  void set_line(const size_t line_end, const size_t newline_size)
+  {
+    line = buf.data() + buf_start;
+    width = line_end - buf_start;
+    size = width - newline_size;
+    if (size > 0 && line[size - 1] == '\r') {
+      size--;
+    }
+    line_offset = buf_offset + buf_start;
+    buf_start = line_end;
+  }
+
+  void refill()
+  {
+    std::memmove(buf.data(), buf.data() + buf_start, buf_end - buf_start);
+    buf_offset += buf_start;
+    buf_end -= buf_start;
+    buf_start = 0;
+    if (buf_end == buf.size()) {
+      buf.resize(buf.size() * 2);
+    }
+    const auto bytes = reader.read(
+      buf_offset + buf_end, buf.size() - buf_end, buf.data() + buf_end, cache);
+    if (bytes == 0) {
+      eof = true;
+    }
+    buf_end += bytes;
+  }
+
+  const IndexedSeqReader& reader;
+  BlockCache& cache;
+  std::vector<char> buf;
+  uint64_t buf_offset;
+  size_t buf_start = 0;
+  size_t buf_end = 0;
+  bool eof = false;
+};
+/// @endcond
+
+IndexedSeqReader::IndexedSeqReader(const std::string& seq_path,
+                                   const unsigned threads)
+  : IndexedSeqReader(seq_path, threads, true)
+{
+}
+
+IndexedSeqReader::IndexedSeqReader(const std::string& seq_path,
+                                   const unsigned threads,
+                                   const bool load)
+  : seq_path(seq_path)
+  , threads(threads)
+{
+  check_error(threads == 0,
+              "IndexedSeqReader: Number of threads cannot be 0.");
+  open_source();
+  struct stat buffer
+  {};
+  if (load && stat((seq_path + ".fai").c_str(), &buffer) == 0) {
+    load_index();
+  } else {
+    build_index_entries();
+    save_index();
+  }
+}
+
+IndexedSeqReader::~IndexedSeqReader()
+{
+  close();
+}
+
+void
+IndexedSeqReader::close() noexcept
+{
+  bool closed_expected = false;
+  if (closed.compare_exchange_strong(closed_expected, true)) {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+}
+
+void
+IndexedSeqReader::open_source()
+{
+  fd = open(seq_path.c_str(), O_RDONLY);
+  check_error(fd < 0,
+              "IndexedSeqReader: failed to open " + seq_path + ": " +
+                get_strerror());
+
+  char header[BGZF_HEADER_SIZE];
+  const auto header_size = pread(fd, header, BGZF_HEADER_SIZE, 0);
+  check_error(header_size < 0,
+              "IndexedSeqReader: pread failed: " + get_strerror());
+  compressed = is_bgzf(header, size_t(header_size));
+  if (compressed) {
+    struct stat buffer
+    {};
+    const auto gzi_path = seq_path + ".gzi";
+    if (stat(gzi_path.c_str(), &buffer) == 0) {
+      blocks = load_gzi(gzi_path, fd);
+      gzi_loaded = true;
+    } else {
+      blocks = scan_bgzf_blocks(fd);
+    }
+    check_error(blocks.empty(), "IndexedSeqReader: " + seq_path + " is empty.");
+    uncompressed_size = blocks.back().uoffset + blocks.back().usize;
+  } else {
+    check_error(header_size > 1 && header[0] == char(31) &&
+                  header[1] == char(139),
+                "IndexedSeqReader: " + seq_path +
+                  " is gzip but not BGZF compressed. Recompress it with "
+                  "bgzip for random access.");
+    struct stat buffer
+    {};
+    check_error(fstat(fd, &buffer) != 0,
+                "IndexedSeqReader: fstat failed: " + get_strerror());
+    uncompressed_size = buffer.st_size;
+  }
+
+  BlockCache cache;
+  char first = 0;
+  check_error(read(0, 1, &first, cache) != 1,
+              "IndexedSeqReader: " + seq_path + " is empty.");
+  if (first == '>') {
+    format = Format::FASTA;
+  } else if (first == '@') {
+    format = Format::FASTQ;
+  } else {
+    log_error("IndexedSeqReader: " + seq_path +
+              " is neither a FASTA nor a FASTQ file.");
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+  }
+}
+
+size_t
+IndexedSeqReader::read(uint64_t offset,
+                       const size_t size,
+                       char* out,
+                       BlockCache& cache) const
+{
+  size_t total = 0;
+  if (!compressed) {
+    while (total < size) {
+      const auto ret = pread(fd, out + total, size - total, off_t(offset));
+      if (ret == 0) {
+        break;
+      }
+      check_error(ret < 0, "IndexedSeqReader: pread failed: " + get_strerror());
+      total += size_t(ret);
+      offset += size_t(ret);
+    }
+    return total;
+  }
+
+  while (total < size && offset < uncompressed_size) {
+    if (cache.block_idx >= blocks.size() ||
+        offset < blocks[cache.block_idx].uoffset ||
+        offset >= blocks[cache.block_idx].uoffset +
+                    blocks[cache.block_idx].usize) {
+      const auto it = std::upper_bound(
+        blocks.begin(),
+        blocks.end(),
+        offset,
+        [](const uint64_t o, const BgzfBlock& b) { return o < b.uoffset; });
+      const auto& block = *(it - 1);
+      cache.block_idx = size_t(it - blocks.begin()) - 1;
+      cache.cdata.resize(block.csize);
+      cache.udata.resize(BGZF_MAX_BLOCK_SIZE);
+      size_t cbytes = 0;
+      while (cbytes < block.csize) {
+        const auto ret = pread(fd,
+                               cache.cdata.data() + cbytes,
+                               block.csize - cbytes,
+                               off_t(block.coffset + cbytes));
+        check_error(ret <= 0,
+                    "IndexedSeqReader: failed to read BGZF block: " +
+                      get_strerror());
+        cbytes += size_t(ret);
+      }
+      bgzf_inflate_block(cache.cdata.data(), block.csize, cache.udata.data());
+    }
+    const auto& block = blocks[cache.block_idx];
+    const auto block_pos = size_t(offset - block.uoffset);
+    const auto bytes = std::min(size - total, size_t(block.usize) - block_pos);
+    std::memcpy(out + total, cache.udata.data() + block_pos, bytes);
+    total += bytes;
+    offset += bytes;
+  }
+  return total;
+}
+
+uint64_t
+IndexedSeqReader::find_record_start(const uint64_t from,
+                                    BlockCache& cache) const
+{
+  if (from == 0) {
+    return 0;
+  }
+  const char marker = format == Format::FASTA ? '>' : '@';
+  // Start from the previous byte so that a record starting at `from` is found
+  LineScanner scanner(*this, cache, from - 1);
+  if (!scanner.next()) {
+    return uncompressed_size;
+  }
+  while (scanner.next()) {
+    if (scanner.size == 0 || scanner.line[0] != marker) {
+      continue;
+    }
+    const auto candidate = scanner.line_offset;
+    if (format == Format::FASTA) {
+      return candidate;
+    }
+    // A FASTQ quality line can also start with '@', but the header is the
+    // only one followed by a separator line two lines later.
+    LineScanner lookahead(*this, cache, candidate);
+    if (lookahead.next() && lookahead.next() && lookahead.next() &&
+        lookahead.size > 0 && lookahead.line[0] == '+') {
+      return candidate;
+    }
+  }
+  return uncompressed_size;
+}
+
+std::vector<IndexedSeqReader::IndexEntry>
+IndexedSeqReader::build_index_range(const uint64_t start,
+                                    const uint64_t end,
+                                    uint64_t& next_start,
+                                    BlockCache& cache,
+                                    const bool strict) const
+{
+  std::vector<IndexEntry> entries;
+  const char marker = format == Format::FASTA ? '>' : '@';
+  next_start = find_record_start(start, cache);
+  if (next_start >= end) {
+    return entries;
+  }
+
+  // A malformed file is an error when indexing sequentially, but only means
+  // that the chunk boundary was misdetected when indexing in parallel.
+  const auto fail = [&](const std::string& msg) -> std::vector<IndexEntry> {
+    check_error(strict, msg);
+    next_start = std::numeric_limits<uint64_t>::max();
+    return entries;
+  };
+
+  LineScanner scanner(*this, cache, next_start);
+  bool have_line = scanner.next();
+  while (have_line && scanner.line_offset < end) {
+    if (scanner.size == 0 || scanner.line[0] != marker) {
+      return fail("IndexedSeqReader: " + seq_path +
+                  " has an unexpected line at offset " +
+                  std::to_string(scanner.line_offset) + ".");
+    }
+    IndexEntry entry;
+    const auto* name_end = scanner.line + 1;
+    while (name_end < scanner.line + scanner.size &&
+           !bool(std::isspace(*name_end))) {
+      name_end++;
+    }
+    entry.name = std::string(scanner.line + 1, name_end);
+    entry.offset = scanner.line_offset + scanner.width;
+
+    // Every line but the last must have the same length, as the offset of a
+    // base is computed from it.
+    bool short_line_seen = false;
+    const auto check_line = [&]() -> bool {
+      if (scanner.size == 0) {
+        short_line_seen = true;
+        return true;
+      }
+      if (short_line_seen ||
+          (entry.line_bases > 0 &&
+           (scanner.size > entry.line_bases ||
+            (scanner.size == entry.line_bases &&
+             scanner.width != entry.line_width)))) {
+        return false;
+      }
+      if (entry.line_bases == 0) {
+        entry.line_bases = scanner.size;
+        entry.line_width = scanner.width;
+      } else if (scanner.size < entry.line_bases) {
+        short_line_seen = true;
+      }
+      return true;
+    };
+
+    const char separator = format == Format::FASTA ? '>' : '+';
+    while ((have_line = scanner.next()) &&
+           (scanner.size == 0 || scanner.line[0] != separator)) {
+      if (!check_line()) {
+        return fail("IndexedSeqReader: " + entry.name +
+                    " has lines of different lengths.");
+      }
+      entry.length += scanner.size;
+    }
+
+    if (format == Format::FASTQ) {
+      if (!have_line) {
+        return fail("IndexedSeqReader: " + entry.name +
+                    " is missing the quality scores.");
+      }
+      entry.qual_offset = scanner.line_offset + scanner.width;
+      size_t qual_length = 0;
+      while (qual_length < entry.length && (have_line = scanner.next())) {
+        qual_length += scanner.size;
+      }
+      if (qual_length != entry.length) {
+        return fail("IndexedSeqReader: " + entry.name +
+                    " has a different number of quality scores and bases.");
+      }
+      have_line = scanner.next();
+    }
+    if (entry.line_bases == 0) {
+      entry.line_width = 1;
+    }
+    entries.push_back(std::move(entry));
+  }
+  next_start = have_line ? scanner.line_offset : uncompressed_size;
+  return entries;
+}
+
+void
+IndexedSeqReader::build_index_entries()
+{
+  unsigned chunks = threads;
+  if (uncompressed_size < READ_SIZE) {
+    chunks = 1;
+  }
+
+  std::vector<std::vector<IndexEntry>> chunk_entries(chunks);
+  std::vector<uint64_t> starts(chunks), next_starts(chunks);
+  std::vector<std::unique_ptr<std::thread>> workers;
+  for (unsigned i = 0; i < chunks; i++) {
+    workers.push_back(
+      std::unique_ptr<std::thread>(new std::thread([&, i]() {
+        BlockCache cache;
+        const auto start = uncompressed_size * i / chunks;
+        const auto end = uncompressed_size * (i + 1) / chunks;
+        starts[i] = find_record_start(start, cache);
+        chunk_entries[i] =
+          build_index_range(start, end, next_starts[i], cache, chunks == 1);
+      })));
+  }
+  for (auto& worker : workers) {
+    worker->join();
+  }
+
+  // Each chunk has to end where the next one starts. If a chunk boundary was
+  // misdetected, e.g. in a multiline FASTQ file, index sequentially instead.
+  bool contiguous = next_starts[chunks - 1] == uncompressed_size;
+  for (unsigned i = 0; i + 1 < chunks; i++) {
+    if (next_starts[i] != starts[i + 1]) {
+      contiguous = false;
+    }
+  }
+  if (!contiguous) {
+    BlockCache cache;
+    uint64_t next_start = 0;
+    chunk_entries.clear();
+    chunk_entries.push_back(
+      build_index_range(0, uncompressed_size, next_start, cache, true));
+  }
+
+  for (auto& entries : chunk_entries) {
+    for (auto& entry : entries) {
+      add_entry(std::move(entry));
+    }
+  }
+}
+
+void
+IndexedSeqReader::add_entry(IndexEntry entry)
+{
+  if (name_to_num.find(entry.name) != name_to_num.end()) {
+    log_warning("IndexedSeqReader: Ignoring duplicate sequence " + entry.name +
+                ".");
+    return;
+  }
+  name_to_num[entry.name] = index.size();
+  index.push_back(std::move(entry));
+}
+
+void
+IndexedSeqReader::load_index()
+{
+  const auto fai_path = seq_path + ".fai";
+  std::ifstream fai(fai_path);
+  check_stream(fai, fai_path);
+  const size_t columns = format == Format::FASTA ? 5 : 6;
+  std::string line;
+  while (std::getline(fai, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    const auto tokens = split(line, "\t");
+    check_error(tokens.size() != columns,
+                "IndexedSeqReader: " + fai_path + " has " +
+                  std::to_string(tokens.size()) + " columns instead of " +
+                  std::to_string(columns) + ".");
+    IndexEntry entry;
+    entry.name = tokens[0];
+    entry.length = std::stoull(tokens[1]);
+    entry.offset = std::stoull(tokens[2]);
+    entry.line_bases = std::stoull(tokens[3]);
+    entry.line_width = std::stoull(tokens[4]);
+    if (format == Format::FASTQ) {
+      entry.qual_offset = std::stoull(tokens[5]);
+    }
+    add_entry(std::move(entry));
+  }
+}
+
+void
+IndexedSeqReader::save_index() const
+{
+  const auto fai_path = seq_path + ".fai";
+  std::ofstream fai(fai_path);
+  if (!fai) {
+    log_warning("IndexedSeqReader: Failed to save " + fai_path + ": " +
+                get_strerror());
+    return;
+  }
+  for (const auto& entry : index) {
+    fai << entry.name << '\t' << entry.length << '\t' << entry.offset << '\t'
+        << entry.line_bases << '\t' << entry.line_width;
+    if (format == Format::FASTQ) {
+      fai << '\t' << entry.qual_offset;
+    }
+    fai << '\n';
+  }
+  fai.close();
+  check_warning(!fai, "IndexedSeqReader: Failed to save " + fai_path + ".");
+
+  if (compressed && !gzi_loaded) {
+    save_gzi(seq_path + ".gzi", blocks);
+  }
+}
+
+void
+IndexedSeqReader::build_index(const std::string& seq_path,
+                              const unsigned threads)
+{
+  const IndexedSeqReader reader(seq_path, threads, false);
+}
+
+std::string
+IndexedSeqReader::read_bases(const IndexEntry& entry,
+                             const uint64_t first_offset,
+                             const size_t start,
+                             const size_t end,
+                             BlockCache& cache) const
+{
+  std::string bases;
+  if (start >= end || entry.line_bases == 0) {
+    return bases;
+  }
+  const auto offset_of = [&](const size_t pos) {
+    return first_offset + pos / entry.line_bases * entry.line_width +
+           pos % entry.line_bases;
+  };
+  const auto from = offset_of(start);
+  const auto to = offset_of(end - 1) + 1;
+  bases.resize(to - from);
+  check_error(read(from, to - from, &bases[0], cache) != to - from,
+              "IndexedSeqReader: " + seq_path + " is truncated.");
+  bases.erase(
+    std::remove_if(bases.begin(),
+                   bases.end(),
+                   [](const char c) { return c == '\n' || c == '\r'; }),
+    bases.end());
+  check_error(bases.size() != end - start,
+              "IndexedSeqReader: index does not match " + seq_path + ".");
+  return bases;
+}
+
+SeqReader::Record
+IndexedSeqReader::get(const Region& region, BlockCache& cache) const
+{
+  const auto it = name_to_num.find(region.name);
+  check_error(it == name_to_num.end(),
+              "IndexedSeqReader: " + region.name + " not found in " +
+                seq_path + ".");
+  const auto& entry = index[it->second];
+  const auto end = std::min(region.end, entry.length);
+  const auto start = std::min(region.start, end);
+
+  SeqReader::Record record;
+  record.num = it->second;
+  record.id = entry.name;
+  record.seq = read_bases(entry, entry.offset, start, end, cache);
+  if (format == Format::FASTQ) {
+    record.qual = read_bases(entry, entry.qual_offset, start, end, cache);
+  }
+  return record;
+}
+
+SeqReader::Record
+IndexedSeqReader::get(const Region& region) const
+{
+  BlockCache cache;
+  return get(region, cache);
+}
+
+SeqReader::Record
+IndexedSeqReader::get(const std::string& name) const
+{
+  return get(Region(name));
+}
+
+SeqReader::Record
+IndexedSeqReader::get(const size_t num) const
+{
+  check_error(num >= index.size(),
+              "IndexedSeqReader: record number " + std::to_string(num) +
+                " is out of range.");
+  return get(Region(index[num].name));
+}
+
+std::vector<SeqReader::Record>
+IndexedSeqReader::get(const std::vector<Region>& regions) const
+{
+  std::vector<SeqReader::Record> records(regions.size());
+  const auto workers_num =
+    unsigned(std::min(size_t(threads), regions.size()));
+  std::vector<std::unique_ptr<std::thread>> workers;
+  for (unsigned i = 0; i < workers_num; i++) {
+    workers.push_back(
+      std::unique_ptr<std::thread>(new std::thread([&, i]() {
+        // Contiguous ranges keep neighbouring regions on one thread, so that
+        // they can share decompressed BGZF blocks
+        BlockCache cache;
+        const auto first = regions.size() * i / workers_num;
+        const auto last = regions.size() * (i + 1) / workers_num;
+        for (auto j = first; j < last; j++) {
+          records[j] = get(regions[j], cache);
+        }
+      })));
+  }
+  for (auto& worker : workers) {
+    worker->join();
+  }
+  return records;
+}
+
+IndexedSeqReader::Region
+IndexedSeqReader::parse_region(const std::string& region)
+{
+  const auto colon = region.rfind(':');
+  if (colon == std::string::npos) {
+    return Region(region);
+  }
+  std::string range;
+  for (size_t i = colon + 1; i < region.size(); i++) {
+    if (region[i] != ',') {
+      range += region[i];
+    }
+  }
+  const auto dash = range.find('-');
+  const auto valid = [](const std::string& s) {
+    return !s.empty() &&
+           std::all_of(s.begin(), s.end(), [](const char c) {
+             return bool(std::isdigit(c));
+           });
+  };
+  const auto beg_str = range.substr(0, dash);
+  const auto end_str =
+    dash == std::string::npos ? std::string() : range.substr(dash + 1);
+  if (!valid(beg_str) || (dash != std::string::npos && !valid(end_str))) {
+    // Not a range, the colon is part of the name
+    return Region(region);
+  }
+  const auto beg = std::stoull(beg_str);
+  check_error(beg == 0,
+              "IndexedSeqReader: region coordinates are 1-based: " + region);
+  Region parsed(region.substr(0, colon), beg - 1);
+  if (dash != std::string::npos) {
+    parsed.end = std::stoull(end_str);
+    check_error(parsed.end < parsed.start,
+                "IndexedSeqReader: invalid region " + region);
+  }
+  return parsed;
+}
+
+} // namespace btllib
@@ -0,0 +1,512 @@
+#include "btllib/indexlr_binary.hpp"
+#include "btllib/status.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace btllib {
+
+constexpr const char IndexlrBinary::MAGIC[];
+
+// Columns of a COLUMNAR block, preceded by their sizes in the block
+static const size_t COLUMNS = 7;
+static const size_t BLOCK_HEADER_SIZE = 24;
+static const size_t MAGIC_SIZE = 8;
+
+static void
+append_le(std::string& out, uint64_t val, const int bytes)
+{
+  char buf[8];
+  for (int i = 0; i < bytes; i++) {
+    buf[i] = char(val & 0xFF);
+    val >>= 8;
+  }
+  out.append(buf, bytes);
+}
+
+static uint32_t
+read_le32(const char* p)
+{
+  const auto* u = reinterpret_cast<const unsigned char*>(p);
+  return uint32_t(u[0]) | (uint32_t(u[1]) << 8) | (uint32_t(u[2]) << 16) |
+         (uint32_t(u[3]) << 24);
+}
+
+static uint64_t
+read_le64(const char* p)
+{
+  return uint64_t(read_le32(p)) | (uint64_t(read_le32(p + 4)) << 32);
+}
+
+static void
+append_varint(std::string& out, uint64_t val)
+{
+  while (val >= 0x80) {
+    out.push_back(char((val & 0x7F) | 0x80));
+    val >>= 7;
+  }
+  out.push_back(char(val));
+}
+
+// Deltas are zigzag encoded, so that small negative ones stay short
+static uint64_t
+zigzag(const uint64_t from, const uint64_t to)
+{
+  const auto delta = int64_t(to - from);
+  return (uint64_t(delta) << 1) ^ uint64_t(delta >> 63);
+}
+
+static uint64_t
+unzigzag(const uint64_t from, const uint64_t encoded)
+{
+  return from + ((encoded >> 1) ^ (~(encoded & 1) + 1));
+}
+
+static void
+fail(const std::string& msg)
+{
+  log_error(msg);
+  std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+}
+
+IndexlrWriter::IndexlrWriter(const std::string& sink_path,
+                             const size_t k,
+                             const size_t w,
+                             const unsigned fields,
+                             const IndexlrBinary::Layout layout)
+  : sink_path(sink_path)
+  , k(k)
+  , fields(fields)
+  , layout(layout)
+  , sink(sink_path == "-" ? stdout : fopen(sink_path.c_str(), "wbe"))
+{
+  check_error(sink == nullptr,
+              "IndexlrWriter: Failed to open " + sink_path + ": " +
+                get_strerror());
+  const unsigned all_fields = IndexlrBinary::SEQ | IndexlrBinary::QUAL;
+  check_error((fields & ~all_fields) != 0, "IndexlrWriter: Invalid fields.");
+  std::string header(IndexlrBinary::MAGIC, MAGIC_SIZE);
+  append_le(header, IndexlrBinary::VERSION, 4);
+  append_le(header, layout, 4);
+  append_le(header, k, 4);
+  append_le(header, w, 4);
+  append_le(header, fields, 4);
+  append_le(header, 0, 4);
+  buffer = std::move(header);
+}
+
+IndexlrWriter::~IndexlrWriter()
+{
+  close();
+}
+
+void
+IndexlrWriter::close()
+{
+  if (closed) {
+    return;
+  }
+  closed = true;
+  if (layout == IndexlrBinary::COLUMNAR) {
+    flush_columns();
+  }
+  flush();
+  if (sink == stdout) {
+    check_error(fflush(sink) != 0,
+                "IndexlrWriter: Failed to flush " + sink_path + ": " +
+                  get_strerror());
+  } else {
+    check_error(fclose(sink) != 0,
+                "IndexlrWriter: Failed to close " + sink_path + ": " +
+                  get_strerror());
+  }
+}
+
+void
+IndexlrWriter::write(const Indexlr::Record& record)
+{
+  if (layout == IndexlrBinary::RECORDS) {
+    write_record(record);
+    if (buffer.size() >= BUFFER_SIZE) {
+      flush();
+    }
+  } else {
+    add_columns(record);
+    if (columns.records >= COLUMNAR_BLOCK_RECORDS) {
+      flush_columns();
+    }
+  }
+}
+
+void
+IndexlrWriter::write_record(const Indexlr::Record& record)
+{
+  append_le(buffer, record.num, 8);
+  append_le(buffer, record.readlen, 8);
+  append_le(buffer, record.id.size(), 4);
+  append_le(buffer, record.barcode.size(), 4);
+  append_le(buffer, record.minimizers.size(), 4);
+  append_le(buffer, 0, 4);
+  buffer += record.id;
+  buffer += record.barcode;
+  for (const auto& min : record.minimizers) {
+    append_le(buffer, min.min_hash, 8);
+    append_le(buffer, min.out_hash, 8);
+    append_le(buffer, (uint64_t(min.pos) << 1) | (min.forward ? 1 : 0), 8);
+  }
+  for (const unsigned field : { unsigned(IndexlrBinary::SEQ),
+                                unsigned(IndexlrBinary::QUAL) }) {
+    if ((fields & field) == 0) {
+      continue;
+    }
+    for (const auto& min : record.minimizers) {
+      const auto& str = field == IndexlrBinary::SEQ ? min.seq : min.qual;
+      if (str.size() != k) {
+        fail("IndexlrWriter: Minimizer sequence or quality length does not "
+             "match k.");
+      }
+      buffer += str;
+    }
+  }
+}
+
+void
+IndexlrWriter::add_columns(const Indexlr::Record& record)
+{
+  append_varint(columns.lengths, zigzag(columns.last_num, record.num));
+  append_varint(columns.lengths, record.id.size());
+  append_varint(columns.lengths, record.barcode.size());
+  append_varint(columns.lengths, record.readlen);
+  append_varint(columns.lengths, record.minimizers.size());
+  columns.last_num = record.num;
+  columns.names += record.id;
+  columns.names += record.barcode;
+
+  size_t last_pos = 0;
+  for (const auto& min : record.minimizers) {
+    append_le(columns.hashes, min.min_hash, 8);
+    append_le(columns.hashes, min.out_hash, 8);
+    append_varint(columns.positions, zigzag(last_pos, min.pos));
+    last_pos = min.pos;
+    if (columns.strand_bits % 8 == 0) {
+      columns.strands.push_back(0);
+    }
+    if (min.forward) {
+      columns.strands.back() |= char(1 << (columns.strand_bits % 8));
+    }
+    columns.strand_bits++;
+    if ((fields & IndexlrBinary::SEQ) != 0) {
+      if (min.seq.size() != k) {
+        fail("IndexlrWriter: Minimizer sequence length does not match k.");
+      }
+      columns.seqs += min.seq;
+    }
+    if ((fields & IndexlrBinary::QUAL) != 0) {
+      if (min.qual.size() != k) {
+        fail("IndexlrWriter: Minimizer quality length does not match k.");
+      }
+      columns.quals += min.qual;
+    }
+  }
+  columns.records++;
+}
+
+void
+IndexlrWriter::flush_columns()
+{
+  if (columns.records == 0) {
+    return;
+  }
+  const std::string* const parts[COLUMNS] = {
+    &columns.lengths, &columns.names, &columns.hashes, &columns.positions,
+    &columns.strands, &columns.seqs,  &columns.quals
+  };
+  std::string raw;
+  for (const auto* part : parts) {
+    append_le(raw, part->size(), 8);
+  }
+  for (const auto* part : parts) {
+    raw += *part;
+  }
+
+  uLongf compressed_size = compressBound(raw.size());
+  std::vector<Bytef> compressed(compressed_size);
+  check_error(compress2(compressed.data(),
+                        &compressed_size,
+                        reinterpret_cast<const Bytef*>(raw.data()),
+                        raw.size(),
+                        Z_DEFAULT_COMPRESSION) != Z_OK,
+              "IndexlrWriter: Block compression failed.");
+  append_le(buffer, raw.size(), 8);
+  append_le(buffer, compressed_size, 8);
+  append_le(buffer, columns.records, 8);
+  buffer.append(reinterpret_cast<const char*>(compressed.data()),
+                compressed_size);
+  flush();
+  columns = Columns();
+}
+
+void
+IndexlrWriter::flush()
+{
+  if (!buffer.empty()) {
+    check_error(fwrite(buffer.data(), 1, buffer.size(), sink) != buffer.size(),
+                "IndexlrWriter: Failed to write to " + sink_path + ": " +
+                  get_strerror());
+    buffer.clear();
+  }
+}
+
+IndexlrReader::IndexlrReader(const std::string& source_path)
+  : source_path(source_path)
+{
+  const int fd = open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+  check_error(fd < 0,
+              "IndexlrReader: File " + source_path +
+                " could not be read: " + get_strerror());
+  struct stat st;
+  check_error(fstat(fd, &st) != 0,
+              "IndexlrReader: Failed to stat " + source_path + ": " +
+                get_strerror());
+  mapping_size = size_t(st.st_size);
+  check_error(mapping_size < IndexlrBinary::HEADER_SIZE,
+              "IndexlrReader: " + source_path + " is truncated.");
+  mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  check_error(mapping == MAP_FAILED,
+              "IndexlrReader: Failed to map " + source_path + ": " +
+                get_strerror());
+  madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+  const char* const header = static_cast<const char*>(mapping);
+  check_error(memcmp(header, IndexlrBinary::MAGIC, MAGIC_SIZE) != 0,
+              "IndexlrReader: " + source_path +
+                " is not an Indexlr binary file.");
+  check_error(read_le32(header + 8) != IndexlrBinary::VERSION,
+              "IndexlrReader: " + source_path + " has version " +
+                std::to_string(read_le32(header + 8)) + ", expected " +
+                std::to_string(IndexlrBinary::VERSION) + ".");
+  const auto layout_value = read_le32(header + 12);
+  check_error(layout_value != IndexlrBinary::RECORDS &&
+                layout_value != IndexlrBinary::COLUMNAR,
+              "IndexlrReader: " + source_path + " has an unknown layout.");
+  layout = IndexlrBinary::Layout(layout_value);
+  k = read_le32(header + 16);
+  w = read_le32(header + 20);
+  fields = read_le32(header + 24);
+  cursor = header + IndexlrBinary::HEADER_SIZE;
+  end_of_data = header + mapping_size;
+}
+
+IndexlrReader::~IndexlrReader()
+{
+  close();
+}
+
+void
+IndexlrReader::close() noexcept
+{
+  if (mapping != nullptr) {
+    munmap(mapping, mapping_size);
+    mapping = nullptr;
+    cursor = end_of_data = nullptr;
+    block_records = 0;
+  }
+}
+
+Indexlr::Record
+IndexlrReader::read()
+{
+  if (layout == IndexlrBinary::RECORDS) {
+    if (cursor == end_of_data) {
+      return Indexlr::Record();
+    }
+    return read_record();
+  }
+  if (block_records == 0 && !load_block()) {
+    return Indexlr::Record();
+  }
+  block_records--;
+  return read_columns();
+}
+
+void
+IndexlrReader::check_available(const size_t bytes) const
+{
+  if (size_t(end_of_data - cursor) < bytes) {
+    fail("IndexlrReader: " + source_path + " is truncated.");
+  }
+}
+
+Indexlr::Record
+IndexlrReader::read_record()
+{
+  check_available(IndexlrBinary::RECORD_HEADER_SIZE);
+  Indexlr::Record record;
+  record.num = read_le64(cursor);
+  record.readlen = read_le64(cursor + 8);
+  const size_t id_len = read_le32(cursor + 16);
+  const size_t barcode_len = read_le32(cursor + 20);
+  const size_t count = read_le32(cursor + 24);
+  cursor += IndexlrBinary::RECORD_HEADER_SIZE;
+
+  size_t field_num = 0;
+  field_num += (fields & IndexlrBinary::SEQ) != 0 ? 1 : 0;
+  field_num += (fields & IndexlrBinary::QUAL) != 0 ? 1 : 0;
+  const uint64_t size =
+    id_len + barcode_len +
+    count * (IndexlrBinary::MINIMIZER_SIZE + k * field_num);
+  check_available(size);
+
+  record.id.assign(cursor, id_len);
+  cursor += id_len;
+  record.barcode.assign(cursor, barcode_len);
+  cursor += barcode_len;
+  record.minimizers.resize(count);
+  for (auto& min : record.minimizers) {
+    min.min_hash = read_le64(cursor);
+    min.out_hash = read_le64(cursor + 8);
+    const uint64_t pos_strand = read_le64(cursor + 16);
+    min.pos = size_t(pos_strand >> 1);
+    min.forward = (pos_strand & 1) != 0;
+    cursor += IndexlrBinary::MINIMIZER_SIZE;
+  }
+  if ((fields & IndexlrBinary::SEQ) != 0) {
+    for (auto& min : record.minimizers) {
+      min.seq.assign(cursor, k);
+      cursor += k;
+    }
+  }
+  if ((fields & IndexlrBinary::QUAL) != 0) {
+    for (auto& min : record.minimizers) {
+      min.qual.assign(cursor, k);
+      cursor += k;
+    }
+  }
+  return record;
+}
+
+bool
+IndexlrReader::load_block()
+{
+  if (cursor == end_of_data) {
+    return false;
+  }
+  check_available(BLOCK_HEADER_SIZE);
+  const uint64_t raw_size = read_le64(cursor);
+  const uint64_t compressed_size = read_le64(cursor + 8);
+  const uint64_t records = read_le64(cursor + 16);
+  cursor += BLOCK_HEADER_SIZE;
+  check_available(compressed_size);
+  if (records == 0 || raw_size < COLUMNS * 8) {
+    fail("IndexlrReader: " + source_path + " has a corrupt block.");
+  }
+
+  block.resize(raw_size);
+  uLongf size = raw_size;
+  if (uncompress(reinterpret_cast<Bytef*>(block.data()),
+                 &size,
+                 reinterpret_cast<const Bytef*>(cursor),
+                 compressed_size) != Z_OK ||
+      size != raw_size) {
+    fail("IndexlrReader: " + source_path + " has a corrupt block.");
+  }
+  cursor += compressed_size;
+
+  Column* const parts[COLUMNS] = { &columns.lengths,   &columns.names,
+                                   &columns.hashes,    &columns.positions,
+                                   &columns.strands,   &columns.seqs,
+                                   &columns.quals };
+  const char* pos = block.data() + COLUMNS * 8;
+  const char* const end = block.data() + block.size();
+  for (size_t i = 0; i < COLUMNS; i++) {
+    const uint64_t column_size = read_le64(block.data() + i * 8);
+    if (uint64_t(end - pos) < column_size) {
+      fail("IndexlrReader: " + source_path + " has a corrupt block.");
+    }
+    parts[i]->pos = pos;
+    parts[i]->end = pos + column_size;
+    pos += column_size;
+  }
+  columns.strand_bit = 0;
+  block_records = records;
+  last_num = 0;
+  return true;
+}
+
+const char*
+IndexlrReader::take(Column& column, const size_t bytes) const
+{
+  if (size_t(column.end - column.pos) < bytes) {
+    fail("IndexlrReader: " + source_path + " has a corrupt block.");
+  }
+  const char* const data = column.pos;
+  column.pos += bytes;
+  return data;
+}
+
+uint64_t
+IndexlrReader::take_varint(Column& column) const
+{
+  uint64_t val = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    const auto byte = uint8_t(*take(column, 1));
+    val |= uint64_t(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return val;
+    }
+  }
+  fail("IndexlrReader: " + source_path + " has a corrupt block.");
+  return val;
+}
+
+Indexlr::Record
+IndexlrReader::read_columns()
+{
+  Indexlr::Record record;
+  record.num = size_t(unzigzag(last_num, take_varint(columns.lengths)));
+  last_num = record.num;
+  const size_t id_len = take_varint(columns.lengths);
+  const size_t barcode_len = take_varint(columns.lengths);
+  record.readlen = take_varint(columns.lengths);
+  const size_t count = take_varint(columns.lengths);
+
+  record.id.assign(take(columns.names, id_len), id_len);
+  record.barcode.assign(take(columns.names, barcode_len), barcode_len);
+  const char* const hashes = take(columns.hashes, count * 16);
+  const bool seq = (fields & IndexlrBinary::SEQ) != 0;
+  const bool qual = (fields & IndexlrBinary::QUAL) != 0;
+  record.minimizers.resize(count);
+  size_t last_pos = 0;
+  for (size_t i = 0; i < count; i++) {
+    auto& min = record.minimizers[i];
+    min.min_hash = read_le64(hashes + i * 16);
+    min.out_hash = read_le64(hashes + i * 16 + 8);
+    min.pos = size_t(unzigzag(last_pos, take_varint(columns.positions)));
+    last_pos = min.pos;
+    const size_t bit = columns.strand_bit++;
+    if (bit / 8 >= size_t(columns.strands.end - columns.strands.pos)) {
+      fail("IndexlrReader: " + source_path + " has a corrupt block.");
+    }
+    min.forward = ((columns.strands.pos[bit / 8] >> (bit % 8)) & 1) != 0;
+    if (seq) {
+      min.seq.assign(take(columns.seqs, k), k);
+    }
+    if (qual) {
+      min.qual.assign(take(columns.quals, k), k);
+    }
+  }
+  return record;
+}
+
+} // namespace btllib
@@ -0,0 +1,164 @@
+#include "btllib/metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace btllib {
+
+static const char* const METRIC_NAMES[METRIC_COUNT] = {
+  "seqreader_bytes",
+  "seqreader_records",
+  "seqreader_reader_blocked_ns",
+  "seqreader_processor_blocked_ns",
+  "seqreader_consumer_blocked_ns",
+  "order_queue_writes",
+  "order_queue_reads",
+  "order_queue_write_wait_ns",
+  "order_queue_read_wait_ns",
+  "order_queue_occupancy",
+  "indexlr_kmers",
+  "indexlr_minimizers",
+  "indexlr_filter_rejects",
+  "bloom_filter_inserts",
+  "bloom_filter_queries",
+  "counting_bloom_filter_inserts",
+  "counting_bloom_filter_queries",
+  "counting_bloom_filter_cas_retries",
+};
+
+static const char* const METRIC_HELP[METRIC_COUNT] = {
+  "Bytes of header, sequence and quality parsed by SeqReaders.",
+  "Records parsed by SeqReaders.",
+  "Nanoseconds SeqReader reader threads waited for room for a block.",
+  "Nanoseconds SeqReader blocks waited to be converted.",
+  "Nanoseconds SeqReader consumers waited for a block.",
+  "Blocks written to order queues.",
+  "Blocks read from order queues.",
+  "Nanoseconds order queue writers waited for their slot.",
+  "Nanoseconds order queue readers waited for the next block.",
+  "Sum of order queue occupancy after each write.",
+  "K-mers hashed by Indexlr.",
+  "Minimizers output by Indexlr.",
+  "Indexlr minimizer candidates rejected by filters.",
+  "Elements inserted into Bloom filters.",
+  "Elements queried in Bloom filters.",
+  "Elements inserted into counting Bloom filters.",
+  "Counter lookups of counting Bloom filters.",
+  "Retried compare-and-swaps of counting Bloom filter inserts.",
+};
+
+// Shards of the live threads, and the totals of the threads that have exited
+static std::mutex&
+shards_mutex()
+{
+  static std::mutex var;
+  return var;
+}
+
+static std::vector<MetricsShard*>&
+live_shards()
+{
+  static std::vector<MetricsShard*> var;
+  return var;
+}
+
+static uint64_t*
+retired_values()
+{
+  static uint64_t var[METRIC_COUNT] = { 0 };
+  return var;
+}
+
+MetricsShard::MetricsShard()
+{
+  for (auto& value : values) {
+    value = 0;
+  }
+  const std::unique_lock<std::mutex> lock(shards_mutex());
+  live_shards().push_back(this);
+}
+
+MetricsShard::~MetricsShard()
+{
+  const std::unique_lock<std::mutex> lock(shards_mutex());
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    retired_values()[i] += values[i];
+  }
+  auto& shards = live_shards();
+  shards.erase(std::remove(shards.begin(), shards.end(), this), shards.end());
+}
+
+bool
+metrics_enabled()
+{
+#ifdef BTLLIB_METRICS
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint64_t
+get_metric(const Metric metric)
+{
+  const auto i = unsigned(metric);
+  const std::unique_lock<std::mutex> lock(shards_mutex());
+  uint64_t total = retired_values()[i];
+  for (const auto* shard : live_shards()) {
+    total += shard->values[i].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+const char*
+get_metric_name(const Metric metric)
+{
+  return METRIC_NAMES[unsigned(metric)];
+}
+
+void
+reset_metrics()
+{
+  const std::unique_lock<std::mutex> lock(shards_mutex());
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    retired_values()[i] = 0;
+    for (auto* shard : live_shards()) {
+      shard->values[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+std::string
+get_metrics_json()
+{
+  std::string json = "{";
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    if (i > 0) {
+      json += ", ";
+    }
+    json += '"' + std::string(METRIC_NAMES[i]) +
+            "\": " + std::to_string(get_metric(Metric(i)));
+  }
+  json += "}\n";
+  return json;
+}
+
+std::string
+get_metrics_prometheus()
+{
+  std::string text;
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    const std::string name =
+      "btllib_" + std::string(METRIC_NAMES[i]) + "_total";
+    text += "# HELP " + name + ' ' + METRIC_HELP[i] + '\n';
+    text += "# TYPE " + name + " counter\n";
+    text += name + ' ' + std::to_string(get_metric(Metric(i))) + '\n';
+  }
+  return text;
+}
+
+} // namespace btllib
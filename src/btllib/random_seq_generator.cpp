@@ -2,10 +2,33 @@
 #include "btllib/status.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <random>
+#include <string>
 
 namespace btllib {
 
+static uint64_t
+splitmix64(uint64_t& x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL; // NOLINT
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL; // NOLINT
+  return z ^ (z >> 31);                        // NOLINT
+}
+
+RandomEngine::RandomEngine(const uint64_t seed, const uint64_t stream)
+{
+  // The stream is mixed in on its own first, so that consecutive streams
+  // start from unrelated states
+  uint64_t x = stream;
+  x = seed ^ splitmix64(x);
+  for (auto& s : state) {
+    s = splitmix64(x);
+  }
+}
+
 RandomSequenceGenerator::RandomSequenceGenerator(SequenceType seq_type,
                                                  Masking masking)
 {
@@ -26,20 +49,85 @@ RandomSequenceGenerator::RandomSequenceGenerator(SequenceType seq_type,
   } else if (masking == Masking::HARD) {
     chars += seq_type == SequenceType::PROTEIN ? 'X' : 'N';
   }
+  // Alphabets of a power of two size take a fixed number of bits per
+  // character
+  for (unsigned bits = 1; bits <= 8; bits++) {
+    if (chars.size() == (size_t(1) << bits)) {
+      bits_per_char = bits;
+    }
+  }
+  if (bits_per_char == 2) {
+    char_quads.resize(256 * 4);
+    for (size_t byte = 0; byte < 256; byte++) {
+      for (size_t j = 0; j < 4; j++) {
+        char_quads[byte * 4 + j] = chars[(byte >> (2 * j)) & 3];
+      }
+    }
+  }
+}
+
+RandomSequenceGenerator::RandomSequenceGenerator(SequenceType seq_type,
+                                                 Masking masking,
+                                                 const uint64_t seed)
+  : RandomSequenceGenerator(seq_type, masking)
+{
+  seeded = true;
+  this->seed = seed;
 }
 
 std::string
 RandomSequenceGenerator::generate(size_t length)
 {
   std::string seq;
-  seq.reserve(length);
-  std::random_device rd;
-  std::default_random_engine rng(rd());
-  std::uniform_int_distribution<size_t> dist(0, chars.size() - 1);
-  for (size_t i = 0; i < length; i++) {
-    seq.append(std::string(1, chars[dist(rng)]));
+  if (seeded) {
+    RandomEngine rng(seed, calls++);
+    generate(length, rng, seq);
+  } else {
+    thread_local static RandomEngine rng((std::random_device())(),
+                                         std::random_device()());
+    generate(length, rng, seq);
   }
   return seq;
 }
 
-} // namespace btllib
\ No newline at end of file
+void
+RandomSequenceGenerator::generate(const size_t length,
+                                  RandomEngine& rng,
+                                  std::string& seq) const
+{
+  seq.resize(length);
+  char* const out = &seq[0];
+  size_t i = 0;
+  if (bits_per_char == 2) {
+    // Each byte of a draw is looked up as 4 characters at once
+    for (; i + 32 <= length; i += 32) {
+      uint64_t bits = rng();
+      for (size_t j = 0; j < 32; j += 4, bits >>= 8) {
+        std::memcpy(out + i + j, &char_quads[(bits & 0xff) * 4], 4);
+      }
+    }
+  }
+  if (bits_per_char > 0) {
+    const unsigned per_draw = 64 / bits_per_char;
+    const uint64_t mask = (uint64_t(1) << bits_per_char) - 1;
+    while (i < length) {
+      uint64_t bits = rng();
+      const size_t end = std::min(length, i + per_draw);
+      for (; i < end; i++, bits >>= bits_per_char) {
+        out[i] = chars[bits & mask];
+      }
+    }
+  } else {
+    // Each 32 bits of a draw are scaled down to the alphabet size
+    const uint64_t n = chars.size();
+    while (i < length) {
+      const uint64_t bits = rng();
+      out[i++] = chars[((bits & 0xffffffffULL) * n) >> 32];
+      if (i < length) {
+        out[i++] = chars[((bits >> 32) * n) >> 32];
+      }
+    }
+  }
+}
+
+} // namespace btllib
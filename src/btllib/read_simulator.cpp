@@ -0,0 +1,274 @@
+#include "btllib/read_simulator.hpp"
+#include "btllib/executor.hpp"
+#include "btllib/random_seq_generator.hpp"
+#include "btllib/seq.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/seq_writer.hpp"
+#include "btllib/status.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace btllib {
+
+static const char BASES[] = "ACGT";
+static const double PI = 3.14159265358979323846;
+
+static unsigned
+base_code(const char c)
+{
+  switch (c) {
+    case 'A':
+    case 'a':
+      return 0;
+    case 'C':
+    case 'c':
+      return 1;
+    case 'G':
+    case 'g':
+      return 2;
+    default:
+      return 3;
+  }
+}
+
+// Box-Muller transform, so that lengths do not depend on the standard library
+static double
+standard_normal(RandomEngine& rng)
+{
+  const double u1 = 1.0 - rng.uniform();
+  const double u2 = rng.uniform();
+  return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * PI * u2);
+}
+
+ReadLengthDistribution::ReadLengthDistribution(const Type type,
+                                               const double a,
+                                               const double b)
+  : type(type)
+  , a(a)
+  , b(b)
+{
+}
+
+ReadLengthDistribution
+ReadLengthDistribution::fixed(const size_t length)
+{
+  return ReadLengthDistribution(Type::FIXED, double(length), 0.0);
+}
+
+ReadLengthDistribution
+ReadLengthDistribution::uniform(const size_t min_length,
+                                const size_t max_length)
+{
+  check_error(min_length > max_length,
+              "ReadLengthDistribution: minimum length exceeds maximum length.");
+  return ReadLengthDistribution(
+    Type::UNIFORM, double(min_length), double(max_length));
+}
+
+ReadLengthDistribution
+ReadLengthDistribution::normal(const double mean, const double sd)
+{
+  check_error(sd < 0, "ReadLengthDistribution: negative standard deviation.");
+  return ReadLengthDistribution(Type::NORMAL, mean, sd);
+}
+
+ReadLengthDistribution
+ReadLengthDistribution::log_normal(const double mean, const double sd)
+{
+  check_error(mean <= 0, "ReadLengthDistribution: mean must be positive.");
+  check_error(sd < 0, "ReadLengthDistribution: negative standard deviation.");
+  // Parameters of the underlying normal distribution
+  const double sigma2 = std::log(1.0 + (sd * sd) / (mean * mean));
+  return ReadLengthDistribution(
+    Type::LOG_NORMAL, std::log(mean) - sigma2 / 2.0, std::sqrt(sigma2));
+}
+
+size_t
+ReadLengthDistribution::sample(RandomEngine& rng) const
+{
+  double length = 0;
+  switch (type) {
+    case Type::FIXED:
+      length = a;
+      break;
+    case Type::UNIFORM:
+      length = a + double(rng() % (uint64_t(b - a) + 1));
+      break;
+    case Type::NORMAL:
+      length = std::round(a + b * standard_normal(rng));
+      break;
+    case Type::LOG_NORMAL:
+      length = std::round(std::exp(a + b * standard_normal(rng)));
+      break;
+  }
+  return length < 1 ? 1 : size_t(length);
+}
+
+ReadSimulator::ReadSimulator(std::vector<std::string> references,
+                             const ReadLengthDistribution lengths,
+                             const uint64_t seed,
+                             const double substitution_rate,
+                             const double insertion_rate,
+                             const double deletion_rate,
+                             const bool both_strands)
+  : references(std::move(references))
+  , lengths(lengths)
+  , seed(seed)
+  , substitution_rate(substitution_rate)
+  , insertion_rate(insertion_rate)
+  , deletion_rate(deletion_rate)
+  , both_strands(both_strands)
+{
+  // Written so that NaN rates are rejected too
+  check_error(!(substitution_rate >= 0 && insertion_rate >= 0 &&
+                deletion_rate >= 0 &&
+                substitution_rate + insertion_rate + deletion_rate <= 1),
+              "ReadSimulator: invalid error rates.");
+  size_t total = 0;
+  for (const auto& reference : this->references) {
+    total += reference.size();
+    reference_ends.push_back(total);
+  }
+  check_error(total == 0, "ReadSimulator: no reference sequence to read.");
+}
+
+void
+ReadSimulator::simulate(const size_t num, SeqReader::Record& record) const
+{
+  RandomEngine rng(seed, num);
+  size_t read_len = lengths.sample(rng);
+
+  const uint64_t pos = rng() % reference_ends.back();
+  const size_t ref_idx =
+    std::upper_bound(reference_ends.begin(), reference_ends.end(), pos) -
+    reference_ends.begin();
+  const auto& reference = references[ref_idx];
+  read_len = std::min(read_len, reference.size());
+  const size_t start = rng() % (reference.size() - read_len + 1);
+  const bool reverse = both_strands && (rng() & 1U) == 1U;
+
+  const size_t end = start + add_errors(reference.data() + start,
+                                        reference.size() - start,
+                                        read_len,
+                                        rng,
+                                        record);
+  if (reverse) {
+    reverse_complement(record.seq);
+    std::reverse(record.qual.begin(), record.qual.end());
+  }
+
+  record.num = num;
+  record.id = std::to_string(num + 1);
+  record.comment = std::to_string(ref_idx) + ':' + std::to_string(start) +
+                   '-' + std::to_string(end) + ':' + (reverse ? '-' : '+');
+}
+
+// Reads up to read_len bases from ref and returns the number of reference
+// bases the read covers
+size_t
+ReadSimulator::add_errors(const char* const ref,
+                          const size_t ref_len,
+                          const size_t read_len,
+                          RandomEngine& rng,
+                          SeqReader::Record& record) const
+{
+  auto& seq = record.seq;
+  auto& qual = record.qual;
+  if (substitution_rate + insertion_rate + deletion_rate <= 0) {
+    seq.assign(ref, read_len);
+    qual.assign(read_len, QUAL_CORRECT);
+    return read_len;
+  }
+  seq.resize(read_len);
+  qual.resize(read_len);
+  size_t i = 0, j = 0;
+  while (j < read_len && i < ref_len) {
+    double u = rng.uniform();
+    if (u < deletion_rate) {
+      if (j == 0 && i + 1 == ref_len) {
+        // An empty read cannot be written, so the last base of the
+        // reference is kept
+        seq[j] = ref[i++];
+        qual[j++] = QUAL_CORRECT;
+      } else {
+        i++;
+      }
+      continue;
+    }
+    u -= deletion_rate;
+    if (u < insertion_rate) {
+      seq[j] = BASES[rng() & 3U];
+      qual[j++] = QUAL_ERROR;
+      continue;
+    }
+    u -= insertion_rate;
+    if (u < substitution_rate) {
+      seq[j] = BASES[(base_code(ref[i++]) + 1 + rng.below(3)) & 3U];
+      qual[j++] = QUAL_ERROR;
+      continue;
+    }
+    seq[j] = ref[i++];
+    qual[j++] = QUAL_CORRECT;
+  }
+  // Deletions at the end of the reference can leave the read short, but
+  // never empty
+  seq.resize(j);
+  qual.resize(j);
+  return i;
+}
+
+uint64_t
+ReadSimulator::write(SeqWriter& writer,
+                     const size_t count,
+                     const size_t first,
+                     Executor& executor) const
+{
+  // While a window of reads is written, the next one is simulated
+  const size_t window = BATCH_SIZE * 2 * executor.get_threads();
+  std::vector<SeqReader::Record> windows[2];
+  size_t sizes[2] = { 0, 0 };
+  TaskGroup group(executor);
+
+  const auto simulate_window = [&](const size_t w, const size_t start) {
+    sizes[w] = std::min(window, count - start);
+    windows[w].resize(sizes[w]);
+    auto* const records = windows[w].data();
+    for (size_t b = 0; b < sizes[w]; b += BATCH_SIZE) {
+      const size_t end = std::min(b + BATCH_SIZE, sizes[w]);
+      const size_t num = first + start;
+      group.run([this, records, b, end, num]() {
+        for (size_t i = b; i < end; i++) {
+          simulate(num + i, records[i]);
+        }
+      });
+    }
+  };
+
+  uint64_t bases = 0;
+  size_t start = 0;
+  size_t w = 0;
+  if (count > 0) {
+    simulate_window(w, start);
+  }
+  while (start < count) {
+    group.wait();
+    const size_t next = start + sizes[w];
+    if (next < count) {
+      simulate_window(1 - w, next);
+    }
+    writer.write_block(windows[w].data(), sizes[w]);
+    for (size_t i = 0; i < sizes[w]; i++) {
+      bases += windows[w][i].seq.size();
+    }
+    start = next;
+    w = 1 - w;
+  }
+  return bases;
+}
+
+} // namespace btllib
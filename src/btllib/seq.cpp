@@ -2,8 +2,16 @@
 #include "btllib/status.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
+#if defined(__x86_64__) || defined(__i386__)
+#define BTLLIB_SEQ_SIMD
+#include <immintrin.h>
+#endif
+
 namespace btllib {
 
 // clang-format off
@@ -72,13 +80,516 @@ const char CAPITALS[256] = {
 };
 // clang-format on
 
+// Lookup tables split by the high nibble of the character, so that SIMD
+// kernels can translate 16 characters at once with a byte shuffle. Only ASCII
+// characters are translated, the rest map to 0. Each table is repeated for
+// every 16 byte lane of the widest vector.
+struct SimdTable
+{
+  explicit SimdTable(const char* table)
+    : table(table)
+  {
+    for (unsigned hi = 0; hi < 8; hi++) {
+      bool used = false;
+      for (unsigned lo = 0; lo < 64; lo++) {
+        luts[count][lo] = table[hi * 16 + lo % 16];
+        used |= bool(luts[count][lo]);
+      }
+      if (used) {
+        his[count++] = char(hi);
+      }
+    }
+  }
+
+  const char* table;
+  unsigned count = 0;
+  char his[8] = { 0 };
+  char luts[8][64] = { { 0 } };
+};
+
+static const SimdTable COMPLEMENTS_SIMD(COMPLEMENTS);
+static const SimdTable CAPITALS_SIMD(CAPITALS);
+
+// Scalar kernels. Each returns the position of the first character it could
+// not translate, or len.
+
+static size_t
+translate_scalar(char* seq,
+                 const size_t len,
+                 const SimdTable& table,
+                 const bool stop_invalid,
+                 size_t i = 0)
+{
+  for (; i < len; i++) {
+    const char c = table.table[(unsigned char)(seq[i])];
+    if (stop_invalid && !bool(c)) {
+      return i;
+    }
+    seq[i] = c;
+  }
+  return len;
+}
+
+static size_t
+validate_scalar(const char* seq,
+                const size_t len,
+                const SimdTable& table,
+                size_t i = 0)
+{
+  for (; i < len; i++) {
+    if (!bool(table.table[(unsigned char)(seq[i])])) {
+      return i;
+    }
+  }
+  return len;
+}
+
+static void
+reverse_translate_scalar(char* seq,
+                         const size_t len,
+                         const SimdTable& table,
+                         const size_t i = 0)
+{
+  std::reverse(seq + i, seq + len - i);
+  translate_scalar(seq + i, len - 2 * i, table, false);
+}
+
+static bool
+is_masked(const char c)
+{
+  return c >= 'a' && c <= 'z';
+}
+
+static size_t
+masked_prefix_scalar(const char* seq, const size_t len, size_t i = 0)
+{
+  while (i < len && is_masked(seq[i])) {
+    i++;
+  }
+  return i;
+}
+
+static size_t
+masked_suffix_scalar(const char* seq, const size_t len, size_t i = 0)
+{
+  while (i < len && is_masked(seq[len - i - 1])) {
+    i++;
+  }
+  return i;
+}
+
+#ifdef BTLLIB_SEQ_SIMD
+
+#define BTLLIB_SSE4 __attribute__((target("sse4.1")))
+#define BTLLIB_AVX2 __attribute__((target("avx2")))
+#define BTLLIB_AVX512 __attribute__((target("avx512f,avx512bw")))
+#define BTLLIB_SIMD_INLINE inline __attribute__((always_inline))
+
+// Vector operations of each instruction set, used by the kernels below
+struct Sse4Ops
+{
+  using V = __m128i;
+  static const size_t WIDTH = 16;
+
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static V load(const char* p)
+  {
+    return _mm_loadu_si128((const __m128i*)p); // NOLINT
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static void store(char* p, const V v)
+  {
+    _mm_storeu_si128((__m128i*)p, v); // NOLINT
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static V set1(const char c)
+  {
+    return _mm_set1_epi8(c);
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static V nibble_lo(const V v)
+  {
+    return _mm_and_si128(v, set1(0x0f));
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static V nibble_hi(const V v)
+  {
+    return _mm_and_si128(_mm_srli_epi16(v, 4), set1(0x0f));
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static V lookup(const V r,
+                              const V lut,
+                              const V lo,
+                              const V hi,
+                              const V k)
+  {
+    return _mm_or_si128(
+      r, _mm_and_si128(_mm_shuffle_epi8(lut, lo), _mm_cmpeq_epi8(hi, k)));
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static V zero() { return _mm_setzero_si128(); }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static uint64_t zero_mask(const V v)
+  {
+    return uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero())));
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static uint64_t masked_mask(const V v)
+  {
+    const V x = _mm_sub_epi8(v, set1('a'));
+    return uint64_t(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, set1(25)), x)));
+  }
+  BTLLIB_SSE4 BTLLIB_SIMD_INLINE static V reverse(const V v)
+  {
+    return _mm_shuffle_epi8(
+      v, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+  }
+};
+
+struct Avx2Ops
+{
+  using V = __m256i;
+  static const size_t WIDTH = 32;
+
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static V load(const char* p)
+  {
+    return _mm256_loadu_si256((const __m256i*)p); // NOLINT
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static void store(char* p, const V v)
+  {
+    _mm256_storeu_si256((__m256i*)p, v); // NOLINT
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static V set1(const char c)
+  {
+    return _mm256_set1_epi8(c);
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static V nibble_lo(const V v)
+  {
+    return _mm256_and_si256(v, set1(0x0f));
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static V nibble_hi(const V v)
+  {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), set1(0x0f));
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static V lookup(const V r,
+                              const V lut,
+                              const V lo,
+                              const V hi,
+                              const V k)
+  {
+    return _mm256_or_si256(r,
+                           _mm256_and_si256(_mm256_shuffle_epi8(lut, lo),
+                                            _mm256_cmpeq_epi8(hi, k)));
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static V zero()
+  {
+    return _mm256_setzero_si256();
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static uint64_t zero_mask(const V v)
+  {
+    return uint64_t(
+      uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero()))));
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static uint64_t masked_mask(const V v)
+  {
+    const V x = _mm256_sub_epi8(v, set1('a'));
+    return uint64_t(uint32_t(_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_min_epu8(x, set1(25)), x))));
+  }
+  BTLLIB_AVX2 BTLLIB_SIMD_INLINE static V reverse(const V v)
+  {
+    const V in_lane = _mm256_shuffle_epi8(
+      v,
+      _mm256_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    return _mm256_permute4x64_epi64(in_lane, 0x4e);
+  }
+};
+
+struct Avx512Ops
+{
+  using V = __m512i;
+  static const size_t WIDTH = 64;
+
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static V load(const char* p)
+  {
+    return _mm512_loadu_si512(p);
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static void store(char* p, const V v)
+  {
+    _mm512_storeu_si512(p, v);
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static V set1(const char c)
+  {
+    return _mm512_set1_epi8(c);
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static V nibble_lo(const V v)
+  {
+    return _mm512_and_si512(v, set1(0x0f));
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static V nibble_hi(const V v)
+  {
+    return _mm512_and_si512(_mm512_srli_epi16(v, 4), set1(0x0f));
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static V lookup(const V r,
+                                const V lut,
+                                const V lo,
+                                const V hi,
+                                const V k)
+  {
+    return _mm512_mask_shuffle_epi8(
+      r, _mm512_cmpeq_epi8_mask(hi, k), lut, lo);
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static V zero()
+  {
+    return _mm512_setzero_si512();
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static uint64_t zero_mask(const V v)
+  {
+    return _mm512_cmpeq_epi8_mask(v, zero());
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static uint64_t masked_mask(const V v)
+  {
+    return _mm512_cmple_epu8_mask(_mm512_sub_epi8(v, set1('a')), set1(25));
+  }
+  BTLLIB_AVX512 BTLLIB_SIMD_INLINE static V reverse(const V v)
+  {
+    const V in_lane = _mm512_shuffle_epi8(
+      v,
+      _mm512_set_epi32(0x00010203,
+                       0x04050607,
+                       0x08090a0b,
+                       0x0c0d0e0f,
+                       0x00010203,
+                       0x04050607,
+                       0x08090a0b,
+                       0x0c0d0e0f,
+                       0x00010203,
+                       0x04050607,
+                       0x08090a0b,
+                       0x0c0d0e0f,
+                       0x00010203,
+                       0x04050607,
+                       0x08090a0b,
+                       0x0c0d0e0f));
+    // The unmasked form trips a maybe-uninitialized warning in GCC's headers
+    return _mm512_mask_shuffle_i64x2(in_lane, 0xff, in_lane, in_lane, 0x1b);
+  }
+};
+
+// The kernels are written once for all instruction sets. A function only
+// inlines vector operations of its own target, so every instruction set gets
+// its own copy of each kernel.
+#define BTLLIB_SEQ_KERNELS(OPS, TARGET)                                        \
+  /* Translate a vector through the lookup tables */                           \
+  TARGET BTLLIB_SIMD_INLINE static OPS::V translate_##OPS(                     \
+    const OPS::V v, const OPS::V* luts, const OPS::V* his, unsigned count)     \
+  {                                                                            \
+    const OPS::V lo = OPS::nibble_lo(v), hi = OPS::nibble_hi(v);               \
+    OPS::V r = OPS::zero();                                                    \
+    for (unsigned j = 0; j < count; j++) {                                     \
+      r = OPS::lookup(r, luts[j], lo, hi, his[j]);                             \
+    }                                                                          \
+    return r;                                                                  \
+  }                                                                            \
+                                                                               \
+  TARGET BTLLIB_SIMD_INLINE static void load_table_##OPS(                      \
+    const SimdTable& table, OPS::V* luts, OPS::V* his)                         \
+  {                                                                            \
+    for (unsigned j = 0; j < table.count; j++) {                               \
+      luts[j] = OPS::load(table.luts[j]);                                      \
+      his[j] = OPS::set1(table.his[j]);                                        \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  TARGET static size_t translate_kernel_##OPS(                                 \
+    char* seq, size_t len, const SimdTable& table, bool stop_invalid)          \
+  {                                                                            \
+    OPS::V luts[8], his[8];                                                    \
+    load_table_##OPS(table, luts, his);                                        \
+    size_t i = 0;                                                              \
+    for (; i + OPS::WIDTH <= len; i += OPS::WIDTH) {                           \
+      const OPS::V t =                                                         \
+        translate_##OPS(OPS::load(seq + i), luts, his, table.count);           \
+      if (stop_invalid && OPS::zero_mask(t) != 0) {                            \
+        break;                                                                 \
+      }                                                                        \
+      OPS::store(seq + i, t);                                                  \
+    }                                                                          \
+    return translate_scalar(seq, len, table, stop_invalid, i);                 \
+  }                                                                            \
+                                                                               \
+  TARGET static size_t validate_kernel_##OPS(                                  \
+    const char* seq, size_t len, const SimdTable& table)                       \
+  {                                                                            \
+    OPS::V luts[8], his[8];                                                    \
+    load_table_##OPS(table, luts, his);                                        \
+    size_t i = 0;                                                              \
+    for (; i + OPS::WIDTH <= len; i += OPS::WIDTH) {                           \
+      const OPS::V t =                                                         \
+        translate_##OPS(OPS::load(seq + i), luts, his, table.count);           \
+      if (OPS::zero_mask(t) != 0) {                                            \
+        break;                                                                 \
+      }                                                                        \
+    }                                                                          \
+    return validate_scalar(seq, len, table, i);                                \
+  }                                                                            \
+                                                                               \
+  TARGET static void reverse_translate_kernel_##OPS(                           \
+    char* seq, size_t len, const SimdTable& table)                             \
+  {                                                                            \
+    OPS::V luts[8], his[8];                                                    \
+    load_table_##OPS(table, luts, his);                                        \
+    size_t i = 0;                                                              \
+    /* Vectors from both ends are translated, reversed and swapped */          \
+    for (; len - 2 * i >= 2 * OPS::WIDTH; i += OPS::WIDTH) {                   \
+      char* const front = seq + i;                                             \
+      char* const back = seq + len - i - OPS::WIDTH;                           \
+      const OPS::V a = OPS::reverse(                                           \
+        translate_##OPS(OPS::load(front), luts, his, table.count));            \
+      const OPS::V b = OPS::reverse(                                           \
+        translate_##OPS(OPS::load(back), luts, his, table.count));             \
+      OPS::store(front, b);                                                    \
+      OPS::store(back, a);                                                     \
+    }                                                                          \
+    reverse_translate_scalar(seq, len, table, i);                              \
+  }                                                                            \
+                                                                               \
+  TARGET static size_t masked_prefix_kernel_##OPS(                             \
+    const char* seq, size_t len)                                               \
+  {                                                                            \
+    const uint64_t all = OPS::WIDTH == 64 ? ~uint64_t(0)                       \
+                                          : (uint64_t(1) << OPS::WIDTH) - 1;   \
+    size_t i = 0;                                                              \
+    for (; i + OPS::WIDTH <= len; i += OPS::WIDTH) {                           \
+      const uint64_t unmasked = ~OPS::masked_mask(OPS::load(seq + i)) & all;   \
+      if (unmasked != 0) {                                                     \
+        return i + __builtin_ctzll(unmasked);                                  \
+      }                                                                        \
+    }                                                                          \
+    return masked_prefix_scalar(seq, len, i);                                  \
+  }                                                                            \
+                                                                               \
+  TARGET static size_t masked_suffix_kernel_##OPS(                             \
+    const char* seq, size_t len)                                               \
+  {                                                                            \
+    const uint64_t all = OPS::WIDTH == 64 ? ~uint64_t(0)                       \
+                                          : (uint64_t(1) << OPS::WIDTH) - 1;   \
+    size_t i = 0;                                                              \
+    for (; i + OPS::WIDTH <= len; i += OPS::WIDTH) {                           \
+      const uint64_t unmasked =                                                \
+        ~OPS::masked_mask(OPS::load(seq + len - i - OPS::WIDTH)) & all;        \
+      if (unmasked != 0) {                                                     \
+        return i + OPS::WIDTH - 64 + __builtin_clzll(unmasked);                \
+      }                                                                        \
+    }                                                                          \
+    return masked_suffix_scalar(seq, len, i);                                  \
+  }
+
+BTLLIB_SEQ_KERNELS(Sse4Ops, BTLLIB_SSE4)
+BTLLIB_SEQ_KERNELS(Avx2Ops, BTLLIB_AVX2)
+BTLLIB_SEQ_KERNELS(Avx512Ops, BTLLIB_AVX512)
+
+#undef BTLLIB_SEQ_KERNELS
+#undef BTLLIB_SIMD_INLINE
+#undef BTLLIB_AVX512
+#undef BTLLIB_AVX2
+#undef BTLLIB_SSE4
+
+#endif
+
+static SimdLevel
+detect_simd_level()
+{
+#ifdef BTLLIB_SEQ_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    return SimdLevel::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return SimdLevel::SSE4;
+  }
+#endif
+  return SimdLevel::SCALAR;
+}
+
+static SimdLevel
+supported_simd_level()
+{
+  static const SimdLevel level = detect_simd_level();
+  return level;
+}
+
+static std::atomic<SimdLevel>&
+simd_level()
+{
+  static std::atomic<SimdLevel> level(supported_simd_level());
+  return level;
+}
+
+SimdLevel
+get_simd_level()
+{
+  return simd_level().load(std::memory_order_relaxed);
+}
+
+void
+set_simd_level(const SimdLevel level)
+{
+  simd_level().store(std::min(level, supported_simd_level()),
+                     std::memory_order_relaxed);
+}
+
+#ifdef BTLLIB_SEQ_SIMD
+#define BTLLIB_SEQ_DISPATCH(KERNEL, ...)                                       \
+  switch (get_simd_level()) {                                                  \
+    case SimdLevel::AVX512:                                                    \
+      return KERNEL##_kernel_Avx512Ops(__VA_ARGS__);                           \
+    case SimdLevel::AVX2:                                                      \
+      return KERNEL##_kernel_Avx2Ops(__VA_ARGS__);                             \
+    case SimdLevel::SSE4:                                                      \
+      return KERNEL##_kernel_Sse4Ops(__VA_ARGS__);                             \
+    default:                                                                   \
+      return KERNEL##_scalar(__VA_ARGS__);                                     \
+  }
+#else
+#define BTLLIB_SEQ_DISPATCH(KERNEL, ...) return KERNEL##_scalar(__VA_ARGS__);
+#endif
+
+static size_t
+translate(char* seq,
+          const size_t len,
+          const SimdTable& table,
+          const bool stop_invalid)
+{
+  BTLLIB_SEQ_DISPATCH(translate, seq, len, table, stop_invalid)
+}
+
+static size_t
+validate(const char* seq, const size_t len, const SimdTable& table)
+{
+  BTLLIB_SEQ_DISPATCH(validate, seq, len, table)
+}
+
+static void
+reverse_translate(char* seq, const size_t len, const SimdTable& table)
+{
+  BTLLIB_SEQ_DISPATCH(reverse_translate, seq, len, table)
+}
+
+static size_t
+masked_prefix(const char* seq, const size_t len)
+{
+  BTLLIB_SEQ_DISPATCH(masked_prefix, seq, len)
+}
+
+static size_t
+masked_suffix(const char* seq, const size_t len)
+{
+  BTLLIB_SEQ_DISPATCH(masked_suffix, seq, len)
+}
+
+#undef BTLLIB_SEQ_DISPATCH
+
 void
 reverse_complement(std::string& seq)
 {
-  std::reverse(seq.begin(), seq.end());
-  std::transform(seq.begin(), seq.end(), seq.begin(), [](char c) {
-    return COMPLEMENTS[(unsigned char)(c)];
-  });
+  reverse_translate(&seq[0], seq.size(), COMPLEMENTS_SIMD);
 }
 
 std::string
@@ -89,4 +600,51 @@ get_reverse_complement(const std::string& seq)
   return rc;
 }
 
-} // namespace btllib
\ No newline at end of file
+void
+complement(std::string& seq)
+{
+  translate(&seq[0], seq.size(), COMPLEMENTS_SIMD, false);
+}
+
+size_t
+fold_case(std::string& seq)
+{
+  const size_t i = translate(&seq[0], seq.size(), CAPITALS_SIMD, true);
+  return i == seq.size() ? std::string::npos : i;
+}
+
+size_t
+find_invalid_iupac(const std::string& seq)
+{
+  const size_t i = validate(seq.data(), seq.size(), COMPLEMENTS_SIMD);
+  return i == seq.size() ? std::string::npos : i;
+}
+
+void
+trim_masked(std::string& seq)
+{
+  const size_t start = masked_prefix(seq.data(), seq.size());
+  if (start == seq.size()) {
+    seq.clear();
+    return;
+  }
+  seq.erase(seq.size() - masked_suffix(seq.data(), seq.size()));
+  seq.erase(0, start);
+}
+
+void
+trim_masked(std::string& seq, std::string& qual)
+{
+  const size_t start = masked_prefix(seq.data(), seq.size());
+  const size_t end = start == seq.size()
+                       ? start
+                       : seq.size() - masked_suffix(seq.data(), seq.size());
+  seq.erase(end);
+  seq.erase(0, start);
+  if (!qual.empty()) {
+    qual.erase(std::min(end, qual.size()));
+    qual.erase(0, std::min(start, qual.size()));
+  }
+}
+
+} // namespace btllib
@@ -1,6 +1,7 @@
 #include "btllib/seq_reader.hpp"
 #include "btllib/cstring.hpp"
 #include "btllib/data_stream.hpp"
+#include "btllib/metrics.hpp"
 #include "btllib/order_queue.hpp"
 #include "btllib/seq.hpp"
 #include "btllib/status.hpp"
@@ -8,6 +9,7 @@
 #include <algorithm>
 #include <atomic>
 #include <cctype>
+#include <chrono>
 #include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
@@ -17,6 +19,7 @@
 #include <stack>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace btllib {
@@ -39,27 +42,77 @@ thread_local size_t
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 std::atomic<long> SeqReader::last_id(0);
 
+SeqReader::CStringBlock::CStringBlock(const size_t size)
+  : arena(new CStringArena())
+{
+  resize(size);
+}
+
+SeqReader::CStringBlock&
+SeqReader::CStringBlock::operator=(CStringBlock&& block) noexcept
+{
+  std::swap(data, block.data);
+  std::swap(arena, block.arena);
+  count = block.count;
+  num = block.num;
+  block.count = 0;
+  block.num = 0;
+  return *this;
+}
+
+void
+SeqReader::CStringBlock::resize(const size_t size)
+{
+  const auto old_size = data.size();
+  data.resize(size);
+  for (size_t i = old_size; i < size; i++) {
+    data[i].header.set_arena(arena.get());
+    data[i].seq.set_arena(arena.get());
+    data[i].qual.set_arena(arena.get());
+  }
+}
+
+void
+SeqReader::CStringBlock::recycle()
+{
+  arena->reset();
+  for (auto& record : data) {
+    record.header.set_arena(arena.get());
+    record.seq.set_arena(arena.get());
+    record.qual.set_arena(arena.get());
+  }
+}
+
 SeqReader::SeqReader(const std::string& source_path,
                      const unsigned flags,
                      const unsigned threads)
   : source_path(source_path)
-  , source(source_path)
+  , source(source_path, SeqReaderBamModule::is_bam_file(source_path))
   , flags(flags)
   , threads(threads)
-  , buffer_size(short_mode() ? SHORT_MODE_BUFFER_SIZE : LONG_MODE_BUFFER_SIZE)
-  , block_size(short_mode() ? SHORT_MODE_BLOCK_SIZE : LONG_MODE_BLOCK_SIZE)
-  , cstring_queue(buffer_size, block_size)
+  , buffer_size(auto_mode()    ? AUTO_MODE_BUFFER_SIZE
+                : short_mode() ? SHORT_MODE_BUFFER_SIZE
+                               : LONG_MODE_BUFFER_SIZE)
+  , block_size(auto_mode()    ? AUTO_MODE_BLOCK_SIZE
+               : short_mode() ? SHORT_MODE_BLOCK_SIZE
+                              : LONG_MODE_BLOCK_SIZE)
+  , block_bytes(auto_mode() ? AUTO_MODE_BLOCK_BYTES : 0)
   , output_queue(buffer_size, block_size)
   , id(++last_id)
+  , queue_depth(size_t(buffer_size))
 {
   // Parameter sanity check
-  check_error(!short_mode() && !long_mode(),
-              "SeqReader: no mode selected, either short or long mode flag "
-              "must be provided.");
-  check_error(short_mode() && long_mode(),
-              "SeqReader: short and long mode are mutually exclusive.");
+  check_error(!short_mode() && !long_mode() && !auto_mode(),
+              "SeqReader: no mode selected, either short, long, or auto mode "
+              "flag must be provided.");
+  check_error(int(short_mode()) + int(long_mode()) + int(auto_mode()) > 1,
+              "SeqReader: short, long, and auto mode are mutually exclusive.");
   check_error(threads == 0, "SeqReader: Number of helper threads cannot be 0.");
-  start_processors();
+  if (auto_mode()) {
+    queue_depth = std::min(size_t(buffer_size),
+                           std::max(size_t(AUTO_MODE_MIN_BUFFER_SIZE),
+                                    size_t(threads)));
+  }
   {
     std::unique_lock<std::mutex> lock(format_mutex);
     start_reader();
@@ -79,12 +132,13 @@ SeqReader::close() noexcept
   if (closed.compare_exchange_strong(closed_expected, true)) {
     try {
       reader_end = true;
-      output_queue.close();
-      for (auto& pt : processor_threads) {
-        pt->join();
+      {
+        const std::unique_lock<std::mutex> lock(room_mutex);
+        room_cv.notify_all();
       }
-      cstring_queue.close();
+      output_queue.close();
       reader_thread->join();
+      processing.wait();
       source.close();
     } catch (const std::system_error& e) {
       log_error("SeqReader thread join failure: " + std::string(e.what()));
@@ -98,24 +152,17 @@ SeqReader::load_buffer()
 {
   buffer.start = 0;
   const char last = buffer.end > 0 ? buffer.data[buffer.end - 1] : char(0);
-  buffer.end = 0;
-  do {
-    buffer.end += fread(buffer.data.data() + buffer.end,
-                        1,
-                        buffer.data.size() - buffer.end,
-                        source);
-  } while (buffer.end < buffer.data.size() && !bool(std::feof(source)));
-
-  if (bool(std::feof(source)) && !buffer.eof_newline_inserted) {
-    if (buffer.end < buffer.data.size()) {
-      if ((buffer.end == 0 && last != '\n') ||
-          (buffer.end > 0 && buffer.data[buffer.end - 1] != '\n')) {
-        buffer.data[buffer.end++] = '\n';
-      }
-      buffer.eof_newline_inserted = true;
-    } else if (buffer.data[buffer.data.size() - 1] == '\n') {
-      buffer.eof_newline_inserted = true;
+  // Nothing has been read through stdio yet, so the buffer is filled straight
+  // from the file descriptor
+  buffer.end = source.read(buffer.data.data(), buffer.data.size());
+  const bool at_end = buffer.end < buffer.data.size();
+
+  if (at_end && !buffer.eof_newline_inserted) {
+    if ((buffer.end == 0 && last != '\n') ||
+        (buffer.end > 0 && buffer.data[buffer.end - 1] != '\n')) {
+      buffer.data[buffer.end++] = '\n';
     }
+    buffer.eof_newline_inserted = true;
     return true;
   }
   return bool(buffer.end);
@@ -124,28 +171,23 @@ SeqReader::load_buffer()
 bool
 SeqReader::readline_buffer_append(CString& s)
 {
-  char c = char(0);
-  for (; buffer.start < buffer.end && (c = buffer.data[buffer.start]) != '\n';
-       ++buffer.start) {
-    if (s.s_size >= s.s_cap) {
-      s.change_cap(s.s_cap * 2);
-    }
-    s.s[s.s_size++] = c;
-  }
-  if (s.s_size >= s.s_cap) {
-    s.change_cap(s.s_cap * 2);
-  }
-  s.s[s.s_size] = '\0';
-  if (c == '\n') {
-    ++buffer.start;
-    return true;
+  const char* const start = buffer.data.data() + buffer.start;
+  const size_t len = buffer.end - buffer.start;
+  const auto* const newline = (const char*)std::memchr(start, '\n', len);
+  if (newline == nullptr) {
+    s.append(start, len);
+    buffer.start = buffer.end;
+    return false;
   }
-  return false;
+  s.append(start, newline - start);
+  buffer.start += newline - start + 1;
+  return true;
 }
 
 void
 SeqReader::readline_file(CString& s, FILE* f)
 {
+  s.make_heap();
   s.s_size = getline(&(s.s), &(s.s_cap), f);
 }
 
@@ -153,11 +195,9 @@ void
 SeqReader::readline_file_append(CString& s, FILE* f)
 {
   readline_file(tmp, f);
-  if (s.s_size + tmp.s_size + 1 > s.s_cap) {
-    s.change_cap(s.s_size + tmp.s_size + 1);
+  if (!tmp.empty()) {
+    s.append(tmp.s, tmp.s_size);
   }
-  memcpy(s.s + s.s_size, tmp.s, tmp.s_size + 1);
-  s.s_size += tmp.s_size;
 }
 
 bool
@@ -195,15 +235,127 @@ SeqReader::ungetc_buffer(const int c)
 }
 
 void
-SeqReader::update_cstring_records(OrderQueueSPMC<RecordCString>::Block& records,
-                                  size_t& counter)
+SeqReader::update_cstring_records(CStringBlock& records, size_t& counter)
 {
+  auto& record = records.data[records.count];
+  record.num = reader_record_num++;
+  reader_block_bytes +=
+    record.header.size() + record.seq.size() + record.qual.size();
   records.count++;
-  if (records.count == block_size) {
-    records.num = counter++;
-    cstring_queue.write(records);
-    records.num = 0;
-    records.count = 0;
+  if (records.count == block_size ||
+      (block_bytes > 0 && reader_block_bytes >= block_bytes)) {
+    write_cstring_records(records, counter);
+  } else if (records.count == records.data.size()) {
+    // Blocks in auto mode start small and grow up to block_size records
+    records.resize(std::min(2 * records.data.size(), size_t(block_size)));
+    reader_record = nullptr;
+  }
+}
+
+void
+SeqReader::write_cstring_records(CStringBlock& records, size_t& counter)
+{
+  const auto start = std::chrono::steady_clock::now();
+  wait_for_queue_room();
+  BTLLIB_METRIC_ADD(SEQREADER_BYTES, reader_block_bytes);
+  BTLLIB_METRIC_ADD(SEQREADER_RECORDS, records.count);
+  records.num = counter++;
+  submit_block(records);
+  reader_blocked_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  BTLLIB_METRIC_ADD_ELAPSED(SEQREADER_READER_BLOCKED_NS, start);
+  records.num = 0;
+  records.count = 0;
+
+  reader_total_bytes += reader_block_bytes;
+  reader_block_bytes = 0;
+  ++produced_blocks;
+  if (auto_mode() && produced_blocks % AUTO_MODE_ADAPT_PERIOD == 0) {
+    adapt_queue_depth();
+  }
+}
+
+void
+SeqReader::wait_for_queue_room()
+{
+  // Average block size bounds how many blocks fit into the memory budget
+  const size_t avg_block_bytes = std::max(
+    size_t(1), produced_blocks > 0 ? reader_total_bytes / produced_blocks : 1);
+  const size_t budget_depth =
+    std::max(size_t(1), size_t(AUTO_MODE_MEMORY_BUDGET) / avg_block_bytes);
+  const size_t depth = auto_mode()
+                         ? std::min(size_t(queue_depth), budget_depth)
+                         : size_t(queue_depth);
+  // Blocks are only handed to the executor while fewer than `threads` are
+  // being converted, so that a reader never takes more than its share of
+  // the workers
+  const auto room = [&]() {
+    return (produced_blocks - delivered_blocks < depth &&
+            processing_blocks < threads) ||
+           reader_end;
+  };
+  if (room()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(room_mutex);
+  reader_waiting = true;
+  room_cv.wait(lock, room);
+  reader_waiting = false;
+}
+
+void
+SeqReader::adapt_queue_depth()
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (produced_blocks == AUTO_MODE_ADAPT_PERIOD) {
+    last_adapt_time = now;
+    last_adapt_reader_blocked_ns = reader_blocked_ns;
+    last_adapt_consumer_blocked_ns = consumer_blocked_ns;
+    return;
+  }
+  const uint64_t elapsed =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_adapt_time)
+      .count();
+  const uint64_t reader_blocked = reader_blocked_ns;
+  const uint64_t consumer_blocked = consumer_blocked_ns;
+
+  // A side counts as stalled if it spent over 5% of the period blocked
+  const bool reader_stalled =
+    (reader_blocked - last_adapt_reader_blocked_ns) * 20 > elapsed;
+  const bool consumer_stalled =
+    (consumer_blocked - last_adapt_consumer_blocked_ns) * 20 > elapsed;
+
+  const size_t min_depth = std::min(
+    size_t(buffer_size),
+    std::max(size_t(AUTO_MODE_MIN_BUFFER_SIZE), size_t(threads)));
+  if (reader_stalled && consumer_stalled) {
+    // Both sides wait on each other in turns, so the workload is bursty and
+    // a deeper queue can absorb it.
+    queue_depth = std::min(size_t(buffer_size), 2 * queue_depth);
+  } else if (reader_stalled) {
+    // Consumers are the bottleneck and extra blocks in flight only hold memory.
+    queue_depth = std::max(min_depth, queue_depth - 1);
+  }
+
+  last_adapt_time = now;
+  last_adapt_reader_blocked_ns = reader_blocked;
+  last_adapt_consumer_blocked_ns = consumer_blocked;
+}
+
+void
+SeqReader::block_delivered()
+{
+  ++delivered_blocks;
+  notify_room();
+}
+
+void
+SeqReader::notify_room()
+{
+  if (reader_waiting) {
+    const std::unique_lock<std::mutex> lock(room_mutex);
+    room_cv.notify_one();
   }
 }
 
@@ -240,6 +392,7 @@ SeqReader::determine_format()
   BTLLIB_SEQREADER_FORMAT_CHECK(FASTA, multiline_fasta_module)
   BTLLIB_SEQREADER_FORMAT_CHECK(FASTQ, fastq_module)
   BTLLIB_SEQREADER_FORMAT_CHECK(FASTQ, multiline_fastq_module)
+  BTLLIB_SEQREADER_FORMAT_CHECK(SAM, bam_module)
   BTLLIB_SEQREADER_FORMAT_CHECK(SAM, sam_module)
   BTLLIB_SEQREADER_FORMAT_CHECK(GFA2, gfa2_module)
   {
@@ -260,7 +413,7 @@ SeqReader::start_reader()
     }
 
     size_t counter = 0;
-    decltype(cstring_queue)::Block records(block_size);
+    CStringBlock records(initial_block_size());
 
     if (get_format() != Format::UNDETERMINED) {
       int module_counter = 0;
@@ -269,6 +422,7 @@ SeqReader::start_reader()
       BTLLIB_SEQREADER_FORMAT_READ(multiline_fasta_module)
       BTLLIB_SEQREADER_FORMAT_READ(fastq_module)
       BTLLIB_SEQREADER_FORMAT_READ(multiline_fastq_module)
+      BTLLIB_SEQREADER_FORMAT_READ(bam_module)
       BTLLIB_SEQREADER_FORMAT_READ(sam_module)
       BTLLIB_SEQREADER_FORMAT_READ(gfa2_module)
       {
@@ -277,20 +431,18 @@ SeqReader::start_reader()
       }
     }
 
-    reader_end = true;
     if (records.count > 0) {
-      records.num = counter++;
-      cstring_queue.write(records);
+      write_cstring_records(records, counter);
     }
-    for (unsigned i = 0; i < threads; i++) {
-      if (i == 0) {
-        dummy_block_num = counter;
-      }
-      decltype(cstring_queue)::Block dummy(block_size);
-      dummy.num = counter++;
-      dummy.count = 0;
-      cstring_queue.write(dummy);
+    reader_end = true;
+    {
+      const std::unique_lock<std::mutex> lock(room_mutex);
+      room_cv.notify_all();
     }
+    // Blocks before it are written by the tasks converting them, in order
+    OutputBlock end_block(0);
+    end_block.num = counter;
+    output_queue.write(end_block);
   }));
 }
 
@@ -298,133 +450,149 @@ SeqReader::start_reader()
 #undef BTLLIB_SEQREADER_FORMAT_READ
 
 void
-SeqReader::start_processors()
+SeqReader::submit_block(CStringBlock& records)
+{
+  std::unique_ptr<CStringBlock> block_in;
+  std::unique_ptr<OutputBlock> block_out;
+  {
+    const std::unique_lock<std::mutex> lock(free_blocks_mutex);
+    if (!free_cstring_blocks.empty()) {
+      block_in = std::move(free_cstring_blocks.back());
+      free_cstring_blocks.pop_back();
+    }
+    if (!free_output_blocks.empty()) {
+      block_out = std::move(free_output_blocks.back());
+      free_output_blocks.pop_back();
+    }
+  }
+  if (!block_in) {
+    block_in.reset(new CStringBlock(0));
+  }
+  if (!block_out) {
+    block_out.reset(new OutputBlock(block_size));
+  }
+  // The reader carries on with the records and arena of a previously
+  // converted block, so their memory is reused
+  *block_in = std::move(records);
+  records.recycle();
+  if (records.data.size() < initial_block_size()) {
+    records.resize(initial_block_size());
+  }
+
+  ++processing_blocks;
+  auto* const records_in = block_in.release();
+  auto* const records_out = block_out.release();
+  const auto queued = std::chrono::steady_clock::now();
+  processing.run([this, records_in, records_out, queued]() {
+    processors_blocked_ns +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - queued)
+        .count();
+    BTLLIB_METRIC_ADD_ELAPSED(SEQREADER_PROCESSOR_BLOCKED_NS, queued);
+    process_block(*records_in, *records_out);
+    output_queue.write(*records_out);
+    {
+      const std::unique_lock<std::mutex> lock(free_blocks_mutex);
+      free_cstring_blocks.push_back(std::unique_ptr<CStringBlock>(records_in));
+      free_output_blocks.push_back(std::unique_ptr<OutputBlock>(records_out));
+    }
+    --processing_blocks;
+    notify_room();
+  });
+}
+
+void
+SeqReader::process_block(CStringBlock& records_in, OutputBlock& records_out)
 {
-  processor_threads.reserve(threads);
-  for (unsigned i = 0; i < threads; i++) {
-    processor_threads.push_back(
-      std::unique_ptr<std::thread>(new std::thread([this]() {
-        decltype(cstring_queue)::Block records_in(block_size);
-        decltype(output_queue)::Block records_out(block_size);
-        for (;;) {
-          cstring_queue.read(records_in);
-          for (size_t i = 0; i < records_in.count; i++) {
-            records_out.data[i].seq = std::string(
-              records_in.data[i].seq, records_in.data[i].seq.size());
-            auto& seq = records_out.data[i].seq;
-            rtrim(seq);
-
-            records_out.data[i].qual = std::string(
-              records_in.data[i].qual, records_in.data[i].qual.size());
-            auto& qual = records_out.data[i].qual;
-            rtrim(qual);
-
-            char *first_whitespace = nullptr, *last_whitespace = nullptr;
-            for (size_t j = 0; j < records_in.data[i].header.size(); j++) {
-              if (bool(std::isspace(records_in.data[i].header[j]))) {
-                if (first_whitespace == nullptr) {
-                  first_whitespace = records_in.data[i].header + j;
-                }
-                last_whitespace = records_in.data[i].header + j;
-              } else if (last_whitespace != nullptr) {
-                break;
-              }
-            }
-            const size_t id_start =
-              (format == Format::FASTA || format == Format::FASTQ ||
-               format == Format::SAM)
-                ? 1
-                : 0;
-
-            switch (format) {
-              case Format::FASTA:
-                check_error(records_in.data[i].header.empty(),
-                            "SeqReader: Invalid FASTA header");
-                check_error(records_in.data[i].header[0] != '>',
-                            "SeqReader: Unexpected character in a FASTA file.");
-                break;
-              case Format::FASTQ:
-                check_error(records_in.data[i].header.empty(),
-                            "SeqReader: Invalid FASTQ header");
-                check_error(records_in.data[i].header[0] != '@',
-                            "SeqReader: Unexpected character in a FASTQ file.");
-                break;
-              default:
-                break;
-            }
-
-            if (!qual.empty()) {
-              check_error(qual.size() != seq.size(),
-                          "SeqReader: Quality string length (" +
-                            std::to_string(qual.size()) +
-                            ") does not match "
-                            "sequence length (" +
-                            std::to_string(seq.size()) + ").");
-            }
-
-            if (first_whitespace == nullptr) {
-              records_out.data[i].id =
-                std::string(records_in.data[i].header + id_start,
-                            records_in.data[i].header.size() - id_start);
-              records_out.data[i].comment = "";
-            } else {
-              records_out.data[i].id = std::string(
-                records_in.data[i].header + id_start,
-                first_whitespace - records_in.data[i].header - id_start);
-              records_out.data[i].comment = std::string(
-                last_whitespace + 1,
-                records_in.data[i].header.size() -
-                  (last_whitespace - records_in.data[i].header) - 1);
-            }
-            records_in.data[i].header.clear();
-
-            auto& id = records_out.data[i].id;
-            auto& comment = records_out.data[i].comment;
-            rtrim(id);
-            rtrim(comment);
-
-            if (trim_masked()) {
-              const auto len = seq.length();
-              size_t trim_start = 0, trim_end = seq.length();
-              while (trim_start <= len && bool(islower(seq[trim_start]))) {
-                trim_start++;
-              }
-              while (trim_end > 0 && bool(islower(seq[trim_end - 1]))) {
-                trim_end--;
-              }
-              seq.erase(trim_end);
-              seq.erase(0, trim_start);
-              if (!qual.empty()) {
-                qual.erase(trim_end);
-                qual.erase(0, trim_start);
-              }
-            }
-            if (fold_case()) {
-              for (auto& c : seq) {
-                const char old = c;
-                c = CAPITALS[(unsigned char)(c)];
-                if (!bool(c)) {
-                  log_error(std::string("A sequence contains invalid "
-                                        "IUPAC character: ") +
-                            old);
-                  std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
-                }
-              }
-            }
-            records_out.data[i].num = records_in.num * block_size + i;
-          }
-          records_out.count = records_in.count;
-          records_out.num = records_in.num;
-          if (records_out.count == 0) {
-            if (records_out.num == dummy_block_num) {
-              output_queue.write(records_out);
-            }
-            break;
-          }
-          output_queue.write(records_out);
+  for (size_t i = 0; i < records_in.count; i++) {
+    records_out.data[i].seq =
+      std::string(records_in.data[i].seq, records_in.data[i].seq.size());
+    auto& seq = records_out.data[i].seq;
+    rtrim(seq);
+
+    records_out.data[i].qual =
+      std::string(records_in.data[i].qual, records_in.data[i].qual.size());
+    auto& qual = records_out.data[i].qual;
+    rtrim(qual);
+
+    char *first_whitespace = nullptr, *last_whitespace = nullptr;
+    for (size_t j = 0; j < records_in.data[i].header.size(); j++) {
+      if (bool(std::isspace(records_in.data[i].header[j]))) {
+        if (first_whitespace == nullptr) {
+          first_whitespace = records_in.data[i].header + j;
         }
-      })));
+        last_whitespace = records_in.data[i].header + j;
+      } else if (last_whitespace != nullptr) {
+        break;
+      }
+    }
+    const size_t id_start = (format == Format::FASTA ||
+                             format == Format::FASTQ || format == Format::SAM)
+                              ? 1
+                              : 0;
+
+    switch (format) {
+      case Format::FASTA:
+        check_error(records_in.data[i].header.empty(),
+                    "SeqReader: Invalid FASTA header");
+        check_error(records_in.data[i].header[0] != '>',
+                    "SeqReader: Unexpected character in a FASTA file.");
+        break;
+      case Format::FASTQ:
+        check_error(records_in.data[i].header.empty(),
+                    "SeqReader: Invalid FASTQ header");
+        check_error(records_in.data[i].header[0] != '@',
+                    "SeqReader: Unexpected character in a FASTQ file.");
+        break;
+      default:
+        break;
+    }
+
+    if (!qual.empty()) {
+      check_error(qual.size() != seq.size(),
+                  "SeqReader: Quality string length (" +
+                    std::to_string(qual.size()) +
+                    ") does not match "
+                    "sequence length (" +
+                    std::to_string(seq.size()) + ").");
+    }
+
+    if (first_whitespace == nullptr) {
+      records_out.data[i].id =
+        std::string(records_in.data[i].header + id_start,
+                    records_in.data[i].header.size() - id_start);
+      records_out.data[i].comment = "";
+    } else {
+      records_out.data[i].id = std::string(
+        records_in.data[i].header + id_start,
+        first_whitespace - records_in.data[i].header - id_start);
+      records_out.data[i].comment = std::string(
+        last_whitespace + 1,
+        records_in.data[i].header.size() -
+          (last_whitespace - records_in.data[i].header) - 1);
+    }
+    records_in.data[i].header.clear();
+
+    auto& id = records_out.data[i].id;
+    auto& comment = records_out.data[i].comment;
+    rtrim(id);
+    rtrim(comment);
+
+    if (trim_masked()) {
+      btllib::trim_masked(seq, qual);
+    }
+    if (fold_case()) {
+      const auto invalid = btllib::fold_case(seq);
+      if (invalid != std::string::npos) {
+        log_error(std::string("A sequence contains invalid IUPAC character: ") +
+                  seq[invalid]);
+        std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+      }
+    }
+    records_out.data[i].num = records_in.data[i].num;
   }
+  records_out.count = records_in.count;
+  records_out.num = records_in.num;
 }
 
 SeqReader::Record
@@ -442,7 +610,15 @@ SeqReader::read()
   auto& current = ready_records_current[id % MAX_SIMULTANEOUS_SEQREADERS];
   if (current >= ready_records.count) {
     ready_records.count = 0;
+    const auto start = std::chrono::steady_clock::now();
     output_queue.read(ready_records);
+    consumer_blocked_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    BTLLIB_METRIC_ADD_ELAPSED(SEQREADER_CONSUMER_BLOCKED_NS, start);
+    if (ready_records.count > 0) {
+      block_delivered();
+    }
     if (ready_records.count == 0) {
       close();
       ready_records = decltype(output_queue)::Block(block_size);
@@ -457,7 +633,15 @@ OrderQueueMPMC<SeqReader::Record>::Block
 SeqReader::read_block()
 {
   decltype(SeqReader::read_block()) block(block_size);
+  const auto start = std::chrono::steady_clock::now();
   output_queue.read(block);
+  consumer_blocked_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  BTLLIB_METRIC_ADD_ELAPSED(SEQREADER_CONSUMER_BLOCKED_NS, start);
+  if (block.count > 0) {
+    block_delivered();
+  }
   if (block.count == 0) {
     close();
   }
@@ -0,0 +1,208 @@
+#include "btllib/seq_reader_bam_module.hpp"
+#include "btllib/bgzf.hpp"
+#include "btllib/cstring.hpp"
+#include "btllib/status.hpp"
+#include "btllib/util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <zlib.h>
+
+namespace btllib {
+
+static const char BAM_MAGIC[] = { 'B', 'A', 'M', 1 };
+static const size_t BAM_MAGIC_SIZE = 4;
+
+// Size of the fixed length part of an alignment, after block_size
+static const size_t ALIGNMENT_CORE_SIZE = 32;
+
+static const char BAM_BASES[] = "=ACMGRSVTWYHKDBN";
+
+// Pairs of bases encoded by each byte, so that a byte of a BAM sequence is
+// decoded with a single lookup
+struct BamBasePairs
+{
+  BamBasePairs()
+  {
+    for (unsigned i = 0; i < 256; i++) {
+      pairs[i][0] = BAM_BASES[i >> 4];
+      pairs[i][1] = BAM_BASES[i & 0xF];
+    }
+  }
+
+  char pairs[256][2];
+};
+
+static const BamBasePairs BAM_BASE_PAIRS;
+
+// Complementary base codes are bit reversed: A = 1, C = 2, G = 4, T = 8
+static const char BAM_COMPLEMENT_BASES[] = "=TGKCYSBAWRDMHVN";
+
+static uint16_t
+read_le16(const char* p)
+{
+  const auto* u = reinterpret_cast<const unsigned char*>(p);
+  return uint16_t(u[0] | (u[1] << 8));
+}
+
+static uint32_t
+read_le32(const char* p)
+{
+  const auto* u = reinterpret_cast<const unsigned char*>(p);
+  return uint32_t(u[0]) | (uint32_t(u[1]) << 8) | (uint32_t(u[2]) << 16) |
+         (uint32_t(u[3]) << 24);
+}
+
+static void
+reserve(CString& s, const size_t size)
+{
+  if (size + 1 > s.s_cap) {
+    s.change_cap(size + 1);
+  }
+  s.s_size = size;
+  s.s[size] = '\0';
+}
+
+bool
+SeqReaderBamModule::is_bam_file(const std::string& path)
+{
+  return endswith(path, ".bam") && is_bgzf(path);
+}
+
+bool
+SeqReaderBamModule::buffer_valid(const char* buffer, const size_t size)
+{
+  if (!is_bgzf(buffer, size)) {
+    return false;
+  }
+  // The buffer may hold only part of the first block, which is enough to
+  // inflate the magic string
+  const size_t csize = std::min(size_t(bgzf_block_csize(buffer)), size);
+  char magic[BAM_MAGIC_SIZE];
+  z_stream zs{};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(buffer)) +
+               BGZF_HEADER_SIZE;
+  zs.avail_in = uInt(csize - BGZF_HEADER_SIZE);
+  zs.next_out = reinterpret_cast<Bytef*>(magic);
+  zs.avail_out = uInt(BAM_MAGIC_SIZE);
+  if (inflateInit2(&zs, -15) != Z_OK) {
+    return false;
+  }
+  inflate(&zs, Z_SYNC_FLUSH);
+  const size_t inflated = zs.total_out;
+  inflateEnd(&zs);
+  return inflated == BAM_MAGIC_SIZE &&
+         std::memcmp(magic, BAM_MAGIC, BAM_MAGIC_SIZE) == 0;
+}
+
+void
+SeqReaderBamModule::read_exact(char* out, const size_t size)
+{
+  check_error(bgzf->read(out, size) != size,
+              "SeqReader BAM module: unexpected end of file.");
+}
+
+void
+SeqReaderBamModule::read_header()
+{
+  char buf[BAM_MAGIC_SIZE];
+  read_exact(buf, BAM_MAGIC_SIZE);
+  check_error(std::memcmp(buf, BAM_MAGIC, BAM_MAGIC_SIZE) != 0,
+              "SeqReader BAM module: invalid BAM magic string.");
+
+  // Skip the SAM header text and the reference sequence dictionary
+  read_exact(buf, 4);
+  alignment.resize(read_le32(buf));
+  read_exact(alignment.data(), alignment.size());
+  read_exact(buf, 4);
+  const auto n_ref = read_le32(buf);
+  for (uint32_t i = 0; i < n_ref; i++) {
+    read_exact(buf, 4);
+    alignment.resize(read_le32(buf) + 4);
+    read_exact(alignment.data(), alignment.size());
+  }
+}
+
+bool
+SeqReaderBamModule::read_alignment(CString& header, CString& seq, CString& qual)
+{
+  for (;;) {
+    char buf[4];
+    const auto bytes = bgzf->read(buf, 4);
+    if (bytes == 0) {
+      return false;
+    }
+    check_error(bytes != 4, "SeqReader BAM module: unexpected end of file.");
+    const auto block_size = read_le32(buf);
+    check_error(block_size < ALIGNMENT_CORE_SIZE,
+                "SeqReader BAM module: invalid alignment size.");
+    alignment.resize(block_size);
+    read_exact(alignment.data(), block_size);
+
+    const char* const core = alignment.data();
+    const size_t l_read_name = uint8_t(core[8]);
+    const size_t n_cigar_op = read_le16(core + 12);
+    const auto flag = read_le16(core + 14);
+    const size_t l_seq = read_le32(core + 16);
+    check_error(ALIGNMENT_CORE_SIZE + l_read_name + 4 * n_cigar_op +
+                    (l_seq + 1) / 2 + l_seq >
+                  block_size,
+                "SeqReader BAM module: invalid alignment size.");
+    if ((flag & (FLAG_SECONDARY | FLAG_SUPPLEMENTARY)) != 0 || l_seq == 0) {
+      continue;
+    }
+
+    const char* const read_name = core + ALIGNMENT_CORE_SIZE;
+    const char* const packed_seq = read_name + l_read_name + 4 * n_cigar_op;
+    const char* const packed_qual = packed_seq + (l_seq + 1) / 2;
+
+    // l_read_name includes the terminating null character
+    const size_t name_size = l_read_name > 0 ? l_read_name - 1 : 0;
+    const char* suffix = "";
+    if ((flag & FLAG_READ1) != 0 && (flag & FLAG_READ2) == 0) {
+      suffix = "/1";
+    } else if ((flag & FLAG_READ2) != 0 && (flag & FLAG_READ1) == 0) {
+      suffix = "/2";
+    }
+    const size_t suffix_size = std::strlen(suffix);
+    reserve(header, 1 + name_size + suffix_size);
+    header.s[0] = '@';
+    std::memcpy(header.s + 1, read_name, name_size);
+    std::memcpy(header.s + 1 + name_size, suffix, suffix_size);
+
+    reserve(seq, l_seq);
+    reserve(qual, l_seq);
+    const auto* const codes = reinterpret_cast<const uint8_t*>(packed_seq);
+    const auto* const quals = reinterpret_cast<const uint8_t*>(packed_qual);
+    const bool has_qual = quals[0] != 0xFF;
+    if ((flag & FLAG_REVERSE) != 0) {
+      for (size_t i = 0; i < l_seq; i++) {
+        const auto code = (codes[i / 2] >> ((~i & 1) * 4)) & 0xF;
+        seq.s[l_seq - 1 - i] = BAM_COMPLEMENT_BASES[code];
+        qual.s[l_seq - 1 - i] =
+          has_qual ? char(quals[i] + '!') : DEFAULT_QUAL;
+      }
+    } else {
+      for (size_t i = 0; i < l_seq / 2; i++) {
+        std::memcpy(seq.s + 2 * i, BAM_BASE_PAIRS.pairs[codes[i]], 2);
+      }
+      if (l_seq % 2 == 1) {
+        seq.s[l_seq - 1] = BAM_BASES[codes[l_seq / 2] >> 4];
+      }
+      if (has_qual) {
+        for (size_t i = 0; i < l_seq; i++) {
+          qual.s[i] = char(quals[i] + '!');
+        }
+      } else {
+        std::memset(qual.s, DEFAULT_QUAL, l_seq);
+      }
+    }
+    return true;
+  }
+}
+
+} // namespace btllib
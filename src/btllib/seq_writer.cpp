@@ -1,77 +1,238 @@
 #include "btllib/seq_writer.hpp"
+#include "btllib/bgzf.hpp"
 #include "btllib/data_stream.hpp"
 #include "btllib/seq.hpp"
 #include "btllib/status.hpp"
+#include "btllib/util.hpp"
 
+#include <algorithm>
 #include <cstdio>
+#include <functional>
 #include <mutex>
 #include <string>
+#include <system_error>
+#include <thread>
 
 namespace btllib {
 
-SeqWriter::SeqWriter(const std::string& sink_path, Format format, bool append)
+static bool
+compress_in_process(const std::string& sink_path, const unsigned threads)
+{
+  return threads > 0 && sink_path != "-" && endswith(sink_path, ".gz");
+}
+
+SeqWriter::SeqWriter(const std::string& sink_path,
+                     Format format,
+                     bool append,
+                     const unsigned threads)
   : sink_path(sink_path)
-  , sink(sink_path, append)
-  , closed(false)
+  , compress(compress_in_process(sink_path, threads))
+  , sink(sink_path, append, compress)
   , format(format)
   , headerchar(format == FASTA ? '>' : '@')
+  , threads(threads)
+  , staging(new Staging[STAGING_BUFFERS])
+  , raw_queue(QUEUE_SIZE, 1)
+  , output_queue(QUEUE_SIZE, 1)
+{
+  if (compress) {
+    start_compressors();
+  }
+  start_flusher();
+}
+
+SeqWriter::~SeqWriter()
 {
+  close();
 }
 
 void
 SeqWriter::close()
 {
-  if (!closed) {
+  bool closed_expected = false;
+  if (closed.compare_exchange_strong(closed_expected, true)) {
+    for (size_t i = 0; i < STAGING_BUFFERS; i++) {
+      const std::unique_lock<std::mutex> lock(staging[i].mutex);
+      if (!staging[i].buffer.empty()) {
+        submit(staging[i].buffer);
+      }
+    }
+
+    // End of output markers, one per thread reading them
+    end_num = size_t(next_chunk_num);
+    const unsigned markers = compress ? threads : 1;
+    for (unsigned i = 0; i < markers; i++) {
+      OrderQueueMPMC<std::string>::Block marker(1);
+      marker.num = next_chunk_num++;
+      if (compress) {
+        raw_queue.write(marker);
+      } else {
+        output_queue.write(marker);
+      }
+    }
+
+    try {
+      for (auto& compressor : compressor_threads) {
+        compressor->join();
+      }
+      flusher_thread->join();
+    } catch (const std::system_error& e) {
+      log_error("SeqWriter thread join failure: " + std::string(e.what()));
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
     sink.close();
-    closed = true;
   }
 }
 
+SeqWriter::Staging&
+SeqWriter::get_staging()
+{
+  return staging[std::hash<std::thread::id>()(std::this_thread::get_id()) %
+                 STAGING_BUFFERS];
+}
+
 void
-SeqWriter::write(const std::string& id,
-                 const std::string& comment,
-                 const std::string& seq,
-                 const std::string& qual)
+SeqWriter::format_record(std::string& out,
+                         const std::string& id,
+                         const std::string& comment,
+                         const std::string& seq,
+                         const std::string& qual) const
 {
   check_error(seq.empty(), "Attempted to write empty sequence.");
-  for (const auto& c : seq) {
-    if (!bool(COMPLEMENTS[(unsigned char)(c)])) {
-      log_error(std::string("A sequence contains invalid IUPAC character: ") +
-                c);
-      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
-    }
+  const auto invalid = find_invalid_iupac(seq);
+  if (invalid != std::string::npos) {
+    log_error(std::string("A sequence contains invalid IUPAC character: ") +
+              seq[invalid]);
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
   }
-
-  std::string output;
-  output.reserve(1 + id.size() + 1 + comment.size() + 1 + seq.size() + 3 +
-                 qual.size() + 1);
-  output += headerchar;
-  if (!id.empty()) {
-    output += id;
+  if (format == FASTQ) {
+    check_error(seq.size() != qual.size(),
+                "Quality must be the same length as sequence.");
   }
+
+  out += headerchar;
+  out += id;
   if (!comment.empty()) {
-    output += " ";
-    output += comment;
+    out += ' ';
+    out += comment;
   }
-  output += '\n';
+  out += '\n';
 
-  output += seq;
-  output += '\n';
+  out += seq;
+  out += '\n';
 
   if (format == FASTQ) {
-    check_error(seq.size() != qual.size(),
-                "Quality must be the same length as sequence.");
-    output += "+\n";
-    output += qual;
-    output += '\n';
+    out += "+\n";
+    out += qual;
+    out += '\n';
   }
+}
+
+void
+SeqWriter::submit(std::string& chunk)
+{
+  OrderQueueMPMC<std::string>::Block block(1);
+  std::swap(block.data[0], chunk);
+  block.count = 1;
+  block.num = next_chunk_num++;
+  if (compress) {
+    raw_queue.write(block);
+  } else {
+    output_queue.write(block);
+  }
+  // Reuse the buffer that the queue handed back
+  std::swap(chunk, block.data[0]);
+  chunk.clear();
+}
+
+void
+SeqWriter::write(const std::string& id,
+                 const std::string& comment,
+                 const std::string& seq,
+                 const std::string& qual)
+{
+  check_error(closed, "SeqWriter: Attempted to write to a closed writer.");
+  auto& stage = get_staging();
+  const std::unique_lock<std::mutex> lock(stage.mutex);
+  format_record(stage.buffer, id, comment, seq, qual);
+  if (stage.buffer.size() >= CHUNK_SIZE) {
+    submit(stage.buffer);
+  }
+}
 
-  {
-    const std::unique_lock<std::mutex> lock(mutex);
-    if (fwrite(output.c_str(), 1, output.size(), sink) != output.size()) {
-      log_error("SeqWriter: fwrite failed: " + get_strerror());
+void
+SeqWriter::write_block(const SeqReader::Record* records, const size_t count)
+{
+  check_error(closed, "SeqWriter: Attempted to write to a closed writer.");
+  auto& stage = get_staging();
+  const std::unique_lock<std::mutex> lock(stage.mutex);
+  for (size_t i = 0; i < count; i++) {
+    const auto& record = records[i];
+    format_record(
+      stage.buffer, record.id, record.comment, record.seq, record.qual);
+    if (stage.buffer.size() >= CHUNK_SIZE) {
+      submit(stage.buffer);
     }
   }
 }
 
+void
+SeqWriter::start_compressors()
+{
+  for (unsigned i = 0; i < threads; i++) {
+    compressor_threads.push_back(
+      std::unique_ptr<std::thread>(new std::thread([this]() {
+        OrderQueueMPMC<std::string>::Block block(1);
+        std::string compressed;
+        std::vector<char> bgzf_block(BGZF_MAX_BLOCK_SIZE);
+        for (;;) {
+          raw_queue.read(block);
+          if (block.num >= end_num) {
+            // Only one end of output marker is passed on
+            if (block.num == end_num) {
+              output_queue.write(block);
+            }
+            break;
+          }
+          const auto& chunk = block.data[0];
+          const size_t max_block_data = BGZF_MAX_BLOCK_SIZE - 1024;
+          compressed.clear();
+          for (size_t pos = 0; pos < chunk.size(); pos += max_block_data) {
+            const auto size = std::min(max_block_data, chunk.size() - pos);
+            const auto csize = bgzf_deflate_block(
+              chunk.data() + pos, size, bgzf_block.data());
+            compressed.append(bgzf_block.data(), csize);
+          }
+          std::swap(block.data[0], compressed);
+          output_queue.write(block);
+        }
+      })));
+  }
+}
+
+void
+SeqWriter::start_flusher()
+{
+  flusher_thread = std::unique_ptr<std::thread>(new std::thread([this]() {
+    OrderQueueMPSC<std::string>::Block block(1);
+    for (;;) {
+      output_queue.read(block);
+      if (block.num >= end_num) {
+        break;
+      }
+      const auto& chunk = block.data[0];
+      if (fwrite(chunk.data(), 1, chunk.size(), sink) != chunk.size()) {
+        log_error("SeqWriter: fwrite failed: " + get_strerror());
+      }
+    }
+    if (compress) {
+      std::vector<char> eof_block(BGZF_MAX_BLOCK_SIZE);
+      const auto csize = bgzf_deflate_block(nullptr, 0, eof_block.data());
+      if (fwrite(eof_block.data(), 1, csize, sink) != csize) {
+        log_error("SeqWriter: fwrite failed: " + get_strerror());
+      }
+    }
+  }));
+}
+
 } // namespace btllib
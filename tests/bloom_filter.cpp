@@ -5,7 +5,9 @@
 #include <algorithm>
 #include <cstdio>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 int
 main()
@@ -36,6 +38,26 @@ main()
 
   std::remove(filename.c_str());
 
+  std::cerr << "Testing BloomFilter batches" << std::endl;
+  {
+    btllib::BloomFilter batch_bf(1024 * 1024, 3);
+    std::vector<uint64_t> batch_hashes;
+    for (uint64_t i = 0; i < 300; i++) {
+      batch_hashes.push_back(i * 7919);
+      batch_hashes.push_back(i * 104729 + 1);
+      batch_hashes.push_back(i * 1299709 + 2);
+    }
+    batch_bf.insert_batch(batch_hashes.data(), 100);
+    std::unique_ptr<bool[]> results(new bool[300]);
+    TEST_ASSERT_EQ(
+      batch_bf.contains_batch(batch_hashes.data(), 300, results.get()), 100);
+    for (size_t i = 0; i < 300; i++) {
+      TEST_ASSERT_EQ(results[i], (i < 100));
+      TEST_ASSERT_EQ(results[i],
+                     batch_bf.contains(batch_hashes.data() + i * 3));
+    }
+  }
+
   std::string seq = "CACTATCGACGATCATTCGAGCATCAGCGACTG";
   std::string seq2 = "GTAGTACGATCAGCGACTATCGAGCTACGAGCA";
   TEST_ASSERT_EQ(seq.size(), seq2.size());
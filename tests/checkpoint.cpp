@@ -0,0 +1,268 @@
+#include "btllib/checkpoint.hpp"
+#include "btllib/counting_bloom_filter.hpp"
+#include "btllib/filter_pipeline.hpp"
+#include "btllib/mi_bloom_filter_builder.hpp"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Run f in a child process, which is expected to exit from within f as if
+// the machine had failed
+template<typename F>
+static void
+run_interrupted(F f)
+{
+  const pid_t pid = fork();
+  TEST_ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    f();
+    std::_Exit(EXIT_FAILURE);
+  }
+  int status = 0;
+  TEST_ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  TEST_ASSERT(WIFEXITED(status));
+  TEST_ASSERT_EQ(WEXITSTATUS(status), 0);
+}
+
+static std::string
+read_file(const std::string& path)
+{
+  std::ifstream ifs(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(ifs),
+                     std::istreambuf_iterator<char>());
+}
+
+static std::string
+write_fasta(const size_t reads, const size_t min_len, const size_t max_len)
+{
+  const auto path = get_random_name(64) + ".fa";
+  std::ofstream ofs(path);
+  for (size_t i = 0; i < reads; i++) {
+    ofs << '>' << i + 1 << '\n'
+        << get_random_seq(get_random(int(min_len), int(max_len))) << '\n';
+  }
+  return path;
+}
+
+int
+main()
+{
+  const unsigned hash_num = 3, k = 25;
+  const std::vector<std::string> fastas = { write_fasta(2000, 20, 400),
+                                            write_fasta(500, 100, 200) };
+  const auto long_fasta = write_fasta(3000, 200, 400);
+
+  // Builds are interrupted before anything else starts threads, so that the
+  // child processes start from a clean state
+  using Pipeline = btllib::FilterPipeline<btllib::KmerCountingBloomFilter8>;
+  const size_t filter_bytes = 1024 * 1024;
+  const auto pipeline_prefix = get_random_name(64);
+  run_interrupted([&]() {
+    btllib::KmerCountingBloomFilter8 cbf(filter_bytes, hash_num, k);
+    btllib::Checkpoint checkpoint(pipeline_prefix, 0);
+    Pipeline pipeline(cbf, Pipeline::Mode::INSERT, 1);
+    pipeline.set_checkpoint(checkpoint);
+    size_t reads = 0;
+    pipeline.set_read_callback(
+      [&](const btllib::SeqReader::Record&, const Pipeline::Result&) {
+        if (++reads == 1234) {
+          std::_Exit(0);
+        }
+      });
+    pipeline.run(fastas);
+  });
+
+  using Builder = btllib::MIBloomFilterBuilder<uint32_t>;
+  std::vector<uint64_t> hashes;
+  for (uint64_t i = 1; i <= 1000; i++) {
+    for (unsigned j = 0; j < hash_num; j++) {
+      hashes.push_back(i * 1000003 + j * 7919);
+    }
+  }
+  const auto assign_id = [](const btllib::SeqReader::Record& record) {
+    return uint32_t(std::stoul(record.id) % 5 + 1);
+  };
+  // Interrupted while populating the bit vector and while placing IDs
+  std::vector<std::string> builder_prefixes;
+  for (const size_t interrupt_at : { 1500, 3000 + 2500 }) {
+    builder_prefixes.push_back(get_random_name(64));
+    const auto& prefix = builder_prefixes.back();
+    run_interrupted([&]() {
+      btllib::Checkpoint checkpoint(prefix, 0);
+      std::atomic<size_t> records{ 0 };
+      Builder builder(hash_num, k, 0.5, 4);
+      builder.set_checkpoint(checkpoint);
+      builder.add_source(long_fasta,
+                         [&](const btllib::SeqReader::Record& record) {
+                           if (++records == interrupt_at) {
+                             std::_Exit(0);
+                           }
+                           return assign_id(record);
+                         });
+      builder.add_hashes(hashes, 7);
+      builder.build();
+    });
+  }
+
+  std::cerr << "Testing Checkpoint" << std::endl;
+  {
+    const auto prefix = get_random_name(64);
+    btllib::Checkpoint::State state;
+    state.stage = 2;
+    state.source = 1;
+    state.record = 12345;
+    state.offset = 67;
+    state.counters["a"] = { 1, 2, 3 };
+    state.counters["b"] = {};
+    const auto writer = [](const std::string& path) {
+      std::ofstream(path) << path;
+      std::ofstream(path + ".extra") << "extra";
+      return std::vector<std::string>{ path, path + ".extra" };
+    };
+    {
+      btllib::Checkpoint checkpoint(prefix);
+      TEST_ASSERT(!checkpoint.exists());
+      TEST_ASSERT(!checkpoint.due());
+      checkpoint.save(state, writer);
+      checkpoint.wait();
+      TEST_ASSERT(checkpoint.exists());
+      TEST_ASSERT_EQ(checkpoint.get_snapshot_path(), prefix + ".0");
+      TEST_ASSERT_EQ(checkpoint.get_state().get_counter("a", 2), 3);
+    }
+    {
+      btllib::Checkpoint checkpoint(prefix);
+      TEST_ASSERT(checkpoint.exists());
+      const auto& loaded = checkpoint.get_state();
+      TEST_ASSERT_EQ(loaded.stage, 2);
+      TEST_ASSERT_EQ(loaded.source, 1);
+      TEST_ASSERT_EQ(loaded.record, 12345);
+      TEST_ASSERT_EQ(loaded.offset, 67);
+      TEST_ASSERT(loaded.counters == state.counters);
+      TEST_ASSERT_EQ(loaded.get_counter("a", 3), 0);
+      TEST_ASSERT_EQ(loaded.get_counter("c"), 0);
+      TEST_ASSERT_EQ(read_file(checkpoint.get_snapshot_path()), prefix + ".0");
+
+      // The next checkpoint goes to the other slot
+      state.record++;
+      checkpoint.save(state, writer);
+      checkpoint.wait();
+      TEST_ASSERT_EQ(checkpoint.get_snapshot_path(), prefix + ".1");
+      TEST_ASSERT_EQ(checkpoint.get_state().record, 12346);
+      checkpoint.remove();
+      TEST_ASSERT(!checkpoint.exists());
+    }
+    for (const auto* suffix : { ".checkpoint", ".0", ".0.extra", ".1" }) {
+      TEST_ASSERT(!std::ifstream(prefix + suffix));
+    }
+  }
+
+  std::cerr << "Testing FilterPipeline resuming from a checkpoint"
+            << std::endl;
+  {
+    btllib::KmerCountingBloomFilter8 expected(filter_bytes, hash_num, k);
+    Pipeline expected_pipeline(expected, Pipeline::Mode::INSERT, 1);
+    expected_pipeline.run(fastas);
+    const auto expected_path = get_random_name(64);
+    expected.save(expected_path);
+
+    btllib::Checkpoint checkpoint(pipeline_prefix);
+    TEST_ASSERT(checkpoint.exists());
+    const auto& state = checkpoint.get_state();
+    TEST_ASSERT_EQ(state.source, 0);
+    TEST_ASSERT_GT(state.record, 0);
+    TEST_ASSERT_LT(state.record, 1234);
+    TEST_ASSERT_EQ(state.get_counter("reads"), state.record);
+
+    btllib::KmerCountingBloomFilter8 resumed(checkpoint.get_snapshot_path());
+    btllib::KmerCountingBloomFilter8 sequential(
+      checkpoint.get_snapshot_path());
+    {
+      Pipeline pipeline(resumed, Pipeline::Mode::INSERT, 4);
+      pipeline.set_checkpoint(checkpoint);
+      pipeline.run(fastas);
+      const auto progress = pipeline.get_progress();
+      const auto expected_progress = expected_pipeline.get_progress();
+      TEST_ASSERT_EQ(progress.reads, 2500);
+      TEST_ASSERT_EQ(progress.reads, expected_progress.reads);
+      TEST_ASSERT_EQ(progress.bases, expected_progress.bases);
+      TEST_ASSERT_EQ(progress.elements, expected_progress.elements);
+    }
+    // Conservative counting depends on the order of insertion, so only the
+    // single threaded filters are compared as a whole
+    TEST_ASSERT_EQ(resumed.get_pop_cnt(), expected.get_pop_cnt());
+    {
+      Pipeline pipeline(sequential, Pipeline::Mode::INSERT, 1);
+      pipeline.set_checkpoint(checkpoint);
+      pipeline.run(fastas);
+    }
+    const auto sequential_path = get_random_name(64);
+    sequential.save(sequential_path);
+    TEST_ASSERT(read_file(sequential_path) == read_file(expected_path));
+
+    checkpoint.remove();
+    std::remove(expected_path.c_str());
+    std::remove(sequential_path.c_str());
+  }
+
+  std::cerr << "Testing MIBloomFilterBuilder resuming from a checkpoint"
+            << std::endl;
+  {
+    Builder expected_builder(hash_num, k, 0.5, 4);
+    expected_builder.add_source(long_fasta, assign_id);
+    expected_builder.add_hashes(hashes, 7);
+    const auto expected = expected_builder.build();
+    const auto& expected_coverage = expected_builder.get_coverage();
+
+    unsigned stage = 0;
+    for (const auto& prefix : builder_prefixes) {
+      btllib::Checkpoint checkpoint(prefix);
+      TEST_ASSERT(checkpoint.exists());
+      TEST_ASSERT_EQ(checkpoint.get_state().stage, stage);
+      TEST_ASSERT_EQ(checkpoint.get_state().source, 0);
+      stage++;
+
+      Builder builder(hash_num, k, 0.5, 3);
+      builder.set_checkpoint(checkpoint);
+      builder.add_source(long_fasta, assign_id);
+      builder.add_hashes(hashes, 7);
+      const auto filter = builder.build();
+      TEST_ASSERT_EQ(builder.get_expected_elements(),
+                     expected_builder.get_expected_elements());
+      TEST_ASSERT_EQ(filter->size(), expected->size());
+      TEST_ASSERT_EQ(filter->get_pop(), expected->get_pop());
+      for (size_t rank = 0; rank < expected->get_pop(); rank++) {
+        TEST_ASSERT_EQ(filter->get_data(rank), expected->get_data(rank));
+      }
+      const auto& coverage = builder.get_coverage();
+      TEST_ASSERT_EQ(coverage.size(), expected_coverage.size());
+      for (size_t id = 0; id < coverage.size(); id++) {
+        TEST_ASSERT_EQ(coverage[id].elements, expected_coverage[id].elements);
+        TEST_ASSERT_EQ(coverage[id].represented,
+                       expected_coverage[id].represented);
+        TEST_ASSERT_EQ(coverage[id].saturated,
+                       expected_coverage[id].saturated);
+        TEST_ASSERT_EQ(coverage[id].slots, expected_coverage[id].slots);
+      }
+      checkpoint.remove();
+    }
+  }
+
+  for (const auto& fasta : fastas) {
+    std::remove(fasta.c_str());
+  }
+  std::remove(long_fasta.c_str());
+
+  return 0;
+}
@@ -5,6 +5,7 @@
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <vector>
 
 int
 main()
@@ -215,5 +216,24 @@ main()
     TEST_ASSERT_EQ(cbf.contains(hashes), 0);
   }
 
+  {
+    std::cerr << "Testing CBF batches" << std::endl;
+    btllib::CountingBloomFilter16 cbf(1024 * 1024, 2);
+    std::vector<uint64_t> hashes;
+    for (uint64_t i = 0; i < 200; i++) {
+      hashes.push_back(i * 7919);
+      hashes.push_back(i * 104729 + 1);
+    }
+    cbf.insert_batch(hashes.data(), 150);
+    cbf.insert_batch(hashes.data(), 50);
+    std::vector<uint16_t> counts(200);
+    TEST_ASSERT_EQ(cbf.contains_batch(hashes.data(), 200, counts.data()), 150);
+    for (size_t i = 0; i < 200; i++) {
+      const unsigned expected = i < 50 ? 2 : (i < 150 ? 1 : 0);
+      TEST_ASSERT_EQ(counts[i], expected);
+      TEST_ASSERT_EQ(counts[i], cbf.contains(hashes.data() + i * 2));
+    }
+  }
+
   return 0;
 }
\ No newline at end of file
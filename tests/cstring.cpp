@@ -2,6 +2,7 @@
 #include "helpers.hpp"
 
 #include <iostream>
+#include <string>
 
 int
 main()
@@ -19,5 +20,61 @@ main()
   TEST_ASSERT_EQ(cstring.size(), 0);
   TEST_ASSERT_EQ(std::string(cstring), "");
 
+  PRINT_TEST_NAME("CString growth")
+
+  btllib::CString grown;
+  TEST_ASSERT(!grown.s_heap);
+  std::string expected;
+  for (size_t i = 0; i < 1000; i++) {
+    const std::string seq = get_random_seq(get_random(1, 10));
+    grown.append(seq.c_str(), seq.size());
+    expected += seq;
+  }
+  TEST_ASSERT(grown.s_heap);
+  TEST_ASSERT_EQ(std::string(grown), expected);
+
+  btllib::CString moved(std::move(grown));
+  TEST_ASSERT_EQ(std::string(moved), expected);
+  TEST_ASSERT_EQ(grown.size(), 0); // NOLINT
+  btllib::CString copied(moved);
+  TEST_ASSERT_EQ(std::string(copied), expected);
+
+  PRINT_TEST_NAME("CString arena")
+
+  btllib::CStringArena arena;
+  btllib::CString a, b;
+  a.set_arena(&arena);
+  b.set_arena(&arena);
+  const std::string long_seq = get_random_seq(1000);
+  a.append(long_seq.c_str(), 500);
+  a.append(long_seq.c_str() + 500, 500);
+  b = std::string("ACGT");
+  b += long_seq;
+  TEST_ASSERT(!a.s_heap);
+  TEST_ASSERT(!b.s_heap);
+  TEST_ASSERT_EQ(std::string(a), long_seq);
+  TEST_ASSERT_EQ(std::string(b), "ACGT" + long_seq);
+  const auto capacity = arena.get_capacity();
+
+  // Reusing the arena allocates no new slabs
+  for (size_t i = 0; i < 10; i++) {
+    arena.reset();
+    a.set_arena(&arena);
+    b.set_arena(&arena);
+    TEST_ASSERT_EQ(a.size(), 0);
+    a += long_seq;
+    b += long_seq;
+    TEST_ASSERT_EQ(std::string(a), long_seq);
+    TEST_ASSERT_EQ(std::string(b), long_seq);
+  }
+  TEST_ASSERT_EQ(arena.get_capacity(), capacity);
+
+  // Allocations larger than a slab get one of their own
+  btllib::CString c;
+  c.set_arena(&arena);
+  c.resize(btllib::CStringArena::SLAB_SIZE * 2, 'A');
+  TEST_ASSERT_EQ(c.size(), btllib::CStringArena::SLAB_SIZE * 2);
+  TEST_ASSERT_EQ(c[c.size() - 1], 'A');
+
   return 0;
-}
\ No newline at end of file
+}
@@ -5,7 +5,9 @@
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <string>
 #include <thread>
+#include <vector>
 
 int
 main()
@@ -28,6 +30,58 @@ main()
   gz_source.close();
   TEST_ASSERT_EQ(strcmp(line, txt), 0);
 
+  std::cerr << "Test .gz append and repeated reads" << std::endl;
+  {
+    btllib::DataSink gz_append_sink(gz_filename, true);
+    TEST_ASSERT_EQ(fwrite(txt, 1, strlen(txt), gz_append_sink), strlen(txt));
+  }
+  const auto opens = btllib::DataStream::get_open_count();
+  for (int i = 0; i < 50; i++) {
+    btllib::DataSource source(gz_filename);
+    TEST_ASSERT_GE(source.get_setup_time(), 0.0);
+    std::string contents;
+    char buf[64];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), source)) > 0) {
+      contents.append(buf, len);
+    }
+    TEST_ASSERT_EQ(contents, std::string(txt) + txt);
+  }
+  TEST_ASSERT_EQ(btllib::DataStream::get_open_count(), opens + 50);
+  TEST_ASSERT_GT(btllib::DataStream::get_total_setup_time(), 0.0);
+
+  std::cerr << "Test .gz close before the end" << std::endl;
+  {
+    btllib::DataSink large_sink(gz_filename, false);
+    for (int i = 0; i < 500000; i++) {
+      fprintf(large_sink, "%s %d\n", txt, i);
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    btllib::DataSource source(gz_filename);
+    TEST_ASSERT_GT(getline(&line, &line_len, source), 0);
+    TEST_ASSERT_EQ(strcmp(line, (std::string(txt) + " 0\n").c_str()), 0);
+  }
+
+  std::cerr << "Test .gz raw read" << std::endl;
+  {
+    btllib::DataSource source(gz_filename);
+    std::vector<char> buf(1024 * 1024);
+    size_t total = 0, len;
+    while ((len = source.read(buf.data(), buf.size())) > 0) {
+      TEST_ASSERT_LE(len, buf.size());
+      if (total == 0) {
+        TEST_ASSERT_EQ(std::string(buf.data(), strlen(txt)), txt);
+      }
+      total += len;
+    }
+    size_t expected = 0;
+    for (int i = 0; i < 500000; i++) {
+      expected += strlen(txt) + 2 + std::to_string(i).size();
+    }
+    TEST_ASSERT_EQ(total, expected);
+  }
+
   std::remove(gz_filename.c_str());
 
   // Test .xz
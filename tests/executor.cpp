@@ -0,0 +1,161 @@
+#include "btllib/executor.hpp"
+#include "btllib/indexlr.hpp"
+#include "btllib/seq_reader.hpp"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+int
+main()
+{
+  btllib::Executor::configure(4);
+
+  {
+    PRINT_TEST_NAME("Executor tasks")
+    btllib::Executor executor(3);
+    TEST_ASSERT_EQ(executor.get_threads(), 3);
+    TEST_ASSERT(!executor.in_worker());
+    std::atomic<size_t> sum{ 0 };
+    {
+      btllib::TaskGroup group(executor);
+      for (size_t i = 1; i <= 1000; i++) {
+        group.run([&, i]() { sum += i; });
+      }
+      group.wait();
+      TEST_ASSERT_EQ(group.get_pending(), 0);
+    }
+    TEST_ASSERT_EQ(sum, 1000 * 1001 / 2);
+    TEST_ASSERT_GE(executor.get_executed(), 1000);
+  }
+
+  {
+    PRINT_TEST_NAME("Executor nested task groups")
+    btllib::Executor executor(2);
+    std::atomic<size_t> leaves{ 0 };
+    btllib::TaskGroup group(executor);
+    for (size_t i = 0; i < 16; i++) {
+      group.run([&]() {
+        // Waiting inside a task runs other tasks rather than blocking a
+        // worker, so this completes with fewer workers than groups
+        btllib::TaskGroup inner(executor);
+        for (size_t j = 0; j < 16; j++) {
+          inner.run([&]() { leaves++; });
+        }
+        inner.wait();
+      });
+    }
+    group.wait();
+    TEST_ASSERT_EQ(leaves, 16 * 16);
+  }
+
+  {
+    PRINT_TEST_NAME("Executor work stealing")
+    btllib::Executor executor(4);
+    std::atomic<size_t> done{ 0 };
+    btllib::TaskGroup group(executor);
+    group.run([&]() {
+      // Tasks submitted by a worker go to its own deque, so the others
+      // have to steal them
+      for (size_t i = 0; i < 64; i++) {
+        group.run([&]() {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          done++;
+        });
+      }
+    });
+    group.wait();
+    TEST_ASSERT_EQ(done, 64);
+    TEST_ASSERT_GT(executor.get_stolen(), 0);
+  }
+
+  {
+    PRINT_TEST_NAME("Executor pinned workers")
+    btllib::Executor executor(2, true);
+    TEST_ASSERT(executor.is_pinned());
+    std::atomic<size_t> count{ 0 };
+    btllib::parallel_for(
+      0, 100, 7, [&](size_t start, size_t end) { count += end - start; },
+      executor);
+    TEST_ASSERT_EQ(count, 100);
+  }
+
+  {
+    PRINT_TEST_NAME("parallel_for")
+    std::vector<unsigned> visits(10007, 0);
+    btllib::parallel_for(0, visits.size(), 100, [&](size_t start, size_t end) {
+      for (size_t i = start; i < end; i++) {
+        visits[i]++;
+      }
+    });
+    for (const auto v : visits) {
+      TEST_ASSERT_EQ(v, 1);
+    }
+    size_t calls = 0;
+    btllib::parallel_for(5, 5, 10, [&](size_t, size_t) { calls++; });
+    TEST_ASSERT_EQ(calls, 0);
+  }
+
+  {
+    PRINT_TEST_NAME("Executor shared by readers")
+    auto& executor = btllib::Executor::global();
+    TEST_ASSERT_EQ(executor.get_threads(), 4);
+
+    std::vector<std::string> seqs;
+    for (size_t i = 0; i < 3000; i++) {
+      seqs.push_back(get_random_seq(get_random(50, 150)));
+    }
+    const auto fasta = get_random_name(64) + ".fa";
+    std::ofstream ofs(fasta);
+    for (size_t i = 0; i < seqs.size(); i++) {
+      ofs << '>' << i << '\n' << seqs[i] << '\n';
+    }
+    ofs.close();
+
+    // More readers than workers, each converting up to 3 blocks at once
+    std::vector<std::unique_ptr<btllib::SeqReader>> readers;
+    for (size_t i = 0; i < 8; i++) {
+      readers.push_back(std::unique_ptr<btllib::SeqReader>(
+        new btllib::SeqReader(fasta, btllib::SeqReader::Flag::SHORT_MODE, 3)));
+    }
+    std::vector<size_t> counts(readers.size(), 0);
+    bool reading = true;
+    while (reading) {
+      reading = false;
+      for (size_t i = 0; i < readers.size(); i++) {
+        const auto record = readers[i]->read();
+        if (record) {
+          TEST_ASSERT_EQ(record.seq, seqs[record.num]);
+          TEST_ASSERT_EQ(record.num, counts[i]);
+          counts[i]++;
+          reading = true;
+        }
+      }
+    }
+    for (const auto c : counts) {
+      TEST_ASSERT_EQ(c, seqs.size());
+    }
+
+    btllib::Indexlr indexlr(fasta, 21, 5, btllib::Indexlr::Flag::SHORT_MODE, 8);
+    size_t records = 0;
+    for (const auto& record : indexlr) {
+      TEST_ASSERT_EQ(record.num, records);
+      TEST_ASSERT_EQ(record.readlen, seqs[record.num].size());
+      records++;
+    }
+    TEST_ASSERT_EQ(records, seqs.size());
+    TEST_ASSERT_GT(executor.get_executed(), 0);
+
+    std::remove(fasta.c_str());
+  }
+
+  return 0;
+}
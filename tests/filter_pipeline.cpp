@@ -0,0 +1,184 @@
+#include "btllib/bloom_filter.hpp"
+#include "btllib/counting_bloom_filter.hpp"
+#include "btllib/filter_pipeline.hpp"
+#include "btllib/mi_bloom_filter_builder.hpp"
+#include "btllib/nthash.hpp"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+int
+main()
+{
+  const unsigned hash_num = 3, k = 25;
+  std::vector<std::string> seqs;
+  size_t bases = 0, kmers = 0;
+  for (size_t i = 0; i < 2000; i++) {
+    // Some reads are too short to hash
+    seqs.push_back(get_random_seq(i % 50 == 0 ? k - 1 : get_random(k, 400)));
+    bases += seqs.back().size();
+    kmers += seqs.back().size() >= k ? seqs.back().size() - k + 1 : 0;
+  }
+  const auto fasta = get_random_name(64) + ".fa";
+  std::ofstream ofs(fasta);
+  for (size_t i = 0; i < seqs.size(); i++) {
+    ofs << '>' << i + 1 << '\n' << seqs[i] << '\n';
+  }
+  ofs.close();
+  const auto other_fasta = get_random_name(64) + ".fa";
+  std::ofstream other_ofs(other_fasta);
+  for (size_t i = 0; i < 100; i++) {
+    other_ofs << '>' << i << '\n' << get_random_seq(200) << '\n';
+  }
+  other_ofs.close();
+
+  using Pipeline = btllib::FilterPipeline<btllib::KmerBloomFilter>;
+
+  std::cerr << "Testing FilterPipeline insertion" << std::endl;
+  btllib::KmerBloomFilter bf(1024 * 1024, hash_num, k);
+  {
+    Pipeline pipeline(bf, Pipeline::Mode::INSERT, 4);
+    std::atomic<size_t> progress_calls{ 0 };
+    size_t last_reads = 0;
+    pipeline.set_progress_callback([&](const Pipeline::Progress& progress) {
+      TEST_ASSERT_GE(progress.reads, last_reads);
+      last_reads = progress.reads;
+      progress_calls++;
+    });
+    pipeline.run(fasta);
+    const auto progress = pipeline.get_progress();
+    TEST_ASSERT_EQ(progress.reads, seqs.size());
+    TEST_ASSERT_EQ(progress.bases, bases);
+    TEST_ASSERT_EQ(progress.elements, kmers);
+    TEST_ASSERT_EQ(progress.hits, 0);
+    TEST_ASSERT_GT(progress_calls, 0);
+    TEST_ASSERT_EQ(last_reads, seqs.size());
+  }
+  btllib::KmerBloomFilter bf_serial(1024 * 1024, hash_num, k);
+  for (const auto& seq : seqs) {
+    if (seq.size() >= k) {
+      bf_serial.insert(seq);
+    }
+  }
+  TEST_ASSERT_EQ(bf.get_pop_cnt(), bf_serial.get_pop_cnt());
+
+  std::cerr << "Testing FilterPipeline queries" << std::endl;
+  {
+    Pipeline pipeline(bf, Pipeline::Mode::QUERY, 3);
+    std::mutex mutex;
+    std::vector<bool> seen(seqs.size(), false);
+    pipeline.set_read_callback(
+      [&](const btllib::SeqReader::Record& record,
+          const Pipeline::Result& result) {
+        const std::unique_lock<std::mutex> lock(mutex);
+        TEST_ASSERT_EQ(record.id, std::to_string(result.num + 1));
+        TEST_ASSERT_EQ(record.seq, seqs[result.num]);
+        const size_t expected =
+          record.seq.size() >= k ? record.seq.size() - k + 1 : 0;
+        TEST_ASSERT_EQ(result.elements, expected);
+        TEST_ASSERT_EQ(result.hits, expected);
+        TEST_ASSERT_EQ(result.values.size(), expected);
+        for (const auto value : result.values) {
+          TEST_ASSERT_EQ(value, 1);
+        }
+        seen[result.num] = true;
+      },
+      true);
+    pipeline.run(fasta);
+    TEST_ASSERT_EQ(pipeline.get_progress().hits, kmers);
+    for (const auto read_seen : seen) {
+      TEST_ASSERT(read_seen);
+    }
+
+    pipeline.set_read_callback(nullptr);
+    pipeline.run(other_fasta);
+    const auto progress = pipeline.get_progress();
+    TEST_ASSERT_EQ(progress.reads, seqs.size() + 100);
+    TEST_ASSERT_EQ(progress.elements, kmers + 100 * (200 - k + 1));
+    TEST_ASSERT_LT(progress.hits, kmers + 100);
+  }
+
+  std::cerr << "Testing FilterPipeline with a counting Bloom filter"
+            << std::endl;
+  {
+    using CountingPipeline =
+      btllib::FilterPipeline<btllib::KmerCountingBloomFilter8>;
+    btllib::KmerCountingBloomFilter8 cbf(1024 * 1024, hash_num, k);
+    CountingPipeline inserter(cbf, CountingPipeline::Mode::INSERT, 4);
+    inserter.run(fasta);
+    inserter.run(fasta);
+    CountingPipeline querier(cbf, CountingPipeline::Mode::CONTAINS_INSERT, 4);
+    std::atomic<size_t> low_counts{ 0 };
+    querier.set_read_callback(
+      [&](const btllib::SeqReader::Record&,
+          const CountingPipeline::Result& result) {
+        for (const auto value : result.values) {
+          if (value < 2) {
+            low_counts++;
+          }
+        }
+      },
+      true);
+    querier.run(fasta);
+    TEST_ASSERT_EQ(low_counts, 0);
+    TEST_ASSERT_EQ(querier.get_progress().hits, kmers);
+    for (const auto& seq : seqs) {
+      if (seq.size() >= k) {
+        TEST_ASSERT_GE(cbf.contains(seq.substr(0, k)), 3);
+      }
+    }
+  }
+
+  std::cerr << "Testing FilterPipeline with a spaced seed Bloom filter"
+            << std::endl;
+  {
+    using SeedPipeline = btllib::FilterPipeline<btllib::SeedBloomFilter>;
+    const std::vector<std::string> seeds = { "1111100000000000000011111",
+                                             "1111111111100111111111111" };
+    btllib::SeedBloomFilter sbf(1024 * 1024, k, seeds, 2);
+    SeedPipeline inserter(sbf, SeedPipeline::Mode::INSERT, 2);
+    inserter.run(fasta);
+    TEST_ASSERT_EQ(inserter.get_progress().elements, kmers * seeds.size());
+    SeedPipeline querier(sbf, SeedPipeline::Mode::QUERY, 2);
+    querier.run(fasta);
+    TEST_ASSERT_EQ(querier.get_progress().hits, kmers * seeds.size());
+  }
+
+  std::cerr << "Testing FilterPipeline with a multi-index Bloom filter"
+            << std::endl;
+  {
+    using MIPipeline =
+      btllib::FilterPipeline<btllib::MIBloomFilter<uint32_t>>;
+    btllib::MIBloomFilterBuilder<uint32_t> builder(hash_num, k, 0.5, 2);
+    builder.add_source(fasta, 1);
+    const auto mibf = builder.build();
+    MIPipeline querier(*mibf, MIPipeline::Mode::QUERY, 4);
+    std::atomic<size_t> wrong_ids{ 0 };
+    querier.set_read_callback(
+      [&](const btllib::SeqReader::Record&, const MIPipeline::Result& result) {
+        TEST_ASSERT_EQ(result.values.size(), result.elements * hash_num);
+        for (const auto value : result.values) {
+          if ((value & btllib::MIBloomFilter<uint32_t>::ID_MASK) != 1) {
+            wrong_ids++;
+          }
+        }
+      },
+      true);
+    querier.run(fasta);
+    TEST_ASSERT_EQ(querier.get_progress().elements, kmers);
+    TEST_ASSERT_EQ(querier.get_progress().hits, kmers);
+    TEST_ASSERT_EQ(wrong_ids, 0);
+  }
+
+  std::remove(fasta.c_str());
+  std::remove(other_fasta.c_str());
+
+  return 0;
+}
@@ -0,0 +1,256 @@
+#include "btllib/bgzf.hpp"
+#include "btllib/indexed_seq_reader.hpp"
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+struct TestRecord
+{
+  std::string name;
+  std::string seq;
+  std::string qual;
+};
+
+static std::vector<TestRecord>
+get_random_records(const size_t num, const bool fastq)
+{
+  std::vector<TestRecord> records;
+  for (size_t i = 0; i < num; i++) {
+    TestRecord record;
+    record.name = "seq" + std::to_string(i);
+    record.seq = get_random_seq(get_random(1, 10000));
+    if (fastq) {
+      for (size_t j = 0; j < record.seq.size(); j++) {
+        record.qual += char(get_random('!', 'J'));
+      }
+    }
+    records.push_back(record);
+  }
+  return records;
+}
+
+static std::string
+wrap(const std::string& seq, const size_t line_bases)
+{
+  std::string wrapped;
+  for (size_t i = 0; i < seq.size(); i += line_bases) {
+    wrapped += seq.substr(i, line_bases) + '\n';
+  }
+  return wrapped;
+}
+
+static std::string
+format_records(const std::vector<TestRecord>& records,
+               const bool fastq,
+               const size_t line_bases)
+{
+  std::string contents;
+  for (const auto& record : records) {
+    if (fastq) {
+      contents += '@' + record.name + " comment\n" +
+                  wrap(record.seq, line_bases) + "+\n" +
+                  wrap(record.qual, line_bases);
+    } else {
+      contents += '>' + record.name + " comment\n" +
+                  wrap(record.seq, line_bases);
+    }
+  }
+  return contents;
+}
+
+static void
+write_file(const std::string& path,
+           const std::string& contents,
+           const bool compress)
+{
+  std::ofstream file(path, std::ios::binary);
+  if (!compress) {
+    file << contents;
+    return;
+  }
+  std::vector<char> block(btllib::BGZF_MAX_BLOCK_SIZE);
+  const size_t chunk = 60000;
+  for (size_t i = 0; i < contents.size(); i += chunk) {
+    const auto size = std::min(chunk, contents.size() - i);
+    file.write(block.data(),
+               long(btllib::bgzf_deflate_block(
+                 contents.data() + i, size, block.data())));
+  }
+  // End of file marker, an empty block
+  file.write(block.data(),
+             long(btllib::bgzf_deflate_block(nullptr, 0, block.data())));
+}
+
+static void
+remove_files(const std::string& path)
+{
+  std::remove(path.c_str());
+  std::remove((path + ".fai").c_str());
+  std::remove((path + ".gzi").c_str());
+}
+
+static void
+check_reader(const btllib::IndexedSeqReader& reader,
+             const std::vector<TestRecord>& records,
+             const bool fastq)
+{
+  TEST_ASSERT_EQ(reader.size(), records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    const auto record = reader.get(i);
+    TEST_ASSERT_EQ(record.id, records[i].name);
+    TEST_ASSERT_EQ(record.num, i);
+    TEST_ASSERT_EQ(record.seq, records[i].seq);
+    TEST_ASSERT_EQ(record.qual, records[i].qual);
+  }
+
+  std::vector<btllib::IndexedSeqReader::Region> regions;
+  for (size_t i = 0; i < 1000; i++) {
+    const auto& record = records[get_random(0, int(records.size()) - 1)];
+    const auto start = size_t(get_random(0, int(record.seq.size()) - 1));
+    const auto end = start + size_t(get_random(0, 200));
+    regions.emplace_back(record.name, start, end);
+  }
+  const auto fetched = reader.get(regions);
+  TEST_ASSERT_EQ(fetched.size(), regions.size());
+  for (size_t i = 0; i < regions.size(); i++) {
+    const auto& region = regions[i];
+    const auto& record = records[reader.get(region.name).num];
+    const auto length = region.end - region.start;
+    TEST_ASSERT_EQ(fetched[i].seq, record.seq.substr(region.start, length));
+    if (fastq) {
+      TEST_ASSERT_EQ(fetched[i].qual,
+                     record.qual.substr(region.start, length));
+    }
+    TEST_ASSERT_EQ(reader.get(region).seq, fetched[i].seq);
+  }
+}
+
+static void
+test_file(const bool fastq,
+          const size_t line_bases,
+          const bool compress,
+          const unsigned threads)
+{
+  std::cerr << "Test " << (fastq ? "FASTQ" : "FASTA") << " with "
+            << line_bases << " bases per line"
+            << (compress ? ", BGZF compressed," : "") << " and " << threads
+            << " threads" << std::endl;
+  const auto records = get_random_records(300, fastq);
+  const auto path = get_random_name(64);
+  write_file(path, format_records(records, fastq, line_bases), compress);
+
+  {
+    btllib::IndexedSeqReader reader(path, threads);
+    TEST_ASSERT(reader.get_format() ==
+                (fastq ? btllib::IndexedSeqReader::Format::FASTQ
+                       : btllib::IndexedSeqReader::Format::FASTA));
+    TEST_ASSERT_EQ(reader.is_compressed(), compress);
+    check_reader(reader, records, fastq);
+  }
+
+  // The second reader loads the saved index
+  std::ifstream fai(path + ".fai");
+  TEST_ASSERT(fai.good());
+  std::ifstream gzi(path + ".gzi");
+  TEST_ASSERT_EQ(gzi.good(), compress);
+  {
+    btllib::IndexedSeqReader reader(path, threads);
+    check_reader(reader, records, fastq);
+  }
+
+  remove_files(path);
+}
+
+// Write a .gzi the way bgzip does, with an entry for every block but the
+// first, which is implicit, and the end of file marker block
+static void
+write_bgzip_gzi(const std::string& path, const size_t max_entries)
+{
+  const int fd = open(path.c_str(), O_RDONLY);
+  TEST_ASSERT_GE(fd, 0);
+  const auto blocks = btllib::scan_bgzf_blocks(fd);
+  close(fd);
+  TEST_ASSERT_GE(blocks.size(), 2);
+  TEST_ASSERT_EQ(blocks.back().usize, 0);
+
+  const auto entries = std::min(max_entries, blocks.size() - 2);
+  const auto write_le64 = [](std::ofstream& gzi, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+      gzi.put(char(value & 0xFF));
+      value >>= 8;
+    }
+  };
+  std::ofstream gzi(path + ".gzi", std::ios::binary);
+  write_le64(gzi, entries);
+  for (size_t i = 1; i <= entries; i++) {
+    write_le64(gzi, blocks[i].coffset);
+    write_le64(gzi, blocks[i].uoffset);
+  }
+}
+
+static void
+test_bgzip_gzi(const size_t max_entries)
+{
+  std::cerr << "Test loading a bgzip .gzi with at most " << max_entries
+            << " entries" << std::endl;
+  const auto records = get_random_records(100, false);
+  const auto path = get_random_name(64);
+  write_file(path, format_records(records, false, 60), true);
+  write_bgzip_gzi(path, max_entries);
+  {
+    btllib::IndexedSeqReader reader(path, 2);
+    check_reader(reader, records, false);
+  }
+  remove_files(path);
+}
+
+int
+main()
+{
+  PRINT_TEST_NAME("IndexedSeqReader::parse_region")
+  auto region = btllib::IndexedSeqReader::parse_region("chr1");
+  TEST_ASSERT_EQ(region.name, "chr1");
+  TEST_ASSERT_EQ(region.start, size_t(0));
+  TEST_ASSERT_EQ(region.end, std::numeric_limits<size_t>::max());
+  region = btllib::IndexedSeqReader::parse_region("chr1:1,001-2,000");
+  TEST_ASSERT_EQ(region.name, "chr1");
+  TEST_ASSERT_EQ(region.start, size_t(1000));
+  TEST_ASSERT_EQ(region.end, size_t(2000));
+  region = btllib::IndexedSeqReader::parse_region("chr1:5");
+  TEST_ASSERT_EQ(region.start, size_t(4));
+  TEST_ASSERT_EQ(region.end, std::numeric_limits<size_t>::max());
+  region = btllib::IndexedSeqReader::parse_region("HLA:A*01:01:1-10");
+  TEST_ASSERT_EQ(region.name, "HLA:A*01:01");
+  TEST_ASSERT_EQ(region.start, size_t(0));
+  TEST_ASSERT_EQ(region.end, size_t(10));
+  region = btllib::IndexedSeqReader::parse_region("ns:seq");
+  TEST_ASSERT_EQ(region.name, "ns:seq");
+
+  PRINT_TEST_NAME("IndexedSeqReader")
+  for (const bool compress : { false, true }) {
+    test_file(false, 60, compress, 1);
+    test_file(false, 80, compress, 4);
+    test_file(true, 100000, compress, 4);
+  }
+  // Multiline FASTQ quality lines can look like headers, which makes the
+  // parallel index fall back to a sequential one
+  test_file(true, 70, false, 4);
+
+  // bgzip does not index the end of file marker block, so the size of the
+  // last data block is not known from the index
+  test_bgzip_gzi(std::numeric_limits<size_t>::max());
+  test_bgzip_gzi(3);
+  test_bgzip_gzi(0);
+
+  return 0;
+}
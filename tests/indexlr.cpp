@@ -1,10 +1,17 @@
 #include "btllib/indexlr.hpp"
 #include "btllib/bloom_filter.hpp"
+#include "btllib/nthash.hpp"
 #include "btllib/util.hpp"
 #include "helpers.hpp"
 
+#include <cstdio>
 #include <fstream>
+#include <limits>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 int
 main()
@@ -257,5 +264,149 @@ main()
   }
   TEST_ASSERT_GE(mins_found, filter_in_hashes.size());
 
+  std::cerr << "Testing against window scans" << std::endl;
+  {
+    const unsigned k = 21;
+    std::vector<std::string> seqs, quals;
+    for (int j = 0; j < 20; j++) {
+      auto seq = get_random_seq(get_random(k, 3000));
+      if (j % 3 == 0) {
+        seq[get_random(0, seq.size() - 1)] = 'N';
+      }
+      std::string qual;
+      for (size_t i = 0; i < seq.size(); i++) {
+        qual += char('!' + get_random(0, 40));
+      }
+      seqs.push_back(seq);
+      quals.push_back(qual);
+    }
+    const auto fastq = get_random_name(64) + ".fq";
+    std::ofstream ofs(fastq);
+    for (size_t j = 0; j < seqs.size(); j++) {
+      ofs << '@' << j << '\n' << seqs[j] << "\n+\n" << quals[j] << '\n';
+    }
+    ofs.close();
+
+    // Filter out about a third of the k-mers
+    btllib::BloomFilter repeat_bf(1024 * 1024, 1);
+    for (const auto& seq : seqs) {
+      for (btllib::NtHash nh(seq, 2, k); nh.roll();) {
+        if (nh.hashes()[0] % 3 == 0) {
+          repeat_bf.insert(nh.hashes());
+        }
+      }
+    }
+
+    for (const size_t w : { 1, 4, 50, 300 }) {
+      // A quality threshold near the mean quality filters about half of the
+      // k-mers
+      const size_t q = w == 50 ? 20 : 0;
+      btllib::Indexlr indexlr_scan(fastq,
+                                   k,
+                                   w,
+                                   q,
+                                   btllib::Indexlr::Flag::FILTER_OUT |
+                                     btllib::Indexlr::Flag::SEQ |
+                                     btllib::Indexlr::Flag::SHORT_MODE,
+                                   3,
+                                   false,
+                                   repeat_bf);
+      for (size_t s = 0; s < seqs.size(); s++) {
+        const auto& seq = seqs[s];
+        record = indexlr_scan.read();
+        TEST_ASSERT(bool(record));
+
+        std::vector<btllib::Indexlr::Minimizer> kmers;
+        for (btllib::NtHash nh(seq, 2, k); nh.roll();) {
+          kmers.emplace_back(nh.hashes()[0],
+                             nh.hashes()[1],
+                             nh.get_pos(),
+                             nh.forward(),
+                             seq.substr(nh.get_pos(), k));
+          size_t qual_sum = 0;
+          for (size_t i = 0; i < k; i++) {
+            qual_sum += quals[s][nh.get_pos() + i] - '!';
+          }
+          if (repeat_bf.contains(nh.hashes()) || qual_sum / k < q) {
+            kmers.back().min_hash = std::numeric_limits<uint64_t>::max();
+          }
+        }
+        std::vector<btllib::Indexlr::Minimizer> expected;
+        ssize_t prev_pos = -1;
+        for (size_t r = w - 1; seq.size() >= k + w - 1 && r < kmers.size();
+             r++) {
+          size_t min_idx = r + 1 - w;
+          for (size_t j = r + 1 - w; j <= r; j++) {
+            if (kmers[j].min_hash <= kmers[min_idx].min_hash) {
+              min_idx = j;
+            }
+          }
+          const auto& min = kmers[min_idx];
+          if (ssize_t(min.pos) > prev_pos &&
+              min.min_hash != std::numeric_limits<uint64_t>::max()) {
+            prev_pos = ssize_t(min.pos);
+            expected.push_back(min);
+          }
+        }
+
+        TEST_ASSERT_EQ(record.minimizers.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); j++) {
+          TEST_ASSERT_EQ(record.minimizers[j].min_hash, expected[j].min_hash);
+          TEST_ASSERT_EQ(record.minimizers[j].out_hash, expected[j].out_hash);
+          TEST_ASSERT_EQ(record.minimizers[j].pos, expected[j].pos);
+          TEST_ASSERT_EQ(record.minimizers[j].forward, expected[j].forward);
+          TEST_ASSERT_EQ(record.minimizers[j].seq, expected[j].seq);
+        }
+      }
+      TEST_ASSERT(!indexlr_scan.read());
+    }
+    std::remove(fastq.c_str());
+  }
+
+  std::cerr << "Testing reading blocks from multiple threads" << std::endl;
+  {
+    const auto path = btllib::get_dirname(__FILE__) + "/indexlr.fq";
+    std::vector<btllib::Indexlr::Record> expected;
+    btllib::Indexlr indexlr_records(
+      path, 21, 11, btllib::Indexlr::Flag::SHORT_MODE);
+    for (const auto record : indexlr_records) {
+      expected.push_back(record);
+    }
+
+    btllib::Indexlr indexlr_blocks(
+      path, 21, 11, btllib::Indexlr::Flag::SHORT_MODE, 3);
+    std::vector<btllib::Indexlr::Record> records(expected.size());
+    std::mutex records_mutex;
+    std::vector<std::thread> readers;
+    for (int j = 0; j < 3; j++) {
+      readers.emplace_back([&]() {
+        for (;;) {
+          auto block = indexlr_blocks.read_block();
+          if (block.count == 0) {
+            break;
+          }
+          const std::unique_lock<std::mutex> lock(records_mutex);
+          for (size_t idx = 0; idx < block.count; idx++) {
+            auto& record = block.data[idx];
+            TEST_ASSERT_LT(record.num, records.size());
+            records[record.num] = std::move(record);
+          }
+        }
+      });
+    }
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    for (size_t j = 0; j < expected.size(); j++) {
+      TEST_ASSERT_EQ(records[j].id, expected[j].id);
+      TEST_ASSERT_EQ(records[j].minimizers.size(),
+                     expected[j].minimizers.size());
+      for (size_t m = 0; m < expected[j].minimizers.size(); m++) {
+        TEST_ASSERT_EQ(records[j].minimizers[m].out_hash,
+                       expected[j].minimizers[m].out_hash);
+      }
+    }
+  }
+
   return 0;
 }
\ No newline at end of file
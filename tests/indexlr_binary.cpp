@@ -0,0 +1,127 @@
+#include "btllib/indexlr.hpp"
+#include "btllib/indexlr_binary.hpp"
+#include "btllib/util.hpp"
+
+#include "helpers.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static void
+check_records(const std::vector<btllib::Indexlr::Record>& expected,
+              btllib::IndexlrReader& reader)
+{
+  size_t i = 0;
+  for (const auto record : reader) {
+    TEST_ASSERT_LT(i, expected.size());
+    TEST_ASSERT_EQ(record.num, expected[i].num);
+    TEST_ASSERT_EQ(record.id, expected[i].id);
+    TEST_ASSERT_EQ(record.barcode, expected[i].barcode);
+    TEST_ASSERT_EQ(record.readlen, expected[i].readlen);
+    TEST_ASSERT_EQ(record.minimizers.size(), expected[i].minimizers.size());
+    for (size_t j = 0; j < record.minimizers.size(); j++) {
+      const auto& min = record.minimizers[j];
+      const auto& expected_min = expected[i].minimizers[j];
+      TEST_ASSERT_EQ(min.min_hash, expected_min.min_hash);
+      TEST_ASSERT_EQ(min.out_hash, expected_min.out_hash);
+      TEST_ASSERT_EQ(min.pos, expected_min.pos);
+      TEST_ASSERT_EQ(min.forward, expected_min.forward);
+      TEST_ASSERT_EQ(min.seq, expected_min.seq);
+      TEST_ASSERT_EQ(min.qual, expected_min.qual);
+    }
+    i++;
+  }
+  TEST_ASSERT_EQ(i, expected.size());
+  TEST_ASSERT(!reader.read());
+}
+
+int
+main()
+{
+  const auto layouts = { btllib::IndexlrBinary::RECORDS,
+                         btllib::IndexlrBinary::COLUMNAR };
+
+  std::cerr << "Testing sequences and quality strings" << std::endl;
+  {
+    const size_t k = 20, w = 10;
+    btllib::Indexlr indexlr(
+      btllib::get_dirname(__FILE__) + "/indexlr.quality.fq",
+      k,
+      w,
+      btllib::Indexlr::Flag::SEQ | btllib::Indexlr::Flag::QUAL |
+        btllib::Indexlr::Flag::SHORT_MODE);
+    std::vector<btllib::Indexlr::Record> records;
+    for (const auto record : indexlr) {
+      records.push_back(record);
+    }
+    TEST_ASSERT(!records.empty());
+    for (const auto layout : layouts) {
+      const auto path = get_random_name(64);
+      {
+        btllib::IndexlrWriter writer(
+          path,
+          k,
+          w,
+          btllib::IndexlrBinary::SEQ | btllib::IndexlrBinary::QUAL,
+          layout);
+        for (const auto& record : records) {
+          writer.write(record);
+        }
+      }
+      btllib::IndexlrReader reader(path);
+      TEST_ASSERT_EQ(reader.get_k(), k);
+      TEST_ASSERT_EQ(reader.get_w(), w);
+      TEST_ASSERT_EQ(reader.get_layout(), layout);
+      TEST_ASSERT_EQ(reader.get_fields(),
+                     unsigned(btllib::IndexlrBinary::SEQ |
+                              btllib::IndexlrBinary::QUAL));
+      check_records(records, reader);
+      std::remove(path.c_str());
+    }
+  }
+
+  std::cerr << "Testing multiple blocks" << std::endl;
+  {
+    const size_t k = 32, w = 16;
+    const auto fasta = get_random_name(64) + ".fa";
+    std::ofstream ofs(fasta);
+    const size_t read_num = btllib::IndexlrWriter::COLUMNAR_BLOCK_RECORDS + 500;
+    for (size_t i = 0; i < read_num; i++) {
+      // Some reads are too short to have minimizers
+      ofs << ">read" << i << '\n'
+          << get_random_seq(i % 10 == 0 ? k - 1 : get_random(k, 300)) << '\n';
+    }
+    ofs.close();
+
+    btllib::Indexlr indexlr(fasta, k, w, btllib::Indexlr::Flag::SHORT_MODE);
+    std::vector<btllib::Indexlr::Record> records;
+    for (const auto record : indexlr) {
+      records.push_back(record);
+    }
+    std::remove(fasta.c_str());
+    TEST_ASSERT_EQ(records.size(), read_num);
+
+    std::vector<long> sizes;
+    for (const auto layout : layouts) {
+      const auto path = get_random_name(64);
+      {
+        btllib::IndexlrWriter writer(path, k, w, 0, layout);
+        for (const auto& record : records) {
+          writer.write(record);
+        }
+      }
+      std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+      sizes.push_back(long(ifs.tellg()));
+      btllib::IndexlrReader reader(path);
+      TEST_ASSERT_EQ(reader.get_fields(), 0);
+      check_records(records, reader);
+      std::remove(path.c_str());
+    }
+    TEST_ASSERT_LT(sizes[1], sizes[0]);
+  }
+
+  return 0;
+}
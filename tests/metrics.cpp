@@ -0,0 +1,91 @@
+#include "btllib/counting_bloom_filter.hpp"
+#include "btllib/metrics.hpp"
+#include "btllib/seq_reader.hpp"
+
+#include "helpers.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+int
+main()
+{
+  PRINT_TEST_NAME("metrics aggregation")
+
+  btllib::reset_metrics();
+  TEST_ASSERT_EQ(btllib::get_metric(btllib::Metric::SEQREADER_RECORDS), 0);
+
+  // Counters of threads that have exited are kept
+  std::vector<std::unique_ptr<std::thread>> threads;
+  for (unsigned i = 0; i < 4; i++) {
+    threads.push_back(std::unique_ptr<std::thread>(new std::thread([]() {
+      for (unsigned j = 0; j < 1000; j++) {
+        btllib::metric_add(btllib::Metric::BLOOM_FILTER_QUERIES, 2);
+      }
+    })));
+  }
+  for (auto& t : threads) {
+    t->join();
+  }
+  btllib::metric_add(btllib::Metric::BLOOM_FILTER_QUERIES, 1);
+  TEST_ASSERT_EQ(btllib::get_metric(btllib::Metric::BLOOM_FILTER_QUERIES),
+                 4 * 1000 * 2 + 1);
+
+  PRINT_TEST_NAME("metrics export")
+
+  const auto json = btllib::get_metrics_json();
+  TEST_ASSERT_EQ(json.front(), '{');
+  TEST_ASSERT_NE(json.find("\"bloom_filter_queries\": 8001"),
+                 std::string::npos);
+  TEST_ASSERT_NE(json.find("\"counting_bloom_filter_cas_retries\": 0"),
+                 std::string::npos);
+
+  const auto prometheus = btllib::get_metrics_prometheus();
+  TEST_ASSERT_NE(
+    prometheus.find("# TYPE btllib_bloom_filter_queries_total counter\n"),
+    std::string::npos);
+  TEST_ASSERT_NE(prometheus.find("\nbtllib_bloom_filter_queries_total 8001\n"),
+                 std::string::npos);
+  TEST_ASSERT_EQ(
+    std::string(btllib::get_metric_name(btllib::Metric::INDEXLR_MINIMIZERS)),
+    "indexlr_minimizers");
+
+  btllib::reset_metrics();
+  TEST_ASSERT_EQ(btllib::get_metric(btllib::Metric::BLOOM_FILTER_QUERIES), 0);
+
+  if (btllib::metrics_enabled()) {
+    PRINT_TEST_NAME("metrics instrumentation")
+
+    const auto fasta = get_random_name(64) + ".fa";
+    std::ofstream ofs(fasta);
+    size_t bases = 0;
+    for (size_t i = 0; i < 500; i++) {
+      const auto seq = get_random_seq(get_random(50, 150));
+      bases += seq.size();
+      ofs << '>' << i << '\n' << seq << '\n';
+    }
+    ofs.close();
+    {
+      btllib::SeqReader reader(fasta, btllib::SeqReader::Flag::SHORT_MODE);
+      for (const auto record : reader) {
+        (void)record;
+      }
+    }
+    std::remove(fasta.c_str());
+    TEST_ASSERT_EQ(btllib::get_metric(btllib::Metric::SEQREADER_RECORDS), 500);
+    TEST_ASSERT_GT(btllib::get_metric(btllib::Metric::SEQREADER_BYTES), bases);
+    TEST_ASSERT_GT(btllib::get_metric(btllib::Metric::ORDER_QUEUE_WRITES), 0);
+
+    btllib::KmerCountingBloomFilter8 cbf(1024, 3, 5);
+    cbf.insert("ACGTACGT");
+    TEST_ASSERT_EQ(
+      btllib::get_metric(btllib::Metric::COUNTING_BLOOM_FILTER_INSERTS), 4);
+  }
+
+  return 0;
+}
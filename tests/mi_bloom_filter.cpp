@@ -0,0 +1,258 @@
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/mi_bloom_filter_builder.hpp"
+#include "btllib/nthash.hpp"
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+int
+main()
+{
+  const unsigned k = 25;
+  const std::vector<std::string> seeds = { "1111100000000000000011111",
+                                           "1111111111000001111111111",
+                                           "1111111111111111111111111" };
+  const std::vector<std::string> refs = { get_random_seq(20000),
+                                          get_random_seq(20000),
+                                          get_random_seq(20000) };
+
+  const auto fasta = get_random_name(64) + ".fa";
+  std::ofstream ofs(fasta);
+  for (size_t i = 0; i < refs.size(); i++) {
+    ofs << '>' << i + 1 << '\n' << refs[i] << '\n';
+  }
+  ofs.close();
+
+  btllib::MIBloomFilterBuilder<uint32_t> builder(
+    seeds.size(), k, 0.5, 3, seeds);
+  builder.add_source(fasta, [](const btllib::SeqReader::Record& record) {
+    return uint32_t(std::stoul(record.id));
+  });
+  const auto filter = builder.build();
+  std::remove(fasta.c_str());
+
+  const unsigned hash_num = filter->get_hash_num();
+
+  std::cerr << "Testing caller buffer queries" << std::endl;
+  std::vector<uint64_t> batch_hashes;
+  for (const auto& query : { refs[0].substr(0, 1000), get_random_seq(1000) }) {
+    btllib::SeedNtHash nthash(query, seeds, 1, k);
+    std::vector<uint32_t> values(hash_num);
+    std::vector<uint64_t> ranks(hash_num);
+    std::unique_ptr<bool[]> hits(new bool[hash_num]);
+    std::vector<bool> hits_vector(hash_num);
+    std::vector<uint64_t> ranks_vector(hash_num);
+    while (nthash.roll()) {
+      bool saturated = true, saturated_buffer = true;
+      const auto expected = filter->at(nthash.hashes(), saturated);
+      const bool found =
+        filter->at(nthash.hashes(), values.data(), saturated_buffer);
+      TEST_ASSERT_EQ(found, !expected.empty());
+      TEST_ASSERT_EQ(saturated, saturated_buffer);
+      if (found) {
+        TEST_ASSERT(values == expected);
+      }
+
+      filter->get_rank_pos(nthash.hashes(), ranks.data());
+      TEST_ASSERT(ranks == filter->get_rank_pos(nthash.hashes()));
+      filter->get_data(ranks.data(), values.data());
+      TEST_ASSERT(values == filter->get_data(ranks));
+
+      TEST_ASSERT_EQ(
+        filter->at_rank(nthash.hashes(), ranks.data(), hits.get(), hash_num),
+        filter->at_rank(
+          nthash.hashes(), ranks_vector, hits_vector, hash_num));
+      for (unsigned i = 0; i < hash_num; i++) {
+        TEST_ASSERT_EQ(hits[i], hits_vector[i]);
+      }
+
+      batch_hashes.insert(
+        batch_hashes.end(), nthash.hashes(), nthash.hashes() + hash_num);
+    }
+  }
+
+  std::cerr << "Testing batched queries" << std::endl;
+  const size_t count = batch_hashes.size() / hash_num;
+  std::vector<uint32_t> batch_values(batch_hashes.size());
+  std::vector<uint64_t> batch_ranks(batch_hashes.size());
+  const size_t found = filter->at_batch(
+    batch_hashes.data(), count, batch_values.data(), batch_ranks.data());
+  size_t expected_found = 0;
+  for (size_t i = 0; i < count; i++) {
+    const uint64_t* hashes = batch_hashes.data() + i * hash_num;
+    bool all_set = true;
+    for (unsigned j = 0; j < hash_num; j++) {
+      const auto rank = filter->get_rank_pos(hashes[j]);
+      if (batch_ranks[i * hash_num + j] == uint64_t(-1)) {
+        TEST_ASSERT_EQ(batch_values[i * hash_num + j], 0);
+        all_set = false;
+      } else {
+        TEST_ASSERT_EQ(batch_ranks[i * hash_num + j], rank);
+        TEST_ASSERT_EQ(batch_values[i * hash_num + j],
+                       filter->get_data(rank));
+      }
+    }
+    expected_found += all_set ? 1 : 0;
+  }
+  TEST_ASSERT_EQ(found, expected_found);
+  TEST_ASSERT_GE(found, 1000 - k + 1);
+
+  std::cerr << "Testing read classification" << std::endl;
+  btllib::MIBloomFilter<uint32_t>::QueryBuffer buffer;
+  std::vector<size_t> counts(refs.size() + 1);
+  btllib::SeedNtHash nthash(refs[0], seeds, 1, k);
+  for (int i = 0; i < 100; i++) {
+    const size_t ref = get_random(0, refs.size() - 1);
+    const size_t pos = get_random(0, refs[ref].size() - 150);
+    const auto read = refs[ref].substr(pos, 150);
+    std::fill(counts.begin(), counts.end(), 0);
+    nthash.change_seq(read);
+    TEST_ASSERT_EQ(filter->classify(nthash, counts, buffer), ref + 1);
+    TEST_ASSERT_GT(counts[ref + 1], 0);
+
+    std::fill(counts.begin(), counts.end(), 0);
+    TEST_ASSERT_EQ(filter->classify(read, counts, buffer), ref + 1);
+  }
+  // Hits accumulate across calls, and the best ID is taken over all of them
+  std::fill(counts.begin(), counts.end(), 0);
+  counts[1] = 1000;
+  TEST_ASSERT_EQ(filter->classify(refs[1].substr(0, 150), counts, buffer), 1);
+  TEST_ASSERT_GT(counts[2], 0);
+  TEST_ASSERT_EQ(filter->classify(refs[1].substr(150, 150), counts, buffer),
+                 1);
+  counts[1] = 0;
+  TEST_ASSERT_EQ(filter->classify(refs[1].substr(300, 150), counts, buffer),
+                 2);
+  // A random read only hits frames by chance, far fewer than a true one
+  std::fill(counts.begin(), counts.end(), 0);
+  filter->classify(get_random_seq(150), counts, buffer);
+  for (size_t id = 1; id < counts.size(); id++) {
+    TEST_ASSERT_LT(counts[id], 60);
+  }
+
+  std::cerr << "Testing insertion and placement" << std::endl;
+  {
+    const unsigned element_num = 2000, element_hash_num = 4;
+    std::vector<uint64_t> elements;
+    for (unsigned i = 0; i < element_num * element_hash_num; i++) {
+      elements.push_back(
+        uint64_t(get_random(0, std::numeric_limits<int>::max())) * 1000003);
+    }
+    sdsl::bit_vector bv(btllib::MIBloomFilter<uint32_t>::calc_optimal_size(
+      element_num, element_hash_num, 0.5));
+    for (unsigned i = 0; i < element_num; i++) {
+      btllib::MIBloomFilter<uint32_t>::insert(
+        bv, elements.data() + i * element_hash_num, element_hash_num);
+    }
+    // The filter takes over the bit vector it is given
+    sdsl::bit_vector bv_placed(bv), bv_placed_reverse(bv);
+    btllib::MIBloomFilter<uint32_t> inserted(element_hash_num, k, bv);
+    btllib::MIBloomFilter<uint32_t> placed(element_hash_num, k, bv_placed);
+    btllib::MIBloomFilter<uint32_t> placed_reverse(
+      element_hash_num, k, bv_placed_reverse);
+    for (unsigned i = 0; i < element_num; i++) {
+      const uint64_t* hashes = elements.data() + i * element_hash_num;
+      const uint32_t id = i % 7 + 1;
+      if (inserted.insert(hashes, id, 1)) {
+        bool saturated = true;
+        const auto ids = inserted.at(hashes, saturated);
+        TEST_ASSERT(std::find(ids.begin(), ids.end(), id) != ids.end());
+      }
+      placed.place(hashes, id);
+    }
+    for (unsigned i = element_num; i > 0; i--) {
+      placed_reverse.place(elements.data() + (i - 1) * element_hash_num,
+                           (i - 1) % 7 + 1);
+    }
+    for (size_t rank = 0; rank < placed.get_pop(); rank++) {
+      TEST_ASSERT_EQ(placed.get_data(rank), placed_reverse.get_data(rank));
+      TEST_ASSERT_NE(placed.get_data(rank), 0);
+    }
+  }
+
+  std::cerr << "Testing single file and legacy storage" << std::endl;
+  const auto path = get_random_name(64);
+  const auto legacy_path = get_random_name(64);
+  filter->save(path);
+  filter->store(legacy_path);
+  TEST_ASSERT(btllib::MIBloomFilter<uint32_t>::is_mapped_file(path));
+  TEST_ASSERT(!btllib::MIBloomFilter<uint32_t>::is_mapped_file(legacy_path));
+  {
+    btllib::MIBloomFilter<uint32_t> mapped(path);
+    btllib::MIBloomFilter<uint32_t> legacy(legacy_path);
+    for (const auto* loaded : { &mapped, &legacy }) {
+      TEST_ASSERT_EQ(loaded->size(), filter->size());
+      TEST_ASSERT_EQ(loaded->get_pop(), filter->get_pop());
+      TEST_ASSERT_EQ(loaded->get_hash_num(), hash_num);
+      TEST_ASSERT_EQ(loaded->get_kmer_size(), k);
+      TEST_ASSERT_EQ(loaded->get_pop_saturated(), filter->get_pop_saturated());
+      TEST_ASSERT(loaded->get_seed_values() == filter->get_seed_values());
+      for (size_t rank = 0; rank < filter->get_pop(); rank++) {
+        TEST_ASSERT_EQ(loaded->get_data(rank), filter->get_data(rank));
+      }
+      const auto query = refs[1].substr(0, 1000);
+      btllib::SeedNtHash nthash(query, seeds, 1, k);
+      while (nthash.roll()) {
+        TEST_ASSERT(loaded->get_rank_pos(nthash.hashes()) ==
+                    filter->get_rank_pos(nthash.hashes()));
+      }
+      std::fill(counts.begin(), counts.end(), 0);
+      TEST_ASSERT_EQ(loaded->classify(refs[2].substr(100, 150), counts, buffer),
+                     3);
+    }
+  }
+
+  std::cerr << "Testing compressed IDs" << std::endl;
+  const auto compressed_path = get_random_name(64);
+  const auto decompressed_path = get_random_name(64);
+  {
+    btllib::MIBloomFilter<uint32_t> compressed(path);
+    TEST_ASSERT(!compressed.is_compressed());
+    compressed.compress();
+    TEST_ASSERT(compressed.is_compressed());
+    // 3 IDs take 2 bits, plus the saturation and strand bits
+    TEST_ASSERT_LT(compressed.get_data_bytes(),
+                   filter->get_data_bytes() * 5 / 32 + 64);
+    compressed.save(compressed_path);
+    compressed.store(decompressed_path);
+    btllib::MIBloomFilter<uint32_t> mapped(compressed_path);
+    btllib::MIBloomFilter<uint32_t> decompressed(decompressed_path);
+    TEST_ASSERT(mapped.is_compressed());
+    TEST_ASSERT(!decompressed.is_compressed());
+    for (const auto* loaded : { &compressed, &mapped, &decompressed }) {
+      TEST_ASSERT_EQ(loaded->get_pop_saturated(), filter->get_pop_saturated());
+      for (size_t rank = 0; rank < filter->get_pop(); rank++) {
+        TEST_ASSERT_EQ(loaded->get_data(rank), filter->get_data(rank));
+      }
+      std::fill(counts.begin(), counts.end(), 0);
+      TEST_ASSERT_EQ(loaded->classify(refs[1].substr(200, 150), counts, buffer),
+                     2);
+    }
+
+    // Saving over a mapped filter leaves the mapping with the old filter
+    btllib::MIBloomFilter<uint32_t> previous(path);
+    compressed.save(path);
+    TEST_ASSERT(!std::ifstream(path + ".tmp"));
+    TEST_ASSERT(btllib::MIBloomFilter<uint32_t>(path).is_compressed());
+    TEST_ASSERT(!previous.is_compressed());
+    for (size_t rank = 0; rank < filter->get_pop(); rank++) {
+      TEST_ASSERT_EQ(previous.get_data(rank), filter->get_data(rank));
+    }
+  }
+  std::remove(compressed_path.c_str());
+  std::remove(decompressed_path.c_str());
+  std::remove((decompressed_path + ".sdsl").c_str());
+
+  std::remove(path.c_str());
+  std::remove(legacy_path.c_str());
+  std::remove((legacy_path + ".sdsl").c_str());
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include "btllib/mi_bloom_filter_builder.hpp"
+#include "btllib/nthash.hpp"
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int
+main()
+{
+  const unsigned hash_num = 3, k = 25;
+  const std::vector<std::string> seqs = { get_random_seq(1000),
+                                          get_random_seq(5000),
+                                          get_random_seq(300000) };
+
+  const auto fasta = get_random_name(64) + ".fa";
+  std::ofstream ofs(fasta);
+  for (size_t i = 0; i < seqs.size(); i++) {
+    ofs << '>' << i + 1 << '\n' << seqs[i] << '\n';
+  }
+  ofs.close();
+
+  std::vector<uint64_t> hashes;
+  for (uint64_t i = 1; i <= 1000; i++) {
+    for (unsigned j = 0; j < hash_num; j++) {
+      hashes.push_back(i * 1000003 + j * 7919);
+    }
+  }
+
+  const auto assign_id = [](const btllib::SeqReader::Record& record) {
+    return uint32_t(std::stoul(record.id));
+  };
+
+  std::cerr << "Testing MIBloomFilterBuilder" << std::endl;
+  btllib::MIBloomFilterBuilder<uint32_t> builder(hash_num, k, 0.5, 4);
+  builder.add_source(fasta, assign_id);
+  builder.add_hashes(hashes, 4);
+  const auto filter = builder.build();
+
+  size_t kmers = 1000;
+  for (const auto& seq : seqs) {
+    kmers += seq.size() - k + 1;
+  }
+  TEST_ASSERT_EQ(builder.get_expected_elements(), kmers);
+  TEST_ASSERT_EQ(filter->get_hash_num(), hash_num);
+  TEST_ASSERT_EQ(filter->get_kmer_size(), k);
+
+  const auto& coverage = builder.get_coverage();
+  TEST_ASSERT_EQ(coverage.size(), 5);
+  TEST_ASSERT_EQ(coverage[0].elements, 0);
+  for (uint32_t id = 1; id <= 4; id++) {
+    const size_t elements = id == 4 ? 1000 : seqs[id - 1].size() - k + 1;
+    TEST_ASSERT_EQ(coverage[id].elements, elements);
+    TEST_ASSERT_EQ(coverage[id].represented + coverage[id].saturated,
+                   elements);
+    TEST_ASSERT_GT(coverage[id].coverage(), 0.9);
+    TEST_ASSERT_GT(coverage[id].slots, 0);
+  }
+
+  // Every k-mer either finds its ID or is saturated
+  for (size_t i = 0; i < seqs.size(); i++) {
+    btllib::NtHash nthash(seqs[i], hash_num, k);
+    while (nthash.roll()) {
+      bool saturated = true;
+      const auto ids = filter->at(nthash.hashes(), saturated);
+      TEST_ASSERT_EQ(ids.size(), hash_num);
+      TEST_ASSERT(saturated || std::find(ids.begin(), ids.end(), i + 1) !=
+                                 ids.end());
+    }
+  }
+
+  std::cerr << "Testing MIBloomFilterBuilder with a single thread"
+            << std::endl;
+  btllib::MIBloomFilterBuilder<uint32_t> builder_single(
+    hash_num, k, 0.5, 1, std::vector<std::string>(), kmers);
+  builder_single.add_source(fasta, assign_id);
+  builder_single.add_hashes(hashes, 4);
+  const auto filter_single = builder_single.build();
+  TEST_ASSERT_EQ(filter_single->size(), filter->size());
+  TEST_ASSERT_EQ(filter_single->get_pop(), filter->get_pop());
+  // Placement does not depend on insertion order
+  for (size_t rank = 0; rank < filter->get_pop(); rank++) {
+    TEST_ASSERT_EQ(filter_single->get_data(rank), filter->get_data(rank));
+  }
+  const auto& coverage_single = builder_single.get_coverage();
+  for (uint32_t id = 1; id <= 4; id++) {
+    TEST_ASSERT_EQ(coverage_single[id].saturated, coverage[id].saturated);
+    TEST_ASSERT_EQ(coverage_single[id].slots, coverage[id].slots);
+  }
+
+  std::cerr << "Testing MIBloomFilterBuilder with spaced seeds" << std::endl;
+  const std::vector<std::string> seeds = { "1111100000000000000011111",
+                                           "1111111111000001111111111" };
+  btllib::MIBloomFilterBuilder<uint16_t> builder_seeds(
+    seeds.size(), k, 0.5, 3, seeds);
+  builder_seeds.add_source(fasta, 7);
+  const auto filter_seeds = builder_seeds.build();
+  const auto& coverage_seeds = builder_seeds.get_coverage();
+  TEST_ASSERT_EQ(coverage_seeds.size(), 8);
+  TEST_ASSERT_EQ(coverage_seeds[7].elements, kmers - 1000);
+  TEST_ASSERT_EQ(coverage_seeds[7].saturated, 0);
+
+  std::cerr << "Testing MIBloomFilterBuilder with more threads than blocks"
+            << std::endl;
+  // Records span several segments, so that every thread asks for records
+  // while the first block is still being consumed
+  std::vector<std::string> long_seqs;
+  const auto long_fasta = get_random_name(64) + ".fa";
+  std::ofstream long_ofs(long_fasta);
+  for (size_t i = 0; i < 20; i++) {
+    long_seqs.push_back(get_random_seq(10000));
+    long_ofs << '>' << i % 3 + 1 << '\n' << long_seqs.back() << '\n';
+  }
+  long_ofs.close();
+  btllib::MIBloomFilterBuilder<uint32_t> builder_many(hash_num, k, 0.5, 16);
+  builder_many.add_source(long_fasta, assign_id);
+  const auto filter_many = builder_many.build();
+  const auto& coverage_many = builder_many.get_coverage();
+  size_t many_elements = 0;
+  for (uint32_t id = 1; id <= 3; id++) {
+    many_elements += coverage_many[id].elements;
+  }
+  TEST_ASSERT_EQ(many_elements, long_seqs.size() * (10000 - k + 1));
+  for (size_t i = 0; i < long_seqs.size(); i++) {
+    btllib::NtHash nthash(long_seqs[i], hash_num, k);
+    while (nthash.roll()) {
+      bool saturated = true;
+      const auto ids = filter_many->at(nthash.hashes(), saturated);
+      TEST_ASSERT_EQ(ids.size(), hash_num);
+      TEST_ASSERT(saturated || std::find(ids.begin(), ids.end(), i % 3 + 1) !=
+                                 ids.end());
+    }
+  }
+
+  std::remove(fasta.c_str());
+  std::remove(long_fasta.c_str());
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "btllib/mi_bloom_filter_builder.hpp"
+#include "btllib/mi_bloom_filter_classifier.hpp"
+#include "btllib/seq.hpp"
+
+#include "helpers.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int
+main()
+{
+  const unsigned k = 25;
+  const std::vector<std::string> seeds = { "1111100000000000000011111",
+                                           "1111111111000001111111111",
+                                           "1111111111111111111111111" };
+  const std::vector<std::string> refs = { get_random_seq(20000),
+                                          get_random_seq(20000),
+                                          get_random_seq(20000) };
+
+  const auto ref_fasta = get_random_name(64) + ".fa";
+  std::ofstream ref_ofs(ref_fasta);
+  for (size_t i = 0; i < refs.size(); i++) {
+    ref_ofs << '>' << i + 1 << '\n' << refs[i] << '\n';
+  }
+  ref_ofs.close();
+
+  btllib::MIBloomFilterBuilder<uint32_t> builder(
+    seeds.size(), k, 0.5, 3, seeds);
+  builder.add_source(ref_fasta, [](const btllib::SeqReader::Record& record) {
+    return uint32_t(std::stoul(record.id));
+  });
+  const auto filter = builder.build();
+  std::remove(ref_fasta.c_str());
+
+  std::cerr << "Testing p-values" << std::endl;
+  using Classifier = btllib::MIBloomFilterClassifier<uint32_t>;
+  TEST_ASSERT_EQ(Classifier::calc_p_value(100, 0, 0.1), 1.0);
+  TEST_ASSERT_LT(std::abs(Classifier::calc_p_value(100, 100, 0.5) /
+                            std::pow(0.5, 100) -
+                          1.0),
+                 1e-9);
+  TEST_ASSERT_LT(std::abs(Classifier::calc_p_value(2, 1, 0.5) - 0.75), 1e-12);
+  TEST_ASSERT_LT(std::abs(Classifier::calc_p_value(10000, 1, 0.5) - 1.0),
+                 1e-12);
+  TEST_ASSERT_LT(std::abs(Classifier::calc_p_value(100, 50, 0.5) - 0.5397946),
+                 1e-6);
+  TEST_ASSERT_LT(Classifier::calc_p_value(1000, 900, 0.1), 1e-300);
+
+  // Reads alternate between references and strands, every tenth is random
+  const size_t read_num = 1000, read_len = 150;
+  std::vector<size_t> read_refs;
+  const auto read_fasta = get_random_name(64) + ".fa";
+  std::ofstream read_ofs(read_fasta);
+  for (size_t i = 0; i < read_num; i++) {
+    std::string read;
+    if (i % 10 == 9) {
+      read = get_random_seq(read_len);
+      read_refs.push_back(0);
+    } else {
+      const size_t ref = i % refs.size();
+      const size_t pos = get_random(0, refs[ref].size() - read_len);
+      read = refs[ref].substr(pos, read_len);
+      if (i % 2 == 1) {
+        read = btllib::get_reverse_complement(read);
+      }
+      read_refs.push_back(ref + 1);
+    }
+    read_ofs << ">read" << i << '\n' << read << '\n';
+  }
+  read_ofs.close();
+
+  std::cerr << "Testing MIBloomFilterClassifier" << std::endl;
+  for (const unsigned threads : { 1, 4 }) {
+    Classifier classifier(*filter, read_fasta, threads);
+    const auto& frame_probs = classifier.get_frame_probs();
+    TEST_ASSERT_EQ(frame_probs.size(), refs.size() + 1);
+    for (size_t id = 1; id < frame_probs.size(); id++) {
+      TEST_ASSERT_GT(frame_probs[id], 0.0);
+      TEST_ASSERT_LT(frame_probs[id], 1.0);
+    }
+
+    size_t i = 0;
+    Classifier::Result result;
+    while ((result = classifier.read())) {
+      TEST_ASSERT_EQ(result.num, i);
+      TEST_ASSERT_EQ(result.id, "read" + std::to_string(i));
+      TEST_ASSERT_EQ(result.frames, read_len - k + 1);
+      if (read_refs[i] == 0) {
+        TEST_ASSERT_GT(result.p_value, 1e-6);
+      } else {
+        TEST_ASSERT_EQ(result.best_id, read_refs[i]);
+        TEST_ASSERT_LT(result.p_value, 1e-10);
+        TEST_ASSERT(!result.ids.empty());
+        TEST_ASSERT_EQ(result.ids.front().id, result.best_id);
+        TEST_ASSERT_EQ(result.ids.front().hits(), result.hits);
+        for (const auto& id_hits : result.ids) {
+          TEST_ASSERT_LE(id_hits.hits(), result.hits);
+        }
+      }
+      i++;
+    }
+    TEST_ASSERT_EQ(i, read_num);
+    TEST_ASSERT(!classifier.read());
+  }
+
+  std::cerr << "Testing early close" << std::endl;
+  {
+    Classifier classifier(*filter, read_fasta, 3);
+    TEST_ASSERT(classifier.read());
+    classifier.close();
+    TEST_ASSERT(!classifier.read());
+  }
+
+  std::remove(read_fasta.c_str());
+
+  return 0;
+}
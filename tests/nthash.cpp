@@ -174,6 +174,34 @@ main()
     TEST_ASSERT_EQ(positions.size(), i)
   }
 
+  {
+    PRINT_TEST_NAME("batch rolling")
+
+    std::string seq = "ACGTACACTGGACTGAGTCTNACGTACACTGGAC";
+    const unsigned h = 3, k = 7;
+    btllib::NtHash nthash(seq, h, k);
+    btllib::NtHash nthash_batch(seq, h, k);
+
+    std::vector<uint64_t> batch_hashes(seq.size() * h), batch_positions;
+    batch_positions.resize(seq.size());
+    size_t count = 0;
+    size_t n = 0;
+    while ((n = nthash_batch.roll_batch(batch_hashes.data() + count * h,
+                                        batch_positions.data() + count,
+                                        5)) > 0) {
+      count += n;
+    }
+    size_t i = 0;
+    while (nthash.roll()) {
+      TEST_ASSERT_LT(i, count);
+      TEST_ASSERT_EQ(batch_positions[i], nthash.get_pos());
+      const uint64_t* const batch_kmer_hashes = batch_hashes.data() + i * h;
+      TEST_ASSERT_ARRAY_EQ(batch_kmer_hashes, nthash.hashes(), h);
+      i++;
+    }
+    TEST_ASSERT_EQ(i, count);
+  }
+
   {
     PRINT_TEST_NAME("base substitution")
 
@@ -0,0 +1,124 @@
+#include "btllib/order_queue.hpp"
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const size_t QUEUE_SIZE = 8;
+static const size_t BLOCK_SIZE = 4;
+static const size_t BLOCKS = 10000;
+
+template<typename Queue>
+static void
+test_queue(const unsigned producers,
+           const unsigned consumers,
+           const size_t queue_size = QUEUE_SIZE)
+{
+  Queue queue(queue_size, BLOCK_SIZE);
+  std::atomic<size_t> next_num{ 0 };
+  std::vector<std::vector<size_t>> read_nums(consumers);
+
+  std::vector<std::unique_ptr<std::thread>> threads;
+  for (unsigned i = 0; i < producers; i++) {
+    threads.push_back(std::unique_ptr<std::thread>(new std::thread([&]() {
+      typename Queue::Block block(BLOCK_SIZE);
+      size_t num;
+      while ((num = next_num++) < BLOCKS) {
+        block.num = num;
+        block.count = 1;
+        block.data[0] = num * 2;
+        queue.write(block);
+      }
+    })));
+  }
+  for (unsigned i = 0; i < consumers; i++) {
+    threads.push_back(
+      std::unique_ptr<std::thread>(new std::thread([&, i]() {
+        typename Queue::Block block(BLOCK_SIZE);
+        for (size_t j = i; j < BLOCKS; j += consumers) {
+          queue.read(block);
+          TEST_ASSERT_EQ(block.count, size_t(1));
+          TEST_ASSERT_EQ(block.data[0], block.num * 2);
+          read_nums[i].push_back(block.num);
+        }
+      })));
+  }
+  for (auto& t : threads) {
+    t->join();
+  }
+  TEST_ASSERT_EQ(queue.elements(), size_t(0));
+
+  std::vector<size_t> all_nums;
+  for (const auto& nums : read_nums) {
+    if (consumers == 1) {
+      TEST_ASSERT(std::is_sorted(nums.begin(), nums.end()));
+    }
+    all_nums.insert(all_nums.end(), nums.begin(), nums.end());
+  }
+  std::sort(all_nums.begin(), all_nums.end());
+  TEST_ASSERT_EQ(all_nums.size(), BLOCKS);
+  for (size_t i = 0; i < all_nums.size(); i++) {
+    TEST_ASSERT_EQ(all_nums[i], i);
+  }
+
+  // Waiting readers and writers are released by close()
+  typename Queue::Block block(BLOCK_SIZE);
+  block.num = BLOCKS + QUEUE_SIZE;
+  std::thread blocked_reader([&]() { queue.read(block); });
+  std::thread blocked_writer([&]() {
+    typename Queue::Block block2(BLOCK_SIZE);
+    block2.num = BLOCKS + QUEUE_SIZE;
+    block2.count = 1;
+    queue.write(block2);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  queue.close();
+  blocked_reader.join();
+  blocked_writer.join();
+  TEST_ASSERT(queue.is_closed());
+  TEST_ASSERT_EQ(block.count, size_t(0));
+}
+
+int
+main()
+{
+  const unsigned thread_counts[][2] = { { 1, 1 }, { 4, 1 }, { 1, 4 }, { 4, 4 } };
+
+  for (const auto& tc : thread_counts) {
+    std::cerr << "Test OrderQueueMPMC with " << tc[0] << " producers and "
+              << tc[1] << " consumers" << std::endl;
+    test_queue<btllib::OrderQueueMPMC<size_t>>(tc[0], tc[1]);
+
+    std::cerr << "Test OrderQueueLockFree with " << tc[0] << " producers and "
+              << tc[1] << " consumers" << std::endl;
+    test_queue<btllib::OrderQueueLockFree<size_t>>(tc[0], tc[1]);
+
+    std::cerr << "Test OrderQueueLockFree of the smallest size with " << tc[0]
+              << " producers and " << tc[1] << " consumers" << std::endl;
+    test_queue<btllib::OrderQueueLockFree<size_t>>(tc[0], tc[1], 2);
+  }
+
+  std::cerr << "Test OrderQueueLockFree rejecting a single slot" << std::endl;
+  {
+    const pid_t pid = fork();
+    TEST_ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      btllib::OrderQueueLockFree<size_t> queue(1, BLOCK_SIZE);
+      std::_Exit(0);
+    }
+    int status = 0;
+    TEST_ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    TEST_ASSERT(WIFEXITED(status));
+    TEST_ASSERT_EQ(WEXITSTATUS(status), EXIT_FAILURE);
+  }
+
+  return 0;
+}
@@ -0,0 +1,189 @@
+#include "btllib/executor.hpp"
+#include "btllib/random_seq_generator.hpp"
+#include "btllib/read_simulator.hpp"
+#include "btllib/seq.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/seq_writer.hpp"
+
+#include "helpers.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int
+main()
+{
+  PRINT_TEST_NAME("RandomSequenceGenerator")
+
+  {
+    btllib::RandomEngine rng1(42, 7), rng2(42, 7), rng3(42, 8);
+    const auto a = rng1(), b = rng2(), c = rng3();
+    TEST_ASSERT_EQ(a, b);
+    TEST_ASSERT_NE(a, c);
+    for (size_t i = 0; i < 1000; i++) {
+      const auto u = rng1.uniform();
+      TEST_ASSERT(u >= 0.0 && u < 1.0);
+      TEST_ASSERT_LT(rng1.below(5), 5);
+    }
+
+    using Generator = btllib::RandomSequenceGenerator;
+    Generator dna(Generator::SequenceType::DNA);
+    const auto seq = dna.generate(1000);
+    TEST_ASSERT_EQ(seq.size(), 1000);
+    TEST_ASSERT_EQ(seq.find_first_not_of("ACGT"), std::string::npos);
+    for (const char c : std::string("ACGT")) {
+      TEST_ASSERT_NE(seq.find(c), std::string::npos);
+    }
+
+    Generator masked(Generator::SequenceType::DNA, Generator::Masking::HARD);
+    const auto masked_seq = masked.generate(1000);
+    TEST_ASSERT_EQ(masked_seq.find_first_not_of("ACGTN"), std::string::npos);
+    TEST_ASSERT_NE(masked_seq.find('N'), std::string::npos);
+
+    Generator seeded1(Generator::SequenceType::PROTEIN,
+                      Generator::Masking::SOFT,
+                      123);
+    Generator seeded2(Generator::SequenceType::PROTEIN,
+                      Generator::Masking::SOFT,
+                      123);
+    const auto first = seeded1.generate(77);
+    TEST_ASSERT_EQ(first, seeded2.generate(77));
+    TEST_ASSERT_NE(first, seeded1.generate(77));
+  }
+
+  PRINT_TEST_NAME("ReadSimulator without errors")
+
+  const std::vector<std::string> references = { get_random_seq(5000),
+                                                get_random_seq(20),
+                                                get_random_seq(3000) };
+  {
+    btllib::ReadSimulator simulator(
+      references, btllib::ReadLengthDistribution::uniform(50, 150), 1);
+    btllib::SeqReader::Record record;
+    size_t reverse = 0;
+    for (size_t i = 0; i < 1000; i++) {
+      simulator.simulate(i, record);
+      TEST_ASSERT_EQ(record.id, std::to_string(i + 1));
+      TEST_ASSERT_EQ(record.seq.size(), record.qual.size());
+
+      const auto colon1 = record.comment.find(':');
+      const auto dash = record.comment.find('-');
+      const auto colon2 = record.comment.rfind(':');
+      const auto ref = std::stoul(record.comment.substr(0, colon1));
+      const auto start = std::stoul(record.comment.substr(colon1 + 1));
+      const auto end = std::stoul(record.comment.substr(dash + 1));
+      const auto& reference = references[ref];
+      TEST_ASSERT_LE(end, reference.size());
+      TEST_ASSERT_EQ(end - start, record.seq.size());
+      if (ref != 1) {
+        TEST_ASSERT_GE(record.seq.size(), 50);
+        TEST_ASSERT_LE(record.seq.size(), 150);
+      }
+
+      auto origin = reference.substr(start, end - start);
+      if (record.comment[colon2 + 1] == '-') {
+        btllib::reverse_complement(origin);
+        reverse++;
+      }
+      TEST_ASSERT_EQ(record.seq, origin);
+      TEST_ASSERT_EQ(record.qual.find_first_not_of(
+                       btllib::ReadSimulator::QUAL_CORRECT),
+                     std::string::npos);
+    }
+    TEST_ASSERT_GT(reverse, 0);
+    TEST_ASSERT_LT(reverse, 1000);
+  }
+
+  PRINT_TEST_NAME("ReadSimulator with errors")
+
+  {
+    btllib::ReadSimulator simulator(
+      references,
+      btllib::ReadLengthDistribution::log_normal(200, 50),
+      7,
+      0.02,
+      0.01,
+      0.01);
+    btllib::SeqReader::Record record1, record2;
+    size_t errors = 0, bases = 0;
+    for (size_t i = 0; i < 500; i++) {
+      simulator.simulate(i, record1);
+      simulator.simulate(i, record2);
+      TEST_ASSERT_EQ(record1.seq, record2.seq);
+      TEST_ASSERT_EQ(record1.comment, record2.comment);
+      for (const char q : record1.qual) {
+        errors += q == btllib::ReadSimulator::QUAL_ERROR ? 1 : 0;
+      }
+      bases += record1.seq.size();
+    }
+    TEST_ASSERT_GT(errors, 0);
+    TEST_ASSERT_LT(errors, bases / 10);
+  }
+
+  PRINT_TEST_NAME("ReadSimulator output")
+
+  {
+    btllib::ReadSimulator simulator(
+      references, btllib::ReadLengthDistribution::normal(100, 10), 99, 0.01);
+    std::vector<std::string> outputs;
+    for (const unsigned threads : { 1U, 4U }) {
+      btllib::Executor executor(threads);
+      const auto path = get_random_name(64) + ".fq";
+      size_t bases = 0;
+      {
+        btllib::SeqWriter writer(path, btllib::SeqWriter::FASTQ);
+        bases = simulator.write(writer, 5000, 10, executor);
+      }
+      std::string output;
+      size_t num = 0, read_bases = 0;
+      {
+        btllib::SeqReader reader(path, btllib::SeqReader::Flag::SHORT_MODE);
+        for (const auto record : reader) {
+          TEST_ASSERT_EQ(record.id, std::to_string(num + 11));
+          output += record.seq + '\n' + record.qual + '\n';
+          read_bases += record.seq.size();
+          num++;
+        }
+      }
+      std::remove(path.c_str());
+      TEST_ASSERT_EQ(num, 5000);
+      TEST_ASSERT_EQ(read_bases, bases);
+      outputs.push_back(output);
+    }
+    TEST_ASSERT(outputs[0] == outputs[1]);
+  }
+
+  PRINT_TEST_NAME("ReadSimulator with short reads and many deletions")
+
+  {
+    btllib::ReadSimulator simulator(
+      references, btllib::ReadLengthDistribution::normal(2, 1), 5, 0, 0, 0.9);
+    btllib::SeqReader::Record record;
+    for (size_t i = 0; i < 1000; i++) {
+      simulator.simulate(i, record);
+      TEST_ASSERT_GE(record.seq.size(), 1);
+      TEST_ASSERT_EQ(record.seq.size(), record.qual.size());
+    }
+
+    btllib::Executor executor(2);
+    const auto path = get_random_name(64) + ".fq";
+    {
+      btllib::SeqWriter writer(path, btllib::SeqWriter::FASTQ);
+      simulator.write(writer, 1000, 0, executor);
+    }
+    size_t num = 0;
+    {
+      btllib::SeqReader reader(path, btllib::SeqReader::Flag::SHORT_MODE);
+      for (const auto record : reader) {
+        TEST_ASSERT_GE(record.seq.size(), 1);
+        num++;
+      }
+    }
+    std::remove(path.c_str());
+    TEST_ASSERT_EQ(num, 1000);
+  }
+
+  return 0;
+}
@@ -1,7 +1,10 @@
 #include "btllib/seq.hpp"
 #include "helpers.hpp"
 
+#include <algorithm>
+#include <iostream>
 #include <string>
+#include <vector>
 
 int
 main()
@@ -9,5 +12,80 @@ main()
   std::string seq = "ACGTACACTGGACTGAGTCT";
   std::string rc = "AGACTCAGTCCAGTGTACGT";
   TEST_ASSERT_EQ(btllib::get_reverse_complement(seq), rc);
+
+  // Every instruction set has to give the same results as the scalar code,
+  // for lengths around the vector widths
+  const auto supported = btllib::get_simd_level();
+  const std::string iupac = "ACGTUNRYSWKMBDHVacgtunryswkmbdhv-.";
+  for (const auto level : { btllib::SimdLevel::SCALAR,
+                            btllib::SimdLevel::SSE4,
+                            btllib::SimdLevel::AVX2,
+                            btllib::SimdLevel::AVX512 }) {
+    if (level > supported) {
+      break;
+    }
+    btllib::set_simd_level(level);
+    TEST_ASSERT(btllib::get_simd_level() == level);
+    PRINT_TEST_NAME("sequence kernels at SIMD level " +
+                    std::to_string(int(level)))
+
+    for (size_t len = 0; len < 300; len++) {
+      std::string s;
+      for (size_t i = 0; i < len; i++) {
+        s += iupac[get_random(0, int(iupac.size()) - 1)];
+      }
+
+      std::string expected_rc(s.rbegin(), s.rend());
+      for (auto& c : expected_rc) {
+        c = btllib::COMPLEMENTS[(unsigned char)(c)];
+      }
+      TEST_ASSERT_EQ(btllib::get_reverse_complement(s), expected_rc);
+
+      auto complemented = s;
+      btllib::complement(complemented);
+      TEST_ASSERT_EQ(std::string(complemented.rbegin(), complemented.rend()),
+                     expected_rc);
+
+      auto folded = s;
+      TEST_ASSERT_EQ(btllib::fold_case(folded), std::string::npos);
+      for (size_t i = 0; i < len; i++) {
+        TEST_ASSERT_EQ(folded[i], btllib::CAPITALS[(unsigned char)(s[i])]);
+      }
+      TEST_ASSERT_EQ(btllib::find_invalid_iupac(s), std::string::npos);
+
+      if (len > 0) {
+        auto invalid = s;
+        const size_t pos = get_random(0, int(len) - 1);
+        invalid[pos] = len % 2 == 0 ? '!' : char(0xc3);
+        TEST_ASSERT_EQ(btllib::find_invalid_iupac(invalid), pos);
+        TEST_ASSERT_EQ(btllib::fold_case(invalid), pos);
+        for (size_t i = 0; i < pos; i++) {
+          TEST_ASSERT_EQ(invalid[i], btllib::CAPITALS[(unsigned char)(s[i])]);
+        }
+      }
+
+      const size_t prefix = get_random(0, int(len));
+      const size_t suffix = get_random(0, int(len - prefix));
+      const auto unmasked = get_random_seq(len);
+      auto masked = unmasked;
+      std::transform(masked.begin(),
+                     masked.begin() + prefix,
+                     masked.begin(),
+                     [](char c) { return char(std::tolower(c)); });
+      std::transform(masked.end() - suffix,
+                     masked.end(),
+                     masked.end() - suffix,
+                     [](char c) { return char(std::tolower(c)); });
+      auto qual = std::string(len, '#');
+      for (size_t i = prefix; i < len - suffix; i++) {
+        qual[i] = 'I';
+      }
+      btllib::trim_masked(masked, qual);
+      TEST_ASSERT_EQ(masked, unmasked.substr(prefix, len - prefix - suffix));
+      TEST_ASSERT_EQ(qual, std::string(len - prefix - suffix, 'I'));
+    }
+  }
+  btllib::set_simd_level(supported);
+
   return 0;
-}
\ No newline at end of file
+}
@@ -240,6 +240,68 @@ main()
     TEST_ASSERT_EQ(i, 500);
     TEST_ASSERT_EQ(size_t(i), read_nums.size());
 
+    std::cerr << "Test larger randomly generated FASTQ file in auto mode"
+              << std::endl;
+
+    read_nums.clear();
+
+    parallel_ids.clear();
+    parallel_comments.clear();
+    parallel_seqs.clear();
+    parallel_quals.clear();
+
+    btllib::SeqReader random_reader5(random_filename,
+                                     btllib::SeqReader::Flag::AUTO_MODE);
+    TEST_ASSERT_EQ(random_reader5.get_block_size(),
+                   btllib::SeqReader::AUTO_MODE_BLOCK_SIZE);
+    TEST_ASSERT_EQ(random_reader5.get_block_bytes(),
+                   btllib::SeqReader::AUTO_MODE_BLOCK_BYTES);
+    TEST_ASSERT(random_reader5.get_queue_depth() <=
+                random_reader5.get_buffer_size());
+#pragma omp parallel shared(read_nums,                                         \
+                            parallel_ids,                                      \
+                            parallel_comments,                                 \
+                            parallel_seqs,                                     \
+                            parallel_quals,                                    \
+                            random_reader5)
+    while (true) {
+      auto block = random_reader5.read_block();
+      if (block.count == 0) {
+        break;
+      }
+      for (size_t j = 0; j < block.count; j++) {
+        const auto& record = block.data[j];
+#pragma omp critical
+        {
+          read_nums.push_back(record.num);
+          parallel_ids.push_back(record.id);
+          parallel_comments.push_back(record.comment);
+          parallel_seqs.push_back(record.seq);
+          parallel_quals.push_back(record.qual);
+        }
+      }
+    }
+    TEST_ASSERT(random_reader5.get_reader_blocked_time() >= 0);
+    TEST_ASSERT(random_reader5.get_processors_blocked_time() >= 0);
+    TEST_ASSERT(random_reader5.get_consumer_blocked_time() >= 0);
+
+    std::sort(read_nums.begin(), read_nums.end());
+
+    std::sort(parallel_ids.begin(), parallel_ids.end());
+    std::sort(parallel_comments.begin(), parallel_comments.end());
+    std::sort(parallel_seqs.begin(), parallel_seqs.end());
+    std::sort(parallel_quals.begin(), parallel_quals.end());
+
+    for (i = 0; i < parallel_ids.size(); i++) {
+      TEST_ASSERT_EQ(read_nums[i], long(i));
+      TEST_ASSERT_EQ(parallel_ids[i], generated_ids[i]);
+      TEST_ASSERT_EQ(parallel_comments[i], generated_comments[i]);
+      TEST_ASSERT_EQ(parallel_seqs[i], generated_seqs[i]);
+      TEST_ASSERT_EQ(parallel_quals[i], generated_quals[i]);
+    }
+    TEST_ASSERT_EQ(i, 500);
+    TEST_ASSERT_EQ(size_t(i), read_nums.size());
+
     std::remove(random_filename.c_str());
   }
 
@@ -1,9 +1,76 @@
+#include "btllib/bgzf.hpp"
+#include "btllib/seq.hpp"
 #include "btllib/seq_reader.hpp"
 #include "btllib/util.hpp"
 #include "helpers.hpp"
 
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
+
+static void
+append_le(std::string& s, const uint64_t val, const int bytes)
+{
+  for (int i = 0; i < bytes; i++) {
+    s += char((val >> (8 * i)) & 0xFF);
+  }
+}
+
+static std::string
+encode_alignment(const std::string& name,
+                 const uint16_t flag,
+                 const std::string& seq,
+                 const std::string& qual)
+{
+  static const std::string bases = "=ACMGRSVTWYHKDBN";
+  std::string packed_seq((seq.size() + 1) / 2, char(0));
+  for (size_t i = 0; i < seq.size(); i++) {
+    packed_seq[i / 2] =
+      char(packed_seq[i / 2] | (bases.find(seq[i]) << ((~i & 1) * 4)));
+  }
+  std::string packed_qual;
+  for (size_t i = 0; i < seq.size(); i++) {
+    packed_qual += qual.empty() ? char(0xFF) : char(qual[i] - '!');
+  }
+
+  std::string core;
+  append_le(core, uint32_t(-1), 4); // refID
+  append_le(core, uint32_t(-1), 4); // pos
+  append_le(core, name.size() + 1, 1);
+  append_le(core, 255, 1); // mapq
+  append_le(core, 4680, 2); // bin
+  append_le(core, 0, 2);    // n_cigar_op
+  append_le(core, flag, 2);
+  append_le(core, seq.size(), 4);
+  append_le(core, uint32_t(-1), 4); // next_refID
+  append_le(core, uint32_t(-1), 4); // next_pos
+  append_le(core, 0, 4);            // tlen
+  core += name + '\0' + packed_seq + packed_qual;
+
+  std::string alignment;
+  append_le(alignment, core.size(), 4);
+  return alignment + core;
+}
+
+static void
+write_bam(const std::string& path, const std::string& contents)
+{
+  std::ofstream file(path, std::ios::binary);
+  std::vector<char> block(btllib::BGZF_MAX_BLOCK_SIZE);
+  const size_t chunk = 60000;
+  for (size_t i = 0; i < contents.size(); i += chunk) {
+    const auto size = std::min(chunk, contents.size() - i);
+    file.write(block.data(),
+               long(btllib::bgzf_deflate_block(
+                 contents.data() + i, size, block.data())));
+  }
+  // End of file marker, an empty block
+  file.write(block.data(),
+             long(btllib::bgzf_deflate_block(nullptr, 0, block.data())));
+}
 
 int
 main()
@@ -50,5 +117,71 @@ main()
     }
   }
 
+  std::cerr << "Test generated BAM file" << std::endl;
+  std::string contents = "BAM\1";
+  const std::string header_text = "@HD\tVN:1.6\tSO:unsorted\n";
+  append_le(contents, header_text.size(), 4);
+  contents += header_text;
+  append_le(contents, 0, 4); // n_ref
+
+  std::vector<btllib::SeqReader::Record> expected;
+  for (size_t i = 0; i < 20000; i++) {
+    const auto name = "read" + std::to_string(i);
+    const auto seq = get_random_seq(get_random(1, 301));
+    std::string qual;
+    if (i % 7 != 0) {
+      for (size_t j = 0; j < seq.size(); j++) {
+        qual += char(get_random('!', 'J'));
+      }
+    }
+    const uint16_t flags[] = { 0x0, 0x10, 0x41, 0x81, 0x51, 0x100, 0x800 };
+    const uint16_t flag = flags[i % 7];
+    contents += encode_alignment(name, flag, seq, qual);
+    if ((flag & 0x900) != 0) {
+      continue;
+    }
+    btllib::SeqReader::Record record;
+    record.id = name;
+    if ((flag & 0x40) != 0) {
+      record.id += "/1";
+    } else if ((flag & 0x80) != 0) {
+      record.id += "/2";
+    }
+    record.seq = seq;
+    record.qual = qual.empty() ? std::string(seq.size(), '"') : qual;
+    if ((flag & 0x10) != 0) {
+      btllib::reverse_complement(record.seq);
+      std::reverse(record.qual.begin(), record.qual.end());
+    }
+    expected.push_back(record);
+  }
+  const auto bam_path = get_random_name(64) + ".bam";
+  write_bam(bam_path, contents);
+
+  for (const auto flag : { btllib::SeqReader::Flag::SHORT_MODE,
+                           btllib::SeqReader::Flag::LONG_MODE,
+                           btllib::SeqReader::Flag::AUTO_MODE }) {
+    btllib::SeqReader reader(bam_path, flag);
+    TEST_ASSERT_EQ(reader.get_format(), btllib::SeqReader::Format::SAM);
+    size_t i = 0;
+    for (const auto record : reader) {
+      TEST_ASSERT_LT(i, expected.size());
+      TEST_ASSERT_EQ(record.num, i);
+      TEST_ASSERT_EQ(record.id, expected[i].id);
+      TEST_ASSERT_EQ(record.seq, expected[i].seq);
+      TEST_ASSERT_EQ(record.qual, expected[i].qual);
+      i++;
+    }
+    TEST_ASSERT_EQ(i, expected.size());
+  }
+
+  // Stopping early must not hang the decoding threads
+  {
+    btllib::SeqReader reader(bam_path, btllib::SeqReader::Flag::SHORT_MODE);
+    TEST_ASSERT(reader.read());
+  }
+
+  std::remove(bam_path.c_str());
+
   return 0;
 }
\ No newline at end of file
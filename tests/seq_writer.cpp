@@ -1,4 +1,6 @@
 #include "btllib/seq_writer.hpp"
+#include "btllib/bgzf.hpp"
+#include "btllib/indexed_seq_reader.hpp"
 #include "btllib/seq_reader.hpp"
 
 #include "helpers.hpp"
@@ -183,5 +185,50 @@ main()
     std::remove(random_filename2.c_str());
   }
 
+  std::cerr << "Test batched writing with in-process compression"
+            << std::endl;
+  std::vector<btllib::SeqReader::Record> records;
+  for (size_t s = 0; s < 3000; s++) {
+    btllib::SeqReader::Record record;
+    record.id = get_random_name(10);
+    record.comment = s % 2 == 0 ? get_random_name(20) : "";
+    record.seq = get_random_seq(get_random(100, 2000));
+    record.qual = get_random_name(record.seq.size());
+    records.push_back(record);
+  }
+  const auto compressed_filename = get_random_name(64) + ".fq.gz";
+  {
+    btllib::SeqWriter writer(
+      compressed_filename, btllib::SeqWriter::FASTQ, false, 3);
+    for (size_t s = 0; s < records.size(); s += 100) {
+      const std::vector<btllib::SeqReader::Record> batch(
+        records.begin() + long(s), records.begin() + long(s + 100));
+      writer.write_block(batch);
+    }
+  }
+  TEST_ASSERT(btllib::is_bgzf(compressed_filename));
+
+  btllib::SeqReader compressed_reader(compressed_filename,
+                                      btllib::SeqReader::Flag::LONG_MODE);
+  size_t i = 0;
+  for (const auto record : compressed_reader) {
+    TEST_ASSERT_LT(i, records.size());
+    TEST_ASSERT_EQ(record.id, records[i].id);
+    TEST_ASSERT_EQ(record.comment, records[i].comment);
+    TEST_ASSERT_EQ(record.seq, records[i].seq);
+    TEST_ASSERT_EQ(record.qual, records[i].qual);
+    i++;
+  }
+  TEST_ASSERT_EQ(i, records.size());
+
+  btllib::IndexedSeqReader indexed_reader(compressed_filename);
+  TEST_ASSERT(indexed_reader.is_compressed());
+  TEST_ASSERT_EQ(indexed_reader.get(records[1234].id).seq, records[1234].seq);
+  indexed_reader.close();
+
+  std::remove(compressed_filename.c_str());
+  std::remove((compressed_filename + ".fai").c_str());
+  std::remove((compressed_filename + ".gzi").c_str());
+
   return 0;
 }
\ No newline at end of file
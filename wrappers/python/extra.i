@@ -97,4 +97,292 @@
     PyObject *item = SWIG_NewPointerObj(new btllib::Indexlr::Minimizer((*($1))[i]), SWIGTYPE_p_btllib__Indexlr__Minimizer, SWIG_POINTER_OWN);
     PyList_SetItem($result, i, item);
   }
-%}
\ No newline at end of file
+%}
+%{
+  // The batch methods below exchange arrays through the buffer protocol, so
+  // NumPy arrays, array.array, bytes and memoryview objects all work without
+  // a NumPy dependency. Arrays are returned as memoryview objects, which
+  // numpy.asarray() wraps without a copy. The GIL is released while btllib
+  // works on the arrays, so that Python threads can run batches in parallel.
+
+  // Get a C contiguous buffer of 64-bit integers holding hash_num values per
+  // element. Returns false with a Python exception set on failure.
+  static bool btllib_get_hashes(PyObject* obj, Py_buffer* view, const unsigned hash_num, size_t* count)
+  {
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+      return false;
+    }
+    const char* format = view->format == nullptr ? "B" : view->format;
+    if (*format == '@' || *format == '=' || *format == '<') {
+      ++format;
+    }
+    if (view->itemsize != sizeof(uint64_t) || std::strlen(format) != 1 ||
+        std::strchr("QqLl", *format) == nullptr) {
+      PyErr_SetString(PyExc_TypeError, "Hash values must be a contiguous array of 64-bit integers.");
+      PyBuffer_Release(view);
+      return false;
+    }
+    const size_t values = size_t(view->len) / sizeof(uint64_t);
+    if (values % hash_num != 0) {
+      PyErr_SetString(PyExc_ValueError, "Number of hash values is not a multiple of the number of hash values per element.");
+      PyBuffer_Release(view);
+      return false;
+    }
+    *count = values / hash_num;
+    return true;
+  }
+
+  // Wrap array in a memoryview of the given struct format, of shape (rows,)
+  // or (rows, cols) if cols > 0. Steals the reference to array.
+  static PyObject* btllib_array_view(PyObject* array, const char* format, const size_t itemsize, const size_t rows, const size_t cols = 0)
+  {
+    // Views with no elements cannot be cast, so they are cast as one row and
+    // sliced
+    if (rows == 0 && PyByteArray_Resize(array, Py_ssize_t(itemsize * (cols == 0 ? 1 : cols))) != 0) {
+      Py_DECREF(array);
+      return nullptr;
+    }
+    PyObject* view = PyMemoryView_FromObject(array);
+    Py_DECREF(array);
+    if (view == nullptr) {
+      return nullptr;
+    }
+    const Py_ssize_t cast_rows = rows == 0 ? 1 : Py_ssize_t(rows);
+    PyObject* cast = cols == 0
+      ? PyObject_CallMethod(view, "cast", "s", format)
+      : PyObject_CallMethod(view, "cast", "s(nn)", format, cast_rows, Py_ssize_t(cols));
+    Py_DECREF(view);
+    if (cast == nullptr || rows > 0) {
+      return cast;
+    }
+    PyObject* empty = PySequence_GetSlice(cast, 0, 0);
+    Py_DECREF(cast);
+    return empty;
+  }
+
+  template<typename T>
+  static const char* btllib_uint_format()
+  {
+    static_assert(sizeof(unsigned short) == 2 && sizeof(unsigned) == 4, "Unexpected integer sizes.");
+    return sizeof(T) == 1 ? "B" : (sizeof(T) == 2 ? "H" : (sizeof(T) == 4 ? "I" : "Q"));
+  }
+
+  template<typename Hasher>
+  static PyObject* btllib_roll_batch(Hasher& hasher, const size_t seq_len, size_t max_kmers)
+  {
+    const size_t remaining = seq_len >= hasher.get_k() ? seq_len - hasher.get_k() + 1 : 0;
+    if (max_kmers == 0 || max_kmers > remaining) {
+      max_kmers = remaining;
+    }
+    const unsigned hash_num = hasher.get_hash_num();
+    PyObject* hashes = PyByteArray_FromStringAndSize(nullptr, Py_ssize_t(max_kmers * hash_num * sizeof(uint64_t)));
+    PyObject* positions = PyByteArray_FromStringAndSize(nullptr, Py_ssize_t(max_kmers * sizeof(uint64_t)));
+    if (hashes == nullptr || positions == nullptr) {
+      Py_XDECREF(hashes);
+      Py_XDECREF(positions);
+      return nullptr;
+    }
+    size_t count = 0;
+    Py_BEGIN_ALLOW_THREADS
+    count = hasher.roll_batch((uint64_t*)PyByteArray_AS_STRING(hashes), (uint64_t*)PyByteArray_AS_STRING(positions), max_kmers);
+    Py_END_ALLOW_THREADS
+    if (PyByteArray_Resize(hashes, Py_ssize_t(count * hash_num * sizeof(uint64_t))) != 0 ||
+        PyByteArray_Resize(positions, Py_ssize_t(count * sizeof(uint64_t))) != 0) {
+      Py_DECREF(hashes);
+      Py_DECREF(positions);
+      return nullptr;
+    }
+    PyObject* hashes_view = btllib_array_view(hashes, "Q", sizeof(uint64_t), count, hash_num);
+    PyObject* positions_view = btllib_array_view(positions, "Q", sizeof(uint64_t), count);
+    if (hashes_view == nullptr || positions_view == nullptr) {
+      Py_XDECREF(hashes_view);
+      Py_XDECREF(positions_view);
+      return nullptr;
+    }
+    return Py_BuildValue("(NN)", hashes_view, positions_view);
+  }
+
+  // Sequences of NtHash objects created from Python are kept in nthash_strings
+  static size_t btllib_nthash_seq_len(void* nthash)
+  {
+    std::unique_lock<std::mutex> lock(nthash_mutex);
+    return nthash_strings[nthash_ids[nthash]].size();
+  }
+
+  template<typename Filter>
+  static PyObject* btllib_insert_batch(Filter& filter, PyObject* hashes)
+  {
+    Py_buffer view;
+    size_t count = 0;
+    if (!btllib_get_hashes(hashes, &view, filter.get_hash_num(), &count)) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    filter.insert_batch((const uint64_t*)view.buf, count);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    Py_RETURN_NONE;
+  }
+
+  template<typename Result, typename Filter>
+  static PyObject* btllib_contains_batch(const Filter& filter, PyObject* hashes, const char* format)
+  {
+    Py_buffer view;
+    size_t count = 0;
+    if (!btllib_get_hashes(hashes, &view, filter.get_hash_num(), &count)) {
+      return nullptr;
+    }
+    PyObject* results = PyByteArray_FromStringAndSize(nullptr, Py_ssize_t(count * sizeof(Result)));
+    if (results == nullptr) {
+      PyBuffer_Release(&view);
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    filter.contains_batch((const uint64_t*)view.buf, count, (Result*)PyByteArray_AS_STRING(results));
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    return btllib_array_view(results, format, sizeof(Result), count);
+  }
+
+  // Read a block of records into a dict of contiguous arrays: "num" holds
+  // the record numbers, and each of "id", "comment", "seq" and "qual" is a
+  // bytearray of the concatenated fields, with field i at
+  // [<field>_offsets[i], <field>_offsets[i + 1]). Returns None at the end.
+  static PyObject* btllib_read_batch(btllib::SeqReader& reader)
+  {
+    using Record = btllib::SeqReader::Record;
+    static const char* const names[] = { "id", "comment", "seq", "qual" };
+    static const char* const offset_names[] = { "id_offsets", "comment_offsets", "seq_offsets", "qual_offsets" };
+    static std::string Record::* const members[] = { &Record::id, &Record::comment, &Record::seq, &Record::qual };
+    const size_t fields = sizeof(members) / sizeof(members[0]);
+
+    decltype(reader.read_block()) block(0);
+    size_t sizes[fields] = {};
+    Py_BEGIN_ALLOW_THREADS
+    block = reader.read_block();
+    for (size_t i = 0; i < block.count; ++i) {
+      for (size_t f = 0; f < fields; ++f) {
+        sizes[f] += (block.data[i].*members[f]).size();
+      }
+    }
+    Py_END_ALLOW_THREADS
+    if (block.count == 0) {
+      Py_RETURN_NONE;
+    }
+
+    PyObject* nums = PyByteArray_FromStringAndSize(nullptr, Py_ssize_t(block.count * sizeof(uint64_t)));
+    PyObject* arrays[fields] = {};
+    PyObject* offsets[fields] = {};
+    bool allocated = nums != nullptr;
+    for (size_t f = 0; f < fields; ++f) {
+      arrays[f] = PyByteArray_FromStringAndSize(nullptr, Py_ssize_t(sizes[f]));
+      offsets[f] = PyByteArray_FromStringAndSize(nullptr, Py_ssize_t((block.count + 1) * sizeof(uint64_t)));
+      allocated = allocated && arrays[f] != nullptr && offsets[f] != nullptr;
+    }
+    if (!allocated) {
+      Py_XDECREF(nums);
+      for (size_t f = 0; f < fields; ++f) {
+        Py_XDECREF(arrays[f]);
+        Py_XDECREF(offsets[f]);
+      }
+      return nullptr;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    auto* const num_data = (uint64_t*)PyByteArray_AS_STRING(nums);
+    for (size_t i = 0; i < block.count; ++i) {
+      num_data[i] = block.data[i].num;
+    }
+    for (size_t f = 0; f < fields; ++f) {
+      char* const data = PyByteArray_AS_STRING(arrays[f]);
+      auto* const offset_data = (uint64_t*)PyByteArray_AS_STRING(offsets[f]);
+      uint64_t offset = 0;
+      for (size_t i = 0; i < block.count; ++i) {
+        const std::string& field = block.data[i].*members[f];
+        offset_data[i] = offset;
+        std::memcpy(data + offset, field.data(), field.size());
+        offset += field.size();
+      }
+      offset_data[block.count] = offset;
+    }
+    Py_END_ALLOW_THREADS
+
+    PyObject* batch = PyDict_New();
+    bool ok = batch != nullptr;
+    PyObject* view = btllib_array_view(nums, "Q", sizeof(uint64_t), block.count);
+    ok = ok && view != nullptr && PyDict_SetItemString(batch, "num", view) == 0;
+    Py_XDECREF(view);
+    for (size_t f = 0; f < fields; ++f) {
+      ok = ok && PyDict_SetItemString(batch, names[f], arrays[f]) == 0;
+      Py_DECREF(arrays[f]);
+      view = btllib_array_view(offsets[f], "Q", sizeof(uint64_t), block.count + 1);
+      ok = ok && view != nullptr && PyDict_SetItemString(batch, offset_names[f], view) == 0;
+      Py_XDECREF(view);
+    }
+    if (!ok) {
+      Py_XDECREF(batch);
+      return nullptr;
+    }
+    return batch;
+  }
+%}
+
+%extend btllib::NtHash {
+  PyObject* roll_batch(size_t max_kmers = 0) {
+    return btllib_roll_batch(*$self, btllib_nthash_seq_len((void*)$self), max_kmers);
+  }
+}
+
+%extend btllib::SeedNtHash {
+  PyObject* roll_batch(size_t max_kmers = 0) {
+    return btllib_roll_batch(*$self, btllib_nthash_seq_len((void*)$self), max_kmers);
+  }
+}
+
+%extend btllib::BloomFilter {
+  PyObject* insert_batch(PyObject* hashes) {
+    return btllib_insert_batch(*$self, hashes);
+  }
+
+  PyObject* contains_batch(PyObject* hashes) {
+    return btllib_contains_batch<bool>(*$self, hashes, "?");
+  }
+}
+
+%extend btllib::KmerBloomFilter {
+  PyObject* insert_batch(PyObject* hashes) {
+    return btllib_insert_batch($self->get_bloom_filter(), hashes);
+  }
+
+  PyObject* contains_batch(PyObject* hashes) {
+    return btllib_contains_batch<bool>($self->get_bloom_filter(), hashes, "?");
+  }
+}
+
+%extend btllib::CountingBloomFilter {
+  PyObject* insert_batch(PyObject* hashes) {
+    return btllib_insert_batch(*$self, hashes);
+  }
+
+  PyObject* contains_batch(PyObject* hashes) {
+    using T = decltype($self->contains((const uint64_t*)nullptr));
+    return btllib_contains_batch<T>(*$self, hashes, btllib_uint_format<T>());
+  }
+}
+
+%extend btllib::KmerCountingBloomFilter {
+  PyObject* insert_batch(PyObject* hashes) {
+    return btllib_insert_batch($self->get_counting_bloom_filter(), hashes);
+  }
+
+  PyObject* contains_batch(PyObject* hashes) {
+    using T = decltype($self->contains((const uint64_t*)nullptr));
+    return btllib_contains_batch<T>($self->get_counting_bloom_filter(), hashes, btllib_uint_format<T>());
+  }
+}
+
+%extend btllib::SeqReader {
+  PyObject* read_batch() {
+    return btllib_read_batch(*$self);
+  }
+}